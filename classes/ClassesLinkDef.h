@@ -27,6 +27,7 @@
 
 #include "classes/DelphesModule.h"
 #include "classes/DelphesFactory.h"
+#include "classes/DelphesNeighbourIndex.h"
 
 #include "classes/SortableObject.h"
 #include "classes/DelphesClasses.h"
@@ -39,6 +40,7 @@
 
 #pragma link C++ class DelphesModule+;
 #pragma link C++ class DelphesFactory+;
+#pragma link C++ class DelphesNeighbourIndex+;
 
 #pragma link C++ class SortableObject+;
 
@@ -53,6 +55,7 @@
 #pragma link C++ class ScalarHT+;
 #pragma link C++ class Rho+;
 #pragma link C++ class Weight+;
+#pragma link C++ class Rejection+;
 #pragma link C++ class Photon+;
 #pragma link C++ class Electron+;
 #pragma link C++ class Muon+;
@@ -0,0 +1,68 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesAxisBins_h
+#define DelphesAxisBins_h
+
+/** \class DelphesAxisBins
+ *
+ *  Bins of a histogram axis, following the TH1 conventions: bin 0 and
+ *  bin n + 1 hold the underflow and the overflow. The bin search is
+ *  reduced to arithmetic for uniform binning, and NaN goes to the
+ *  underflow bin.
+ *
+ */
+
+#include "Rtypes.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+struct DelphesAxisBins
+{
+  Int_t n;
+  Bool_t uniform;
+  Double_t min, max, scale;
+  std::vector<Double_t> edges;
+
+  Int_t FindBin(Double_t x) const;
+};
+
+//------------------------------------------------------------------------------
+
+inline Int_t DelphesAxisBins::FindBin(Double_t x) const
+{
+  Double_t u;
+
+  if(uniform)
+  {
+    // clamp to [-1, n] so that underflow and overflow map to bins 0 and n + 1,
+    // NaN fails both comparisons and goes to the underflow bin
+    u = (x - min) * scale;
+    if(!(u >= -1.0)) return 0;
+    if(u > n) return n + 1;
+    return 1 + Int_t(std::floor(u));
+  }
+
+  if(x != x) return 0;
+
+  return std::upper_bound(edges.begin(), edges.end(), x) - edges.begin();
+}
+
+#endif /* DelphesAxisBins_h */
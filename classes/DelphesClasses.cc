@@ -477,11 +477,14 @@ void Candidate::Copy(TObject &obj) const
   object.ExclYmerge45 = ExclYmerge45;
   object.ExclYmerge56 = ExclYmerge56;
 
+  object.ParticleDensity = ParticleDensity;
+
   object.SoftDroppedJet = SoftDroppedJet;
   object.SoftDroppedSubJet1 = SoftDroppedSubJet1;
   object.SoftDroppedSubJet2 = SoftDroppedSubJet2;
   object.TrackCovariance = TrackCovariance;
-  object.fFactory = fFactory;
+  // a candidate created by a factory keeps it, a candidate read from a file has none
+  if(!object.fFactory) object.fFactory = fFactory;
   object.fArray = 0;
 
   // copy cluster timing info
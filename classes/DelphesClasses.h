@@ -245,6 +245,16 @@ public:
 
 //---------------------------------------------------------------------------
 
+class Rejection: public TObject
+{
+public:
+  Int_t Module; // position in the execution path of the module that rejected the event, -1 if accepted
+
+  ClassDef(Rejection, 1)
+};
+
+//---------------------------------------------------------------------------
+
 class Photon: public SortableObject
 {
 public:
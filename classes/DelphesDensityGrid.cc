@@ -0,0 +1,132 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \class DelphesDensityGrid
+ *
+ *  Particle multiplicity density map in eta-phi bins.
+ *
+ */
+
+#include "classes/DelphesDensityGrid.h"
+
+#include "TMath.h"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+DelphesDensityGrid::DelphesDensityGrid()
+{
+  vector<Double_t> bins(2);
+  bins[0] = 0.0;
+  bins[1] = 1.0;
+  SetBins(bins, bins);
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesDensityGrid::SetAxis(DelphesAxisBins &axis, const vector<Double_t> &bins)
+{
+  Int_t i;
+  Double_t width;
+
+  if(bins.size() < 2)
+  {
+    stringstream message;
+    message << "at least two bin edges are required";
+    throw runtime_error(message.str());
+  }
+
+  axis.n = bins.size() - 1;
+  axis.edges = bins;
+  axis.min = bins.front();
+  axis.max = bins.back();
+
+  for(i = 0; i < axis.n; ++i)
+  {
+    if(bins[i + 1] <= bins[i])
+    {
+      stringstream message;
+      message << "bin edges must be in increasing order";
+      throw runtime_error(message.str());
+    }
+  }
+
+  // uniform binning does not need the binary search over the edges
+  width = (axis.max - axis.min) / axis.n;
+  axis.scale = 1.0 / width;
+  axis.uniform = kTRUE;
+  for(i = 0; i < axis.n; ++i)
+  {
+    if(TMath::Abs(bins[i + 1] - bins[i] - width) > 1.0e-9 * width)
+    {
+      axis.uniform = kFALSE;
+      break;
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesDensityGrid::SetBins(const vector<Double_t> &etaBins, const vector<Double_t> &phiBins)
+{
+  SetAxis(fEta, etaBins);
+  SetAxis(fPhi, phiBins);
+  fContent.assign((fEta.n + 2) * (fPhi.n + 2), 0.0);
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesDensityGrid::Clear(Option_t *option)
+{
+  fill(fContent.begin(), fContent.end(), 0.0);
+}
+
+//------------------------------------------------------------------------------
+
+Double_t DelphesDensityGrid::GetBinWidth(const DelphesAxisBins &axis, Int_t bin)
+{
+  if(bin < 1) bin = 1;
+  if(bin > axis.n) bin = axis.n;
+  return axis.edges[bin] - axis.edges[bin - 1];
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesDensityGrid::Normalize()
+{
+  Int_t i, j;
+  Double_t width;
+  Double_t *content = &fContent[0];
+
+  for(i = 0; i < fEta.n + 2; ++i)
+  {
+    width = GetBinWidth(fEta, i);
+    for(j = 0; j < fPhi.n + 2; ++j)
+    {
+      *content /= width * GetBinWidth(fPhi, j);
+      ++content;
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,77 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesDensityGrid_h
+#define DelphesDensityGrid_h
+
+/** \class DelphesDensityGrid
+ *
+ *  Particle multiplicity density map in eta-phi bins.
+ *
+ *  ParticleDensity exports the map of each event as the only object
+ *  of its DensityMapArray, other modules can read it with
+ *
+ *    array = ImportArray("ParticleDensity/densityMap");
+ *    grid = static_cast<const DelphesDensityGrid *>(array->At(0));
+ *    density = grid->GetDensity(eta, phi);
+ *
+ *  Bins follow the TH2 conventions: bin 0 and bin n + 1 hold
+ *  the underflow and the overflow, and take the width of the
+ *  adjacent bin when the content is normalised.
+ *
+ */
+
+#include "classes/DelphesAxisBins.h"
+
+#include "TObject.h"
+
+#include <vector>
+
+class DelphesDensityGrid: public TObject
+{
+public:
+  DelphesDensityGrid();
+
+  void SetBins(const std::vector<Double_t> &etaBins, const std::vector<Double_t> &phiBins);
+
+  void Clear(Option_t *option = "");
+
+  Int_t FindBin(Double_t eta, Double_t phi) const { return fEta.FindBin(eta) * (fPhi.n + 2) + fPhi.FindBin(phi); }
+
+  void Fill(Double_t eta, Double_t phi) { fContent[FindBin(eta, phi)] += 1.0; }
+
+  void Fill(Int_t bin) { fContent[bin] += 1.0; }
+
+  // divide the content of each bin by its area
+  void Normalize();
+
+  Double_t GetBinContent(Int_t bin) const { return fContent[bin]; }
+
+  Double_t GetDensity(Double_t eta, Double_t phi) const { return fContent[FindBin(eta, phi)]; }
+
+private:
+  static void SetAxis(DelphesAxisBins &axis, const std::vector<Double_t> &bins);
+
+  static Double_t GetBinWidth(const DelphesAxisBins &axis, Int_t bin);
+
+  DelphesAxisBins fEta, fPhi;
+
+  std::vector<Double_t> fContent;
+};
+
+#endif /* DelphesDensityGrid_h */
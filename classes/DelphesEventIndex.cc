@@ -0,0 +1,260 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \class DelphesEventIndex
+ *
+ *  Event number to byte offset index of text event files (HepMC, LHEF).
+ *
+ *  The index is stored in a side-car file named after the input file
+ *  with the .idx suffix. It contains the size of the indexed file,
+ *  the number of events and the offset of each event, all in XDR format.
+ *
+ */
+
+#include "classes/DelphesEventIndex.h"
+
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "classes/DelphesXDRReader.h"
+#include "classes/DelphesXDRWriter.h"
+
+using namespace std;
+
+static const int kBufferSize = 1000000;
+
+//------------------------------------------------------------------------------
+
+DelphesEventIndex::DelphesEventIndex(const char *marker, bool lineStart) :
+  fMarker(marker), fLineStart(lineStart), fFileSize(0), fBuffer(0)
+{
+  fBuffer = new char[kBufferSize];
+}
+
+//------------------------------------------------------------------------------
+
+DelphesEventIndex::~DelphesEventIndex()
+{
+  if(fBuffer) delete[] fBuffer;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesEventIndex::Open(FILE *inputFile, const char *fileName)
+{
+  int64_t fileSize;
+  string indexName(fileName);
+
+  indexName += ".idx";
+
+  fseeko(inputFile, 0L, SEEK_END);
+  fileSize = ftello(inputFile);
+  fseeko(inputFile, 0L, SEEK_SET);
+
+  if(Read(indexName.c_str(), fileSize)) return;
+
+  cout << "** Indexing " << fileName << endl;
+
+  Build(inputFile);
+
+  // the index is only a cache, failing to store it is not an error
+
+  try
+  {
+    Write(indexName.c_str());
+  }
+  catch(runtime_error &e)
+  {
+    cerr << "** WARNING: " << e.what() << endl;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesEventIndex::Build(FILE *inputFile)
+{
+  int64_t offset;
+  size_t length, markerLength;
+  bool atLineStart, found;
+
+  fOffsets.clear();
+
+  markerLength = strlen(fMarker);
+
+  // lines longer than the buffer are read in several pieces,
+  // only the first piece of each line is matched against the marker
+
+  fseeko(inputFile, 0L, SEEK_SET);
+
+  offset = 0;
+  atLineStart = true;
+  while(fgets(fBuffer, kBufferSize, inputFile))
+  {
+    length = strlen(fBuffer);
+
+    if(atLineStart)
+    {
+      if(fLineStart)
+      {
+        found = strncmp(fBuffer, fMarker, markerLength) == 0;
+      }
+      else
+      {
+        found = strstr(fBuffer, fMarker) != 0;
+      }
+
+      if(found) fOffsets.push_back(offset);
+    }
+
+    atLineStart = length > 0 && fBuffer[length - 1] == '\n';
+    offset += length;
+  }
+
+  fFileSize = offset;
+
+  clearerr(inputFile);
+  fseeko(inputFile, 0L, SEEK_SET);
+}
+
+//------------------------------------------------------------------------------
+
+bool DelphesEventIndex::Read(const char *indexName, int64_t fileSize)
+{
+  FILE *indexFile;
+  DelphesXDRReader reader;
+  int64_t i, size, entries, offset;
+  uint8_t header[16];
+  vector<uint8_t> buffer;
+
+  indexFile = fopen(indexName, "rb");
+  if(!indexFile) return false;
+
+  fseeko(indexFile, 0L, SEEK_END);
+  size = ftello(indexFile);
+  fseeko(indexFile, 0L, SEEK_SET);
+
+  if(size < 16 || fread(header, 1, 16, indexFile) != 16)
+  {
+    fclose(indexFile);
+    return false;
+  }
+
+  reader.SetBuffer(header);
+  reader.ReadValue(&fFileSize, 8);
+  reader.ReadValue(&entries, 8);
+
+  // an index of a different file or a truncated index is ignored
+
+  if(fFileSize != fileSize || entries < 0 || size != 16 + entries * 8)
+  {
+    fclose(indexFile);
+    return false;
+  }
+
+  buffer.resize(entries * 8);
+  if(entries > 0 && fread(&buffer[0], 1, entries * 8, indexFile) != size_t(entries * 8))
+  {
+    fclose(indexFile);
+    return false;
+  }
+
+  fclose(indexFile);
+
+  fOffsets.resize(entries);
+  if(entries > 0) reader.SetBuffer(&buffer[0]);
+  for(i = 0; i < entries; ++i)
+  {
+    reader.ReadValue(&offset, 8);
+    fOffsets[i] = offset;
+  }
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesEventIndex::Write(const char *indexName)
+{
+  stringstream message;
+  FILE *indexFile;
+  DelphesXDRWriter writer;
+  int64_t i, entries, offset;
+  string tempName;
+
+  // write to a temporary file first, so that jobs sharing
+  // the same input file never read an incomplete index
+
+  message << indexName << "." << getpid();
+  tempName = message.str();
+  message.str("");
+
+  indexFile = fopen(tempName.c_str(), "wb");
+  if(!indexFile)
+  {
+    message << "can't create index file " << indexName;
+    throw runtime_error(message.str());
+  }
+
+  entries = fOffsets.size();
+
+  writer.SetFile(indexFile);
+  writer.WriteValue(&fFileSize, 8);
+  writer.WriteValue(&entries, 8);
+  for(i = 0; i < entries; ++i)
+  {
+    offset = fOffsets[i];
+    writer.WriteValue(&offset, 8);
+  }
+
+  if(fclose(indexFile) != 0 || rename(tempName.c_str(), indexName) != 0)
+  {
+    remove(tempName.c_str());
+    message << "can't write index file " << indexName;
+    throw runtime_error(message.str());
+  }
+}
+
+//------------------------------------------------------------------------------
+
+int64_t DelphesEventIndex::GetOffset(int64_t entry) const
+{
+  if(entry < 0) return 0;
+  if(entry >= GetEntries()) return fFileSize;
+  return fOffsets[entry];
+}
+
+//------------------------------------------------------------------------------
+
+int64_t DelphesEventIndex::Seek(FILE *inputFile, int64_t entry) const
+{
+  // returns the number of events skipped
+
+  if(entry > GetEntries()) entry = GetEntries();
+
+  fseeko(inputFile, GetOffset(entry), SEEK_SET);
+
+  return entry;
+}
+
+//------------------------------------------------------------------------------
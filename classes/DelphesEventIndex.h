@@ -0,0 +1,64 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesEventIndex_h
+#define DelphesEventIndex_h
+
+/** \class DelphesEventIndex
+ *
+ *  Event number to byte offset index of text event files (HepMC, LHEF).
+ *
+ *  The index is stored in a side-car file named after the input file
+ *  with the .idx suffix. It contains the size of the indexed file,
+ *  the number of events and the offset of each event, all in XDR format.
+ *
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <vector>
+
+class DelphesEventIndex
+{
+public:
+  DelphesEventIndex(const char *marker, bool lineStart = true);
+  ~DelphesEventIndex();
+
+  void Open(FILE *inputFile, const char *fileName);
+
+  void Build(FILE *inputFile);
+  bool Read(const char *indexName, int64_t fileSize);
+  void Write(const char *indexName);
+
+  int64_t GetEntries() const { return fOffsets.size(); }
+  int64_t GetOffset(int64_t entry) const;
+
+  int64_t Seek(FILE *inputFile, int64_t entry) const;
+
+private:
+  const char *fMarker;
+  bool fLineStart;
+
+  int64_t fFileSize;
+  std::vector<int64_t> fOffsets;
+
+  char *fBuffer;
+};
+
+#endif // DelphesEventIndex_h
@@ -0,0 +1,846 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \class DelphesExpression
+ *
+ *  Parser and evaluator of the arithmetic expressions used in the
+ *  configuration files, without going through the interpreter.
+ *
+ */
+
+#include "classes/DelphesExpression.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+static Double_t Min(Double_t a, Double_t b) { return a < b ? a : b; }
+static Double_t Max(Double_t a, Double_t b) { return a > b ? a : b; }
+
+struct TFunction1
+{
+  const char *name;
+  Double_t (*function)(Double_t);
+};
+
+struct TFunction2
+{
+  const char *name;
+  Double_t (*function)(Double_t, Double_t);
+};
+
+static const TFunction1 kFunctions1[] = {
+  {"abs", fabs}, {"fabs", fabs}, {"TMath::Abs", fabs},
+  {"sqrt", sqrt}, {"TMath::Sqrt", sqrt},
+  {"exp", exp}, {"TMath::Exp", exp},
+  {"log", log}, {"TMath::Log", log},
+  {"log10", log10}, {"TMath::Log10", log10},
+  {"sin", sin}, {"TMath::Sin", sin},
+  {"cos", cos}, {"TMath::Cos", cos},
+  {"tan", tan}, {"TMath::Tan", tan},
+  {"asin", asin}, {"TMath::ASin", asin},
+  {"acos", acos}, {"TMath::ACos", acos},
+  {"atan", atan}, {"TMath::ATan", atan},
+  {"sinh", sinh}, {"TMath::SinH", sinh},
+  {"cosh", cosh}, {"TMath::CosH", cosh},
+  {"tanh", tanh}, {"TMath::TanH", tanh}};
+
+static const TFunction2 kFunctions2[] = {
+  {"pow", pow}, {"TMath::Power", pow},
+  {"atan2", atan2}, {"TMath::ATan2", atan2},
+  {"min", Min}, {"TMath::Min", Min},
+  {"max", Max}, {"TMath::Max", Max}};
+
+//------------------------------------------------------------------------------
+
+class DelphesExpression::TParser
+{
+public:
+  TParser(const char *text, const vector<string> &variables, const vector<Int_t> &parameters, vector<TNode> &nodes) :
+    fIt(text), fVariables(variables), fParameters(parameters), fNodes(nodes) {}
+
+  Int_t Parse();
+
+private:
+  Int_t ParseOr();
+  Int_t ParseAnd();
+  Int_t ParseEquality();
+  Int_t ParseRelational();
+  Int_t ParseAdditive();
+  Int_t ParseMultiplicative();
+  Int_t ParseUnary();
+  Int_t ParsePower();
+  Int_t ParsePrimary();
+  Int_t ParseIdentifier();
+
+  Bool_t Accept(const char *token);
+  void Expect(const char *token);
+  void Fail();
+
+  Int_t NewNode(EOperation operation, Int_t left = -1, Int_t right = -1);
+
+  const char *fIt;
+  const vector<string> &fVariables;
+  const vector<Int_t> &fParameters;
+  vector<TNode> &fNodes;
+};
+
+//------------------------------------------------------------------------------
+
+Int_t DelphesExpression::TParser::Parse()
+{
+  Int_t node = ParseOr();
+  while(isspace(*fIt)) ++fIt;
+  if(*fIt) Fail();
+  return node;
+}
+
+//------------------------------------------------------------------------------
+
+Int_t DelphesExpression::TParser::ParseOr()
+{
+  Int_t node = ParseAnd();
+  while(Accept("||")) node = NewNode(kOr, node, ParseAnd());
+  return node;
+}
+
+//------------------------------------------------------------------------------
+
+Int_t DelphesExpression::TParser::ParseAnd()
+{
+  Int_t node = ParseEquality();
+  while(Accept("&&")) node = NewNode(kAnd, node, ParseEquality());
+  return node;
+}
+
+//------------------------------------------------------------------------------
+
+Int_t DelphesExpression::TParser::ParseEquality()
+{
+  Int_t node = ParseRelational();
+  while(true)
+  {
+    if(Accept("=="))
+      node = NewNode(kEqual, node, ParseRelational());
+    else if(Accept("!="))
+      node = NewNode(kNotEqual, node, ParseRelational());
+    else
+      return node;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+Int_t DelphesExpression::TParser::ParseRelational()
+{
+  Int_t node = ParseAdditive();
+  while(true)
+  {
+    if(Accept("<="))
+      node = NewNode(kLessEqual, node, ParseAdditive());
+    else if(Accept(">="))
+      node = NewNode(kGreaterEqual, node, ParseAdditive());
+    else if(Accept("<"))
+      node = NewNode(kLess, node, ParseAdditive());
+    else if(Accept(">"))
+      node = NewNode(kGreater, node, ParseAdditive());
+    else
+      return node;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+Int_t DelphesExpression::TParser::ParseAdditive()
+{
+  Int_t node = ParseMultiplicative();
+  while(true)
+  {
+    if(Accept("+"))
+      node = NewNode(kAdd, node, ParseMultiplicative());
+    else if(Accept("-"))
+      node = NewNode(kSubtract, node, ParseMultiplicative());
+    else
+      return node;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+Int_t DelphesExpression::TParser::ParseMultiplicative()
+{
+  Int_t node = ParseUnary();
+  while(true)
+  {
+    if(Accept("*"))
+      node = NewNode(kMultiply, node, ParseUnary());
+    else if(Accept("/"))
+      node = NewNode(kDivide, node, ParseUnary());
+    else
+      return node;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+Int_t DelphesExpression::TParser::ParseUnary()
+{
+  if(Accept("-")) return NewNode(kNegate, ParseUnary());
+  if(Accept("+")) return ParseUnary();
+  if(Accept("!")) return NewNode(kNot, ParseUnary());
+  return ParsePower();
+}
+
+//------------------------------------------------------------------------------
+
+Int_t DelphesExpression::TParser::ParsePower()
+{
+  Int_t node = ParsePrimary();
+
+  // as in TFormula, -x^2 is -(x^2) and the exponent can carry a sign
+  while(Accept("^"))
+  {
+    if(Accept("-"))
+      node = NewNode(kPower, node, NewNode(kNegate, ParsePrimary()));
+    else
+    {
+      Accept("+");
+      node = NewNode(kPower, node, ParsePrimary());
+    }
+  }
+  return node;
+}
+
+//------------------------------------------------------------------------------
+
+Int_t DelphesExpression::TParser::ParsePrimary()
+{
+  const char *begin;
+  Int_t node;
+  char *end;
+  long index;
+
+  while(isspace(*fIt)) ++fIt;
+
+  if(isdigit(*fIt) || (*fIt == '.' && isdigit(fIt[1])))
+  {
+    // octal and hexadecimal numbers are left to TFormula
+    if(fIt[0] == '0' && (isdigit(fIt[1]) || fIt[1] == 'x' || fIt[1] == 'X')) Fail();
+    begin = fIt;
+    node = NewNode(kConstant);
+    fNodes[node].value = strtod(fIt, &end);
+    fIt = end;
+    if(isalnum(*fIt) || *fIt == '_' || *fIt == '.') Fail();
+    // as in C++, a number without a decimal point or an exponent is an integer
+    fNodes[node].integer = string(begin, fIt).find_first_of(".eE") == string::npos;
+    if(fNodes[node].integer && fNodes[node].value > INT_MAX) Fail();
+    return node;
+  }
+
+  if(Accept("("))
+  {
+    node = ParseOr();
+    Expect(")");
+    return node;
+  }
+
+  if(Accept("["))
+  {
+    while(isspace(*fIt)) ++fIt;
+    if(!isdigit(*fIt)) Fail();
+    index = strtol(fIt, &end, 10);
+    fIt = end;
+    Expect("]");
+    if(index >= Long_t(fParameters.size())) Fail();
+    node = NewNode(kVariable);
+    fNodes[node].index = fParameters[index];
+    return node;
+  }
+
+  if(isalpha(*fIt) || *fIt == '_') return ParseIdentifier();
+
+  Fail();
+  return -1;
+}
+
+//------------------------------------------------------------------------------
+
+Int_t DelphesExpression::TParser::ParseIdentifier()
+{
+  const char *begin = fIt;
+  string name;
+  Int_t node, left, right;
+  size_t i;
+
+  while(isalnum(*fIt) || *fIt == '_' || (fIt[0] == ':' && fIt[1] == ':'))
+  {
+    fIt += fIt[0] == ':' ? 2 : 1;
+  }
+  name.assign(begin, fIt);
+
+  for(i = 0; i < fVariables.size(); ++i)
+  {
+    if(name != fVariables[i]) continue;
+    node = NewNode(kVariable);
+    fNodes[node].index = i;
+    return node;
+  }
+
+  if(name == "pi" || name == "TMath::Pi")
+  {
+    if(name == "TMath::Pi")
+    {
+      Expect("(");
+      Expect(")");
+    }
+    node = NewNode(kConstant);
+    fNodes[node].value = M_PI;
+    return node;
+  }
+
+  Expect("(");
+
+  for(i = 0; i < sizeof(kFunctions1) / sizeof(kFunctions1[0]); ++i)
+  {
+    if(name != kFunctions1[i].name) continue;
+    node = NewNode(kFunction1, ParseOr());
+    fNodes[node].function1 = kFunctions1[i].function;
+    Expect(")");
+    return node;
+  }
+
+  for(i = 0; i < sizeof(kFunctions2) / sizeof(kFunctions2[0]); ++i)
+  {
+    if(name != kFunctions2[i].name) continue;
+    left = ParseOr();
+    Expect(",");
+    right = ParseOr();
+    node = NewNode(kFunction2, left, right);
+    fNodes[node].function2 = kFunctions2[i].function;
+    // the minimum and maximum of two integers are integers
+    fNodes[node].integer = (kFunctions2[i].function == Min || kFunctions2[i].function == Max) && fNodes[left].integer && fNodes[right].integer;
+    Expect(")");
+    return node;
+  }
+
+  Fail();
+  return -1;
+}
+
+//------------------------------------------------------------------------------
+
+Bool_t DelphesExpression::TParser::Accept(const char *token)
+{
+  size_t length = strlen(token);
+
+  while(isspace(*fIt)) ++fIt;
+
+  if(strncmp(fIt, token, length) != 0) return false;
+
+  // single character operators that are the beginning of another one
+  if(length == 1 && (token[0] == '<' || token[0] == '>' || token[0] == '!') && fIt[1] == '=') return false;
+  if(length == 1 && (token[0] == '&' || token[0] == '|')) return false;
+
+  fIt += length;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesExpression::TParser::Expect(const char *token)
+{
+  if(!Accept(token)) Fail();
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesExpression::TParser::Fail()
+{
+  stringstream message;
+  message << "unsupported syntax at '" << fIt << "'";
+  throw runtime_error(message.str());
+}
+
+//------------------------------------------------------------------------------
+
+Int_t DelphesExpression::TParser::NewNode(EOperation operation, Int_t left, Int_t right)
+{
+  TNode node;
+
+  node.operation = operation;
+  node.index = 0;
+  node.value = 0.0;
+  node.function1 = 0;
+  node.function2 = 0;
+  node.left = left;
+  node.right = right;
+
+  switch(operation)
+  {
+    case kNot:
+    case kLess:
+    case kLessEqual:
+    case kGreater:
+    case kGreaterEqual:
+    case kEqual:
+    case kNotEqual:
+    case kAnd:
+    case kOr:
+      node.integer = true;
+      break;
+    case kAdd:
+    case kSubtract:
+    case kMultiply:
+    case kDivide:
+      node.integer = fNodes[left].integer && fNodes[right].integer;
+      break;
+    case kNegate:
+      node.integer = fNodes[left].integer;
+      break;
+    default:
+      node.integer = false;
+      break;
+  }
+
+  fNodes.push_back(node);
+
+  return fNodes.size() - 1;
+}
+
+//------------------------------------------------------------------------------
+
+DelphesExpression::DelphesExpression() :
+  fVariables(0), fSlots(0)
+{
+}
+
+//------------------------------------------------------------------------------
+
+Bool_t DelphesExpression::Compile(const char *expression, const vector<string> &variables, const vector<Int_t> &parameters)
+{
+  vector<TNode> nodes;
+  Int_t root;
+
+  fCode.clear();
+  fVariables = 0;
+  fSlots = 0;
+
+  try
+  {
+    TParser parser(expression, variables, parameters, nodes);
+    root = parser.Parse();
+  }
+  catch(runtime_error &e)
+  {
+    return false;
+  }
+
+  if(!Fold(nodes, root)) return false;
+
+  fVariables = variables.size();
+  fSlots = Share(nodes, fVariables, fCode);
+  Emit(nodes, root, fCode);
+
+  if(GetDepth(fCode) > kMaxDepth)
+  {
+    fCode.clear();
+    return false;
+  }
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+Double_t DelphesExpression::Run(const vector<TInstruction> &code, const Double_t *variables, Int_t size, Int_t slots)
+{
+  Double_t stack[kMaxDepth], registers[kMaxRegisters];
+  const TInstruction *program = code.data();
+  Int_t i, top = -1;
+
+  if(slots > 0)
+  {
+    copy(variables, variables + size, registers);
+    variables = registers;
+  }
+
+  size = code.size();
+
+  for(i = 0; i < size; ++i)
+  {
+    const TInstruction &instruction = program[i];
+    switch(instruction.operation)
+    {
+      case kConstant:
+        stack[++top] = instruction.value;
+        break;
+      case kVariable:
+        stack[++top] = variables[instruction.index];
+        break;
+      case kAdd:
+        --top;
+        stack[top] += stack[top + 1];
+        break;
+      case kSubtract:
+        --top;
+        stack[top] -= stack[top + 1];
+        break;
+      case kMultiply:
+        --top;
+        stack[top] *= stack[top + 1];
+        break;
+      case kDivide:
+        --top;
+        stack[top] /= stack[top + 1];
+        break;
+      case kPower:
+        --top;
+        stack[top] = pow(stack[top], stack[top + 1]);
+        break;
+      case kNegate:
+        stack[top] = -stack[top];
+        break;
+      case kNot:
+        stack[top] = stack[top] == 0.0;
+        break;
+      case kLess:
+        --top;
+        stack[top] = stack[top] < stack[top + 1];
+        break;
+      case kLessEqual:
+        --top;
+        stack[top] = stack[top] <= stack[top + 1];
+        break;
+      case kGreater:
+        --top;
+        stack[top] = stack[top] > stack[top + 1];
+        break;
+      case kGreaterEqual:
+        --top;
+        stack[top] = stack[top] >= stack[top + 1];
+        break;
+      case kEqual:
+        --top;
+        stack[top] = stack[top] == stack[top + 1];
+        break;
+      case kNotEqual:
+        --top;
+        stack[top] = stack[top] != stack[top + 1];
+        break;
+      case kLessConstant:
+        stack[++top] = variables[instruction.index] < instruction.value;
+        break;
+      case kLessEqualConstant:
+        stack[++top] = variables[instruction.index] <= instruction.value;
+        break;
+      case kGreaterConstant:
+        stack[++top] = variables[instruction.index] > instruction.value;
+        break;
+      case kGreaterEqualConstant:
+        stack[++top] = variables[instruction.index] >= instruction.value;
+        break;
+      case kEqualConstant:
+        stack[++top] = variables[instruction.index] == instruction.value;
+        break;
+      case kNotEqualConstant:
+        stack[++top] = variables[instruction.index] != instruction.value;
+        break;
+      case kFunction1:
+        stack[top] = instruction.function1(stack[top]);
+        break;
+      case kFunction2:
+        --top;
+        stack[top] = instruction.function2(stack[top], stack[top + 1]);
+        break;
+      case kJumpIfZero:
+        // keep 0 as result and skip the right-hand side
+        if(stack[top] == 0.0)
+        {
+          stack[top] = 0.0;
+          i = instruction.jump - 1;
+        }
+        else
+        {
+          --top;
+        }
+        break;
+      case kJumpIfNotZero:
+        if(stack[top] != 0.0)
+        {
+          stack[top] = 1.0;
+          i = instruction.jump - 1;
+        }
+        else
+        {
+          --top;
+        }
+        break;
+      case kBool:
+        stack[top] = stack[top] != 0.0;
+        break;
+      case kStore:
+        registers[instruction.index] = stack[top--];
+        break;
+      default:
+        break;
+    }
+  }
+
+  return top < 0 ? 0.0 : stack[top];
+}
+
+//------------------------------------------------------------------------------
+
+Bool_t DelphesExpression::Fold(vector<TNode> &nodes, Int_t node)
+{
+  vector<TInstruction> code;
+  TNode &current = nodes[node];
+  Int_t left = current.left, right = current.right;
+
+  if(left >= 0 && !Fold(nodes, left)) return false;
+  if(right >= 0 && !Fold(nodes, right)) return false;
+
+  // the quotient of two integers is only computed here, when they are constant
+  if(left < 0 || nodes[left].operation != kConstant || (right >= 0 && nodes[right].operation != kConstant))
+  {
+    return current.operation != kDivide || !current.integer;
+  }
+
+  if(current.operation == kDivide && current.integer)
+  {
+    if(nodes[right].value == 0.0) return false;
+    current.value = Double_t(Long64_t(nodes[left].value) / Long64_t(nodes[right].value));
+  }
+  else
+  {
+    Emit(nodes, node, code);
+    current.value = Run(code, 0, 0, 0);
+  }
+
+  current.operation = kConstant;
+  current.left = -1;
+  current.right = -1;
+
+  // integers that overflow are left to TFormula
+  return !current.integer || fabs(current.value) <= INT_MAX;
+}
+
+//------------------------------------------------------------------------------
+
+Int_t DelphesExpression::Share(vector<TNode> &nodes, Int_t variables, vector<TInstruction> &code)
+{
+  map<pair<Double_t (*)(Double_t), Int_t>, Int_t> counts, registers;
+  map<pair<Double_t (*)(Double_t), Int_t>, Int_t>::iterator itRegisters;
+  TInstruction instruction;
+  size_t i;
+  Int_t slots = 0;
+
+  // functions of a variable used several times, like abs(eta) in the
+  // conditions of piecewise formulas, are computed once at the beginning
+  // and stored in registers that follow the variables
+
+  for(i = 0; i < nodes.size(); ++i)
+  {
+    const TNode &node = nodes[i];
+    if(node.operation != kFunction1 || nodes[node.left].operation != kVariable) continue;
+    ++counts[make_pair(node.function1, nodes[node.left].index)];
+  }
+
+  instruction.value = 0.0;
+  instruction.jump = 0;
+  instruction.function2 = 0;
+
+  for(i = 0; i < nodes.size(); ++i)
+  {
+    TNode &node = nodes[i];
+    if(node.operation != kFunction1 || nodes[node.left].operation != kVariable) continue;
+
+    pair<Double_t (*)(Double_t), Int_t> key(node.function1, nodes[node.left].index);
+    if(counts[key] < 2) continue;
+
+    itRegisters = registers.find(key);
+    if(itRegisters == registers.end())
+    {
+      if(variables + slots >= kMaxRegisters) continue;
+      itRegisters = registers.insert(make_pair(key, variables + slots)).first;
+      ++slots;
+
+      instruction.operation = kVariable;
+      instruction.index = key.second;
+      instruction.function1 = 0;
+      code.push_back(instruction);
+      instruction.operation = kFunction1;
+      instruction.function1 = key.first;
+      code.push_back(instruction);
+      instruction.operation = kStore;
+      instruction.index = itRegisters->second;
+      code.push_back(instruction);
+    }
+
+    node.operation = kVariable;
+    node.index = itRegisters->second;
+    node.left = -1;
+  }
+
+  return slots;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesExpression::Emit(const vector<TNode> &nodes, Int_t node, vector<TInstruction> &code)
+{
+  const TNode &current = nodes[node];
+  TInstruction instruction;
+  size_t jump;
+
+  instruction.operation = current.operation;
+  instruction.index = current.index;
+  instruction.jump = 0;
+  instruction.value = current.value;
+  instruction.function1 = current.function1;
+  instruction.function2 = current.function2;
+
+  switch(current.operation)
+  {
+    case kAnd:
+    case kOr:
+      Emit(nodes, current.left, code);
+      jump = code.size();
+      instruction.operation = current.operation == kAnd ? kJumpIfZero : kJumpIfNotZero;
+      code.push_back(instruction);
+      Emit(nodes, current.right, code);
+      instruction.operation = kBool;
+      code.push_back(instruction);
+      code[jump].jump = code.size();
+      break;
+    case kMultiply:
+      Emit(nodes, current.left, code);
+      if(IsCondition(nodes, current.left) && IsCondition(nodes, current.right))
+      {
+        // conditions are 0 or 1, the product is either 0 or the right-hand side
+        jump = code.size();
+        instruction.operation = kJumpIfZero;
+        code.push_back(instruction);
+        Emit(nodes, current.right, code);
+        code[jump].jump = code.size();
+      }
+      else
+      {
+        Emit(nodes, current.right, code);
+        code.push_back(instruction);
+      }
+      break;
+    case kLess:
+    case kLessEqual:
+    case kGreater:
+    case kGreaterEqual:
+    case kEqual:
+    case kNotEqual:
+      // comparison of a variable with a constant in one instruction
+      if(nodes[current.left].operation == kVariable && nodes[current.right].operation == kConstant)
+      {
+        instruction.operation = EOperation(kLessConstant + current.operation - kLess);
+        instruction.index = nodes[current.left].index;
+        instruction.value = nodes[current.right].value;
+        code.push_back(instruction);
+        break;
+      }
+      Emit(nodes, current.left, code);
+      Emit(nodes, current.right, code);
+      code.push_back(instruction);
+      break;
+    default:
+      if(current.left >= 0) Emit(nodes, current.left, code);
+      if(current.right >= 0) Emit(nodes, current.right, code);
+      code.push_back(instruction);
+      break;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+Bool_t DelphesExpression::IsCondition(const vector<TNode> &nodes, Int_t node)
+{
+  switch(nodes[node].operation)
+  {
+    case kNot:
+    case kLess:
+    case kLessEqual:
+    case kGreater:
+    case kGreaterEqual:
+    case kEqual:
+    case kNotEqual:
+    case kAnd:
+    case kOr:
+      return true;
+    case kMultiply:
+      return IsCondition(nodes, nodes[node].left) && IsCondition(nodes, nodes[node].right);
+    case kConstant:
+      return nodes[node].value == 0.0 || nodes[node].value == 1.0;
+    default:
+      return false;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+Int_t DelphesExpression::GetDepth(const vector<TInstruction> &code)
+{
+  Int_t depth = 0, maxDepth = 0;
+  size_t i;
+
+  // the code following a jump is the longest path
+  for(i = 0; i < code.size(); ++i)
+  {
+    switch(code[i].operation)
+    {
+      case kConstant:
+      case kVariable:
+      case kLessConstant:
+      case kLessEqualConstant:
+      case kGreaterConstant:
+      case kGreaterEqualConstant:
+      case kEqualConstant:
+      case kNotEqualConstant:
+        ++depth;
+        break;
+      case kNegate:
+      case kNot:
+      case kFunction1:
+      case kBool:
+        break;
+      default:
+        --depth;
+        break;
+    }
+    maxDepth = max(maxDepth, depth);
+  }
+
+  return maxDepth;
+}
@@ -0,0 +1,136 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesExpression_h
+#define DelphesExpression_h
+
+/** \class DelphesExpression
+ *
+ *  Parser and evaluator of the arithmetic expressions used in the
+ *  configuration files, without going through the interpreter.
+ *
+ *  The supported syntax is the C++ subset used by TFormula: numbers,
+ *  named variables and parameters [i], the operators + - * / ^ ! < <= >
+ *  >= == != && ||, and the usual mathematical functions, with or without
+ *  the TMath:: prefix. As in the C++ code generated by TFormula, numbers
+ *  without a decimal point or an exponent are integers, conditions are
+ *  integers, and the quotient of two integers is truncated. Expressions
+ *  that divide integers which are not constant are left to TFormula.
+ *
+ *  The expression is compiled into a flat program for a stack machine,
+ *  with constant sub-expressions folded. The right-hand side of && and ||
+ *  is only evaluated when needed, and so is the right-hand side of a
+ *  product of two conditions, as in the (condition) * (condition) factors
+ *  of piecewise formulas. A product with any other right-hand side is
+ *  always evaluated, so that infinities and NaN propagate as in C++.
+ *  Functions of a variable repeated in the expression, like abs(eta) in
+ *  the conditions of these formulas, are computed once per evaluation.
+ *
+ */
+
+#include "Rtypes.h"
+
+#include <string>
+#include <vector>
+
+class DelphesExpression
+{
+public:
+  DelphesExpression();
+
+  // returns false when the expression uses an unsupported syntax,
+  // variables are looked up by name and parameters [i] by position
+  // in the parameter list
+  Bool_t Compile(const char *expression,
+    const std::vector<std::string> &variables,
+    const std::vector<Int_t> &parameters = std::vector<Int_t>());
+
+  Double_t Eval(const Double_t *variables) const { return Run(fCode, variables, fVariables, fSlots); }
+
+private:
+  enum EOperation
+  {
+    kConstant,
+    kVariable,
+    kAdd,
+    kSubtract,
+    kMultiply,
+    kDivide,
+    kPower,
+    kNegate,
+    kNot,
+    kLess,
+    kLessEqual,
+    kGreater,
+    kGreaterEqual,
+    kEqual,
+    kNotEqual,
+    kLessConstant,
+    kLessEqualConstant,
+    kGreaterConstant,
+    kGreaterEqualConstant,
+    kEqualConstant,
+    kNotEqualConstant,
+    kFunction1,
+    kFunction2,
+    kAnd,
+    kOr,
+    kJumpIfZero,
+    kJumpIfNotZero,
+    kBool,
+    kStore
+  };
+
+  struct TInstruction
+  {
+    EOperation operation;
+    Int_t index, jump;
+    Double_t value;
+    Double_t (*function1)(Double_t);
+    Double_t (*function2)(Double_t, Double_t);
+  };
+
+  struct TNode
+  {
+    EOperation operation;
+    Int_t index;
+    Double_t value;
+    Double_t (*function1)(Double_t);
+    Double_t (*function2)(Double_t, Double_t);
+    Int_t left, right;
+    Bool_t integer;
+  };
+
+  class TParser;
+
+  static const Int_t kMaxDepth = 64;
+  static const Int_t kMaxRegisters = 64;
+
+  static Double_t Run(const std::vector<TInstruction> &code, const Double_t *variables, Int_t size, Int_t slots);
+
+  static Bool_t Fold(std::vector<TNode> &nodes, Int_t node);
+  static Int_t Share(std::vector<TNode> &nodes, Int_t variables, std::vector<TInstruction> &code);
+  static void Emit(const std::vector<TNode> &nodes, Int_t node, std::vector<TInstruction> &code);
+  static Bool_t IsCondition(const std::vector<TNode> &nodes, Int_t node);
+  static Int_t GetDepth(const std::vector<TInstruction> &code);
+
+  std::vector<TInstruction> fCode;
+  Int_t fVariables, fSlots;
+};
+
+#endif /* DelphesExpression_h */
@@ -49,6 +49,12 @@ DelphesFactory::~DelphesFactory()
 {
   if(fObjArrays) delete fObjArrays;
 
+  set<TObject *>::iterator itOwned;
+  for(itOwned = fOwned.begin(); itOwned != fOwned.end(); ++itOwned)
+  {
+    delete(*itOwned);
+  }
+
   map<const TClass *, ExRootTreeBranch *>::iterator itBranches;
   for(itBranches = fBranches.begin(); itBranches != fBranches.end(); ++itBranches)
   {
@@ -86,6 +92,14 @@ TObjArray *DelphesFactory::NewPermanentArray()
 
 //------------------------------------------------------------------------------
 
+void DelphesFactory::AddPermanentObject(TObject *object)
+{
+  fPool.insert(object);
+  fOwned.insert(object);
+}
+
+//------------------------------------------------------------------------------
+
 Candidate *DelphesFactory::NewCandidate()
 {
   Candidate *object = New<Candidate>();
@@ -48,6 +48,9 @@ public:
 
   TObjArray *NewPermanentArray();
 
+  // take ownership of an object that is cleared at each event
+  void AddPermanentObject(TObject *object);
+
   TObjArray *NewArray() { return New<TObjArray>(); }
 
   Candidate *NewCandidate();
@@ -66,6 +69,8 @@ private:
 
   std::set<TObject *> fPool; //!
 
+  std::set<TObject *> fOwned; //!
+
   ClassDef(DelphesFactory, 1)
 };
 
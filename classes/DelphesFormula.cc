@@ -18,13 +18,21 @@
 
 #include "classes/DelphesFormula.h"
 #include "classes/DelphesClasses.h"
+#include "classes/DelphesExpression.h"
 
 #include "TString.h"
 
+#include <map>
+#include <mutex>
 #include <stdexcept>
+#include <string>
+#include <vector>
 
 using namespace std;
 
+static mutex gExpressionMutex;
+static map<string, shared_ptr<const DelphesExpression> > gExpressionCache;
+
 //------------------------------------------------------------------------------
 
 DelphesFormula::DelphesFormula() :
@@ -51,11 +59,39 @@ Int_t DelphesFormula::Compile(const char *expression)
 {
   TString buffer;
   const char *it;
+  map<string, shared_ptr<const DelphesExpression> >::iterator itCache;
+
   for(it = expression; *it; ++it)
   {
     if(*it == ' ' || *it == '\t' || *it == '\r' || *it == '\n' || *it == '\\') continue;
     buffer.Append(*it);
   }
+
+  // the expressions are compiled once per process, those that
+  // are not supported by DelphesExpression are left to TFormula
+
+  {
+    lock_guard<mutex> lock(gExpressionMutex);
+
+    itCache = gExpressionCache.find(buffer.Data());
+    if(itCache == gExpressionCache.end())
+    {
+      static const char *names[] = {"pt", "eta", "phi", "energy", "d0", "dz", "ctgTheta", "radius", "density", "x", "y", "z", "t"};
+      static const vector<string> variables(names, names + 13);
+      static const Int_t indices[] = {4, 5, 6, 7, 8};
+      static const vector<Int_t> parameters(indices, indices + 5);
+
+      shared_ptr<DelphesExpression> compiled(new DelphesExpression);
+      if(!compiled->Compile(buffer.Data(), variables, parameters)) compiled.reset();
+
+      itCache = gExpressionCache.insert(make_pair(string(buffer.Data()), shared_ptr<const DelphesExpression>(compiled))).first;
+    }
+
+    fExpression = itCache->second;
+  }
+
+  if(fExpression) return 0;
+
   buffer.ReplaceAll("pt", "x");
   buffer.ReplaceAll("eta", "y");
   buffer.ReplaceAll("phi", "z");
@@ -91,6 +127,12 @@ Double_t DelphesFormula::Eval(Double_t pt, Double_t eta, Double_t phi, Double_t
     density = candidate->ParticleDensity;
   }
     
+  if(fExpression)
+  {
+    Double_t variables[13] = {pt, eta, phi, energy, d0, dz, ctgTheta, radius, density, pt, eta, phi, energy};
+    return fExpression->Eval(variables);
+  }
+
   Double_t x[4] = {pt, eta, phi, energy};
   Double_t params[5] = {d0, dz, ctgTheta, radius, density};
   return EvalPar(x, params);
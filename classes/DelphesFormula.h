@@ -21,7 +21,10 @@
 
 #include "TFormula.h"
 
+#include <memory>
+
 class Candidate;
+class DelphesExpression;
 
 class DelphesFormula: public TFormula
 {
@@ -35,6 +38,11 @@ public:
   Int_t Compile(const char *expression);
 
   Double_t Eval(Double_t pt, Double_t eta = 0, Double_t phi = 0, Double_t energy = 0, Candidate *candidate = nullptr);
+
+private:
+  // compiled expression shared by all the formulas with the same text,
+  // null when the expression is evaluated by TFormula
+  std::shared_ptr<const DelphesExpression> fExpression;
 };
 
 #endif /* DelphesFormula_h */
@@ -20,6 +20,10 @@
  *
  *  Reads HepMC file
  *
+ *  With SetReadAhead(size), a separate thread reads and parses the input
+ *  file into a ring of up to size decoded events, and ReadBlock only
+ *  creates the candidates of the next decoded event.
+ *
  *  \author P. Demin - UCL, Louvain-la-Neuve
  *
  */
@@ -31,6 +35,7 @@
 #include <stdexcept>
 
 #include <map>
+#include <utility>
 #include <vector>
 
 #include <stdio.h>
@@ -54,9 +59,10 @@ static const int kBufferSize = 16384;
 //---------------------------------------------------------------------------
 
 DelphesHepMC2Reader::DelphesHepMC2Reader() :
-  fInputFile(0), fBuffer(0), fPDG(0),
-  fVertexCounter(-1), fInCounter(-1), fOutCounter(-1),
-  fParticleCounter(0)
+  fInputFile(0), fBuffer(0), fPDG(0), fEventReady(false),
+  fVertexCounter(-1), fMomentumCoefficient(1.0), fPositionCoefficient(1.0),
+  fInCounter(-1), fOutCounter(-1),
+  fQueueHead(0), fQueueCount(0), fQueueDone(false), fStop(false)
 {
   fBuffer = new char[kBufferSize];
 
@@ -67,24 +73,69 @@ DelphesHepMC2Reader::DelphesHepMC2Reader() :
 
 DelphesHepMC2Reader::~DelphesHepMC2Reader()
 {
+  StopReadAhead();
   if(fBuffer) delete[] fBuffer;
 }
 
 //---------------------------------------------------------------------------
 
+void DelphesHepMC2Reader::SetReadAhead(int size)
+{
+  StopReadAhead();
+  fQueue.resize(size > 0 ? size : 0);
+}
+
+//---------------------------------------------------------------------------
+
 void DelphesHepMC2Reader::SetInputFile(FILE *inputFile)
 {
+  StopReadAhead();
+
   fInputFile = inputFile;
+
+  if(fInputFile && !fQueue.empty())
+  {
+    ClearEvent();
+    fQueueHead = 0;
+    fQueueCount = 0;
+    fQueueDone = false;
+    fStop = false;
+    fThread = thread(&DelphesHepMC2Reader::ReadAheadLoop, this);
+  }
+}
+
+//---------------------------------------------------------------------------
+
+void DelphesHepMC2Reader::StopReadAhead()
+{
+  if(!fThread.joinable()) return;
+
+  {
+    lock_guard<mutex> lock(fMutex);
+    fStop = true;
+  }
+  fProducerCondition.notify_all();
+  fThread.join();
 }
 
 //---------------------------------------------------------------------------
 
 void DelphesHepMC2Reader::Clear()
 {
-  fStateSize = 0;
-  fState.clear();
-  fWeightSize = 0;
-  fWeight.clear();
+  fEventReady = false;
+
+  // with read-ahead, the parser state belongs to the reading thread
+
+  if(fQueue.empty()) ClearEvent();
+}
+
+//---------------------------------------------------------------------------
+
+void DelphesHepMC2Reader::ClearEvent()
+{
+  fEvent.state.clear();
+  fEvent.weight.clear();
+  fEvent.particles.clear();
   fMomentumCoefficient = 1.0;
   fPositionCoefficient = 1.0;
   fVertexCounter = -1;
@@ -92,12 +143,18 @@ void DelphesHepMC2Reader::Clear()
   fOutCounter = -1;
   fMotherMap.clear();
   fDaughterMap.clear();
-  fParticleCounter = 0;
 }
 
 //---------------------------------------------------------------------------
 
 bool DelphesHepMC2Reader::EventReady()
+{
+  return fEventReady;
+}
+
+//---------------------------------------------------------------------------
+
+bool DelphesHepMC2Reader::EventComplete() const
 {
   return (fVertexCounter == 0) && (fInCounter == 0) && (fOutCounter == 0);
 }
@@ -108,12 +165,94 @@ bool DelphesHepMC2Reader::ReadBlock(DelphesFactory *factory,
   TObjArray *allParticleOutputArray,
   TObjArray *stableParticleOutputArray,
   TObjArray *partonOutputArray)
+{
+  vector<TParticleRecord>::const_iterator itParticle;
+
+  if(fQueue.empty())
+  {
+    if(!ReadLine()) return kFALSE;
+    if(!EventComplete()) return kTRUE;
+  }
+  else
+  {
+    {
+      unique_lock<mutex> lock(fMutex);
+      fConsumerCondition.wait(lock, [this] { return fQueueCount > 0 || fQueueDone; });
+      if(fQueueCount == 0) return kFALSE;
+
+      swap(fOutputEvent, fQueue[fQueueHead]);
+      fQueueHead = (fQueueHead + 1) % fQueue.size();
+      --fQueueCount;
+    }
+    fProducerCondition.notify_one();
+  }
+
+  const TEventRecord &event = fQueue.empty() ? fEvent : fOutputEvent;
+
+  for(itParticle = event.particles.begin(); itParticle != event.particles.end(); ++itParticle)
+  {
+    AnalyzeParticle(factory, *itParticle, allParticleOutputArray,
+      stableParticleOutputArray, partonOutputArray);
+  }
+
+  fEventReady = true;
+
+  return kTRUE;
+}
+
+//---------------------------------------------------------------------------
+
+void DelphesHepMC2Reader::ReadAheadLoop()
+{
+  bool rc;
+  size_t index;
+
+  while(true)
+  {
+    do
+    {
+      rc = ReadLine();
+    } while(rc && !EventComplete() && !fStop);
+
+    if(!rc || fStop) break;
+
+    {
+      unique_lock<mutex> lock(fMutex);
+      fProducerCondition.wait(lock, [this] { return fStop || fQueueCount < fQueue.size(); });
+      if(fStop) break;
+
+      index = (fQueueHead + fQueueCount) % fQueue.size();
+    }
+
+    // the free slot is not visible to the consumer until the counter is incremented
+
+    fQueue[index] = fEvent;
+    ClearEvent();
+
+    {
+      lock_guard<mutex> lock(fMutex);
+      ++fQueueCount;
+    }
+    fConsumerCondition.notify_one();
+  }
+
+  {
+    lock_guard<mutex> lock(fMutex);
+    fQueueDone = true;
+  }
+  fConsumerCondition.notify_one();
+}
+
+//---------------------------------------------------------------------------
+
+bool DelphesHepMC2Reader::ReadLine()
 {
   map<int, pair<int, int> >::iterator itMotherMap;
   map<int, pair<int, int> >::iterator itDaughterMap;
   char key, momentumUnit[4], positionUnit[3];
-  int i, rc, state;
-  double weight;
+  int i, rc, state, stateSize, weightSize, particleCode, inVertexCode, particleCounter;
+  double weight, theta, phi;
+  TParticleRecord particle;
 
   if(!fgets(fBuffer, kBufferSize, fInputFile)) return kFALSE;
 
@@ -123,19 +262,19 @@ bool DelphesHepMC2Reader::ReadBlock(DelphesFactory *factory,
 
   if(key == 'E')
   {
-    Clear();
-
-    rc = bufferStream.ReadInt(fEventNumber)
-      && bufferStream.ReadInt(fMPI)
-      && bufferStream.ReadDbl(fScale)
-      && bufferStream.ReadDbl(fAlphaQCD)
-      && bufferStream.ReadDbl(fAlphaQED)
-      && bufferStream.ReadInt(fProcessID)
-      && bufferStream.ReadInt(fSignalCode)
+    ClearEvent();
+
+    rc = bufferStream.ReadInt(fEvent.eventNumber)
+      && bufferStream.ReadInt(fEvent.mpi)
+      && bufferStream.ReadDbl(fEvent.scale)
+      && bufferStream.ReadDbl(fEvent.alphaQCD)
+      && bufferStream.ReadDbl(fEvent.alphaQED)
+      && bufferStream.ReadInt(fEvent.processID)
+      && bufferStream.ReadInt(fEvent.signalCode)
       && bufferStream.ReadInt(fVertexCounter)
-      && bufferStream.ReadInt(fBeamCode[0])
-      && bufferStream.ReadInt(fBeamCode[1])
-      && bufferStream.ReadInt(fStateSize);
+      && bufferStream.ReadInt(fEvent.beamCode[0])
+      && bufferStream.ReadInt(fEvent.beamCode[1])
+      && bufferStream.ReadInt(stateSize);
 
     if(!rc)
     {
@@ -144,13 +283,13 @@ bool DelphesHepMC2Reader::ReadBlock(DelphesFactory *factory,
       return kFALSE;
     }
 
-    for(i = 0; i < fStateSize; ++i)
+    for(i = 0; i < stateSize; ++i)
     {
       rc = rc && bufferStream.ReadInt(state);
-      fState.push_back(state);
+      fEvent.state.push_back(state);
     }
 
-    rc = rc && bufferStream.ReadInt(fWeightSize);
+    rc = rc && bufferStream.ReadInt(weightSize);
 
     if(!rc)
     {
@@ -159,10 +298,10 @@ bool DelphesHepMC2Reader::ReadBlock(DelphesFactory *factory,
       return kFALSE;
     }
 
-    for(i = 0; i < fWeightSize; ++i)
+    for(i = 0; i < weightSize; ++i)
     {
       rc = rc && bufferStream.ReadDbl(weight);
-      fWeight.push_back(weight);
+      fEvent.weight.push_back(weight);
     }
 
     if(!rc)
@@ -203,8 +342,8 @@ bool DelphesHepMC2Reader::ReadBlock(DelphesFactory *factory,
   }
   else if(key == 'C')
   {
-    rc = bufferStream.ReadDbl(fCrossSection)
-      && bufferStream.ReadDbl(fCrossSectionError);
+    rc = bufferStream.ReadDbl(fEvent.crossSection)
+      && bufferStream.ReadDbl(fEvent.crossSectionError);
 
     if(!rc)
     {
@@ -215,13 +354,13 @@ bool DelphesHepMC2Reader::ReadBlock(DelphesFactory *factory,
   }
   else if(key == 'F')
   {
-    rc = bufferStream.ReadInt(fID1)
-      && bufferStream.ReadInt(fID2)
-      && bufferStream.ReadDbl(fX1)
-      && bufferStream.ReadDbl(fX2)
-      && bufferStream.ReadDbl(fScalePDF)
-      && bufferStream.ReadDbl(fPDF1)
-      && bufferStream.ReadDbl(fPDF2);
+    rc = bufferStream.ReadInt(fEvent.id1)
+      && bufferStream.ReadInt(fEvent.id2)
+      && bufferStream.ReadDbl(fEvent.x1)
+      && bufferStream.ReadDbl(fEvent.x2)
+      && bufferStream.ReadDbl(fEvent.scalePDF)
+      && bufferStream.ReadDbl(fEvent.pdf1)
+      && bufferStream.ReadDbl(fEvent.pdf2);
 
     if(!rc)
     {
@@ -251,17 +390,17 @@ bool DelphesHepMC2Reader::ReadBlock(DelphesFactory *factory,
   }
   else if(key == 'P' && fOutCounter > 0)
   {
-    rc = bufferStream.ReadInt(fParticleCode)
-      && bufferStream.ReadInt(fPID)
-      && bufferStream.ReadDbl(fPx)
-      && bufferStream.ReadDbl(fPy)
-      && bufferStream.ReadDbl(fPz)
-      && bufferStream.ReadDbl(fE)
-      && bufferStream.ReadDbl(fMass)
-      && bufferStream.ReadInt(fStatus)
-      && bufferStream.ReadDbl(fTheta)
-      && bufferStream.ReadDbl(fPhi)
-      && bufferStream.ReadInt(fInVertexCode);
+    rc = bufferStream.ReadInt(particleCode)
+      && bufferStream.ReadInt(particle.pid)
+      && bufferStream.ReadDbl(particle.px)
+      && bufferStream.ReadDbl(particle.py)
+      && bufferStream.ReadDbl(particle.pz)
+      && bufferStream.ReadDbl(particle.e)
+      && bufferStream.ReadDbl(particle.mass)
+      && bufferStream.ReadInt(particle.status)
+      && bufferStream.ReadDbl(theta)
+      && bufferStream.ReadDbl(phi)
+      && bufferStream.ReadInt(inVertexCode);
 
     if(!rc)
     {
@@ -270,16 +409,18 @@ bool DelphesHepMC2Reader::ReadBlock(DelphesFactory *factory,
       return kFALSE;
     }
 
-    if(fInVertexCode < 0)
+    particleCounter = fEvent.particles.size();
+
+    if(inVertexCode < 0)
     {
-      itMotherMap = fMotherMap.find(fInVertexCode);
+      itMotherMap = fMotherMap.find(inVertexCode);
       if(itMotherMap == fMotherMap.end())
       {
-        fMotherMap[fInVertexCode] = make_pair(fParticleCounter, -1);
+        fMotherMap[inVertexCode] = make_pair(particleCounter, -1);
       }
       else
       {
-        itMotherMap->second.second = fParticleCounter;
+        itMotherMap->second.second = particleCounter;
       }
     }
 
@@ -288,16 +429,43 @@ bool DelphesHepMC2Reader::ReadBlock(DelphesFactory *factory,
       itDaughterMap = fDaughterMap.find(fOutVertexCode);
       if(itDaughterMap == fDaughterMap.end())
       {
-        fDaughterMap[fOutVertexCode] = make_pair(fParticleCounter, fParticleCounter);
+        fDaughterMap[fOutVertexCode] = make_pair(particleCounter, particleCounter);
       }
       else
       {
-        itDaughterMap->second.second = fParticleCounter;
+        itDaughterMap->second.second = particleCounter;
       }
     }
 
-    AnalyzeParticle(factory, allParticleOutputArray,
-      stableParticleOutputArray, partonOutputArray);
+    if(fMomentumCoefficient != 1.0)
+    {
+      particle.px *= fMomentumCoefficient;
+      particle.py *= fMomentumCoefficient;
+      particle.pz *= fMomentumCoefficient;
+      particle.e *= fMomentumCoefficient;
+    }
+
+    particle.m2 = 1;
+    particle.d2 = 1;
+    if(fInCounter > 0)
+    {
+      particle.m1 = 1;
+      particle.x = 0.0;
+      particle.y = 0.0;
+      particle.z = 0.0;
+      particle.t = 0.0;
+    }
+    else
+    {
+      particle.m1 = fOutVertexCode;
+      particle.x = fX * fPositionCoefficient;
+      particle.y = fY * fPositionCoefficient;
+      particle.z = fZ * fPositionCoefficient;
+      particle.t = fT * fPositionCoefficient;
+    }
+    particle.d1 = inVertexCode < 0 ? inVertexCode : 1;
+
+    fEvent.particles.push_back(particle);
 
     if(fInCounter > 0)
     {
@@ -307,13 +475,11 @@ bool DelphesHepMC2Reader::ReadBlock(DelphesFactory *factory,
     {
       --fOutCounter;
     }
-
-    ++fParticleCounter;
   }
 
-  if(EventReady())
+  if(EventComplete())
   {
-    FinalizeParticles(allParticleOutputArray);
+    FinalizeParticles();
   }
 
   return kTRUE;
@@ -325,26 +491,27 @@ void DelphesHepMC2Reader::AnalyzeEvent(ExRootTreeBranch *branch, long long event
   TStopwatch *readStopWatch, TStopwatch *procStopWatch)
 {
   HepMCEvent *element;
+  const TEventRecord &event = fQueue.empty() ? fEvent : fOutputEvent;
 
   element = static_cast<HepMCEvent *>(branch->NewEntry());
-  element->Number = fEventNumber;
-
-  element->ProcessID = fProcessID;
-  element->MPI = fMPI;
-  element->Weight = fWeight.size() > 0 ? fWeight[0] : 1.0;
-  element->CrossSection = fCrossSection;
-  element->CrossSectionError = fCrossSectionError;
-  element->Scale = fScale;
-  element->AlphaQED = fAlphaQED;
-  element->AlphaQCD = fAlphaQCD;
-
-  element->ID1 = fID1;
-  element->ID2 = fID2;
-  element->X1 = fX1;
-  element->X2 = fX2;
-  element->ScalePDF = fScalePDF;
-  element->PDF1 = fPDF1;
-  element->PDF2 = fPDF2;
+  element->Number = event.eventNumber;
+
+  element->ProcessID = event.processID;
+  element->MPI = event.mpi;
+  element->Weight = event.weight.size() > 0 ? event.weight[0] : 1.0;
+  element->CrossSection = event.crossSection;
+  element->CrossSectionError = event.crossSectionError;
+  element->Scale = event.scale;
+  element->AlphaQED = event.alphaQED;
+  element->AlphaQCD = event.alphaQCD;
+
+  element->ID1 = event.id1;
+  element->ID2 = event.id2;
+  element->X1 = event.x1;
+  element->X2 = event.x2;
+  element->ScalePDF = event.scalePDF;
+  element->PDF1 = event.pdf1;
+  element->PDF2 = event.pdf2;
 
   element->ReadTime = readStopWatch->RealTime();
   element->ProcTime = procStopWatch->RealTime();
@@ -356,8 +523,9 @@ void DelphesHepMC2Reader::AnalyzeWeight(ExRootTreeBranch *branch)
 {
   Weight *element;
   vector<double>::const_iterator itWeight;
+  const TEventRecord &event = fQueue.empty() ? fEvent : fOutputEvent;
 
-  for(itWeight = fWeight.begin(); itWeight != fWeight.end(); ++itWeight)
+  for(itWeight = event.weight.begin(); itWeight != event.weight.end(); ++itWeight)
   {
     element = static_cast<Weight *>(branch->NewEntry());
 
@@ -368,6 +536,7 @@ void DelphesHepMC2Reader::AnalyzeWeight(ExRootTreeBranch *branch)
 //---------------------------------------------------------------------------
 
 void DelphesHepMC2Reader::AnalyzeParticle(DelphesFactory *factory,
+  const TParticleRecord &particle,
   TObjArray *allParticleOutputArray,
   TObjArray *stableParticleOutputArray,
   TObjArray *partonOutputArray)
@@ -378,51 +547,30 @@ void DelphesHepMC2Reader::AnalyzeParticle(DelphesFactory *factory,
 
   candidate = factory->NewCandidate();
 
-  candidate->PID = fPID;
+  candidate->PID = particle.pid;
   pdgCode = TMath::Abs(candidate->PID);
 
-  candidate->Status = fStatus;
+  candidate->Status = particle.status;
 
-  pdgParticle = fPDG->GetParticle(fPID);
+  pdgParticle = fPDG->GetParticle(particle.pid);
   candidate->Charge = pdgParticle ? int(pdgParticle->Charge() / 3.0) : -999;
-  candidate->Mass = fMass;
+  candidate->Mass = particle.mass;
 
-  candidate->Momentum.SetPxPyPzE(fPx, fPy, fPz, fE);
-  if(fMomentumCoefficient != 1.0)
-  {
-    candidate->Momentum *= fMomentumCoefficient;
-  }
+  candidate->Momentum.SetPxPyPzE(particle.px, particle.py, particle.pz, particle.e);
 
-  candidate->M2 = 1;
-  candidate->D2 = 1;
-  if(fInCounter > 0)
-  {
-    candidate->M1 = 1;
-    candidate->Position.SetXYZT(0.0, 0.0, 0.0, 0.0);
-  }
-  else
-  {
-    candidate->M1 = fOutVertexCode;
-    candidate->Position.SetXYZT(fX, fY, fZ, fT);
-    if(fPositionCoefficient != 1.0)
-    {
-      candidate->Position *= fPositionCoefficient;
-    }
-  }
-  if(fInVertexCode < 0)
-  {
-    candidate->D1 = fInVertexCode;
-  }
-  else
-  {
-    candidate->D1 = 1;
-  }
+  candidate->M1 = particle.m1;
+  candidate->M2 = particle.m2;
+  candidate->D1 = particle.d1;
+  candidate->D2 = particle.d2;
+
+  candidate->Position.SetXYZT(particle.x, particle.y, particle.z, particle.t);
+  candidate->DecayPosition.SetXYZT(particle.decayX, particle.decayY, particle.decayZ, particle.decayT);
 
   allParticleOutputArray->Add(candidate);
 
   if(!pdgParticle) return;
 
-  if(fStatus == 1)
+  if(particle.status == 1)
   {
     stableParticleOutputArray->Add(candidate);
   }
@@ -434,64 +582,76 @@ void DelphesHepMC2Reader::AnalyzeParticle(DelphesFactory *factory,
 
 //---------------------------------------------------------------------------
 
-void DelphesHepMC2Reader::FinalizeParticles(TObjArray *allParticleOutputArray)
+void DelphesHepMC2Reader::FinalizeParticles()
 {
-  Candidate *candidate;
-  Candidate *candidateDaughter;
   map<int, pair<int, int> >::iterator itMotherMap;
   map<int, pair<int, int> >::iterator itDaughterMap;
-  int i;
+  vector<TParticleRecord>::iterator itParticle;
+  const TParticleRecord *decayParticle;
 
-  for(i = 0; i < allParticleOutputArray->GetEntriesFast(); ++i)
+  for(itParticle = fEvent.particles.begin(); itParticle != fEvent.particles.end(); ++itParticle)
   {
-    candidate = static_cast<Candidate *>(allParticleOutputArray->At(i));
-
+    TParticleRecord &particle = *itParticle;
 
-    if(candidate->M1 > 0)
+    if(particle.m1 > 0)
     {
-      candidate->M1 = -1;
-      candidate->M2 = -1;
+      particle.m1 = -1;
+      particle.m2 = -1;
     }
     else
     {
-      itMotherMap = fMotherMap.find(candidate->M1);
+      itMotherMap = fMotherMap.find(particle.m1);
       if(itMotherMap == fMotherMap.end())
       {
-        candidate->M1 = -1;
-        candidate->M2 = -1;
+        particle.m1 = -1;
+        particle.m2 = -1;
       }
       else
       {
-        candidate->M1 = itMotherMap->second.first;
-        candidate->M2 = itMotherMap->second.second;
+        particle.m1 = itMotherMap->second.first;
+        particle.m2 = itMotherMap->second.second;
       }
     }
-    if(candidate->D1 > 0)
+
+    decayParticle = 0;
+    if(particle.d1 > 0)
     {
-      candidate->D1 = -1;
-      candidate->D2 = -1;
+      particle.d1 = -1;
+      particle.d2 = -1;
     }
     else
     {
-      itDaughterMap = fDaughterMap.find(candidate->D1);
+      itDaughterMap = fDaughterMap.find(particle.d1);
       if(itDaughterMap == fDaughterMap.end())
       {
-        candidate->D1 = -1;
-        candidate->D2 = -1;
-        const TLorentzVector &decayPosition = candidate->Position;
-        candidate->DecayPosition.SetXYZT(decayPosition.X(), decayPosition.Y(), decayPosition.Z(), decayPosition.T());// decay position
-     }
+        particle.d1 = -1;
+        particle.d2 = -1;
+        decayParticle = &particle;
+      }
       else
       {
-        candidate->D1 = itDaughterMap->second.first;
-        candidate->D2 = itDaughterMap->second.second;
-        candidateDaughter = static_cast<Candidate *>(allParticleOutputArray->At(candidate->D1));
-        const TLorentzVector &decayPosition = candidateDaughter->Position;
-        candidate->DecayPosition.SetXYZT(decayPosition.X(), decayPosition.Y(), decayPosition.Z(), decayPosition.T());// decay position
-        
-
+        particle.d1 = itDaughterMap->second.first;
+        particle.d2 = itDaughterMap->second.second;
+        decayParticle = &fEvent.particles[particle.d1];
       }
     }
+
+    // decay position
+
+    if(decayParticle)
+    {
+      particle.decayX = decayParticle->x;
+      particle.decayY = decayParticle->y;
+      particle.decayZ = decayParticle->z;
+      particle.decayT = decayParticle->t;
+    }
+    else
+    {
+      particle.decayX = 0.0;
+      particle.decayY = 0.0;
+      particle.decayZ = 0.0;
+      particle.decayT = 0.0;
+    }
   }
 }
 
@@ -23,11 +23,19 @@
  *
  *  Reads HepMC file
  *
+ *  With SetReadAhead(size), a separate thread reads and parses the input
+ *  file into a ring of up to size decoded events, and ReadBlock only
+ *  creates the candidates of the next decoded event.
+ *
  *  \author P. Demin - UCL, Louvain-la-Neuve
  *
  */
 
+#include <atomic>
+#include <condition_variable>
 #include <map>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 #include <stdio.h>
@@ -44,7 +52,10 @@ public:
   DelphesHepMC2Reader();
   ~DelphesHepMC2Reader();
 
+  void SetReadAhead(int size);
+
   void SetInputFile(FILE *inputFile);
+  void StopReadAhead();
 
   void Clear();
   bool EventReady();
@@ -60,12 +71,43 @@ public:
   void AnalyzeWeight(ExRootTreeBranch *branch);
 
 private:
+  struct TParticleRecord
+  {
+    int pid, status, m1, m2, d1, d2;
+    double px, py, pz, e, mass;
+    double x, y, z, t;
+    double decayX, decayY, decayZ, decayT;
+  };
+
+  struct TEventRecord
+  {
+    int eventNumber, mpi, processID, signalCode, beamCode[2];
+    double scale, alphaQCD, alphaQED;
+
+    std::vector<int> state;
+    std::vector<double> weight;
+
+    double crossSection, crossSectionError;
+
+    int id1, id2;
+    double x1, x2, scalePDF, pdf1, pdf2;
+
+    std::vector<TParticleRecord> particles;
+  };
+
+  void ClearEvent();
+  bool ReadLine();
+  bool EventComplete() const;
+
+  void ReadAheadLoop();
+
   void AnalyzeParticle(DelphesFactory *factory,
+    const TParticleRecord &particle,
     TObjArray *allParticleOutputArray,
     TObjArray *stableParticleOutputArray,
     TObjArray *partonOutputArray);
 
-  void FinalizeParticles(TObjArray *allParticleOutputArray);
+  void FinalizeParticles();
 
   FILE *fInputFile;
 
@@ -73,32 +115,28 @@ private:
 
   TDatabasePDG *fPDG;
 
-  int fEventNumber, fMPI, fProcessID, fSignalCode, fVertexCounter, fBeamCode[2];
-  double fScale, fAlphaQCD, fAlphaQED;
-
-  double fMomentumCoefficient, fPositionCoefficient;
+  bool fEventReady;
 
-  int fStateSize;
-  std::vector<int> fState;
+  TEventRecord fEvent, fOutputEvent;
 
-  int fWeightSize;
-  std::vector<double> fWeight;
+  int fVertexCounter;
 
-  double fCrossSection, fCrossSectionError;
-
-  int fID1, fID2;
-  double fX1, fX2, fScalePDF, fPDF1, fPDF2;
+  double fMomentumCoefficient, fPositionCoefficient;
 
   int fOutVertexCode, fVertexID, fInCounter, fOutCounter;
   double fX, fY, fZ, fT;
 
-  int fParticleCode, fPID, fStatus, fInVertexCode;
-  double fPx, fPy, fPz, fE, fMass, fTheta, fPhi;
-
-  int fParticleCounter;
-
   std::map<int, std::pair<int, int> > fMotherMap;
   std::map<int, std::pair<int, int> > fDaughterMap;
+
+  std::vector<TEventRecord> fQueue;
+  size_t fQueueHead, fQueueCount;
+  bool fQueueDone;
+  std::atomic<bool> fStop;
+
+  std::thread fThread;
+  std::mutex fMutex;
+  std::condition_variable fProducerCondition, fConsumerCondition;
 };
 
 #endif // DelphesHepMC2Reader_h
@@ -0,0 +1,542 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \class DelphesInputFile
+ *
+ *  Input file of the event readers, transparently decompressed.
+ *
+ *  Open() detects gzip, zstd, xz and lz4 files from their magic bytes.
+ *  A compressed file is decompressed on a helper thread into a pipe,
+ *  and the returned FILE pointer reads the decompressed data, so that
+ *  decompression overlaps with parsing. Other files are returned as they
+ *  are. GetLength() and GetPosition() refer to the bytes of the file on
+ *  disk and can be passed directly to ExRootProgressBar.
+ *
+ */
+
+#include "classes/DelphesInputFile.h"
+
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef HAS_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef HAS_ZSTD
+#include <zstd.h>
+#endif
+
+#ifdef HAS_LZMA
+#include <lzma.h>
+#endif
+
+#ifdef HAS_LZ4
+#include <lz4frame.h>
+#endif
+
+using namespace std;
+
+static const size_t kBufferSize = 1 << 20;
+
+//------------------------------------------------------------------------------
+
+DelphesInputFile::DelphesInputFile() :
+  fFile(0), fCompressedFile(0), fCodec(kNone), fLength(0), fPipe(-1),
+  fInputBuffer(0), fOutputBuffer(0), fFileBuffer(0), fPosition(0), fStop(false)
+{
+}
+
+//------------------------------------------------------------------------------
+
+DelphesInputFile::~DelphesInputFile()
+{
+  Stop();
+
+  if(fFile && fFile != stdin) fclose(fFile);
+  if(fCompressedFile) fclose(fCompressedFile);
+
+  if(fInputBuffer) delete[] fInputBuffer;
+  if(fOutputBuffer) delete[] fOutputBuffer;
+  if(fFileBuffer) delete[] fFileBuffer;
+}
+
+//------------------------------------------------------------------------------
+
+FILE *DelphesInputFile::Open(const char *fileName, const char *mode)
+{
+  stringstream message;
+  unsigned char header[6];
+  size_t size;
+  bool supported;
+  int fd[2];
+
+  Close();
+
+  fFileName = fileName;
+  fCodec = kNone;
+
+  if(fFileName == "-")
+  {
+    fFile = stdin;
+    fLength = -1;
+    return fFile;
+  }
+
+  fCompressedFile = fopen(fileName, mode);
+  if(!fCompressedFile)
+  {
+    message << "can't open " << fileName;
+    throw runtime_error(message.str());
+  }
+
+  fseeko(fCompressedFile, 0L, SEEK_END);
+  fLength = ftello(fCompressedFile);
+  fseeko(fCompressedFile, 0L, SEEK_SET);
+
+  size = fread(header, 1, sizeof(header), fCompressedFile);
+  fseeko(fCompressedFile, 0L, SEEK_SET);
+
+  fCodec = Detect(header, size);
+
+  if(fCodec == kNone)
+  {
+    fFile = fCompressedFile;
+    fCompressedFile = 0;
+    return fFile;
+  }
+
+  supported = false;
+#ifdef HAS_ZLIB
+  if(fCodec == kGzip) supported = true;
+#endif
+#ifdef HAS_ZSTD
+  if(fCodec == kZstd) supported = true;
+#endif
+#ifdef HAS_LZMA
+  if(fCodec == kXz) supported = true;
+#endif
+#ifdef HAS_LZ4
+  if(fCodec == kLz4) supported = true;
+#endif
+
+  if(!supported)
+  {
+    fclose(fCompressedFile);
+    fCompressedFile = 0;
+    message << fileName << " is compressed with " << GetCodecName(fCodec);
+    message << ", but Delphes was built without " << GetCodecName(fCodec) << " support";
+    throw runtime_error(message.str());
+  }
+
+  if(pipe(fd) != 0)
+  {
+    fclose(fCompressedFile);
+    fCompressedFile = 0;
+    message << "can't create pipe to decompress " << fileName;
+    throw runtime_error(message.str());
+  }
+
+#ifdef F_SETPIPE_SZ
+  // a larger pipe lets the helper thread run further ahead of the parser,
+  // the default size is kept if the system does not allow it
+  fcntl(fd[1], F_SETPIPE_SZ, int(kBufferSize));
+#endif
+
+  fPipe = fd[1];
+  fFile = fdopen(fd[0], mode);
+
+  if(!fInputBuffer) fInputBuffer = new char[kBufferSize];
+  if(!fOutputBuffer) fOutputBuffer = new char[kBufferSize];
+  if(!fFileBuffer) fFileBuffer = new char[kBufferSize];
+
+  setvbuf(fFile, fFileBuffer, _IOFBF, kBufferSize);
+
+  fPosition = 0;
+  fStop = false;
+  fError.clear();
+
+  fThread = thread(&DelphesInputFile::Decompress, this);
+
+  return fFile;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesInputFile::Close()
+{
+  stringstream message;
+
+  Stop();
+
+  if(fFile && fFile != stdin) fclose(fFile);
+  if(fCompressedFile) fclose(fCompressedFile);
+
+  fFile = 0;
+  fCompressedFile = 0;
+
+  if(!fError.empty())
+  {
+    message << "can't decompress " << fFileName << ": " << fError;
+    fError.clear();
+    throw runtime_error(message.str());
+  }
+}
+
+//------------------------------------------------------------------------------
+
+int64_t DelphesInputFile::GetPosition() const
+{
+  if(fCodec != kNone) return fPosition;
+  return fFile ? ftello(fFile) : 0;
+}
+
+//------------------------------------------------------------------------------
+
+DelphesInputFile::ECodec DelphesInputFile::Detect(const unsigned char *header, size_t size)
+{
+  if(size >= 2 && header[0] == 0x1f && header[1] == 0x8b) return kGzip;
+  if(size >= 4 && memcmp(header, "\x28\xb5\x2f\xfd", 4) == 0) return kZstd;
+  if(size >= 6 && memcmp(header, "\xfd\x37\x7a\x58\x5a\x00", 6) == 0) return kXz;
+  if(size >= 4 && memcmp(header, "\x04\x22\x4d\x18", 4) == 0) return kLz4;
+  return kNone;
+}
+
+//------------------------------------------------------------------------------
+
+const char *DelphesInputFile::GetCodecName(ECodec codec)
+{
+  switch(codec)
+  {
+    case kGzip: return "gzip";
+    case kZstd: return "zstd";
+    case kXz: return "xz";
+    case kLz4: return "lz4";
+    default: return "none";
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesInputFile::Decompress()
+{
+  // errors are reported by Close(), the parser only sees the end of the pipe
+
+  try
+  {
+    switch(fCodec)
+    {
+      case kGzip:
+        DecompressGzip();
+        break;
+      case kZstd:
+        DecompressZstd();
+        break;
+      case kXz:
+        DecompressXz();
+        break;
+      case kLz4:
+        DecompressLz4();
+        break;
+      default:
+        break;
+    }
+  }
+  catch(runtime_error &e)
+  {
+    fError = e.what();
+  }
+
+  close(fPipe);
+  fPipe = -1;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesInputFile::DecompressGzip()
+{
+#ifdef HAS_ZLIB
+  z_stream stream;
+  const char *error = 0;
+  bool full = false;
+  int rc = Z_OK;
+
+  memset(&stream, 0, sizeof(stream));
+
+  // automatic gzip and zlib header detection
+  if(inflateInit2(&stream, 15 + 32) != Z_OK)
+  {
+    throw runtime_error("can't initialize zlib");
+  }
+
+  while(true)
+  {
+    if(stream.avail_in == 0 && !full)
+    {
+      stream.next_in = reinterpret_cast<Bytef *>(fInputBuffer);
+      stream.avail_in = ReadInput();
+      if(stream.avail_in == 0) break;
+    }
+
+    stream.next_out = reinterpret_cast<Bytef *>(fOutputBuffer);
+    stream.avail_out = kBufferSize;
+
+    rc = inflate(&stream, Z_NO_FLUSH);
+    if(rc != Z_OK && rc != Z_STREAM_END && rc != Z_BUF_ERROR)
+    {
+      error = stream.msg ? stream.msg : "corrupted data";
+      break;
+    }
+
+    full = stream.avail_out == 0;
+
+    if(!WriteOutput(fOutputBuffer, kBufferSize - stream.avail_out)) break;
+
+    // next member of a concatenated file
+    if(rc == Z_STREAM_END && (stream.avail_in > 0 || !feof(fCompressedFile)))
+    {
+      inflateReset(&stream);
+    }
+  }
+
+  inflateEnd(&stream);
+
+  if(error) throw runtime_error(error);
+  if(rc != Z_STREAM_END && !fStop) throw runtime_error("unexpected end of file");
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesInputFile::DecompressZstd()
+{
+#ifdef HAS_ZSTD
+  ZSTD_DCtx *context;
+  ZSTD_inBuffer input;
+  ZSTD_outBuffer output;
+  const char *error = 0;
+  size_t rc = 0;
+
+  context = ZSTD_createDCtx();
+  if(!context)
+  {
+    throw runtime_error("can't initialize zstd");
+  }
+
+  // accept files written with a long window (zstd --long)
+  ZSTD_DCtx_setParameter(context, ZSTD_d_windowLogMax, sizeof(size_t) == 4 ? 30 : 31);
+
+  output.dst = fOutputBuffer;
+  output.size = kBufferSize;
+  output.pos = 0;
+
+  while(!error && !fStop && (input.size = ReadInput()) > 0)
+  {
+    input.src = fInputBuffer;
+    input.pos = 0;
+
+    // a full output buffer may leave data inside the decoder
+    do
+    {
+      output.pos = 0;
+      rc = ZSTD_decompressStream(context, &output, &input);
+      if(ZSTD_isError(rc))
+      {
+        error = ZSTD_getErrorName(rc);
+        break;
+      }
+      if(!WriteOutput(fOutputBuffer, output.pos)) break;
+    } while(input.pos < input.size || output.pos == output.size);
+  }
+
+  ZSTD_freeDCtx(context);
+
+  if(error) throw runtime_error(error);
+  if(rc != 0 && !fStop) throw runtime_error("unexpected end of file");
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesInputFile::DecompressXz()
+{
+#ifdef HAS_LZMA
+  lzma_stream stream = LZMA_STREAM_INIT;
+  lzma_action action = LZMA_RUN;
+  const char *error = 0;
+  bool full = false;
+  lzma_ret rc;
+
+#if LZMA_VERSION >= 50040002
+  // files written with xz -T split into blocks that are decoded in parallel
+  lzma_mt options;
+  memset(&options, 0, sizeof(options));
+  options.flags = LZMA_CONCATENATED;
+  options.threads = thread::hardware_concurrency();
+  if(options.threads < 1) options.threads = 1;
+  options.memlimit_threading = lzma_physmem() / 4;
+  options.memlimit_stop = UINT64_MAX;
+  rc = lzma_stream_decoder_mt(&stream, &options);
+#else
+  rc = lzma_stream_decoder(&stream, UINT64_MAX, LZMA_CONCATENATED);
+#endif
+
+  if(rc != LZMA_OK)
+  {
+    throw runtime_error("can't initialize liblzma");
+  }
+
+  while(true)
+  {
+    if(stream.avail_in == 0 && !full && action == LZMA_RUN)
+    {
+      stream.next_in = reinterpret_cast<uint8_t *>(fInputBuffer);
+      stream.avail_in = ReadInput();
+      if(stream.avail_in == 0) action = LZMA_FINISH;
+    }
+
+    stream.next_out = reinterpret_cast<uint8_t *>(fOutputBuffer);
+    stream.avail_out = kBufferSize;
+
+    rc = lzma_code(&stream, action);
+    if(rc != LZMA_OK && rc != LZMA_STREAM_END)
+    {
+      error = rc == LZMA_BUF_ERROR ? "unexpected end of file" : "corrupted data";
+      break;
+    }
+
+    full = stream.avail_out == 0;
+
+    if(!WriteOutput(fOutputBuffer, kBufferSize - stream.avail_out)) break;
+
+    if(rc == LZMA_STREAM_END) break;
+  }
+
+  lzma_end(&stream);
+
+  if(error) throw runtime_error(error);
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesInputFile::DecompressLz4()
+{
+#ifdef HAS_LZ4
+  LZ4F_dctx *context;
+  const char *error = 0;
+  size_t size, position, inputSize, outputSize, rc = 0;
+
+  if(LZ4F_isError(LZ4F_createDecompressionContext(&context, LZ4F_VERSION)))
+  {
+    throw runtime_error("can't initialize lz4");
+  }
+
+  while(!error && !fStop && (size = ReadInput()) > 0)
+  {
+    position = 0;
+
+    // a full output buffer may leave data inside the decoder
+    do
+    {
+      inputSize = size - position;
+      outputSize = kBufferSize;
+      rc = LZ4F_decompress(context, fOutputBuffer, &outputSize, fInputBuffer + position, &inputSize, 0);
+      if(LZ4F_isError(rc))
+      {
+        error = LZ4F_getErrorName(rc);
+        break;
+      }
+      position += inputSize;
+      if(!WriteOutput(fOutputBuffer, outputSize)) break;
+    } while(position < size || outputSize == kBufferSize);
+  }
+
+  LZ4F_freeDecompressionContext(context);
+
+  if(error) throw runtime_error(error);
+  if(rc != 0 && !fStop) throw runtime_error("unexpected end of file");
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+size_t DelphesInputFile::ReadInput()
+{
+  size_t size;
+
+  if(fStop) return 0;
+
+  size = fread(fInputBuffer, 1, kBufferSize, fCompressedFile);
+  if(ferror(fCompressedFile))
+  {
+    throw runtime_error(strerror(errno));
+  }
+
+  fPosition += size;
+
+  return size;
+}
+
+//------------------------------------------------------------------------------
+
+bool DelphesInputFile::WriteOutput(const char *data, size_t size)
+{
+  ssize_t rc;
+
+  while(size > 0)
+  {
+    if(fStop) return false;
+
+    rc = write(fPipe, data, size);
+    if(rc < 0)
+    {
+      if(errno == EINTR) continue;
+      throw runtime_error(strerror(errno));
+    }
+
+    data += rc;
+    size -= rc;
+  }
+
+  return !fStop;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesInputFile::Stop()
+{
+  char buffer[4096];
+
+  if(!fThread.joinable()) return;
+
+  // unblock the helper thread by reading the pipe until it is closed
+
+  fStop = true;
+  while(fread(buffer, 1, sizeof(buffer), fFile) > 0) continue;
+
+  fThread.join();
+}
@@ -0,0 +1,104 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesInputFile_h
+#define DelphesInputFile_h
+
+/** \class DelphesInputFile
+ *
+ *  Input file of the event readers, transparently decompressed.
+ *
+ *  Open() detects gzip, zstd, xz and lz4 files from their magic bytes.
+ *  A compressed file is decompressed on a helper thread into a pipe,
+ *  and the returned FILE pointer reads the decompressed data, so that
+ *  decompression overlaps with parsing. Other files are returned as they
+ *  are. GetLength() and GetPosition() refer to the bytes of the file on
+ *  disk and can be passed directly to ExRootProgressBar.
+ *
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+class DelphesInputFile
+{
+public:
+  enum ECodec
+  {
+    kNone,
+    kGzip,
+    kZstd,
+    kXz,
+    kLz4
+  };
+
+  DelphesInputFile();
+  ~DelphesInputFile();
+
+  // "-" opens the standard input, which is never decompressed
+  FILE *Open(const char *fileName, const char *mode = "r");
+  void Close();
+
+  FILE *GetFile() const { return fFile; }
+
+  ECodec GetCodec() const { return fCodec; }
+  bool IsCompressed() const { return fCodec != kNone; }
+
+  int64_t GetLength() const { return fLength; }
+  int64_t GetPosition() const;
+
+  static ECodec Detect(const unsigned char *header, size_t size);
+  static const char *GetCodecName(ECodec codec);
+
+private:
+  void Decompress();
+
+  void DecompressGzip();
+  void DecompressZstd();
+  void DecompressXz();
+  void DecompressLz4();
+
+  size_t ReadInput();
+  bool WriteOutput(const char *data, size_t size);
+
+  void Stop();
+
+  std::string fFileName;
+
+  FILE *fFile;
+  FILE *fCompressedFile;
+
+  ECodec fCodec;
+  int64_t fLength;
+
+  int fPipe;
+
+  char *fInputBuffer, *fOutputBuffer, *fFileBuffer;
+
+  std::thread fThread;
+  std::atomic<int64_t> fPosition;
+  std::atomic<bool> fStop;
+
+  std::string fError;
+};
+
+#endif // DelphesInputFile_h
@@ -26,36 +26,153 @@
 
 #include "classes/DelphesLHEFReader.h"
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
 
 #include <stdio.h>
+#include <string.h>
 
+#include "TArrayI.h"
 #include "TDatabasePDG.h"
+#include "TDirectory.h"
 #include "TLorentzVector.h"
 #include "TObjArray.h"
 #include "TParticlePDG.h"
 #include "TStopwatch.h"
+#include "TString.h"
+#include "TTree.h"
 
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesStream.h"
 
 #include "ExRootAnalysis/ExRootTreeBranch.h"
+#include "ExRootAnalysis/ExRootTreeWriter.h"
 
 using namespace std;
 
-static const int kBufferSize = 16384;
+static const size_t kBufferSize = 1048576;
+
+static const char kEventStart[] = "<event>";
+static const char kEventStop[] = "</event>";
+
+static const double kPowersOfTen[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
 
 //---------------------------------------------------------------------------
 
-DelphesLHEFReader::DelphesLHEFReader() :
-  fInputFile(0), fBuffer(0), fPDG(0),
-  fEventReady(kFALSE), fEventCounter(-1), fParticleCounter(-1), fCrossSection(1)
+static char *FindString(char *begin, char *end, const char *value)
+{
+  if(begin >= end) return 0;
+  return static_cast<char *>(memmem(begin, end - begin, value, strlen(value)));
+}
+
+//---------------------------------------------------------------------------
+
+static char *NextLine(char *line, char *end)
+{
+  char *next;
+
+  // the current line is terminated, so that it can be parsed as a c string
+
+  next = static_cast<char *>(memchr(line, '\n', end - line));
+  if(!next) return end;
+
+  *next = '\0';
+  return next + 1;
+}
+
+//---------------------------------------------------------------------------
+
+static bool ScanNumber(char *&position, double &value)
+{
+  char *start, *p, *q;
+  unsigned long long mantissa = 0;
+  int digits = 0, exponent = 0, power = 0;
+  bool negative = false, found = false, powerNegative = false;
+
+  // decimal numbers with at most 15 significant digits and a small exponent
+  // are converted exactly by a single multiplication or division by a power of ten,
+  // the other numbers (more digits, large exponents, inf, nan) are converted by strtod
+
+  p = position;
+  while(*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') ++p;
+  start = p;
+
+  if(*p == '-' || *p == '+') negative = *p++ == '-';
+
+  for(; *p >= '0' && *p <= '9'; ++p)
+  {
+    found = true;
+    if(digits < 19)
+    {
+      mantissa = mantissa * 10 + (*p - '0');
+      if(mantissa > 0) ++digits;
+    }
+    else
+    {
+      ++exponent;
+    }
+  }
+
+  if(*p == '.')
+  {
+    for(++p; *p >= '0' && *p <= '9'; ++p)
+    {
+      found = true;
+      if(digits < 19)
+      {
+        mantissa = mantissa * 10 + (*p - '0');
+        if(mantissa > 0) ++digits;
+        --exponent;
+      }
+    }
+  }
+
+  if(found && (*p == 'e' || *p == 'E'))
+  {
+    q = p + 1;
+    if(*q == '-' || *q == '+') powerNegative = *q++ == '-';
+    if(*q >= '0' && *q <= '9')
+    {
+      for(; *q >= '0' && *q <= '9'; ++q)
+      {
+        if(power < 10000) power = power * 10 + (*q - '0');
+      }
+      exponent += powerNegative ? -power : power;
+      p = q;
+    }
+  }
+
+  if(!found || digits > 15 || exponent < -22 || exponent > 22)
+  {
+    value = strtod(start, &p);
+    if(p == start) return false;
+    position = p;
+    return true;
+  }
+
+  value = double(mantissa);
+  value = exponent < 0 ? value / kPowersOfTen[-exponent] : value * kPowersOfTen[exponent];
+  if(negative) value = -value;
+
+  position = p;
+  return true;
+}
+
+//---------------------------------------------------------------------------
 
+DelphesLHEFReader::DelphesLHEFReader() :
+  fInputFile(0), fBuffer(0), fBufferSize(kBufferSize), fBegin(0), fEnd(0),
+  fBufferOffset(0), fEndOfFile(false), fPDG(0),
+  fEventReady(kFALSE), fParticleCounter(-1), fCrossSection(1),
+  fWeightArrayReady(false), fWeightArrayTruncated(false)
 {
-  fBuffer = new char[kBufferSize];
+  fBuffer = new char[fBufferSize + 1];
+  fBuffer[0] = '\0';
 
   fPDG = TDatabasePDG::Instance();
 }
@@ -72,6 +189,21 @@ DelphesLHEFReader::~DelphesLHEFReader()
 void DelphesLHEFReader::SetInputFile(FILE *inputFile)
 {
   fInputFile = inputFile;
+
+  fBegin = 0;
+  fEnd = 0;
+  fBuffer[0] = '\0';
+  fEndOfFile = false;
+
+  fBufferOffset = inputFile ? ftello(inputFile) : 0;
+  if(fBufferOffset < 0) fBufferOffset = 0;
+}
+
+//---------------------------------------------------------------------------
+
+int64_t DelphesLHEFReader::GetPosition() const
+{
+  return fBufferOffset + fBegin;
 }
 
 //---------------------------------------------------------------------------
@@ -79,9 +211,9 @@ void DelphesLHEFReader::SetInputFile(FILE *inputFile)
 void DelphesLHEFReader::Clear()
 {
   fEventReady = kFALSE;
-  fEventCounter = -1;
   fParticleCounter = -1;
-  fWeightList.clear();
+  fWeightIDs.clear();
+  fWeights.clear();
 }
 
 //---------------------------------------------------------------------------
@@ -93,57 +225,157 @@ bool DelphesLHEFReader::EventReady()
 
 //---------------------------------------------------------------------------
 
+bool DelphesLHEFReader::FillBuffer()
+{
+  char *buffer;
+  size_t size;
+
+  // move the data not yet parsed to the beginning of the buffer,
+  // the buffer is enlarged when a single event block does not fit in it
+
+  if(fBegin > 0)
+  {
+    memmove(fBuffer, fBuffer + fBegin, fEnd - fBegin);
+    fBufferOffset += fBegin;
+    fEnd -= fBegin;
+    fBegin = 0;
+  }
+  else if(fEnd == fBufferSize)
+  {
+    buffer = new char[2 * fBufferSize + 1];
+    memcpy(buffer, fBuffer, fEnd);
+    delete[] fBuffer;
+    fBuffer = buffer;
+    fBufferSize *= 2;
+  }
+
+  size = fread(fBuffer + fEnd, 1, fBufferSize - fEnd, fInputFile);
+  if(size < fBufferSize - fEnd) fEndOfFile = true;
+
+  fEnd += size;
+  fBuffer[fEnd] = '\0';
+
+  return size > 0;
+}
+
+//---------------------------------------------------------------------------
+
 bool DelphesLHEFReader::ReadBlock(DelphesFactory *factory,
   TObjArray *allParticleOutputArray,
   TObjArray *stableParticleOutputArray,
   TObjArray *partonOutputArray)
 {
-  int rc, id;
-  char *pch;
-  double weight, xsec;
+  char *begin, *end, *marker, *line;
 
-  if(!fgets(fBuffer, kBufferSize, fInputFile)) return kFALSE;
+  if(!fInputFile) return kFALSE;
 
-  if(strstr(fBuffer, "<event>"))
-  {
-    Clear();
-    fEventCounter = 1;
-  }
-  else if(fEventCounter > 0)
+  while(true)
   {
-    DelphesStream bufferStream(fBuffer);
+    begin = fBuffer + fBegin;
+    end = fBuffer + fEnd;
 
-    rc = bufferStream.ReadInt(fParticleCounter)
-      && bufferStream.ReadInt(fProcessID)
-      && bufferStream.ReadDbl(fWeight)
-      && bufferStream.ReadDbl(fScalePDF)
-      && bufferStream.ReadDbl(fAlphaQED)
-      && bufferStream.ReadDbl(fAlphaQCD);
-
-    if(!rc)
+    marker = FindString(begin, end, kEventStart);
+    if(marker)
     {
-      cerr << "** ERROR: "
-           << "invalid event format" << endl;
-      return kFALSE;
+      line = marker;
+      while(line > begin && line[-1] != '\n') --line;
+
+      // the text preceding the line of the event marker
+
+      if(line > begin)
+      {
+        fBegin = line - fBuffer;
+        return AnalyzeCrossSection(begin, line);
+      }
+
+      // the event block ends with the line of the closing marker
+
+      line = FindString(marker, end, kEventStop);
+      if(line)
+      {
+        line = static_cast<char *>(memchr(line, '\n', end - line));
+        line = line ? line + 1 : (fEndOfFile ? end : 0);
+      }
+
+      if(line)
+      {
+        fBegin = line - fBuffer;
+        return AnalyzeBlock(begin, line, factory, allParticleOutputArray,
+          stableParticleOutputArray, partonOutputArray);
+      }
     }
+    else
+    {
+      // without event marker, all the complete lines precede the next event
 
-    --fEventCounter;
+      line = end;
+      while(line > begin && line[-1] != '\n') --line;
+      if(line == begin && fEndOfFile) line = end;
+
+      if(line > begin)
+      {
+        fBegin = line - fBuffer;
+        return AnalyzeCrossSection(begin, line);
+      }
+    }
+
+    if(fEndOfFile || !FillBuffer()) return kFALSE;
   }
-  else if(fParticleCounter > 0)
+}
+
+//---------------------------------------------------------------------------
+
+bool DelphesLHEFReader::AnalyzeBlock(char *begin, char *end,
+  DelphesFactory *factory,
+  TObjArray *allParticleOutputArray,
+  TObjArray *stableParticleOutputArray,
+  TObjArray *partonOutputArray)
+{
+  int i, rc;
+  char *line, *next;
+
+  Clear();
+
+  // the event information follows the line of the event marker
+
+  line = NextLine(begin, end);
+  next = NextLine(line, end);
+
+  DelphesStream eventStream(line);
+
+  rc = eventStream.ReadInt(fParticleCounter)
+    && eventStream.ReadInt(fProcessID)
+    && eventStream.ReadDbl(fWeight)
+    && eventStream.ReadDbl(fScalePDF)
+    && eventStream.ReadDbl(fAlphaQED)
+    && eventStream.ReadDbl(fAlphaQCD);
+
+  if(!rc)
+  {
+    cerr << "** ERROR: "
+         << "invalid event format" << endl;
+    return kFALSE;
+  }
+
+  for(i = 0; i < fParticleCounter; ++i)
   {
-    DelphesStream bufferStream(fBuffer);
-
-    rc = bufferStream.ReadInt(fPID)
-      && bufferStream.ReadInt(fStatus)
-      && bufferStream.ReadInt(fM1)
-      && bufferStream.ReadInt(fM2)
-      && bufferStream.ReadInt(fC1)
-      && bufferStream.ReadInt(fC2)
-      && bufferStream.ReadDbl(fPx)
-      && bufferStream.ReadDbl(fPy)
-      && bufferStream.ReadDbl(fPz)
-      && bufferStream.ReadDbl(fE)
-      && bufferStream.ReadDbl(fMass);
+    line = next;
+    next = NextLine(line, end);
+
+    DelphesStream particleStream(line);
+
+    rc = line < end
+      && particleStream.ReadInt(fPID)
+      && particleStream.ReadInt(fStatus)
+      && particleStream.ReadInt(fM1)
+      && particleStream.ReadInt(fM2)
+      && particleStream.ReadInt(fC1)
+      && particleStream.ReadInt(fC2)
+      && particleStream.ReadDbl(fPx)
+      && particleStream.ReadDbl(fPy)
+      && particleStream.ReadDbl(fPz)
+      && particleStream.ReadDbl(fE)
+      && particleStream.ReadDbl(fMass);
 
     if(!rc)
     {
@@ -154,12 +386,34 @@ bool DelphesLHEFReader::ReadBlock(DelphesFactory *factory,
 
     AnalyzeParticle(factory, allParticleOutputArray,
       stableParticleOutputArray, partonOutputArray);
-
-    --fParticleCounter;
   }
-  else if(strstr(fBuffer, "<wgt"))
+
+  // the optional blocks following the particles
+
+  if(!AnalyzeWeightBlock(next, end) || !AnalyzeCrossSection(next, end)) return kFALSE;
+
+  fEventReady = kTRUE;
+
+  return kTRUE;
+}
+
+//---------------------------------------------------------------------------
+
+bool DelphesLHEFReader::AnalyzeWeightBlock(char *begin, char *end)
+{
+  char *position, *pch;
+  int id;
+  double weight;
+
+  // <wgt id='...'> value </wgt>, usually grouped in a <rwgt> block,
+  // identifiers that are not integer numbers are stored as zero
+
+  position = begin;
+  while((position = FindString(position, end, "<wgt")))
   {
-    pch = strpbrk(fBuffer, "\"'");
+    position += 4;
+
+    pch = strpbrk(position, "\"'");
     if(!pch)
     {
       cerr << "** ERROR: "
@@ -167,32 +421,41 @@ bool DelphesLHEFReader::ReadBlock(DelphesFactory *factory,
       return kFALSE;
     }
 
+    id = 0;
     DelphesStream idStream(pch + 1);
-    rc = idStream.ReadInt(id);
+    idStream.ReadInt(id);
 
-    pch = strchr(fBuffer, '>');
-    if(!pch)
+    pch = strchr(position, '>');
+    if(!pch || !ScanNumber(++pch, weight))
     {
       cerr << "** ERROR: "
            << "invalid weight format" << endl;
       return kFALSE;
     }
 
-    DelphesStream weightStream(pch + 1);
-    rc = weightStream.ReadDbl(weight);
+    fWeightIDs.push_back(id);
+    fWeights.push_back(weight);
 
-    if(!rc)
-    {
-      cerr << "** ERROR: "
-           << "invalid weight format" << endl;
-      return kFALSE;
-    }
-
-    fWeightList.push_back(make_pair(id, weight));
+    position = pch;
   }
-  else if(strstr(fBuffer, "<xsecinfo"))
+
+  return kTRUE;
+}
+
+//---------------------------------------------------------------------------
+
+bool DelphesLHEFReader::AnalyzeCrossSection(char *begin, char *end)
+{
+  char *position, *pch;
+  int rc;
+  double xsec;
+
+  position = begin;
+  while((position = FindString(position, end, "<xsecinfo")))
   {
-    pch = strstr(fBuffer, "totxsec");
+    position += 9;
+
+    pch = strstr(position, "totxsec");
     if(!pch)
     {
       cerr << "** ERROR: "
@@ -220,10 +483,6 @@ bool DelphesLHEFReader::ReadBlock(DelphesFactory *factory,
 
     fCrossSection = xsec;
   }
-  else if(strstr(fBuffer, "</event>"))
-  {
-    fEventReady = kTRUE;
-  }
 
   return kTRUE;
 }
@@ -255,14 +514,75 @@ void DelphesLHEFReader::AnalyzeEvent(ExRootTreeBranch *branch, long long eventNu
 void DelphesLHEFReader::AnalyzeWeight(ExRootTreeBranch *branch)
 {
   LHEFWeight *element;
-  vector<pair<int, double> >::const_iterator itWeightList;
+  size_t i;
 
-  for(itWeightList = fWeightList.begin(); itWeightList != fWeightList.end(); ++itWeightList)
+  for(i = 0; i < fWeights.size(); ++i)
   {
     element = static_cast<LHEFWeight *>(branch->NewEntry());
 
-    element->ID = itWeightList->first;
-    element->Weight = itWeightList->second;
+    element->ID = fWeightIDs[i];
+    element->Weight = fWeights[i];
+  }
+}
+
+//---------------------------------------------------------------------------
+
+void DelphesLHEFReader::AnalyzeWeightArray(ExRootTreeWriter *treeWriter)
+{
+  TTree *tree;
+  size_t i, size;
+  unordered_map<int, size_t>::const_iterator itIndex;
+
+  // the branch is created with the first event, before any entry
+  // is written to the tree, and the identifiers, that are the same
+  // for all the events, are written once next to the tree
+
+  if(!fWeightArrayReady)
+  {
+    fWeightArrayReady = true;
+    fWeightArrayIDs = fWeightIDs;
+    fWeightArray.resize(fWeights.size());
+
+    for(i = 0; i < fWeightArrayIDs.size(); ++i)
+    {
+      fWeightArrayIndex[fWeightArrayIDs[i]] = i;
+    }
+
+    tree = treeWriter->GetTree();
+    if(tree && !fWeightArray.empty())
+    {
+      size = fWeightArray.size();
+      tree->Branch("WeightArray", &fWeightArray[0], Form("WeightArray[%d]/F", int(size)));
+
+      TArrayI weightIDs(size, &fWeightArrayIDs[0]);
+      if(tree->GetDirectory()) tree->GetDirectory()->WriteObject(&weightIDs, "WeightArrayID");
+    }
+  }
+
+  // the weights usually come in the order of the first event,
+  // otherwise they are placed according to their identifiers
+
+  if(fWeightIDs == fWeightArrayIDs)
+  {
+    copy(fWeights.begin(), fWeights.end(), fWeightArray.begin());
+    return;
+  }
+
+  fill(fWeightArray.begin(), fWeightArray.end(), 0.0f);
+
+  for(i = 0; i < fWeights.size(); ++i)
+  {
+    itIndex = fWeightArrayIndex.find(fWeightIDs[i]);
+    if(itIndex != fWeightArrayIndex.end())
+    {
+      fWeightArray[itIndex->second] = fWeights[i];
+    }
+    else if(!fWeightArrayTruncated)
+    {
+      fWeightArrayTruncated = true;
+      cout << "** WARNING: weight " << fWeightIDs[i] << " is not in the first event, ";
+      cout << "only the " << fWeightArray.size() << " weights of the first event are stored" << endl;
+    }
   }
 }
 
@@ -23,19 +23,27 @@
  *
  *  Reads LHEF file
  *
+ *  The input file is read in large chunks and each call to ReadBlock
+ *  parses either a whole event block or the text preceding the next
+ *  event. The <wgt> entries of an event are scanned into contiguous
+ *  arrays of identifiers and values, that can be written either as
+ *  LHEFWeight objects or as a single fixed-size array branch.
+ *
  *  \author P. Demin - UCL, Louvain-la-Neuve
  *
  */
 
+#include <stdint.h>
 #include <stdio.h>
 
-#include <utility>
+#include <unordered_map>
 #include <vector>
 
 class TObjArray;
 class TStopwatch;
 class TDatabasePDG;
 class ExRootTreeBranch;
+class ExRootTreeWriter;
 class DelphesFactory;
 
 class DelphesLHEFReader
@@ -44,8 +52,13 @@ public:
   DelphesLHEFReader();
   ~DelphesLHEFReader();
 
+  // the data read ahead is dropped, so the reader has to be
+  // set again after the input file is repositioned
   void SetInputFile(FILE *inputFile);
 
+  // offset in the input file of the first byte not yet parsed
+  int64_t GetPosition() const;
+
   void Clear();
   bool EventReady();
 
@@ -59,7 +72,24 @@ public:
 
   void AnalyzeWeight(ExRootTreeBranch *branch);
 
+  // the size of the array and the identifiers of its weights are set by
+  // the first event, the identifiers are written once as the TArrayI
+  // WeightArrayID in the output file, the weights of the following events
+  // are matched to them and the missing ones are set to zero
+  void AnalyzeWeightArray(ExRootTreeWriter *treeWriter);
+
 private:
+  bool FillBuffer();
+
+  bool AnalyzeBlock(char *begin, char *end,
+    DelphesFactory *factory,
+    TObjArray *allParticleOutputArray,
+    TObjArray *stableParticleOutputArray,
+    TObjArray *partonOutputArray);
+
+  bool AnalyzeWeightBlock(char *begin, char *end);
+  bool AnalyzeCrossSection(char *begin, char *end);
+
   void AnalyzeParticle(DelphesFactory *factory,
     TObjArray *allParticleOutputArray,
     TObjArray *stableParticleOutputArray,
@@ -68,20 +98,27 @@ private:
   FILE *fInputFile;
 
   char *fBuffer;
+  size_t fBufferSize, fBegin, fEnd;
+  int64_t fBufferOffset;
+  bool fEndOfFile;
 
   TDatabasePDG *fPDG;
 
   bool fEventReady;
 
-  int fEventCounter;
-
   int fParticleCounter, fProcessID;
   double fCrossSection, fWeight, fScalePDF, fAlphaQCD, fAlphaQED;
 
   int fPID, fStatus, fM1, fM2, fC1, fC2;
   double fPx, fPy, fPz, fE, fMass;
 
-  std::vector<std::pair<int, double> > fWeightList;
+  std::vector<int> fWeightIDs;
+  std::vector<float> fWeights;
+
+  bool fWeightArrayReady, fWeightArrayTruncated;
+  std::vector<int> fWeightArrayIDs;
+  std::vector<float> fWeightArray;
+  std::unordered_map<int, size_t> fWeightArrayIndex;
 };
 
 #endif // DelphesLHEFReader_h
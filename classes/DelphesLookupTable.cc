@@ -0,0 +1,139 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \class DelphesLookupTable
+ *
+ *  Flat copy of the content of a two-dimensional histogram.
+ *
+ */
+
+#include "classes/DelphesLookupTable.h"
+
+#include "TAxis.h"
+#include "TH2.h"
+
+//------------------------------------------------------------------------------
+
+DelphesLookupTable::DelphesLookupTable()
+{
+  fX.n = fY.n = 0;
+  fX.uniform = fY.uniform = kTRUE;
+  fX.min = fY.min = 0.0;
+  fX.max = fY.max = 0.0;
+  fX.scale = fY.scale = 0.0;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesLookupTable::SetAxis(TAxisBins &axis, const TAxis *source)
+{
+  Int_t i;
+
+  axis.n = source->GetNbins();
+  axis.min = source->GetXmin();
+  axis.max = source->GetXmax();
+  axis.uniform = !source->IsVariableBinSize();
+  axis.scale = axis.n / (axis.max - axis.min);
+
+  axis.edges.resize(axis.n + 1);
+  for(i = 0; i <= axis.n; ++i)
+  {
+    axis.edges[i] = source->GetBinLowEdge(i + 1);
+  }
+
+  // underflow and overflow bins take the width of the adjacent bin
+  axis.centers.resize(axis.n + 2);
+  for(i = 0; i < axis.n + 2; ++i)
+  {
+    axis.centers[i] = source->GetBinCenter(i);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesLookupTable::SetHistogram(const TH2 *hist)
+{
+  Int_t i, j;
+
+  SetAxis(fX, hist->GetXaxis());
+  SetAxis(fY, hist->GetYaxis());
+
+  fContent.resize((fX.n + 2) * (fY.n + 2));
+  for(i = 0; i < fX.n + 2; ++i)
+  {
+    for(j = 0; j < fY.n + 2; ++j)
+    {
+      fContent[i * (fY.n + 2) + j] = hist->GetBinContent(i, j);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+Int_t DelphesLookupTable::FindNeighbour(const TAxisBins &axis, Int_t bin, Double_t x, Double_t &weight)
+{
+  Int_t lower = x < axis.centers[bin] ? bin - 1 : bin;
+
+  // flat beyond the first and the last bin centres
+  if(lower < 1)
+  {
+    weight = 0.0;
+    return 1;
+  }
+  if(lower >= axis.n)
+  {
+    weight = 1.0;
+    return axis.n - 1 > 0 ? axis.n - 1 : 1;
+  }
+
+  weight = (x - axis.centers[lower]) / (axis.centers[lower + 1] - axis.centers[lower]);
+  return lower;
+}
+
+//------------------------------------------------------------------------------
+
+Double_t DelphesLookupTable::Interpolate(Double_t x, Double_t y) const
+{
+  Int_t binX, binY, i, j, stride = fY.n + 2;
+  Double_t wx, wy, v00, v01, v10, v11;
+
+  binX = fX.FindBin(x);
+  binY = fY.FindBin(y);
+
+  if(binX < 1 || binX > fX.n || binY < 1 || binY > fY.n || fX.n < 2 || fY.n < 2)
+  {
+    return fContent[binX * stride + binY];
+  }
+
+  i = FindNeighbour(fX, binX, x, wx);
+  j = FindNeighbour(fY, binY, y, wy);
+
+  v00 = fContent[i * stride + j];
+  v01 = fContent[i * stride + j + 1];
+  v10 = fContent[(i + 1) * stride + j];
+  v11 = fContent[(i + 1) * stride + j + 1];
+
+  if(v00 == 0.0 || v01 == 0.0 || v10 == 0.0 || v11 == 0.0)
+  {
+    return fContent[binX * stride + binY];
+  }
+
+  return (1.0 - wx) * ((1.0 - wy) * v00 + wy * v01) + wx * ((1.0 - wy) * v10 + wy * v11);
+}
+
+//------------------------------------------------------------------------------
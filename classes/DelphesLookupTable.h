@@ -0,0 +1,77 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesLookupTable_h
+#define DelphesLookupTable_h
+
+/** \class DelphesLookupTable
+ *
+ *  Flat copy of the content of a two-dimensional histogram, with the
+ *  bin search reduced to arithmetic for uniform axes. Bins follow the
+ *  TH2 conventions (bin 0 and bin n + 1 hold the underflow and the
+ *  overflow), and the content of a profile is its mean value.
+ *
+ */
+
+#include "classes/DelphesAxisBins.h"
+
+#include <vector>
+
+class TAxis;
+class TH2;
+
+class DelphesLookupTable
+{
+public:
+  DelphesLookupTable();
+
+  void SetHistogram(const TH2 *hist);
+
+  Int_t FindBin(Double_t x, Double_t y) const { return fX.FindBin(x) * (fY.n + 2) + fY.FindBin(y); }
+
+  Double_t GetBinContent(Int_t bin) const { return fContent[bin]; }
+
+  // content of the bin containing (x, y)
+  Double_t GetValue(Double_t x, Double_t y) const { return fContent[FindBin(x, y)]; }
+
+  // bilinear interpolation between the bin centres, the bin content is
+  // used outside the axis ranges and next to empty bins
+  Double_t Interpolate(Double_t x, Double_t y) const;
+
+  Double_t GetXmax() const { return fX.max; }
+
+  // centre of the last bin on the x axis
+  Double_t GetXLastCenter() const { return fX.centers[fX.n]; }
+
+private:
+  struct TAxisBins: public DelphesAxisBins
+  {
+    std::vector<Double_t> centers;
+  };
+
+  static void SetAxis(TAxisBins &axis, const TAxis *source);
+
+  // lower neighbour and weight of the upper neighbour for the interpolation
+  static Int_t FindNeighbour(const TAxisBins &axis, Int_t bin, Double_t x, Double_t &weight);
+
+  TAxisBins fX, fY;
+
+  std::vector<Double_t> fContent;
+};
+
+#endif /* DelphesLookupTable_h */
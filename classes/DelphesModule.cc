@@ -27,6 +27,7 @@
 #include "classes/DelphesModule.h"
 
 #include "classes/DelphesFactory.h"
+#include "classes/DelphesNeighbourIndex.h"
 
 #include "ExRootAnalysis/ExRootResult.h"
 #include "ExRootAnalysis/ExRootTreeBranch.h"
@@ -45,7 +46,7 @@
 using namespace std;
 
 DelphesModule::DelphesModule() :
-  fTreeWriter(0), fFactory(0), fPlots(0),
+  fTreeWriter(0), fFactory(0), fEventRejected(kFALSE), fPlots(0),
   fPlotFolder(0), fExportFolder(0)
 {
 }
@@ -112,6 +113,46 @@ TObjArray *DelphesModule::ExportArray(const char *name)
 
 //------------------------------------------------------------------------------
 
+DelphesNeighbourIndex *DelphesModule::ImportNeighbourIndex(const char *name)
+{
+  stringstream message;
+  TObjArray *array;
+  TFolder *folder;
+  DelphesNeighbourIndex *index;
+  string path(name);
+  size_t pos;
+
+  array = ImportArray(name);
+
+  // the index is stored next to the array in the export folder of its module
+  index = static_cast<DelphesNeighbourIndex *>(GetObject(Form("Export/%s.index", name), DelphesNeighbourIndex::Class()));
+  if(index) return index;
+
+  pos = path.rfind('/');
+  folder = 0;
+  if(pos != string::npos)
+  {
+    folder = static_cast<TFolder *>(GetObject(Form("Export/%s", path.substr(0, pos).c_str()), TFolder::Class()));
+  }
+  if(!folder)
+  {
+    message << "can't create index of input list '" << name;
+    message << "' in module '" << GetName() << "'";
+    throw runtime_error(message.str());
+  }
+
+  index = new DelphesNeighbourIndex;
+  index->SetName(Form("%s.index", array->GetName()));
+  index->SetArray(array);
+
+  GetFactory()->AddPermanentObject(index);
+  folder->Add(index);
+
+  return index;
+}
+
+//------------------------------------------------------------------------------
+
 ExRootTreeBranch *DelphesModule::NewBranch(const char *name, TClass *cl)
 {
   stringstream message;
@@ -131,15 +172,12 @@ ExRootTreeBranch *DelphesModule::NewBranch(const char *name, TClass *cl)
 
 void DelphesModule::AddInfo(const char *name, Double_t value)
 {
-  stringstream message;
+  // the information is only recorded in the output file,
+  // it is dropped when running without tree writer
   if(!fTreeWriter)
   {
     fTreeWriter = static_cast<ExRootTreeWriter *>(GetObject("TreeWriter", ExRootTreeWriter::Class()));
-    if(!fTreeWriter)
-    {
-      message << "can't access access tree writer";
-      throw runtime_error(message.str());
-    }
+    if(!fTreeWriter) return;
   }
   fTreeWriter->AddInfo(name, value);
 }
@@ -39,6 +39,7 @@ class ExRootTreeBranch;
 class ExRootTreeWriter;
 
 class DelphesFactory;
+class DelphesNeighbourIndex;
 
 class DelphesModule: public ExRootTask
 {
@@ -53,16 +54,25 @@ public:
   TObjArray *ImportArray(const char *name);
   TObjArray *ExportArray(const char *name);
 
+  // eta-phi index of an exported array, shared by all modules importing it
+  DelphesNeighbourIndex *ImportNeighbourIndex(const char *name);
+
   ExRootTreeBranch *NewBranch(const char *name, TClass *cl);
   void AddInfo(const char *name, Double_t value);
 
   ExRootResult *GetPlots();
   DelphesFactory *GetFactory();
 
+  Bool_t IsEventRejected() const { return fEventRejected; }
+
 protected:
+  void SetEventRejected(Bool_t flag) { fEventRejected = flag; }
+
   ExRootTreeWriter *fTreeWriter;
   DelphesFactory *fFactory;
 
+  Bool_t fEventRejected;
+
 private:
   ExRootResult *fPlots;
 
@@ -0,0 +1,199 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \class DelphesNeighbourIndex
+ *
+ *  Eta-phi cell index of the candidates of an exported array.
+ *
+ */
+
+#include "classes/DelphesNeighbourIndex.h"
+#include "classes/DelphesClasses.h"
+
+#include "TMath.h"
+#include "TObjArray.h"
+#include "TVector2.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace
+{
+bool CompareIndex(const DelphesNeighbourIndex::TNeighbour &a, const DelphesNeighbourIndex::TNeighbour &b)
+{
+  return a.index < b.index;
+}
+} // namespace
+
+//------------------------------------------------------------------------------
+
+DelphesNeighbourIndex::DelphesNeighbourIndex() :
+  fArray(0), fValid(kFALSE)
+{
+  // cells of about 0.5 x 0.5 covering |eta| < 5
+  fEtaMax = 5.0;
+  fEtaCells = 20;
+  fPhiCells = 12;
+
+  fEtaScale = fEtaCells / (2.0 * fEtaMax);
+  fPhiScale = fPhiCells / TMath::TwoPi();
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesNeighbourIndex::Clear(Option_t *option)
+{
+  fValid = kFALSE;
+}
+
+//------------------------------------------------------------------------------
+
+Int_t DelphesNeighbourIndex::FindEtaCell(Double_t eta) const
+{
+  Double_t u = (eta + fEtaMax) * fEtaScale;
+  u = min(max(u, 0.0), fEtaCells - 1.0);
+  return Int_t(u);
+}
+
+//------------------------------------------------------------------------------
+
+Int_t DelphesNeighbourIndex::FindPhiCell(Double_t phi) const
+{
+  Int_t cell = Int_t(floor((phi + TMath::Pi()) * fPhiScale)) % fPhiCells;
+  return cell < 0 ? cell + fPhiCells : cell;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesNeighbourIndex::Build()
+{
+  Int_t i, n, cell, cells = fEtaCells * fPhiCells;
+  Candidate *candidate;
+  vector<Int_t> objectCell;
+
+  n = fArray ? fArray->GetEntriesFast() : 0;
+
+  fEta.resize(n);
+  fPhi.resize(n);
+  fPT.resize(n);
+  objectCell.resize(n);
+
+  fCellStart.assign(cells + 1, 0);
+  fCellObjects.resize(n);
+
+  for(i = 0; i < n; ++i)
+  {
+    candidate = static_cast<Candidate *>(fArray->At(i));
+    const TLorentzVector &momentum = candidate->Momentum;
+
+    fEta[i] = momentum.Eta();
+    fPhi[i] = momentum.Phi();
+    fPT[i] = momentum.Pt();
+
+    cell = FindEtaCell(fEta[i]) * fPhiCells + FindPhiCell(fPhi[i]);
+    objectCell[i] = cell;
+    ++fCellStart[cell + 1];
+  }
+
+  for(cell = 0; cell < cells; ++cell)
+  {
+    fCellStart[cell + 1] += fCellStart[cell];
+  }
+
+  // counting sort, candidates keep the order of the array within each cell
+  vector<Int_t> position(fCellStart.begin(), fCellStart.end() - 1);
+  for(i = 0; i < n; ++i)
+  {
+    fCellObjects[position[objectCell[i]]++] = i;
+  }
+
+  fValid = kTRUE;
+}
+
+//------------------------------------------------------------------------------
+
+Int_t DelphesNeighbourIndex::GetEntries()
+{
+  if(!fValid) Build();
+  return fEta.size();
+}
+
+//------------------------------------------------------------------------------
+
+Candidate *DelphesNeighbourIndex::GetCandidate(Int_t index) const
+{
+  return static_cast<Candidate *>(fArray->At(index));
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesNeighbourIndex::Find(Double_t eta, Double_t phi, Double_t deltaR, vector<TNeighbour> &result)
+{
+  Int_t etaFirst, etaLast, phiFirst, phiCount, iEta, iPhi, cell, i, j;
+  Double_t deltaEta, deltaPhi, dr;
+  TNeighbour neighbour;
+
+  if(!fValid) Build();
+
+  result.clear();
+
+  etaFirst = FindEtaCell(eta - deltaR);
+  etaLast = FindEtaCell(eta + deltaR);
+
+  // cells crossed by the cone in phi, with wrap-around
+  if(2.0 * deltaR * fPhiScale >= fPhiCells - 1)
+  {
+    phiFirst = 0;
+    phiCount = fPhiCells;
+  }
+  else
+  {
+    phiFirst = FindPhiCell(phi - deltaR);
+    phiCount = (FindPhiCell(phi + deltaR) - phiFirst + fPhiCells) % fPhiCells + 1;
+  }
+
+  for(iEta = etaFirst; iEta <= etaLast; ++iEta)
+  {
+    for(iPhi = 0; iPhi < phiCount; ++iPhi)
+    {
+      cell = iEta * fPhiCells + (phiFirst + iPhi) % fPhiCells;
+      for(j = fCellStart[cell]; j < fCellStart[cell + 1]; ++j)
+      {
+        i = fCellObjects[j];
+
+        // same arithmetic as TLorentzVector::DeltaR
+        deltaEta = fEta[i] - eta;
+        deltaPhi = TVector2::Phi_mpi_pi(fPhi[i] - phi);
+        dr = TMath::Sqrt(deltaEta * deltaEta + deltaPhi * deltaPhi);
+
+        if(dr <= deltaR)
+        {
+          neighbour.index = i;
+          neighbour.deltaR = dr;
+          result.push_back(neighbour);
+        }
+      }
+    }
+  }
+
+  sort(result.begin(), result.end(), CompareIndex);
+}
+
+//------------------------------------------------------------------------------
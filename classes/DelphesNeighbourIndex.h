@@ -0,0 +1,87 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesNeighbourIndex_h
+#define DelphesNeighbourIndex_h
+
+/** \class DelphesNeighbourIndex
+ *
+ *  Eta-phi cell index of the candidates of an exported array.
+ *
+ *  The index caches the eta, phi and pt of each candidate and is built
+ *  on the first query of each event, after DelphesFactory::Clear marks
+ *  it as outdated. Cells at the ends of the eta range also hold the
+ *  candidates beyond it.
+ *
+ */
+
+#include "TNamed.h"
+
+#include <vector>
+
+class TObjArray;
+class Candidate;
+
+class DelphesNeighbourIndex: public TNamed
+{
+public:
+  struct TNeighbour
+  {
+    Int_t index;
+    Double_t deltaR;
+  };
+
+  DelphesNeighbourIndex();
+
+  void SetArray(const TObjArray *array) { fArray = array; }
+
+  virtual void Clear(Option_t *option = "");
+
+  // candidates within deltaR of (eta, phi), in the order of the array
+  void Find(Double_t eta, Double_t phi, Double_t deltaR, std::vector<TNeighbour> &result);
+
+  Int_t GetEntries();
+
+  Candidate *GetCandidate(Int_t index) const;
+
+  Double_t GetEta(Int_t index) const { return fEta[index]; }
+  Double_t GetPhi(Int_t index) const { return fPhi[index]; }
+  Double_t GetPT(Int_t index) const { return fPT[index]; }
+
+private:
+  void Build();
+
+  Int_t FindEtaCell(Double_t eta) const;
+  Int_t FindPhiCell(Double_t phi) const;
+
+  const TObjArray *fArray; //!
+
+  Bool_t fValid; //!
+
+  Int_t fEtaCells, fPhiCells; //!
+  Double_t fEtaMax, fEtaScale, fPhiScale; //!
+
+  std::vector<Double_t> fEta, fPhi, fPT; //!
+
+  // candidates sorted by cell, fCellStart[cell] is the first one of each cell
+  std::vector<Int_t> fCellStart, fCellObjects; //!
+
+  ClassDef(DelphesNeighbourIndex, 1)
+};
+
+#endif /* DelphesNeighbourIndex_h */
@@ -26,38 +26,51 @@
 
 #include "classes/DelphesPileUpReader.h"
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
 
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "classes/DelphesXDRReader.h"
 
+#include "RZip.h"
+
 using namespace std;
 
 static const int kIndexSize = 10000000;
 static const int kBufferSize = 1000000;
 static const int kRecordSize = 9;
 
+static const int32_t kMagic = 0x44505532; // "DPU2"
+
+//------------------------------------------------------------------------------
+
+static uint32_t GetValue(const uint8_t *&buffer, int size)
+{
+  int i;
+  uint32_t value = 0;
+  for(i = 0; i < size; ++i)
+  {
+    value = (value << 8) | *buffer++;
+  }
+  return value;
+}
+
 //------------------------------------------------------------------------------
 
 DelphesPileUpReader::DelphesPileUpReader(const char *fileName) :
-  fEntries(0), fEntrySize(0), fCounter(0),
-  fPileUpFile(0), fIndex(0), fBuffer(0),
-  fInputReader(0), fIndexReader(0), fBufferReader(0)
+  fVersion(1), fCompression(0), fEntries(0), fEntrySize(0), fCounter(0),
+  fPileUpFile(0), fInputReader(0)
 {
   stringstream message;
+  int32_t magic = 0;
+  int64_t i;
 
-  fIndex = new uint8_t[kIndexSize * 8];
-  fBuffer = new uint8_t[kBufferSize * kRecordSize * 4];
   fInputReader = new DelphesXDRReader;
-  fIndexReader = new DelphesXDRReader;
-  fBufferReader = new DelphesXDRReader;
-
-  fIndexReader->SetBuffer(fIndex);
-  fBufferReader->SetBuffer(fBuffer);
 
   fPileUpFile = fopen(fileName, "rb");
 
@@ -69,19 +82,36 @@ DelphesPileUpReader::DelphesPileUpReader(const char *fileName) :
 
   fInputReader->SetFile(fPileUpFile);
 
+  // v2 files start with a header, v1 files with the size of the first event
+  fInputReader->ReadValue(&magic, 4);
+  if(magic == kMagic)
+  {
+    fInputReader->ReadValue(&fVersion, 4);
+    fInputReader->ReadValue(&fCompression, 4);
+    if(fVersion != 2)
+    {
+      message << "unsupported version " << fVersion << " of pile-up file " << fileName;
+      throw runtime_error(message.str());
+    }
+  }
+
   // read number of events
   fseeko(fPileUpFile, -8, SEEK_END);
   fInputReader->ReadValue(&fEntries, 8);
 
-  if(fEntries >= kIndexSize)
+  if(fEntries < 0 || fEntries >= kIndexSize)
   {
     message << "too many events in pile-up file " << fileName;
     throw runtime_error(message.str());
   }
 
   // read index of events
+  fIndex.resize(fEntries);
   fseeko(fPileUpFile, -8 - 8 * fEntries, SEEK_END);
-  fInputReader->ReadRaw(fIndex, fEntries * 8);
+  for(i = 0; i < fEntries; ++i)
+  {
+    fInputReader->ReadValue(&fIndex[i], 8);
+  }
 }
 
 //------------------------------------------------------------------------------
@@ -89,11 +119,7 @@ DelphesPileUpReader::DelphesPileUpReader(const char *fileName) :
 DelphesPileUpReader::~DelphesPileUpReader()
 {
   if(fPileUpFile) fclose(fPileUpFile);
-  if(fBufferReader) delete fBufferReader;
-  if(fIndexReader) delete fIndexReader;
   if(fInputReader) delete fInputReader;
-  if(fBuffer) delete[] fBuffer;
-  if(fIndex) delete[] fIndex;
 }
 
 //------------------------------------------------------------------------------
@@ -104,15 +130,15 @@ bool DelphesPileUpReader::ReadParticle(int32_t &pid,
 {
   if(fCounter >= fEntrySize) return false;
 
-  fBufferReader->ReadValue(&pid, 4);
-  fBufferReader->ReadValue(&x, 4);
-  fBufferReader->ReadValue(&y, 4);
-  fBufferReader->ReadValue(&z, 4);
-  fBufferReader->ReadValue(&t, 4);
-  fBufferReader->ReadValue(&px, 4);
-  fBufferReader->ReadValue(&py, 4);
-  fBufferReader->ReadValue(&pz, 4);
-  fBufferReader->ReadValue(&e, 4);
+  pid = fPID[fCounter];
+  x = fData[0][fCounter];
+  y = fData[1][fCounter];
+  z = fData[2][fCounter];
+  t = fData[3][fCounter];
+  px = fData[4][fCounter];
+  py = fData[5][fCounter];
+  pz = fData[6][fCounter];
+  e = fData[7][fCounter];
 
   ++fCounter;
 
@@ -123,28 +149,162 @@ bool DelphesPileUpReader::ReadParticle(int32_t &pid,
 
 bool DelphesPileUpReader::ReadEntry(int64_t entry)
 {
-  int64_t offset;
-
   if(entry >= fEntries) return false;
 
-  // read event position
-  fIndexReader->SetOffset(8 * entry);
-  fIndexReader->ReadValue(&offset, 8);
-
   // read event
-  fseeko(fPileUpFile, offset, SEEK_SET);
-  fInputReader->ReadValue(&fEntrySize, 4);
+  fseeko(fPileUpFile, fIndex[entry], SEEK_SET);
 
-  if(fEntrySize >= kBufferSize)
+  if(fVersion == 1)
   {
-    throw runtime_error("too many particles in pile-up event");
+    ReadEntryV1();
+  }
+  else
+  {
+    ReadEntryV2();
   }
 
-  fInputReader->ReadRaw(fBuffer, fEntrySize * kRecordSize * 4);
-  fBufferReader->SetOffset(0);
   fCounter = 0;
 
   return true;
 }
 
 //------------------------------------------------------------------------------
+
+void DelphesPileUpReader::ReadEntryV1()
+{
+  DelphesXDRReader bufferReader;
+  int32_t i, j;
+
+  fInputReader->ReadValue(&fEntrySize, 4);
+
+  if(fEntrySize < 0 || fEntrySize >= kBufferSize)
+  {
+    throw runtime_error("too many particles in pile-up event");
+  }
+
+  fBuffer.resize(fEntrySize * kRecordSize * 4 + 4);
+  fInputReader->ReadRaw(&fBuffer[0], fEntrySize * kRecordSize * 4);
+
+  fPID.resize(fEntrySize);
+  for(j = 0; j < 8; ++j) fData[j].resize(fEntrySize);
+
+  bufferReader.SetBuffer(&fBuffer[0]);
+  for(i = 0; i < fEntrySize; ++i)
+  {
+    bufferReader.ReadValue(&fPID[i], 4);
+    for(j = 0; j < 8; ++j) bufferReader.ReadValue(&fData[j][i], 4);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesPileUpReader::ReadEntryV2()
+{
+  int32_t i, j, k, width, dictionarySize, payloadSize, storedSize, zipSize, unzipSize, irep;
+  uint32_t previous;
+  const uint8_t *buffer;
+  uint8_t *src, *tgt;
+  vector<int32_t> dictionary;
+
+  fInputReader->ReadValue(&payloadSize, 4);
+  fInputReader->ReadValue(&storedSize, 4);
+
+  if(payloadSize < 8 || storedSize <= 0 || storedSize > payloadSize)
+  {
+    throw runtime_error("corrupted pile-up event");
+  }
+
+  fPayload.resize(payloadSize + 4);
+
+  if(storedSize == payloadSize)
+  {
+    fInputReader->ReadRaw(&fPayload[0], payloadSize);
+  }
+  else
+  {
+    fBuffer.resize(storedSize + 4);
+    fInputReader->ReadRaw(&fBuffer[0], storedSize);
+
+    src = &fBuffer[0];
+    tgt = &fPayload[0];
+    while(src < &fBuffer[0] + storedSize)
+    {
+      if(R__unzip_header(&zipSize, src, &unzipSize) != 0
+        || src + zipSize > &fBuffer[0] + storedSize
+        || tgt + unzipSize > &fPayload[0] + payloadSize)
+      {
+        throw runtime_error("corrupted pile-up event");
+      }
+
+      R__unzip(&zipSize, src, &unzipSize, tgt, &irep);
+
+      if(irep != unzipSize)
+      {
+        throw runtime_error("can't decompress pile-up event");
+      }
+
+      src += zipSize;
+      tgt += unzipSize;
+    }
+
+    if(tgt != &fPayload[0] + payloadSize)
+    {
+      throw runtime_error("corrupted pile-up event");
+    }
+  }
+
+  // decode payload, see DelphesPileUpWriter::EncodeV2
+
+  buffer = &fPayload[0];
+
+  fEntrySize = GetValue(buffer, 4);
+  dictionarySize = GetValue(buffer, 4);
+
+  width = dictionarySize <= 0x100 ? 1 : (dictionarySize <= 0x10000 ? 2 : 4);
+
+  if(fEntrySize < 0 || fEntrySize >= kBufferSize || dictionarySize < 0 || dictionarySize > fEntrySize
+    || payloadSize != 8 + 4 * dictionarySize + width * fEntrySize + 32 * fEntrySize)
+  {
+    throw runtime_error("corrupted pile-up event");
+  }
+
+  dictionary.resize(dictionarySize);
+  for(k = 0; k < dictionarySize; ++k) dictionary[k] = GetValue(buffer, 4);
+
+  fPID.resize(fEntrySize);
+  for(i = 0; i < fEntrySize; ++i)
+  {
+    k = GetValue(buffer, width);
+    if(k >= dictionarySize)
+    {
+      throw runtime_error("corrupted pile-up event");
+    }
+    fPID[i] = dictionary[k];
+  }
+
+  fBits.resize(fEntrySize);
+  for(j = 0; j < 8; ++j)
+  {
+    fill(fBits.begin(), fBits.end(), 0);
+    for(k = 3; k >= 0; --k)
+    {
+      for(i = 0; i < fEntrySize; ++i) fBits[i] |= uint32_t(*buffer++) << (8 * k);
+    }
+
+    // positions and times are XOR-ed with the previous particle
+    if(j < 4)
+    {
+      previous = 0;
+      for(i = 0; i < fEntrySize; ++i)
+      {
+        fBits[i] ^= previous;
+        previous = fBits[i];
+      }
+    }
+
+    fData[j].resize(fEntrySize);
+    if(fEntrySize > 0) memcpy(&fData[j][0], &fBits[0], 4 * fEntrySize);
+  }
+}
+
+//------------------------------------------------------------------------------
@@ -23,6 +23,10 @@
  *
  *  Reads pile-up binary file
  *
+ *  Both the original format (v1) and the compressed format (v2) written
+ *  by DelphesPileUpWriter are supported, the version is detected from
+ *  the beginning of the file.
+ *
  *  \author P. Demin - UCL, Louvain-la-Neuve
  *
  */
@@ -30,6 +34,8 @@
 #include <stdint.h>
 #include <stdio.h>
 
+#include <vector>
+
 class DelphesXDRReader;
 
 class DelphesPileUpReader
@@ -47,19 +53,31 @@ public:
 
   int64_t GetEntries() const { return fEntries; }
 
+  int32_t GetVersion() const { return fVersion; }
+
 private:
+  void ReadEntryV1();
+  void ReadEntryV2();
+
+  int32_t fVersion;
+  int32_t fCompression;
+
   int64_t fEntries;
 
   int32_t fEntrySize;
   int32_t fCounter;
 
   FILE *fPileUpFile;
-  uint8_t *fIndex;
-  uint8_t *fBuffer;
+
+  std::vector<int64_t> fIndex;
+  std::vector<uint8_t> fBuffer;
+  std::vector<uint8_t> fPayload;
+  std::vector<uint32_t> fBits;
+
+  std::vector<int32_t> fPID;
+  std::vector<float> fData[8];
 
   DelphesXDRReader *fInputReader;
-  DelphesXDRReader *fIndexReader;
-  DelphesXDRReader *fBufferReader;
 };
 
 #endif // DelphesPileUpReader_h
@@ -32,32 +32,77 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
+#include <map>
+#include <thread>
+
+#include "classes/DelphesThreadPool.h"
 #include "classes/DelphesXDRWriter.h"
 
+#include "RVersion.h"
+#include "RZip.h"
+
 using namespace std;
 
 static const int kIndexSize = 10000000;
 static const int kBufferSize = 1000000;
 static const int kRecordSize = 9;
 
+static const int32_t kMagic = 0x44505532; // "DPU2"
+static const int32_t kVersion = 2;
+static const int kMaxZipSize = 0xffffff;
+static const int kZipHeaderSize = 9;
+
+//------------------------------------------------------------------------------
+
+static void PutValue(uint8_t *&buffer, uint32_t value, int size)
+{
+  int i;
+  for(i = size - 1; i >= 0; --i)
+  {
+    *buffer++ = value >> (8 * i);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+static int Compress(int compression, uint8_t *src, int srcSize, uint8_t *tgt, int tgtSize)
+{
+  int irep = 0;
+
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6, 20, 0)
+  R__zipMultipleAlgorithm(compression % 100, &srcSize, (char *)src, &tgtSize, (char *)tgt, &irep,
+    static_cast<ROOT::RCompressionSetting::EAlgorithm::EValues>(compression / 100));
+#else
+  R__zipMultipleAlgorithm(compression % 100, &srcSize, (char *)src, &tgtSize, (char *)tgt, &irep,
+    static_cast<ROOT::ECompressionAlgorithm>(compression / 100));
+#endif
+
+  return irep;
+}
+
 //------------------------------------------------------------------------------
 
-DelphesPileUpWriter::DelphesPileUpWriter(const char *fileName) :
-  fEntries(0), fEntrySize(0), fOffset(0),
-  fPileUpFile(0), fIndex(0), fBuffer(0),
-  fOutputWriter(0), fIndexWriter(0), fBufferWriter(0)
+DelphesPileUpWriter::DelphesPileUpWriter(const char *fileName, int compression, int threads) :
+  fCompression(compression), fEntries(0), fOffset(0),
+  fPileUpFile(0), fBatchSize(0), fPool(0), fOutputWriter(0)
 {
   stringstream message;
 
-  fIndex = new uint8_t[kIndexSize * 8];
-  fBuffer = new uint8_t[kBufferSize * kRecordSize * 4];
-  fOutputWriter = new DelphesXDRWriter;
-  fIndexWriter = new DelphesXDRWriter;
-  fBufferWriter = new DelphesXDRWriter;
+  if(fCompression < 0 || (fCompression > 0 && fCompression % 100 == 0))
+  {
+    message << "invalid pile-up compression setting " << fCompression;
+    throw runtime_error(message.str());
+  }
+
+  if(threads <= 0) threads = thread::hardware_concurrency();
+  if(threads <= 0) threads = 1;
 
-  fIndexWriter->SetBuffer(fIndex);
-  fBufferWriter->SetBuffer(fBuffer);
+  fPool = new DelphesThreadPool(threads);
+  fBatch.resize(16 * threads);
+
+  fOutputWriter = new DelphesXDRWriter;
 
   fPileUpFile = fopen(fileName, "wb");
 
@@ -68,6 +113,14 @@ DelphesPileUpWriter::DelphesPileUpWriter(const char *fileName) :
   }
 
   fOutputWriter->SetFile(fPileUpFile);
+
+  if(fCompression > 0)
+  {
+    fOutputWriter->WriteValue(const_cast<int32_t *>(&kMagic), 4);
+    fOutputWriter->WriteValue(const_cast<int32_t *>(&kVersion), 4);
+    fOutputWriter->WriteValue(&fCompression, 4);
+    fOffset = 12;
+  }
 }
 
 //------------------------------------------------------------------------------
@@ -75,11 +128,8 @@ DelphesPileUpWriter::DelphesPileUpWriter(const char *fileName) :
 DelphesPileUpWriter::~DelphesPileUpWriter()
 {
   if(fPileUpFile) fclose(fPileUpFile);
-  if(fBufferWriter) delete fBufferWriter;
-  if(fIndexWriter) delete fIndexWriter;
   if(fOutputWriter) delete fOutputWriter;
-  if(fBuffer) delete[] fBuffer;
-  if(fIndex) delete[] fIndex;
+  if(fPool) delete fPool;
 }
 
 //------------------------------------------------------------------------------
@@ -88,22 +138,22 @@ void DelphesPileUpWriter::WriteParticle(int32_t pid,
   float x, float y, float z, float t,
   float px, float py, float pz, float e)
 {
-  if(fEntrySize >= kBufferSize)
+  TEventRecord &record = fBatch[fBatchSize];
+
+  if(int(record.pid.size()) >= kBufferSize)
   {
     throw runtime_error("too many particles in pile-up event");
   }
 
-  fBufferWriter->WriteValue(&pid, 4);
-  fBufferWriter->WriteValue(&x, 4);
-  fBufferWriter->WriteValue(&y, 4);
-  fBufferWriter->WriteValue(&z, 4);
-  fBufferWriter->WriteValue(&t, 4);
-  fBufferWriter->WriteValue(&px, 4);
-  fBufferWriter->WriteValue(&py, 4);
-  fBufferWriter->WriteValue(&pz, 4);
-  fBufferWriter->WriteValue(&e, 4);
-
-  ++fEntrySize;
+  record.pid.push_back(pid);
+  record.data[0].push_back(x);
+  record.data[1].push_back(y);
+  record.data[2].push_back(z);
+  record.data[3].push_back(t);
+  record.data[4].push_back(px);
+  record.data[5].push_back(py);
+  record.data[6].push_back(pz);
+  record.data[7].push_back(e);
 }
 
 //------------------------------------------------------------------------------
@@ -115,24 +165,163 @@ void DelphesPileUpWriter::WriteEntry()
     throw runtime_error("too many pile-up events");
   }
 
-  fOutputWriter->WriteValue(&fEntrySize, 4);
-  fOutputWriter->WriteRaw(fBuffer, fEntrySize * kRecordSize * 4);
-
-  fIndexWriter->WriteValue(&fOffset, 8);
-  fOffset += fEntrySize * kRecordSize * 4 + 4;
-
-  fBufferWriter->SetOffset(0);
-  fEntrySize = 0;
-
   ++fEntries;
+  ++fBatchSize;
+
+  if(fBatchSize == int(fBatch.size())) Flush();
 }
 
 //------------------------------------------------------------------------------
 
 void DelphesPileUpWriter::WriteIndex()
 {
-  fOutputWriter->WriteRaw(fIndex, fEntries * 8);
+  vector<int64_t>::iterator itIndex;
+
+  Flush();
+
+  for(itIndex = fIndex.begin(); itIndex != fIndex.end(); ++itIndex)
+  {
+    fOutputWriter->WriteValue(&(*itIndex), 8);
+  }
   fOutputWriter->WriteValue(&fEntries, 8);
 }
 
 //------------------------------------------------------------------------------
+
+void DelphesPileUpWriter::Flush()
+{
+  int i;
+
+  // encode and compress the events in parallel, then write them in order
+  fPool->Run(fBatchSize, [this](Int_t entry, Int_t) {
+    if(fCompression > 0)
+    {
+      EncodeV2(fBatch[entry]);
+    }
+    else
+    {
+      EncodeV1(fBatch[entry]);
+    }
+  });
+
+  for(i = 0; i < fBatchSize; ++i)
+  {
+    TEventRecord &record = fBatch[i];
+
+    fIndex.push_back(fOffset);
+    fOutputWriter->WriteRaw(&record.output[0], record.output.size());
+    fOffset += record.output.size();
+
+    record.pid.clear();
+    for(int j = 0; j < 8; ++j) record.data[j].clear();
+  }
+
+  fBatchSize = 0;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesPileUpWriter::EncodeV1(TEventRecord &record)
+{
+  DelphesXDRWriter writer;
+  int32_t i, j, size = record.pid.size();
+
+  record.output.resize(4 + size * kRecordSize * 4);
+
+  writer.SetBuffer(&record.output[0]);
+  writer.WriteValue(&size, 4);
+  for(i = 0; i < size; ++i)
+  {
+    writer.WriteValue(&record.pid[i], 4);
+    for(j = 0; j < 8; ++j) writer.WriteValue(&record.data[j][i], 4);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesPileUpWriter::EncodeV2(TEventRecord &record)
+{
+  int32_t i, j, k, size, width, dictionarySize, payloadSize, storedSize, chunkSize, zipSize;
+  uint32_t bits, previous;
+  uint8_t *buffer, *output;
+  map<int32_t, int32_t> dictionary;
+  map<int32_t, int32_t>::iterator itDictionary;
+
+  size = record.pid.size();
+
+  // PDG codes are replaced by indices into a dictionary of the codes in the event
+
+  for(i = 0; i < size; ++i) dictionary[record.pid[i]] = 0;
+
+  dictionarySize = dictionary.size();
+  width = dictionarySize <= 0x100 ? 1 : (dictionarySize <= 0x10000 ? 2 : 4);
+
+  record.payload.resize(8 + 4 * dictionarySize + width * size + 32 * size);
+  buffer = &record.payload[0];
+
+  PutValue(buffer, size, 4);
+  PutValue(buffer, dictionarySize, 4);
+
+  for(itDictionary = dictionary.begin(), k = 0; itDictionary != dictionary.end(); ++itDictionary, ++k)
+  {
+    itDictionary->second = k;
+    PutValue(buffer, itDictionary->first, 4);
+  }
+
+  for(i = 0; i < size; ++i) PutValue(buffer, dictionary[record.pid[i]], width);
+
+  // floats are stored column by column, with the bytes of each column
+  // grouped by significance; positions and times are XOR-ed with
+  // the previous particle, so that particles from the same vertex
+  // give long runs of zeros
+
+  for(j = 0; j < 8; ++j)
+  {
+    for(k = 3; k >= 0; --k)
+    {
+      previous = 0;
+      for(i = 0; i < size; ++i)
+      {
+        memcpy(&bits, &record.data[j][i], 4);
+        *buffer++ = ((j < 4 ? bits ^ previous : bits) >> (8 * k)) & 0xff;
+        previous = bits;
+      }
+    }
+  }
+
+  payloadSize = buffer - &record.payload[0];
+
+  // compress the payload in chunks accepted by the ROOT compression routines
+
+  record.output.resize(8 + payloadSize + 4);
+  output = &record.output[8];
+  storedSize = 0;
+
+  for(i = 0; i < payloadSize; i += chunkSize)
+  {
+    chunkSize = payloadSize - i < kMaxZipSize ? payloadSize - i : kMaxZipSize;
+    zipSize = Compress(fCompression, &record.payload[i], chunkSize, output + storedSize, payloadSize - storedSize);
+    if(zipSize <= 0 || zipSize >= chunkSize || storedSize + zipSize >= payloadSize)
+    {
+      storedSize = payloadSize;
+      break;
+    }
+    storedSize += zipSize;
+  }
+
+  // store uncompressed payload when compression does not help
+  if(storedSize == payloadSize)
+  {
+    memcpy(output, &record.payload[0], payloadSize);
+  }
+
+  buffer = &record.output[0];
+  PutValue(buffer, payloadSize, 4);
+  PutValue(buffer, storedSize, 4);
+
+  // blocks are padded to 4 bytes
+  record.output.resize(8 + ((storedSize + 3) & ~3));
+  memset(record.output.data() + 8 + storedSize, 0, record.output.size() - 8 - storedSize);
+}
+
+//------------------------------------------------------------------------------
@@ -23,6 +23,12 @@
  *
  *  Writes pile-up binary file
  *
+ *  With compression = 0, the file is written in the original format (v1).
+ *  Otherwise, the file is written in format v2, where each event is stored
+ *  as a compressed block. The compression setting follows the ROOT
+ *  convention, 100 * algorithm + level (e.g. 505 for zstd, 404 for lz4).
+ *  Events are encoded and compressed in batches on a pool of threads.
+ *
  *  \author P. Demin - UCL, Louvain-la-Neuve
  *
  */
@@ -30,12 +36,15 @@
 #include <stdint.h>
 #include <stdio.h>
 
+#include <vector>
+
 class DelphesXDRWriter;
+class DelphesThreadPool;
 
 class DelphesPileUpWriter
 {
 public:
-  DelphesPileUpWriter(const char *fileName);
+  DelphesPileUpWriter(const char *fileName, int compression = 505, int threads = 0);
 
   ~DelphesPileUpWriter();
 
@@ -48,17 +57,34 @@ public:
   void WriteIndex();
 
 private:
+  struct TEventRecord
+  {
+    std::vector<int32_t> pid;
+    std::vector<float> data[8];
+    std::vector<uint8_t> payload;
+    std::vector<uint8_t> output;
+  };
+
+  void Flush();
+
+  void EncodeV1(TEventRecord &record);
+  void EncodeV2(TEventRecord &record);
+
+  int fCompression;
+
   int64_t fEntries;
-  int32_t fEntrySize;
   int64_t fOffset;
 
   FILE *fPileUpFile;
-  uint8_t *fIndex;
-  uint8_t *fBuffer;
+
+  std::vector<int64_t> fIndex;
+
+  std::vector<TEventRecord> fBatch;
+  int fBatchSize;
+
+  DelphesThreadPool *fPool;
 
   DelphesXDRWriter *fOutputWriter;
-  DelphesXDRWriter *fIndexWriter;
-  DelphesXDRWriter *fBufferWriter;
 };
 
 #endif // DelphesPileUpWriter_h
@@ -0,0 +1,399 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \class DelphesPropagator
+ *
+ *  Batched propagation of neutral and charged particles
+ *  in a uniform magnetic field along the z-axis.
+ *
+ *  Particles are gathered with Add into contiguous arrays, one set for
+ *  straight lines and one for helices, and are propagated together
+ *  either to a cylinder centered at (0,0,0) with its axis along the
+ *  z-axis (PropagateToCylinder) or for a given flight time
+ *  (PropagateFlightTime). Results are read back by particle index.
+ *
+ *  Inputs and results are in [mm], [GeV] and [s], the time shift
+ *  returned by GetDT is in [mm/c].
+ *
+ */
+
+#include "classes/DelphesPropagator.h"
+
+#include "TLorentzVector.h"
+#include "TMath.h"
+
+using namespace std;
+
+static const Double_t c_light = 2.99792458E8;
+
+//------------------------------------------------------------------------------
+
+DelphesPropagator::DelphesPropagator() :
+  fBz(0.0), fRadius(1.0), fRadius2(1.0), fHalfLength(3.0),
+  fBeamSpotX(0.0), fBeamSpotY(0.0), fBeamSpotZ(0.0)
+{
+  Clear();
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesPropagator::SetCylinder(Double_t radius, Double_t halfLength)
+{
+  fRadius = radius;
+  fRadius2 = radius * radius;
+  fHalfLength = halfLength;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesPropagator::SetBeamSpot(Double_t x, Double_t y, Double_t z)
+{
+  fBeamSpotX = x * 1.0E-3;
+  fBeamSpotY = y * 1.0E-3;
+  fBeamSpotZ = z * 1.0E-3;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesPropagator::Clear()
+{
+  Int_t i;
+
+  for(i = 0; i < 2; ++i)
+  {
+    TBatch &batch = fBatch[i];
+    batch.size = 0;
+    batch.x.clear();
+    batch.y.clear();
+    batch.z.clear();
+    batch.px.clear();
+    batch.py.clear();
+    batch.pz.clear();
+    batch.pt.clear();
+    batch.pt2.clear();
+    batch.e.clear();
+    batch.q.clear();
+    batch.tof.clear();
+  }
+
+  fType.clear();
+  fSlot.clear();
+}
+
+//------------------------------------------------------------------------------
+
+Int_t DelphesPropagator::Add(const TLorentzVector &position, const TLorentzVector &momentum,
+  Double_t charge, Double_t flightTime)
+{
+  char type;
+
+  type = (TMath::Abs(charge) < 1.0E-9 || TMath::Abs(fBz) < 1.0E-9) ? 0 : 1;
+
+  TBatch &batch = fBatch[type];
+
+  fType.push_back(type);
+  fSlot.push_back(batch.size);
+
+  batch.x.push_back(position.X() * 1.0E-3);
+  batch.y.push_back(position.Y() * 1.0E-3);
+  batch.z.push_back(position.Z() * 1.0E-3);
+  batch.px.push_back(momentum.Px());
+  batch.py.push_back(momentum.Py());
+  batch.pz.push_back(momentum.Pz());
+  batch.pt.push_back(momentum.Pt());
+  batch.pt2.push_back(momentum.Perp2());
+  batch.e.push_back(momentum.E());
+  batch.q.push_back(charge);
+  batch.tof.push_back(flightTime);
+
+  ++batch.size;
+
+  return fType.size() - 1;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesPropagator::Resize(TBatch &batch)
+{
+  Int_t size = batch.size;
+
+  batch.phi0.resize(size);
+  batch.omega.resize(size);
+  batch.r.resize(size);
+  batch.xc.resize(size);
+  batch.yc.resize(size);
+  batch.rc.resize(size);
+  batch.vz.resize(size);
+  batch.td.resize(size);
+
+  batch.xt.resize(size);
+  batch.yt.resize(size);
+  batch.zt.resize(size);
+  batch.dt.resize(size);
+  batch.l.resize(size);
+
+  batch.phid.resize(size);
+  batch.xd.resize(size);
+  batch.yd.resize(size);
+  batch.zd.resize(size);
+  batch.d0.resize(size);
+  batch.dz.resize(size);
+
+  batch.valid.resize(size);
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesPropagator::PropagateToCylinder()
+{
+  Resize(fBatch[0]);
+  Resize(fBatch[1]);
+
+  PropagateNeutral(fBatch[0]);
+  PropagateHelix(fBatch[1]);
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesPropagator::PropagateFlightTime()
+{
+  Resize(fBatch[0]);
+  Resize(fBatch[1]);
+
+  PropagateNeutralTime(fBatch[0]);
+  PropagateHelixTime(fBatch[1]);
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesPropagator::PropagateNeutral(TBatch &batch)
+{
+  Int_t i, size = batch.size;
+  Double_t x, y, z, px, py, pz, pt2, t, t_r, t_z, x_t, y_t, z_t, tmp;
+
+  for(i = 0; i < size; ++i)
+  {
+    x = batch.x[i];
+    y = batch.y[i];
+    z = batch.z[i];
+    px = batch.px[i];
+    py = batch.py[i];
+    pz = batch.pz[i];
+    pt2 = batch.pt2[i];
+
+    // solve pt2*t^2 + 2*(px*x + py*y)*t - (fRadius2 - x*x - y*y) = 0
+    tmp = px * y - py * x;
+    t_r = (TMath::Sqrt(pt2 * fRadius2 - tmp * tmp) - px * x - py * y) / pt2;
+
+    t_z = (TMath::Sign(fHalfLength, pz) - z) / pz;
+
+    t = TMath::Min(t_r, t_z);
+
+    x_t = x + px * t;
+    y_t = y + py * t;
+    z_t = z + pz * t;
+
+    batch.xt[i] = x_t * 1.0E3;
+    batch.yt[i] = y_t * 1.0E3;
+    batch.zt[i] = z_t * 1.0E3;
+    batch.dt[i] = t * batch.e[i] * 1.0E3;
+    batch.l[i] = TMath::Sqrt((x_t - x) * (x_t - x) + (y_t - y) * (y_t - y) + (z_t - z) * (z_t - z)) * 1.0E3;
+    batch.valid[i] = 1;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesPropagator::PropagateHelix(TBatch &batch)
+{
+  Int_t i, size = batch.size;
+  Double_t x, y, z, pt, e, q, r, omega, phi_0, x_c, y_c, r_c, vz, td, pio;
+  Double_t phid, xd, yd, zd, px, py, t, t_r, t_z, alpha, phi_t, x_t, y_t, z_t;
+
+  // 1. initial transverse momentum p_{T0}: Part->pt
+  //    initial transverse momentum direction phi_0 = -atan(p_{X0} / p_{Y0})
+  //    relativistic gamma: gamma = E / mc^2; gammam = gamma * m
+  //    gyration frequency omega = q * Bz / (gammam)
+  //    helix radius r = p_{T0} / (omega * gammam)
+  // 2. helix axis coordinates and time of closest approach
+
+  for(i = 0; i < size; ++i)
+  {
+    x = batch.x[i];
+    y = batch.y[i];
+    pt = batch.pt[i];
+    e = batch.e[i];
+    q = batch.q[i];
+
+    omega = q * fBz / (e * 1.0E9 / (c_light * c_light)); // omega is here in [89875518/s]
+    r = pt / (q * fBz) * 1.0E9 / c_light; // in [m]
+
+    phi_0 = TMath::ATan2(batch.py[i], batch.px[i]); // [rad] in [-pi, pi]
+
+    x_c = x + r * TMath::Sin(phi_0);
+    y_c = y - r * TMath::Cos(phi_0);
+
+    batch.omega[i] = omega;
+    batch.r[i] = r;
+    batch.phi0[i] = phi_0;
+    batch.xc[i] = x_c;
+    batch.yc[i] = y_c;
+    batch.rc[i] = TMath::Hypot(x_c, y_c);
+    batch.td[i] = (phi_0 + TMath::ATan2(x_c, y_c)) / omega;
+    batch.vz[i] = batch.pz[i] * c_light / e;
+  }
+
+  // remove all the modulo pi that might have come from the atan,
+  // rarely needed, so this loop is kept apart from the others
+
+  for(i = 0; i < size; ++i)
+  {
+    td = batch.td[i];
+    pio = TMath::Abs(TMath::Pi() / batch.omega[i]);
+    if(TMath::Abs(td) <= 0.5 * pio) continue;
+    while(TMath::Abs(td) > 0.5 * pio)
+    {
+      td -= TMath::Sign(1.0, td) * pio;
+    }
+    batch.td[i] = td;
+  }
+
+  // 3. closest approach to the z axis and time evaluation t = TMath::Min(t_r, t_z)
+  //    t_r : time to exit from the sides
+  //    t_z : time to exit from the front or the back
+  // 4. position in terms of x(t), y(t), z(t)
+
+  for(i = 0; i < size; ++i)
+  {
+    z = batch.z[i];
+    pt = batch.pt[i];
+    omega = batch.omega[i];
+    r = batch.r[i];
+    phi_0 = batch.phi0[i];
+    x_c = batch.xc[i];
+    y_c = batch.yc[i];
+    r_c = batch.rc[i];
+    vz = batch.vz[i];
+    td = batch.td[i];
+
+    phid = phi_0 - omega * td;
+    xd = x_c - r * TMath::Sin(phid);
+    yd = y_c + r * TMath::Cos(phid);
+    zd = z + vz * td;
+
+    // momentum at closest approach
+    px = pt * TMath::Cos(phid);
+    py = pt * TMath::Sin(phid);
+
+    t_z = (vz == 0.0) ? 1.0E99 : (TMath::Sign(fHalfLength, batch.pz[i]) - z) / vz;
+
+    alpha = TMath::ACos((r * r + r_c * r_c - fRadius * fRadius) / (2 * TMath::Abs(r) * r_c));
+    t_r = td + TMath::Abs(alpha / omega);
+
+    // the helix does not cross the cylinder sides when r_c + |r| < fRadius
+    t = (r_c + TMath::Abs(r) < fRadius) ? t_z : TMath::Min(t_r, t_z);
+
+    phi_t = phi_0 - omega * t;
+    x_t = x_c - r * TMath::Sin(phi_t);
+    y_t = y_c + r * TMath::Cos(phi_t);
+    z_t = z + vz * t;
+
+    batch.phid[i] = phid;
+    batch.xd[i] = xd * 1.0E3;
+    batch.yd[i] = yd * 1.0E3;
+    batch.zd[i] = zd * 1.0E3;
+
+    // track parameters corrected for the beamspot position
+    batch.d0[i] = ((xd - fBeamSpotX) * py - (yd - fBeamSpotY) * px) / pt * 1.0E3;
+    batch.dz[i] = (zd - fBeamSpotZ) * 1.0E3;
+
+    batch.xt[i] = x_t * 1.0E3;
+    batch.yt[i] = y_t * 1.0E3;
+    batch.zt[i] = z_t * 1.0E3;
+    batch.dt[i] = t * c_light * 1.0E3;
+    batch.l[i] = t * TMath::Hypot(vz, r * omega) * 1.0E3;
+    batch.valid[i] = TMath::Hypot(x_t, y_t) > 0.0;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesPropagator::PropagateNeutralTime(TBatch &batch)
+{
+  Int_t i, size = batch.size;
+  Double_t x, y, z, t, x_t, y_t, z_t;
+
+  for(i = 0; i < size; ++i)
+  {
+    x = batch.x[i];
+    y = batch.y[i];
+    z = batch.z[i];
+
+    t = c_light * batch.tof[i] / batch.e[i];
+
+    x_t = x + batch.px[i] * t;
+    y_t = y + batch.py[i] * t;
+    z_t = z + batch.pz[i] * t;
+
+    batch.xt[i] = x_t * 1.0E3;
+    batch.yt[i] = y_t * 1.0E3;
+    batch.zt[i] = z_t * 1.0E3;
+    batch.dt[i] = t * batch.e[i] * 1.0E3;
+    batch.l[i] = TMath::Sqrt((x_t - x) * (x_t - x) + (y_t - y) * (y_t - y) + (z_t - z) * (z_t - z)) * 1.0E3;
+    batch.valid[i] = 1;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesPropagator::PropagateHelixTime(TBatch &batch)
+{
+  Int_t i, size = batch.size;
+  Double_t e, q, r, omega, phi_0, x_c, y_c, vz, t, phi_t, x_t, y_t, z_t;
+
+  for(i = 0; i < size; ++i)
+  {
+    e = batch.e[i];
+    q = batch.q[i];
+
+    omega = q * fBz / (e * 1.0E9 / (c_light * c_light));
+    r = batch.pt[i] / (q * fBz) * 1.0E9 / c_light;
+
+    phi_0 = TMath::ATan2(batch.py[i], batch.px[i]);
+
+    x_c = batch.x[i] + r * TMath::Sin(phi_0);
+    y_c = batch.y[i] - r * TMath::Cos(phi_0);
+
+    vz = batch.pz[i] * c_light / e;
+
+    t = batch.tof[i];
+    phi_t = phi_0 - omega * t;
+    x_t = x_c - r * TMath::Sin(phi_t);
+    y_t = y_c + r * TMath::Cos(phi_t);
+    z_t = batch.z[i] + vz * t;
+
+    batch.xt[i] = x_t * 1.0E3;
+    batch.yt[i] = y_t * 1.0E3;
+    batch.zt[i] = z_t * 1.0E3;
+    batch.dt[i] = t * c_light * 1.0E3;
+    batch.l[i] = t * TMath::Hypot(vz, r * omega) * 1.0E3;
+    batch.valid[i] = TMath::Hypot(x_t, y_t) > 0.0;
+  }
+}
+
+//------------------------------------------------------------------------------
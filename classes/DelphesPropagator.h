@@ -0,0 +1,118 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesPropagator_h
+#define DelphesPropagator_h
+
+/** \class DelphesPropagator
+ *
+ *  Batched propagation of neutral and charged particles
+ *  in a uniform magnetic field along the z-axis.
+ *
+ *  Particles are gathered with Add into contiguous arrays, one set for
+ *  straight lines and one for helices, and are propagated together
+ *  either to a cylinder centered at (0,0,0) with its axis along the
+ *  z-axis (PropagateToCylinder) or for a given flight time
+ *  (PropagateFlightTime). Results are read back by particle index.
+ *
+ *  Inputs and results are in [mm], [GeV] and [s], the time shift
+ *  returned by GetDT is in [mm/c].
+ *
+ */
+
+#include "Rtypes.h"
+
+#include <vector>
+
+class TLorentzVector;
+
+class DelphesPropagator
+{
+public:
+  DelphesPropagator();
+
+  void SetBz(Double_t bz) { fBz = bz; }
+  void SetCylinder(Double_t radius, Double_t halfLength);
+  void SetBeamSpot(Double_t x, Double_t y, Double_t z);
+
+  void Clear();
+
+  Int_t Add(const TLorentzVector &position, const TLorentzVector &momentum,
+    Double_t charge, Double_t flightTime = 0.0);
+
+  Int_t GetSize() const { return fType.size(); }
+
+  Bool_t IsCharged(Int_t i) const { return fType[i] == 1; }
+
+  void PropagateToCylinder();
+  void PropagateFlightTime();
+
+  // final position, time shift and path length
+
+  Bool_t IsValid(Int_t i) const { return Get(i).valid[fSlot[i]]; }
+
+  Double_t GetX(Int_t i) const { return Get(i).xt[fSlot[i]]; }
+  Double_t GetY(Int_t i) const { return Get(i).yt[fSlot[i]]; }
+  Double_t GetZ(Int_t i) const { return Get(i).zt[fSlot[i]]; }
+  Double_t GetDT(Int_t i) const { return Get(i).dt[fSlot[i]]; }
+  Double_t GetL(Int_t i) const { return Get(i).l[fSlot[i]]; }
+
+  // closest approach to the z-axis, charged particles only
+
+  Double_t GetPhiD(Int_t i) const { return Get(i).phid[fSlot[i]]; }
+  Double_t GetXd(Int_t i) const { return Get(i).xd[fSlot[i]]; }
+  Double_t GetYd(Int_t i) const { return Get(i).yd[fSlot[i]]; }
+  Double_t GetZd(Int_t i) const { return Get(i).zd[fSlot[i]]; }
+  Double_t GetD0(Int_t i) const { return Get(i).d0[fSlot[i]]; }
+  Double_t GetDZ(Int_t i) const { return Get(i).dz[fSlot[i]]; }
+
+private:
+  struct TBatch
+  {
+    Int_t size;
+
+    std::vector<Double_t> x, y, z, px, py, pz, pt, pt2, e, q, tof;
+
+    std::vector<Double_t> phi0, omega, r, xc, yc, rc, vz, td;
+
+    std::vector<Double_t> xt, yt, zt, dt, l;
+    std::vector<Double_t> phid, xd, yd, zd, d0, dz;
+    std::vector<char> valid;
+  };
+
+  const TBatch &Get(Int_t i) const { return fBatch[fType[i]]; }
+
+  void Resize(TBatch &batch);
+
+  void PropagateNeutral(TBatch &batch);
+  void PropagateHelix(TBatch &batch);
+
+  void PropagateNeutralTime(TBatch &batch);
+  void PropagateHelixTime(TBatch &batch);
+
+  Double_t fBz;
+  Double_t fRadius, fRadius2, fHalfLength;
+  Double_t fBeamSpotX, fBeamSpotY, fBeamSpotZ;
+
+  TBatch fBatch[2];
+
+  std::vector<char> fType;
+  std::vector<Int_t> fSlot;
+};
+
+#endif /* DelphesPropagator_h */
@@ -0,0 +1,143 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \class DelphesThreadPool
+ *
+ *  Fixed-size pool of worker threads running indexed tasks.
+ *
+ */
+
+#include "classes/DelphesThreadPool.h"
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+DelphesThreadPool::DelphesThreadPool(Int_t threads) :
+  fTask(0), fSize(0), fNext(0), fRunning(0), fGeneration(0), fStop(kFALSE)
+{
+  Int_t i;
+
+  for(i = 1; i < threads; ++i)
+  {
+    fThreads.push_back(thread(&DelphesThreadPool::Loop, this, i));
+  }
+}
+
+//------------------------------------------------------------------------------
+
+DelphesThreadPool::~DelphesThreadPool()
+{
+  vector<thread>::iterator itThreads;
+
+  {
+    lock_guard<mutex> lock(fMutex);
+    fStop = kTRUE;
+  }
+  fStartCondition.notify_all();
+
+  for(itThreads = fThreads.begin(); itThreads != fThreads.end(); ++itThreads)
+  {
+    itThreads->join();
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesThreadPool::Run(Int_t size, const TTask &task)
+{
+  exception_ptr error;
+
+  if(size <= 0) return;
+
+  if(fThreads.empty() || size == 1)
+  {
+    for(Int_t i = 0; i < size; ++i) task(i, 0);
+    return;
+  }
+
+  {
+    lock_guard<mutex> lock(fMutex);
+    fTask = &task;
+    fSize = size;
+    fNext = 0;
+    fRunning = fThreads.size();
+    fException = nullptr;
+    ++fGeneration;
+  }
+  fStartCondition.notify_all();
+
+  Work(0);
+
+  {
+    unique_lock<mutex> lock(fMutex);
+    fDoneCondition.wait(lock, [this] { return fRunning == 0; });
+    fTask = 0;
+    error = fException;
+    fException = nullptr;
+  }
+
+  if(error) rethrow_exception(error);
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesThreadPool::Loop(Int_t thread)
+{
+  ULong64_t generation = 0;
+
+  while(true)
+  {
+    {
+      unique_lock<mutex> lock(fMutex);
+      fStartCondition.wait(lock, [this, generation] { return fStop || fGeneration != generation; });
+      if(fStop) return;
+      generation = fGeneration;
+    }
+
+    Work(thread);
+
+    {
+      lock_guard<mutex> lock(fMutex);
+      --fRunning;
+    }
+    fDoneCondition.notify_one();
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesThreadPool::Work(Int_t thread)
+{
+  Int_t index;
+
+  while((index = fNext++) < fSize)
+  {
+    try
+    {
+      (*fTask)(index, thread);
+    }
+    catch(...)
+    {
+      lock_guard<mutex> lock(fMutex);
+      if(!fException) fException = current_exception();
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
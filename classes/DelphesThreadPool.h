@@ -0,0 +1,74 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesThreadPool_h
+#define DelphesThreadPool_h
+
+/** \class DelphesThreadPool
+ *
+ *  Fixed-size pool of worker threads running indexed tasks.
+ *
+ *  Run(size, task) calls task(index, thread) for every index in [0, size)
+ *  and returns when all of them are done. The calling thread takes part
+ *  in the work as thread 0, so a pool of one thread runs everything
+ *  inline. The thread number can be used to select per-thread workspaces.
+ *
+ */
+
+#include "Rtypes.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class DelphesThreadPool
+{
+public:
+  typedef std::function<void(Int_t, Int_t)> TTask;
+
+  DelphesThreadPool(Int_t threads = 1);
+  ~DelphesThreadPool();
+
+  Int_t GetNumberOfThreads() const { return fThreads.size() + 1; }
+
+  void Run(Int_t size, const TTask &task);
+
+private:
+  void Loop(Int_t thread);
+  void Work(Int_t thread);
+
+  std::vector<std::thread> fThreads;
+
+  std::mutex fMutex;
+  std::condition_variable fStartCondition, fDoneCondition;
+
+  const TTask *fTask;
+  Int_t fSize;
+  std::atomic<Int_t> fNext;
+  Int_t fRunning;
+  ULong64_t fGeneration;
+  Bool_t fStop;
+
+  std::exception_ptr fException;
+};
+
+#endif /* DelphesThreadPool_h */
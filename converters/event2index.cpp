@@ -0,0 +1,100 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <stdio.h>
+#include <string.h>
+
+#include "classes/DelphesEventIndex.h"
+
+using namespace std;
+
+//---------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+  char appName[] = "event2index";
+  stringstream message;
+  FILE *inputFile = 0;
+  DelphesEventIndex *hepmcIndex = 0, *lhefIndex = 0, *index = 0;
+  char buffer[1024];
+  string indexName;
+  int i;
+
+  if(argc < 2)
+  {
+    cout << " Usage: " << appName << " input_file(s)" << endl;
+    cout << " input_file(s) - input file(s) in HepMC or LHEF format," << endl;
+    cout << " the index of each input file is written to input_file.idx." << endl;
+    return 1;
+  }
+
+  try
+  {
+    hepmcIndex = new DelphesEventIndex("E");
+    lhefIndex = new DelphesEventIndex("<event>", false);
+
+    for(i = 1; i < argc; ++i)
+    {
+      cout << "** Indexing " << argv[i] << endl;
+      inputFile = fopen(argv[i], "r");
+
+      if(inputFile == NULL)
+      {
+        message << "can't open " << argv[i];
+        throw runtime_error(message.str());
+      }
+
+      // LHEF files start with an XML tag
+
+      index = hepmcIndex;
+      while(fgets(buffer, sizeof(buffer), inputFile))
+      {
+        if(strspn(buffer, " \t\r\n") == strlen(buffer)) continue;
+        if(buffer[strspn(buffer, " \t")] == '<') index = lhefIndex;
+        break;
+      }
+
+      index->Build(inputFile);
+      fclose(inputFile);
+
+      indexName = argv[i];
+      indexName += ".idx";
+      index->Write(indexName.c_str());
+
+      cout << "** " << index->GetEntries() << " events written to " << indexName << endl;
+    }
+
+    cout << "** Exiting..." << endl;
+
+    delete lhefIndex;
+    delete hepmcIndex;
+
+    return 0;
+  }
+  catch(runtime_error &e)
+  {
+    if(lhefIndex) delete lhefIndex;
+    if(hepmcIndex) delete hepmcIndex;
+    cerr << "** ERROR: " << e.what() << endl;
+    return 1;
+  }
+}
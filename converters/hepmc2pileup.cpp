@@ -21,6 +21,8 @@
 #include <stdexcept>
 
 #include <signal.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "TApplication.h"
 #include "TROOT.h"
@@ -65,13 +67,39 @@ int main(int argc, char *argv[])
   Candidate *candidate = 0;
   DelphesPileUpWriter *writer = 0;
   DelphesHepMC2Reader *reader = 0;
-  Int_t i;
+  Int_t i, j, compression = 505;
   Long64_t length, eventCounter;
 
+  // the options are removed from the arguments
+
+  i = 1;
+  while(i < argc)
+  {
+    if(strncmp(argv[i], "--compression=", 14) == 0)
+    {
+      compression = atoi(argv[i] + 14);
+    }
+    else if(strcmp(argv[i], "--v1") == 0)
+    {
+      compression = 0;
+    }
+    else
+    {
+      ++i;
+      continue;
+    }
+
+    for(j = i + 1; j < argc; ++j) argv[j - 1] = argv[j];
+    --argc;
+  }
+
   if(argc < 2)
   {
-    cout << " Usage: " << appName << " output_file"
+    cout << " Usage: " << appName << " [--compression=505] [--v1] output_file"
          << " [input_file(s)]" << endl;
+    cout << " by default, the events are written in the compressed format (v2) with zstd," << endl;
+    cout << " --compression - ROOT compression setting, 100 * algorithm + level (505 by default)," << endl;
+    cout << " --v1 - write the original uncompressed format (v1) read by older Delphes versions," << endl;
     cout << " output_file - output binary pile-up file," << endl;
     cout << " input_file(s) - input file(s) in HepMC format," << endl;
     cout << " with no input_file, or when input_file is -, read standard input." << endl;
@@ -88,7 +116,7 @@ int main(int argc, char *argv[])
 
   try
   {
-    writer = new DelphesPileUpWriter(argv[1]);
+    writer = new DelphesPileUpWriter(argv[1], compression);
 
     factory = new DelphesFactory("ObjectFactory");
     allParticleOutputArray = factory->NewPermanentArray();
@@ -99,6 +127,9 @@ int main(int argc, char *argv[])
 
     reader = new DelphesHepMC2Reader;
 
+    // parse the input in a separate thread while the writer compresses events
+    reader->SetReadAhead(64);
+
     i = 2;
     do
     {
@@ -167,6 +198,8 @@ int main(int argc, char *argv[])
         progressBar.Update(ftello(inputFile), eventCounter);
       }
 
+      reader->StopReadAhead();
+
       fseek(inputFile, 0L, SEEK_END);
       progressBar.Update(ftello(inputFile), eventCounter, kTRUE);
       progressBar.Finish();
@@ -19,16 +19,202 @@
 #include "display/DelphesBranchElement.h"
 #include "TEveArrow.h"
 #include "TEveJetCone.h"
+#include "TEveStraightLineSet.h"
 #include "TEveTrack.h"
 #include "TEveTrackPropagator.h"
 #include "TEveVector.h"
+#include "TMath.h"
 #include "classes/DelphesClasses.h"
+#include <algorithm>
 #include <iostream>
 
+// copy of the branch content, one object per displayed element
+void DelphesBranchBase::FillData(DelphesBranchData &data) const
+{
+  data.clear();
+  if(!branch_) return;
+
+  TString type = GetType();
+  TIter itObject(branch_);
+  DelphesDisplayObject object;
+  data.reserve(branch_->GetEntriesFast());
+  if(type == "Tower")
+  {
+    Tower *tower;
+    while((tower = (Tower *)itObject.Next()))
+    {
+      object = DelphesDisplayObject();
+      std::copy(tower->Edges, tower->Edges + 4, object.edges);
+      object.eem = tower->Eem;
+      object.ehad = tower->Ehad;
+      data.push_back(object);
+    }
+  }
+  else if(type == "Jet")
+  {
+    Jet *jet;
+    while((jet = (Jet *)itObject.Next()))
+    {
+      object = DelphesDisplayObject();
+      object.pt = jet->PT;
+      object.eta = jet->Eta;
+      object.phi = jet->Phi;
+      object.mass = jet->Mass;
+      object.deltaEta = jet->DeltaEta;
+      object.deltaPhi = jet->DeltaPhi;
+      data.push_back(object);
+    }
+  }
+  else if(type == "MissingET")
+  {
+    MissingET *MET;
+    while((MET = (MissingET *)itObject.Next()))
+    {
+      object = DelphesDisplayObject();
+      object.pt = MET->MET;
+      object.eta = MET->Eta;
+      object.phi = MET->Phi;
+      data.push_back(object);
+    }
+  }
+  else if(type == "Track")
+  {
+    Track *track;
+    while((track = (Track *)itObject.Next()))
+    {
+      object = DelphesDisplayObject();
+      object.pid = track->PID;
+      object.status = 1;
+      object.charge = track->Charge;
+      object.px = track->P4().Px();
+      object.py = track->P4().Py();
+      object.pz = track->P4().Pz();
+      object.e = track->P4().E();
+      object.x = track->X;
+      object.y = track->Y;
+      object.z = track->Z;
+      object.t = track->T;
+      data.push_back(object);
+    }
+  }
+  else if(type == "Electron")
+  {
+    Electron *electron;
+    GenParticle *particle;
+    while((electron = (Electron *)itObject.Next()))
+    {
+      particle = (GenParticle *)electron->Particle.GetObject();
+      object = DelphesDisplayObject();
+      object.pid = electron->Charge < 0 ? 11 : -11;
+      object.status = 1;
+      object.charge = electron->Charge;
+      object.px = electron->P4().Px();
+      object.py = electron->P4().Py();
+      object.pz = electron->P4().Pz();
+      object.e = electron->P4().E();
+      object.x = particle->X;
+      object.y = particle->Y;
+      object.z = particle->Z;
+      object.t = particle->T;
+      data.push_back(object);
+    }
+  }
+  else if(type == "Muon")
+  {
+    Muon *muon;
+    GenParticle *particle;
+    while((muon = (Muon *)itObject.Next()))
+    {
+      particle = (GenParticle *)muon->Particle.GetObject();
+      object = DelphesDisplayObject();
+      object.pid = muon->Charge < 0 ? 13 : -13;
+      object.status = 1;
+      object.charge = muon->Charge;
+      object.px = muon->P4().Px();
+      object.py = muon->P4().Py();
+      object.pz = muon->P4().Pz();
+      object.e = muon->P4().E();
+      object.x = particle->X;
+      object.y = particle->Y;
+      object.z = particle->Z;
+      object.t = particle->T;
+      data.push_back(object);
+    }
+  }
+  else if(type == "Photon")
+  {
+    Photon *photon;
+    while((photon = (Photon *)itObject.Next()))
+    {
+      object = DelphesDisplayObject();
+      object.pid = 22;
+      object.status = 1;
+      object.px = photon->P4().Px();
+      object.py = photon->P4().Py();
+      object.pz = photon->P4().Pz();
+      object.e = photon->P4().E();
+      data.push_back(object);
+    }
+  }
+  else if(type == "GenParticle")
+  {
+    GenParticle *particle;
+    while((particle = (GenParticle *)itObject.Next()))
+    {
+      if(particle->Status != 1) continue;
+      object = DelphesDisplayObject();
+      object.pid = particle->PID;
+      object.status = particle->Status;
+      object.charge = particle->Charge;
+      object.px = particle->P4().Px();
+      object.py = particle->P4().Py();
+      object.pz = particle->P4().Pz();
+      object.e = particle->P4().E();
+      object.x = particle->X;
+      object.y = particle->Y;
+      object.z = particle->Z;
+      object.t = particle->T;
+      data.push_back(object);
+    }
+  }
+}
+
+std::vector<TLorentzVector> DelphesBranchBase::GetVectors() const
+{
+  if(!objects_) return std::vector<TLorentzVector>();
+  return GetVectors(*objects_);
+}
+
+std::vector<TLorentzVector> DelphesBranchBase::GetVectors(const DelphesBranchData &data) const
+{
+  std::vector<TLorentzVector> output;
+  TString type = GetType();
+  DelphesBranchData::const_iterator object;
+  TLorentzVector v;
+  output.reserve(data.size());
+  for(object = data.begin(); object != data.end(); ++object)
+  {
+    if(type == "Tower")
+    {
+      v.SetPtEtaPhiM(object->eem + object->ehad, (object->edges[0] + object->edges[1]) / 2., (object->edges[2] + object->edges[3]) / 2., 0.);
+    }
+    else if(type == "Jet" || type == "MissingET")
+    {
+      v.SetPtEtaPhiM(object->pt, object->eta, object->phi, object->mass);
+    }
+    else
+    {
+      v.SetPxPyPzE(object->px, object->py, object->pz, object->e);
+    }
+    output.push_back(v);
+  }
+  return output;
+}
+
 // special case for calo towers
 template <>
 DelphesBranchElement<DelphesCaloData>::DelphesBranchElement(const char *name, TClonesArray *branch, const enum EColor color, Float_t maxPt) :
-  DelphesBranchBase(name, branch, color, maxPt)
+  DelphesBranchBase(name, branch, color, maxPt), nextChunk_(0)
 {
   data_ = new DelphesCaloData(2);
   data_->RefSliceInfo(0).Setup("ECAL", 0.1, kRed);
@@ -40,42 +226,25 @@ void DelphesBranchElement<DelphesCaloData>::Reset() { data_->ClearTowers(); }
 template <>
 void DelphesBranchElement<DelphesCaloData>::ReadBranch()
 {
-  if(TString(GetType()) == "Tower")
+  if(!objects_ || TString(GetType()) != "Tower") return;
+
+  // fill all towers at once and notify the calorimeter views a single time
+  DelphesBranchData::const_iterator tower;
+  data_->ReserveTowers(objects_->size());
+  for(tower = objects_->begin(); tower != objects_->end(); ++tower)
   {
-    // Loop over all towers
-    TIter itTower(branch_);
-    Tower *tower;
-    while((tower = (Tower *)itTower.Next()))
-    {
-      data_->AddTower(tower->Edges[0], tower->Edges[1], tower->Edges[2], tower->Edges[3]);
-      data_->FillSlice(0, tower->Eem);
-      data_->FillSlice(1, tower->Ehad);
-    }
-    data_->DataChanged();
+    if(tower->eem + tower->ehad < threshold_) continue;
+    data_->AddTower(tower->edges[0], tower->edges[1], tower->edges[2], tower->edges[3]);
+    data_->FillSlice(0, tower->eem);
+    data_->FillSlice(1, tower->ehad);
   }
-}
-template <>
-std::vector<TLorentzVector> DelphesBranchElement<DelphesCaloData>::GetVectors()
-{
-  std::vector<TLorentzVector> output;
-  if(TString(GetType()) == "Tower")
-  {
-    TIter itTower(branch_);
-    Tower *tower;
-    while((tower = (Tower *)itTower.Next()))
-    {
-      TLorentzVector v;
-      v.SetPtEtaPhiM(tower->Eem + tower->Ehad, (tower->Edges[0] + tower->Edges[1]) / 2., (tower->Edges[2] + tower->Edges[3]) / 2., 0.);
-      output.push_back(v);
-    }
-  }
-  return output;
+  data_->DataChanged();
 }
 
 // special case for element lists
 template <>
 DelphesBranchElement<TEveElementList>::DelphesBranchElement(const char *name, TClonesArray *branch, const enum EColor color, Float_t maxPt) :
-  DelphesBranchBase(name, branch, color, maxPt)
+  DelphesBranchBase(name, branch, color, maxPt), nextChunk_(0)
 {
   data_ = new TEveElementList(name);
   data_->SetMainColor(color_);
@@ -85,43 +254,43 @@ void DelphesBranchElement<TEveElementList>::Reset() { data_->DestroyElements();
 template <>
 void DelphesBranchElement<TEveElementList>::ReadBranch()
 {
+  if(!objects_) return;
   if(TString(GetType()) == "Jet")
   {
-    TIter itJet(branch_);
-    Jet *jet;
+    DelphesBranchData::const_iterator jet;
     TEveJetCone *eveJetCone;
     // Loop over all jets
     Int_t counter = 0;
-    while((jet = (Jet *)itJet.Next()))
+    for(jet = objects_->begin(); jet != objects_->end(); ++jet)
     {
+      if(jet->pt < threshold_) continue;
       eveJetCone = new TEveJetCone();
-      eveJetCone->SetTitle(Form("jet [%d]: Pt=%f, Eta=%f, \nPhi=%f, M=%f", counter, jet->PT, jet->Eta, jet->Phi, jet->Mass));
+      eveJetCone->SetTitle(Form("jet [%d]: Pt=%f, Eta=%f, \nPhi=%f, M=%f", counter, jet->pt, jet->eta, jet->phi, jet->mass));
       eveJetCone->SetName(Form("jet [%d]", counter++));
       eveJetCone->SetMainTransparency(60);
       eveJetCone->SetLineColor(GetColor());
       eveJetCone->SetFillColor(GetColor());
       eveJetCone->SetCylinder(tkRadius_ - 10, tkHalfLength_ - 10);
       eveJetCone->SetPickable(kTRUE);
-      eveJetCone->AddEllipticCone(jet->Eta, jet->Phi, jet->DeltaEta, jet->DeltaPhi);
+      eveJetCone->AddEllipticCone(jet->eta, jet->phi, jet->deltaEta, jet->deltaPhi);
       data_->AddElement(eveJetCone);
     }
   }
   else if(TString(GetType()) == "MissingET")
   {
     // MissingET as invisible track (like a photon)
-    MissingET *MET;
     TEveTrack *eveMet;
     TEveTrackPropagator *trkProp = new TEveTrackPropagator();
     trkProp->SetMagField(0., 0., -tk_Bz_);
     trkProp->SetMaxR(tkRadius_);
     trkProp->SetMaxZ(tkHalfLength_);
-    if(branch_->GetEntriesFast() > 0)
+    if(objects_->size() > 0)
     {
-      MET = (MissingET *)branch_->At(0);
+      const DelphesDisplayObject &MET = objects_->front();
       TParticle pb(13, 1, 0, 0, 0, 0,
-        (tkRadius_ * MET->MET / maxPt_) * cos(MET->Phi),
-        (tkRadius_ * MET->MET / maxPt_) * sin(MET->Phi),
-        0., MET->MET, 0.0, 0.0, 0.0, 0.0);
+        (tkRadius_ * MET.pt / maxPt_) * cos(MET.phi),
+        (tkRadius_ * MET.pt / maxPt_) * sin(MET.phi),
+        0., MET.pt, 0.0, 0.0, 0.0, 0.0);
       eveMet = new TEveTrack(&pb, 0, trkProp);
       eveMet->SetName("Missing Et");
       eveMet->SetStdTitle();
@@ -137,41 +306,54 @@ void DelphesBranchElement<TEveElementList>::ReadBranch()
     }
   }
 }
-template <>
-std::vector<TLorentzVector> DelphesBranchElement<TEveElementList>::GetVectors()
+
+// approximates the trajectory of a soft particle by a few straight segments
+static void AddSoftTrack(TEveStraightLineSet *lines, const DelphesDisplayObject &object, Double_t radius, Double_t halfLength, Double_t bz)
 {
-  std::vector<TLorentzVector> output;
-  if(TString(GetType()) == "Jet")
+  const Int_t segments = 8;
+  Double_t pt = TMath::Hypot(object.px, object.py);
+  if(pt <= 0.0) return;
+
+  Double_t x = object.x / 10.0, y = object.y / 10.0, z = object.z / 10.0;
+  Double_t xNext, yNext, zNext, phiNext;
+  Double_t phi = TMath::ATan2(object.py, object.px);
+  Double_t cotTheta = object.pz / pt;
+
+  // signed curvature in 1/cm, positive particles turn clockwise for bz > 0
+  Double_t curvature = -0.0029979 * object.charge * bz / pt;
+
+  // transverse path length: across the tracker, or at most half a turn
+  Double_t length = 2.0 * radius;
+  if(curvature != 0.0) length = TMath::Min(length, TMath::Pi() / TMath::Abs(curvature));
+  Double_t step = length / segments;
+
+  for(Int_t i = 0; i < segments; ++i)
   {
-    TIter itJet(branch_);
-    Jet *jet;
-    // Loop over all jets
-    while((jet = (Jet *)itJet.Next()))
+    phiNext = phi + curvature * step;
+    if(curvature != 0.0)
     {
-      TLorentzVector v;
-      v.SetPtEtaPhiM(jet->PT, jet->Eta, jet->Phi, jet->Mass);
-      output.push_back(v);
+      xNext = x + (TMath::Sin(phiNext) - TMath::Sin(phi)) / curvature;
+      yNext = y - (TMath::Cos(phiNext) - TMath::Cos(phi)) / curvature;
     }
-  }
-  else if(TString(GetType()) == "MissingET")
-  {
-    TIter itMet(branch_);
-    MissingET *MET;
-    // Missing Et
-    while((MET = (MissingET *)itMet.Next()))
+    else
     {
-      TLorentzVector v;
-      v.SetPtEtaPhiM(MET->MET, MET->Eta, MET->Phi, 0.);
-      output.push_back(v);
+      xNext = x + step * TMath::Cos(phi);
+      yNext = y + step * TMath::Sin(phi);
     }
+    zNext = z + step * cotTheta;
+    if(xNext * xNext + yNext * yNext > radius * radius || TMath::Abs(zNext) > halfLength) break;
+    lines->AddLine(x, y, z, xNext, yNext, zNext);
+    x = xNext;
+    y = yNext;
+    z = zNext;
+    phi = phiNext;
   }
-  return output;
 }
 
 // special case for track lists
 template <>
 DelphesBranchElement<TEveTrackList>::DelphesBranchElement(const char *name, TClonesArray *branch, const enum EColor color, Float_t maxPt) :
-  DelphesBranchBase(name, branch, color, maxPt)
+  DelphesBranchBase(name, branch, color, maxPt), nextChunk_(0)
 {
   data_ = new TEveTrackList(name);
   data_->SetMainColor(color_);
@@ -191,161 +373,74 @@ void DelphesBranchElement<TEveTrackList>::SetTrackingVolume(Float_t r, Float_t l
   trkProp->SetMaxZ(tkHalfLength_);
 }
 template <>
-void DelphesBranchElement<TEveTrackList>::Reset() { data_->DestroyElements(); }
+void DelphesBranchElement<TEveTrackList>::Reset()
+{
+  data_->DestroyElements();
+  soft_.clear();
+  softSets_.clear();
+  nextChunk_ = 0;
+}
+template <>
+void DelphesBranchElement<TEveTrackList>::AddTrack(Int_t index)
+{
+  const DelphesDisplayObject &object = (*objects_)[index];
+  TParticle pb(object.pid, object.status, 0, 0, 0, 0,
+    object.px, object.py, object.pz, object.e,
+    object.x / 10.0, object.y / 10.0, object.z / 10.0, object.t / 10.0);
+  TEveTrack *eveTrack = new TEveTrack(&pb, index, data_->GetPropagator());
+  eveTrack->SetName(Form("%s [%d]", pb.GetName(), index));
+  eveTrack->SetStdTitle();
+  eveTrack->SetAttLineAttMarker(data_);
+  if(object.charge == 0) eveTrack->SetLineStyle(7);
+  data_->AddElement(eveTrack);
+  eveTrack->SetLineColor(GetColor());
+  eveTrack->MakeTrack();
+}
 template <>
 void DelphesBranchElement<TEveTrackList>::ReadBranch()
 {
-  TString type = GetType();
-  TIter itTrack(branch_);
-  Int_t counter = 0;
-  TEveTrack *eveTrack;
+  if(!objects_) return;
   TEveTrackPropagator *trkProp = data_->GetPropagator();
   trkProp->SetMagField(0., 0., -tk_Bz_);
   trkProp->SetMaxR(tkRadius_);
   trkProp->SetMaxZ(tkHalfLength_);
-  GenParticle *particle;
-  if(type == "Track")
-  { // CASE 1: TRACKS
-    Track *track;
-    while((track = (Track *)itTrack.Next()))
-    {
-      TParticle pb(track->PID, 1, 0, 0, 0, 0,
-        track->P4().Px(), track->P4().Py(),
-        track->P4().Pz(), track->P4().E(),
-        track->X / 10.0, track->Y / 10.0, track->Z / 10.0, track->T / 10.0);
-      eveTrack = new TEveTrack(&pb, counter, trkProp);
-      eveTrack->SetName(Form("%s [%d]", pb.GetName(), counter++));
-      eveTrack->SetStdTitle();
-      eveTrack->SetAttLineAttMarker(data_);
-      data_->AddElement(eveTrack);
-      eveTrack->SetLineColor(GetColor());
-      eveTrack->MakeTrack();
-    }
-  }
-  else if(type == "Electron")
-  { // CASE 2: ELECTRONS
-    Electron *electron;
-    while((electron = (Electron *)itTrack.Next()))
-    {
-      particle = (GenParticle *)electron->Particle.GetObject();
-      TParticle pb(electron->Charge < 0 ? 11 : -11, 1, 0, 0, 0, 0,
-        electron->P4().Px(), electron->P4().Py(),
-        electron->P4().Pz(), electron->P4().E(),
-        particle->X / 10.0, particle->Y / 10.0, particle->Z / 10.0, particle->T / 10.0);
-      eveTrack = new TEveTrack(&pb, counter, trkProp);
-      eveTrack->SetName(Form("%s [%d]", pb.GetName(), counter++));
-      eveTrack->SetStdTitle();
-      eveTrack->SetAttLineAttMarker(data_);
-      data_->AddElement(eveTrack);
-      eveTrack->SetLineColor(GetColor());
-      eveTrack->MakeTrack();
-    }
-  }
-  else if(type == "Muon")
-  { // CASE 3: MUONS
-    Muon *muon;
-    while((muon = (Muon *)itTrack.Next()))
-    {
-      particle = (GenParticle *)muon->Particle.GetObject();
-      TParticle pb(muon->Charge < 0 ? 13 : -13, 1, 0, 0, 0, 0,
-        muon->P4().Px(), muon->P4().Py(),
-        muon->P4().Pz(), muon->P4().E(),
-        particle->X / 10.0, particle->Y / 10.0, particle->Z / 10.0, particle->T / 10.0);
-      eveTrack = new TEveTrack(&pb, counter, trkProp);
-      eveTrack->SetName(Form("%s [%d]", pb.GetName(), counter++));
-      eveTrack->SetStdTitle();
-      eveTrack->SetAttLineAttMarker(data_);
-      data_->AddElement(eveTrack);
-      eveTrack->SetLineColor(GetColor());
-      eveTrack->MakeTrack();
-    }
-  }
-  else if(type == "Photon")
-  { // CASE 4: PHOTONS
-    Photon *photon;
-    while((photon = (Photon *)itTrack.Next()))
+
+  // hard objects are propagated right away, soft ones are grouped
+  // in chunks drawn as single line sets until they are refined
+  TEveStraightLineSet *lines = 0;
+  for(Int_t i = 0; i < Int_t(objects_->size()); ++i)
+  {
+    const DelphesDisplayObject &object = (*objects_)[i];
+    if(TMath::Hypot(object.px, object.py) >= threshold_)
     {
-      TParticle pb(22, 1, 0, 0, 0, 0,
-        photon->P4().Px(), photon->P4().Py(),
-        photon->P4().Pz(), photon->P4().E(),
-        0.0, 0.0, 0.0, 0.0);
-      eveTrack = new TEveTrack(&pb, counter, trkProp);
-      eveTrack->SetName(Form("%s [%d]", pb.GetName(), counter++));
-      eveTrack->SetStdTitle();
-      eveTrack->SetAttLineAttMarker(data_);
-      eveTrack->SetLineStyle(7);
-      data_->AddElement(eveTrack);
-      eveTrack->SetLineColor(GetColor());
-      eveTrack->MakeTrack();
+      AddTrack(i);
+      continue;
     }
-  }
-  else if(type == "GenParticle")
-  { // CASE 5: GENPARTICLES
-    GenParticle *particle;
-    while((particle = (GenParticle *)itTrack.Next()))
+    if(soft_.size() % chunkSize_ == 0)
     {
-      if(particle->Status != 1) continue;
-      TParticle pb(particle->PID, particle->Status, particle->M1, particle->M2, particle->D1, particle->D2,
-        particle->P4().Px(), particle->P4().Py(),
-        particle->P4().Pz(), particle->P4().E(),
-        particle->X / 10.0, particle->Y / 10.0, particle->Z / 10.0, particle->T / 10.0);
-      eveTrack = new TEveTrack(&pb, counter, trkProp);
-      eveTrack->SetName(Form("%s [%d]", pb.GetName(), counter++));
-      eveTrack->SetStdTitle();
-      eveTrack->SetAttLineAttMarker(data_);
-      data_->AddElement(eveTrack);
-      eveTrack->SetLineColor(GetColor());
-      if(particle->Charge == 0) eveTrack->SetLineStyle(7);
-      eveTrack->MakeTrack();
+      lines = new TEveStraightLineSet(Form("soft %s [%d]", GetName(), Int_t(softSets_.size())));
+      lines->SetLineColor(GetColor());
+      data_->AddElement(lines);
+      softSets_.push_back(lines);
     }
+    soft_.push_back(i);
+    AddSoftTrack(lines, object, tkRadius_, tkHalfLength_, tk_Bz_);
   }
 }
 template <>
-std::vector<TLorentzVector> DelphesBranchElement<TEveTrackList>::GetVectors()
+Int_t DelphesBranchElement<TEveTrackList>::Refine()
 {
-  std::vector<TLorentzVector> output;
-  TString type = GetType();
-  TIter itTrack(branch_);
-  if(type == "Track")
-  { // CASE 1: TRACKS
-    Track *track;
-    while((track = (Track *)itTrack.Next()))
-    {
-      output.push_back(track->P4());
-    }
-  }
-  else if(type == "Electron")
-  { // CASE 2: ELECTRONS
-    Electron *electron;
-    while((electron = (Electron *)itTrack.Next()))
-    {
-      output.push_back(electron->P4());
-    }
-  }
-  else if(type == "Muon")
-  { // CASE 3: MUONS
-    Muon *muon;
-    while((muon = (Muon *)itTrack.Next()))
-    {
-      output.push_back(muon->P4());
-    }
-  }
-  else if(type == "Photon")
-  { // CASE 4: PHOTONS
-    Photon *photon;
-    while((photon = (Photon *)itTrack.Next()))
-    {
-      output.push_back(photon->P4());
-    }
-  }
-  else if(type == "GenParticle")
-  { // CASE 5: GENPARTICLES
-    GenParticle *particle;
-    while((particle = (GenParticle *)itTrack.Next()))
-    {
-      if(particle->Status != 1) continue;
-      output.push_back(particle->P4());
-    }
+  // hidden collections are left aggregated
+  if(nextChunk_ >= softSets_.size() || !data_->GetRnrChildren()) return 0;
+
+  size_t first = nextChunk_ * chunkSize_;
+  size_t last = std::min(first + chunkSize_, soft_.size());
+  for(size_t i = first; i < last; ++i)
+  {
+    AddTrack(soft_[i]);
   }
-  return output;
+  softSets_[nextChunk_]->Destroy();
+  softSets_[nextChunk_] = 0;
+  ++nextChunk_;
+  return Int_t(last - first);
 }
@@ -24,17 +24,35 @@
 #include "TColor.h"
 #include "TEveElement.h"
 #include "TEveTrack.h"
+#include "TLorentzVector.h"
 #include "TString.h"
 #include "display/DelphesCaloData.h"
 #include <exception>
 #include <iostream>
+#include <vector>
+
+class TEveStraightLineSet;
+
+// plain copy of an object from a Delphes-tree branch, independent of the tree reader
+struct DelphesDisplayObject
+{
+  Int_t pid, status, charge;
+  Float_t pt, eta, phi, mass;
+  Float_t px, py, pz, e;
+  Float_t x, y, z, t;
+  Float_t deltaEta, deltaPhi;
+  Float_t edges[4];
+  Float_t eem, ehad;
+};
+
+typedef std::vector<DelphesDisplayObject> DelphesBranchData;
 
 // virtual class to represent objects from a Delphes-tree branch
 class DelphesBranchBase
 {
 public:
   DelphesBranchBase(const char *name = "", TClonesArray *branch = NULL, const enum EColor color = kBlack, Float_t maxPt = 50.) :
-    name_(name), maxPt_(maxPt), branch_(branch), color_(color) {}
+    name_(name), maxPt_(maxPt), threshold_(0.), chunkSize_(500), branch_(branch), objects_(NULL), color_(color) {}
   virtual ~DelphesBranchBase() {}
   const char *GetName() const { return (const char *)name_; }
   const char *GetType() const { return branch_ ? branch_->GetClass()->GetName() : "None"; }
@@ -47,13 +65,31 @@ public:
     tkHalfLength_ = l;
     tk_Bz_ = Bz;
   }
+  // level of detail: tracks below the pT threshold are first drawn as aggregated
+  // geometry and turned into individual tracks by Refine, one chunk at a time;
+  // jets and towers below the threshold are not drawn
+  void SetLevelOfDetail(Float_t threshold, Int_t chunkSize = 500)
+  {
+    threshold_ = threshold;
+    chunkSize_ = chunkSize > 0 ? chunkSize : 1;
+  }
+  // converts the next chunk of aggregated geometry, returns the number of objects added
+  virtual Int_t Refine() { return 0; }
+  // copy the current content of the branch (the caller owns the tree reader)
+  void FillData(DelphesBranchData &data) const;
+  // select the copy used by ReadBranch and GetVectors
+  void SetData(const DelphesBranchData *data) { objects_ = data; }
   virtual void ReadBranch() = 0;
-  virtual std::vector<TLorentzVector> GetVectors() = 0;
+  std::vector<TLorentzVector> GetVectors() const;
+  std::vector<TLorentzVector> GetVectors(const DelphesBranchData &data) const;
 
 protected:
   TString name_;
   Float_t maxPt_;
+  Float_t threshold_;
+  Int_t chunkSize_;
   TClonesArray *branch_;
+  const DelphesBranchData *objects_;
   const enum EColor color_;
   Float_t tkRadius_, tkHalfLength_, tk_Bz_;
 };
@@ -90,18 +126,21 @@ public:
   // template class name
   virtual const char *GetClassName() { return data_->ClassName(); }
 
-  // read the branch and fill elements for display
+  // fill elements for display from the selected copy of the branch
   virtual void ReadBranch() {}
 
-  // return the vector for all elements
-  virtual std::vector<TLorentzVector> GetVectors()
-  {
-    std::vector<TLorentzVector> v;
-    return v;
-  }
+  // convert the next chunk of aggregated geometry
+  virtual Int_t Refine() { return 0; }
 
 private:
+  void AddTrack(Int_t index);
+
   EveContainer *data_;
+
+  // objects drawn as aggregated geometry, and one line set per chunk
+  std::vector<Int_t> soft_;
+  std::vector<TEveStraightLineSet *> softSets_;
+  size_t nextChunk_;
 };
 
 #if !defined(__CINT__) && !defined(__CLING__)
@@ -113,8 +152,6 @@ template <>
 void DelphesBranchElement<DelphesCaloData>::Reset();
 template <>
 void DelphesBranchElement<DelphesCaloData>::ReadBranch();
-template <>
-std::vector<TLorentzVector> DelphesBranchElement<DelphesCaloData>::GetVectors();
 
 // special case for element lists
 template <>
@@ -123,8 +160,6 @@ template <>
 void DelphesBranchElement<TEveElementList>::Reset();
 template <>
 void DelphesBranchElement<TEveElementList>::ReadBranch();
-template <>
-std::vector<TLorentzVector> DelphesBranchElement<TEveElementList>::GetVectors();
 
 // special case for track lists
 template <>
@@ -136,7 +171,9 @@ void DelphesBranchElement<TEveTrackList>::Reset();
 template <>
 void DelphesBranchElement<TEveTrackList>::ReadBranch();
 template <>
-std::vector<TLorentzVector> DelphesBranchElement<TEveTrackList>::GetVectors();
+Int_t DelphesBranchElement<TEveTrackList>::Refine();
+template <>
+void DelphesBranchElement<TEveTrackList>::AddTrack(Int_t index);
 
 #endif // CINT, CLING
 
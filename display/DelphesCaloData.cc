@@ -36,6 +36,21 @@ DelphesCaloData::~DelphesCaloData()
 void DelphesCaloData::ClearTowers()
 {
   fGeomVec.clear();
+  for(vvFloat_i it = fSliceVec.begin(); it != fSliceVec.end(); ++it)
+  {
+    it->clear();
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesCaloData::ReserveTowers(Int_t size)
+{
+  fGeomVec.reserve(size);
+  for(vvFloat_i it = fSliceVec.begin(); it != fSliceVec.end(); ++it)
+  {
+    it->reserve(size);
+  }
 }
 
 //------------------------------------------------------------------------------
@@ -30,6 +30,8 @@ public:
 
   void ClearTowers();
 
+  void ReserveTowers(Int_t size);
+
   ClassDef(DelphesCaloData, 1)
 };
 
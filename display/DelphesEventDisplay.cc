@@ -50,12 +50,14 @@
 #include "TRootBrowser.h"
 #include "TRootEmbeddedCanvas.h"
 #include "TSystem.h"
+#include "TTimer.h"
 
 #include "display/Delphes3DGeometry.h"
 #include "display/DelphesBranchElement.h"
 #include "display/DelphesCaloData.h"
 #include "display/DelphesDisplay.h"
 #include "display/DelphesEventDisplay.h"
+#include "display/DelphesEventLoader.h"
 #include "display/DelphesHtmlSummary.h"
 #include "display/DelphesPlotSummary.h"
 
@@ -76,10 +78,14 @@ DelphesEventDisplay::DelphesEventDisplay()
   delphesDisplay_ = 0;
   etaAxis_ = 0;
   phiAxis_ = 0;
+  loader_ = 0;
+  refineTimer_ = 0;
 }
 
 DelphesEventDisplay::~DelphesEventDisplay()
 {
+  delete refineTimer_;
+  delete loader_;
   delete chain_;
 }
 
@@ -103,6 +109,8 @@ DelphesEventDisplay::DelphesEventDisplay(const char *configFile, const char *inp
   chain_ = new TChain("Delphes");
   treeReader_ = 0;
   delphesDisplay_ = 0;
+  loader_ = 0;
+  refineTimer_ = 0;
 
   // initialize the application
   TEveManager::Create(kTRUE, "IV");
@@ -141,6 +149,10 @@ DelphesEventDisplay::DelphesEventDisplay(const char *configFile, const char *inp
 
   // prepare data collections
   readConfig(configFile, elements_);
+  loader_ = new DelphesEventLoader(treeReader_, elements_, preloadEvents_);
+  refinedObjects_ = 0;
+  refineTimer_ = new TTimer(50);
+  refineTimer_->Connect("Timeout()", "DelphesEventDisplay", this, "RefineEvent()");
   for(std::vector<DelphesBranchBase *>::iterator element = elements_.begin(); element < elements_.end(); ++element)
   {
     DelphesBranchElement<TEveTrackList> *item_v1 = dynamic_cast<DelphesBranchElement<TEveTrackList> *>(*element);
@@ -194,6 +206,14 @@ void DelphesEventDisplay::readConfig(const char *configFile, std::vector<Delphes
   ExRootConfReader *confReader = new ExRootConfReader;
   confReader->ReadFile(configFile);
   ExRootConfParam branches = confReader->GetParam("TreeWriter::Branch");
+
+  // optional display settings, e.g. module EventDisplay EventDisplay { set TrackMinPT 2.0 }
+  preloadEvents_ = confReader->GetInt("EventDisplay::PreloadEvents", 1);
+  trackMinPT_ = confReader->GetDouble("EventDisplay::TrackMinPT", 1.0);
+  towerMinEnergy_ = confReader->GetDouble("EventDisplay::TowerMinEnergy", 0.0);
+  softChunkSize_ = confReader->GetInt("EventDisplay::SoftChunkSize", 500);
+  maxRefinedObjects_ = confReader->GetInt("EventDisplay::MaxRefinedObjects", 5000);
+
   Int_t nBranches = branches.GetSize() / 3;
   DelphesBranchElement<TEveTrackList> *tlist;
   DelphesBranchElement<DelphesCaloData> *clist;
@@ -210,6 +230,7 @@ void DelphesEventDisplay::readConfig(const char *configFile, std::vector<Delphes
       clist = new DelphesBranchElement<DelphesCaloData>(name, treeReader_->UseBranch(name), kBlack);
       clist->GetContainer()->SetEtaBins(etaAxis_);
       clist->GetContainer()->SetPhiBins(phiAxis_);
+      clist->SetLevelOfDetail(towerMinEnergy_);
       elements.push_back(clist);
     }
     else if(className == "Jet")
@@ -257,6 +278,7 @@ void DelphesEventDisplay::readConfig(const char *configFile, std::vector<Delphes
     {
       tlist = new DelphesBranchElement<TEveTrackList>(name, treeReader_->UseBranch(name), kCyan);
       tlist->SetTrackingVolume(tkRadius_, tkHalfLength_, bz_);
+      tlist->SetLevelOfDetail(trackMinPT_, softChunkSize_);
       tlist->GetContainer()->SetRnrSelf(false);
       tlist->GetContainer()->SetRnrChildren(false);
       elements.push_back(tlist);
@@ -277,6 +299,7 @@ void DelphesEventDisplay::readConfig(const char *configFile, std::vector<Delphes
       if(input.Contains("eflow", TString::kIgnoreCase) || name.Contains("eflow", TString::kIgnoreCase)) continue; //no eflow
       tlist = new DelphesBranchElement<TEveTrackList>(name, treeReader_->UseBranch(name), kBlue);
       tlist->SetTrackingVolume(tkRadius_, tkHalfLength_, bz_);
+      tlist->SetLevelOfDetail(trackMinPT_, softChunkSize_);
       elements.push_back(tlist);
     }
   }
@@ -288,25 +311,29 @@ void DelphesEventDisplay::load_event()
   // The contents of previous event are removed.
 
   // safety
-  if(event_id_ >= treeReader_->GetEntries() || event_id_ < 0) return;
+  if(event_id_ >= loader_->GetEntries() || event_id_ < 0) return;
 
   // message
   fStatusBar_->SetText(Form("Loading event %d.", event_id_), 1);
   gSystem->ProcessEvents();
 
   // clear the previous event
+  refineTimer_->Stop();
   gEve->GetViewers()->DeleteAnnotations();
   for(std::vector<DelphesBranchBase *>::iterator data = elements_.begin(); data < elements_.end(); ++data)
   {
     (*data)->Reset();
   }
 
-  // Load selected branches with data from specified event
-  treeReader_->ReadEntry(event_id_);
-  for(std::vector<DelphesBranchBase *>::iterator data = elements_.begin(); data < elements_.end(); ++data)
+  // Load selected branches with data from specified event,
+  // usually already copied by the loader in the background
+  const std::vector<DelphesBranchData> *event = loader_->GetEvent(event_id_);
+  for(size_t i = 0; i < elements_.size(); ++i)
   {
-    (*data)->ReadBranch();
+    elements_[i]->SetData(&(*event)[i]);
+    elements_[i]->ReadBranch();
   }
+  loader_->Prefetch(event_id_);
 
   // update display
   TEveElement *top = (TEveElement *)gEve->GetCurrentEvent();
@@ -321,6 +348,39 @@ void DelphesEventDisplay::load_event()
   gEve->Redraw3D(kFALSE, kTRUE);
   fStatusBar_->SetText(Form("Loaded event %d.", event_id_), 1);
   gSystem->ProcessEvents();
+
+  // soft objects are refined while the display is idle
+  refinedObjects_ = 0;
+  if(maxRefinedObjects_ > 0) refineTimer_->Start(50, kFALSE);
+}
+
+void DelphesEventDisplay::RefineEvent()
+{
+  // Replace the next chunk of aggregated soft objects by individual objects.
+
+  Int_t refined = 0;
+  for(std::vector<DelphesBranchBase *>::iterator data = elements_.begin(); data < elements_.end() && refined == 0; ++data)
+  {
+    refined = (*data)->Refine();
+  }
+  refinedObjects_ += refined;
+
+  if(refined > 0)
+  {
+    TEveElement *top = (TEveElement *)gEve->GetCurrentEvent();
+    delphesDisplay_->DestroyEventRPhi();
+    delphesDisplay_->ImportEventRPhi(top);
+    delphesDisplay_->DestroyEventRhoZ();
+    delphesDisplay_->ImportEventRhoZ(top);
+    gEve->Redraw3D(kFALSE, kFALSE);
+  }
+
+  if(refined == 0 || refinedObjects_ >= maxRefinedObjects_)
+  {
+    refineTimer_->Stop();
+    update_html_summary();
+    fStatusBar_->SetText(Form("Loaded event %d, %d soft objects refined.", event_id_, refinedObjects_), 1);
+  }
 }
 
 void DelphesEventDisplay::update_html_summary()
@@ -356,8 +416,14 @@ void DelphesEventDisplay::update_html_summary()
         TString ename = tracks->GetElementName();
         if(ename.First('\'') != kNPOS)
           ename.Remove(ename.First('\''));
+        // aggregated soft objects are not listed
+        Int_t ntracks = 0;
+        for(j = tracks->BeginChildren(); j != tracks->EndChildren(); ++j)
+        {
+          if((*j)->IsA() == TEveTrack::Class()) ++ntracks;
+        }
         table = htmlSummary_->AddTable(ename.Data(), 5,
-          tracks->NumChildren(), kTRUE, "first");
+          ntracks, kTRUE, "first");
         table->SetLabel(0, "Momentum");
         table->SetLabel(1, "P_t");
         table->SetLabel(2, "Phi");
@@ -366,6 +432,7 @@ void DelphesEventDisplay::update_html_summary()
         k = 0;
         for(j = tracks->BeginChildren(); j != tracks->EndChildren(); ++j)
         {
+          if((*j)->IsA() != TEveTrack::Class()) continue;
           Float_t p = ((TEveTrack *)(*j))->GetMomentum().Mag();
           table->SetValue(0, k, p);
           Float_t pt = ((TEveTrack *)(*j))->GetMomentum().Perp();
@@ -421,7 +488,7 @@ void DelphesEventDisplay::make_gui()
       hf->AddFrame(b, new TGLayoutHints(kLHintsLeft | kLHintsCenterY, 10, 2, 10, 10));
       b->Connect("Clicked()", "DelphesEventDisplay", this, "Bck()");
 
-      TGNumberEntry *numberEntry = new TGNumberEntry(hf, 0, 9, -1, TGNumberFormat::kNESInteger, TGNumberFormat::kNEANonNegative, TGNumberFormat::kNELLimitMinMax, 0, treeReader_->GetEntries());
+      TGNumberEntry *numberEntry = new TGNumberEntry(hf, 0, 9, -1, TGNumberFormat::kNESInteger, TGNumberFormat::kNEANonNegative, TGNumberFormat::kNELLimitMinMax, 0, loader_->GetEntries());
       hf->AddFrame(numberEntry, new TGLayoutHints(kLHintsCenterX | kLHintsCenterY, 2, 0, 10, 10));
       this->Connect("EventChanged(Int_t)", "TGNumberEntry", numberEntry, "SetIntNumber(Long_t)");
       numberEntry->GetNumberEntry()->Connect("TextChanged(char*)", "DelphesEventDisplay", this, "PreSetEv(char*)");
@@ -434,7 +501,7 @@ void DelphesEventDisplay::make_gui()
     vf->AddFrame(hf, new TGLayoutHints(kLHintsExpandX, 2, 2, 2, 2));
 
     TGHProgressBar *progress = new TGHProgressBar(frmMain, TGProgressBar::kFancy, 100);
-    progress->SetMax(treeReader_->GetEntries());
+    progress->SetMax(loader_->GetEntries());
     progress->ShowPosition(kTRUE, kFALSE, "Event %.0f");
     progress->SetBarColor("green");
     vf->AddFrame(progress, new TGLayoutHints(kLHintsExpandX, 10, 10, 5, 5));
@@ -475,7 +542,7 @@ void DelphesEventDisplay::make_gui()
 
 void DelphesEventDisplay::Fwd()
 {
-  if(event_id_ < treeReader_->GetEntries() - 2)
+  if(event_id_ < loader_->GetEntries() - 2)
   {
     EventChanged(event_id_ + 1);
   }
@@ -504,7 +571,7 @@ void DelphesEventDisplay::PreSetEv(char *ev)
 
 void DelphesEventDisplay::GoTo()
 {
-  if(event_id_tmp_ >= 0 && event_id_tmp_ < treeReader_->GetEntries() - 1)
+  if(event_id_tmp_ >= 0 && event_id_tmp_ < loader_->GetEntries() - 1)
   {
     EventChanged(event_id_tmp_);
   }
@@ -516,7 +583,9 @@ void DelphesEventDisplay::GoTo()
 
 void DelphesEventDisplay::InitSummaryPlots()
 {
+  loader_->Lock();
   plotSummary_->FillSample(treeReader_, event_id_);
+  loader_->Unlock();
   plotSummary_->FillEvent();
   plotSummary_->Draw();
 }
@@ -28,9 +28,11 @@ class TAxis;
 class TChain;
 class TGHtml;
 class TGStatusBar;
+class TTimer;
 class DelphesDisplay;
 class Delphes3DGeometry;
 class DelphesBranchBase;
+class DelphesEventLoader;
 class DelphesHtmlSummary;
 class DelphesPlotSummary;
 class ExRootTreeReader;
@@ -71,6 +73,13 @@ private:
   DelphesPlotSummary *plotSummary_;
   TGStatusBar *fStatusBar_;
 
+  // background loading and level of detail
+  DelphesEventLoader *loader_;
+  Int_t preloadEvents_;
+  Double_t trackMinPT_, towerMinEnergy_;
+  Int_t softChunkSize_, maxRefinedObjects_, refinedObjects_;
+  TTimer *refineTimer_;
+
   // gui controls
 public:
   void Fwd();
@@ -84,6 +93,8 @@ public:
   void InitSummaryPlots();
 
   void DisplayProgress(Int_t p);
+
+  void RefineEvent();
 };
 
 #endif //DelphesEventDisplay_h
@@ -0,0 +1,147 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "display/DelphesEventLoader.h"
+
+#include "TROOT.h"
+
+#include "external/ExRootAnalysis/ExRootTreeReader.h"
+
+//------------------------------------------------------------------------------
+
+DelphesEventLoader::DelphesEventLoader(ExRootTreeReader *treeReader, std::vector<DelphesBranchBase *> &elements, Int_t depth) :
+  treeReader_(treeReader), elements_(elements), entries_(treeReader->GetEntries()),
+  depth_(depth > 0 ? depth : 0), center_(0), stop_(false)
+{
+  if(depth_ > 0)
+  {
+    ROOT::EnableThreadSafety();
+    thread_ = std::thread(&DelphesEventLoader::Run, this);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+DelphesEventLoader::~DelphesEventLoader()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  condition_.notify_all();
+  if(thread_.joinable()) thread_.join();
+}
+
+//------------------------------------------------------------------------------
+
+const std::vector<DelphesBranchData> *DelphesEventLoader::GetEvent(Long64_t entry)
+{
+  std::shared_ptr<DelphesEventData> event;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    center_ = entry;
+    std::map<Long64_t, std::shared_ptr<DelphesEventData> >::iterator it = cache_.find(entry);
+    if(it != cache_.end()) event = it->second;
+  }
+
+  // not pre-loaded yet: read it from this thread
+  if(!event) event = Load(entry);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  current_ = event;
+  return current_.get();
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesEventLoader::Prefetch(Long64_t entry)
+{
+  if(depth_ == 0) return;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    center_ = entry;
+    Evict();
+    queue_.clear();
+    for(Int_t i = 1; i <= depth_; ++i)
+    {
+      if(entry + i < entries_ && cache_.find(entry + i) == cache_.end()) queue_.push_back(entry + i);
+      if(entry - i >= 0 && cache_.find(entry - i) == cache_.end()) queue_.push_back(entry - i);
+    }
+  }
+  condition_.notify_one();
+}
+
+//------------------------------------------------------------------------------
+
+std::shared_ptr<DelphesEventLoader::DelphesEventData> DelphesEventLoader::Load(Long64_t entry)
+{
+  std::lock_guard<std::recursive_mutex> readerLock(readerMutex_);
+  {
+    // the entry may have been loaded while waiting for the reader
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<Long64_t, std::shared_ptr<DelphesEventData> >::iterator it = cache_.find(entry);
+    if(it != cache_.end()) return it->second;
+  }
+
+  std::shared_ptr<DelphesEventData> event(new DelphesEventData(elements_.size()));
+  treeReader_->ReadEntry(entry);
+  for(size_t i = 0; i < elements_.size(); ++i)
+  {
+    elements_[i]->FillData((*event)[i]);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  cache_[entry] = event;
+  Evict();
+  return event;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesEventLoader::Evict()
+{
+  // keep only the entries within reach of the displayed one
+  std::map<Long64_t, std::shared_ptr<DelphesEventData> >::iterator it = cache_.begin();
+  while(it != cache_.end())
+  {
+    if(it->first < center_ - depth_ || it->first > center_ + depth_)
+      cache_.erase(it++);
+    else
+      ++it;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesEventLoader::Run()
+{
+  Long64_t entry;
+  while(true)
+  {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      while(!stop_ && queue_.empty()) condition_.wait(lock);
+      if(stop_) return;
+      entry = queue_.front();
+      queue_.pop_front();
+    }
+    Load(entry);
+  }
+}
+
+//------------------------------------------------------------------------------
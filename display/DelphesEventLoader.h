@@ -0,0 +1,80 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesEventLoader_h
+#define DelphesEventLoader_h
+
+#include "Rtypes.h"
+
+#include "display/DelphesBranchElement.h"
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ExRootTreeReader;
+
+// copies the displayed branches of a Delphes tree for a given entry, and pre-loads
+// the neighbouring entries on a background thread. All accesses to the tree reader
+// go through the reader lock.
+class DelphesEventLoader
+{
+public:
+  DelphesEventLoader(ExRootTreeReader *treeReader, std::vector<DelphesBranchBase *> &elements, Int_t depth = 1);
+  ~DelphesEventLoader();
+
+  Long64_t GetEntries() const { return entries_; }
+
+  // copy of the branches for the given entry, valid until the next call
+  const std::vector<DelphesBranchData> *GetEvent(Long64_t entry);
+
+  // schedule the entries around the given one for pre-loading
+  void Prefetch(Long64_t entry);
+
+  // direct access to the tree reader from the calling thread
+  void Lock() { readerMutex_.lock(); }
+  void Unlock() { readerMutex_.unlock(); }
+
+private:
+  typedef std::vector<DelphesBranchData> DelphesEventData;
+
+  std::shared_ptr<DelphesEventData> Load(Long64_t entry);
+  void Evict();
+  void Run();
+
+  ExRootTreeReader *treeReader_;
+  std::vector<DelphesBranchBase *> &elements_;
+  Long64_t entries_;
+  Int_t depth_;
+
+  std::recursive_mutex readerMutex_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::deque<Long64_t> queue_;
+  std::map<Long64_t, std::shared_ptr<DelphesEventData> > cache_;
+  std::shared_ptr<DelphesEventData> current_;
+  Long64_t center_;
+  bool stop_;
+  std::thread thread_;
+};
+
+#endif /* DelphesEventLoader_h */
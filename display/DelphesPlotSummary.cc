@@ -118,12 +118,14 @@ void DelphesPlotSummary::Init(std::vector<DelphesBranchBase *> &elements)
 void DelphesPlotSummary::FillSample(ExRootTreeReader *treeReader, Int_t event_id)
 {
   Int_t entries = treeReader->GetEntries();
+  DelphesBranchData data;
   for(Int_t i = 0; i < entries; ++i)
   {
     treeReader->ReadEntry(i);
     for(std::vector<DelphesBranchBase *>::iterator element = elements_->begin(); element < elements_->end(); ++element)
     {
-      std::vector<TLorentzVector> vectors = (*element)->GetVectors();
+      (*element)->FillData(data);
+      std::vector<TLorentzVector> vectors = (*element)->GetVectors(data);
       std::sort(vectors.begin(), vectors.end(), vecsorter);
       std::vector<TH1F *> histograms = histograms_[(*element)->GetName()];
       for(std::vector<TLorentzVector>::iterator it = vectors.begin(); it < vectors.end(); ++it)
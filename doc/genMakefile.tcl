@@ -257,6 +257,48 @@ OPT_LIBS += -L$(PYTHIA8)/lib -lpythia8 -ldl -lz
 endif
 endif
 
+# optional libraries used to decompress the input files of the readers,
+# searched in the system include directories and in the directory given
+# by the ZLIB, ZSTD, LZMA or LZ4 variable
+
+CODEC_DIRS = /usr/include /usr/local/include /opt/homebrew/include
+
+ifneq ($(wildcard $(ZLIB)/include/zlib.h $(addsuffix /zlib.h,$(CODEC_DIRS))),)
+CXXFLAGS += -DHAS_ZLIB
+ifneq ($(ZLIB),)
+CXXFLAGS += -I$(ZLIB)/include
+OPT_LIBS += -L$(ZLIB)/lib
+endif
+OPT_LIBS += -lz
+endif
+
+ifneq ($(wildcard $(ZSTD)/include/zstd.h $(addsuffix /zstd.h,$(CODEC_DIRS))),)
+CXXFLAGS += -DHAS_ZSTD
+ifneq ($(ZSTD),)
+CXXFLAGS += -I$(ZSTD)/include
+OPT_LIBS += -L$(ZSTD)/lib
+endif
+OPT_LIBS += -lzstd
+endif
+
+ifneq ($(wildcard $(LZMA)/include/lzma.h $(addsuffix /lzma.h,$(CODEC_DIRS))),)
+CXXFLAGS += -DHAS_LZMA
+ifneq ($(LZMA),)
+CXXFLAGS += -I$(LZMA)/include
+OPT_LIBS += -L$(LZMA)/lib
+endif
+OPT_LIBS += -llzma
+endif
+
+ifneq ($(wildcard $(LZ4)/include/lz4frame.h $(addsuffix /lz4frame.h,$(CODEC_DIRS))),)
+CXXFLAGS += -DHAS_LZ4
+ifneq ($(LZ4),)
+CXXFLAGS += -I$(LZ4)/include
+OPT_LIBS += -L$(LZ4)/lib
+endif
+OPT_LIBS += -llz4
+endif
+
 DELPHES_LIBS += $(OPT_LIBS)
 DISPLAY_LIBS += $(OPT_LIBS)
 
@@ -381,6 +423,9 @@ clean:
 distclean: clean
 	@rm -f $(NOFASTJET) $(NOFASTJETLIB) $(DELPHES) $(DELPHESLIB) $(DELPHES_DICT_PCM) $(FASTJET_DICT_PCM) $(DISPLAY) $(DISPLAYLIB) $(DISPLAY_DICT_PCM) $(EXECUTABLE)
 
+benchmark: DelphesBenchmark$(ExeSuf)
+	@./DelphesBenchmark$(ExeSuf) $(BENCHMARK_OPTIONS)
+
 dist:
 	@echo ">> Building $(DISTTAR)"
 	@mkdir -p $(DISTDIR)
@@ -0,0 +1,248 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+Writes two small files, the second one without the Electron branch, and reads
+them with the RDataFrame data source in two event loops using different columns,
+once for the first file and once for both files. The sums of the transverse
+momenta and the numbers of objects must be the ones of the written events:
+
+DataSourceCheck
+DataSourceCheck number_of_events
+*/
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "RVersion.h"
+#include "TApplication.h"
+#include "TFile.h"
+#include "TMath.h"
+#include "TROOT.h"
+#include "TRandom3.h"
+#include "TString.h"
+#include "TSystem.h"
+
+#include "classes/DelphesClasses.h"
+
+#include "ExRootAnalysis/ExRootDataSource.h"
+#include "ExRootAnalysis/ExRootTreeBranch.h"
+#include "ExRootAnalysis/ExRootTreeWriter.h"
+
+using namespace std;
+
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6, 22, 0)
+
+using ROOT::VecOps::RVec;
+
+//------------------------------------------------------------------------------
+
+struct TSums
+{
+  Double_t jetPT, jets, electronPT, electrons;
+};
+
+//------------------------------------------------------------------------------
+
+Double_t SumPT(const RVec<Float_t> &pt)
+{
+  Double_t sum = 0.0;
+  size_t i;
+
+  for(i = 0; i < pt.size(); ++i) sum += pt[i];
+  return sum;
+}
+
+//------------------------------------------------------------------------------
+
+Double_t Size(const RVec<Float_t> &pt)
+{
+  return pt.size();
+}
+
+//------------------------------------------------------------------------------
+
+void WriteFile(const TString &fileName, Int_t file, Long64_t numberOfEvents, TSums &sums)
+{
+  TFile *outputFile;
+  ExRootTreeWriter *treeWriter;
+  ExRootTreeBranch *branchJet, *branchElectron = 0;
+  TRandom3 random(file + 1);
+  Jet *jet;
+  Electron *electron;
+  Long64_t event;
+  Int_t i, size;
+
+  outputFile = TFile::Open(fileName, "RECREATE");
+  if(!outputFile || outputFile->IsZombie())
+  {
+    throw runtime_error(string("can't create ") + fileName.Data());
+  }
+
+  treeWriter = new ExRootTreeWriter(outputFile, "Delphes");
+
+  branchJet = treeWriter->NewBranch("Jet", Jet::Class());
+  if(file == 0) branchElectron = treeWriter->NewBranch("Electron", Electron::Class());
+
+  for(event = 0; event < numberOfEvents; ++event)
+  {
+    treeWriter->Clear();
+
+    size = random.Integer(6);
+    for(i = 0; i < size; ++i)
+    {
+      jet = static_cast<Jet *>(branchJet->NewEntry());
+      jet->PT = random.Uniform(20.0, 200.0);
+      sums.jetPT += jet->PT;
+      sums.jets += 1.0;
+    }
+
+    if(branchElectron)
+    {
+      size = random.Integer(4);
+      for(i = 0; i < size; ++i)
+      {
+        electron = static_cast<Electron *>(branchElectron->NewEntry());
+        electron->PT = random.Uniform(10.0, 100.0);
+        sums.electronPT += electron->PT;
+        sums.electrons += 1.0;
+      }
+    }
+
+    treeWriter->Fill();
+  }
+
+  treeWriter->Write();
+
+  delete treeWriter;
+  delete outputFile;
+}
+
+//------------------------------------------------------------------------------
+
+Int_t Compare(const char *name, Double_t value, Double_t expected)
+{
+  // the sums of RDataFrame are compensated
+  if(TMath::Abs(value - expected) <= 1.0e-9 * TMath::Abs(expected)) return 0;
+  cout << "** ERROR: " << name << " is " << value << " instead of " << expected << endl;
+  return 1;
+}
+
+//------------------------------------------------------------------------------
+
+// each result is taken before the next one is booked, so that each column is
+// read in its own event loop
+
+Int_t CheckFrame(const char *name, const vector<string> &fileNames, const TSums &sums)
+{
+  ROOT::RDataFrame frame = MakeExRootDataFrame("Delphes", fileNames);
+  Int_t failed = 0;
+  Double_t value;
+
+  cout << "** " << name << endl;
+
+  value = *frame.Define("JetSumPT", SumPT, {"Jet.PT"}).Sum<Double_t>("JetSumPT");
+  failed += Compare("Jet.PT sum", value, sums.jetPT);
+
+  value = *frame.Define("ElectronSumPT", SumPT, {"Electron.PT"}).Sum<Double_t>("ElectronSumPT");
+  failed += Compare("Electron.PT sum", value, sums.electronPT);
+
+  value = *frame.Define("Electrons", Size, {"Electron.PT"}).Sum<Double_t>("Electrons");
+  failed += Compare("number of electrons", value, sums.electrons);
+
+  value = *frame.Define("Jets", Size, {"Jet.PT"}).Sum<Double_t>("Jets");
+  failed += Compare("number of jets", value, sums.jets);
+
+  return failed;
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+  char appName[] = "DataSourceCheck";
+  vector<string> fileNames;
+  TString fileName;
+  TSums sums[2] = {{0.0, 0.0, 0.0, 0.0}, {0.0, 0.0, 0.0, 0.0}}, both;
+  Long64_t numberOfEvents = 1000;
+  Int_t file, failed = 0;
+
+  if(argc > 2)
+  {
+    cout << " Usage: " << appName << " [number_of_events]" << endl;
+    cout << " number_of_events - number of events in each file (1000 by default)." << endl;
+    return 1;
+  }
+
+  if(argc == 2) numberOfEvents = atol(argv[1]);
+
+  gROOT->SetBatch();
+
+  int appargc = 1;
+  char *appargv[] = {appName};
+  TApplication app(appName, &appargc, appargv);
+
+  try
+  {
+    for(file = 0; file < 2; ++file)
+    {
+      fileName.Form("%s/%s_%d_%d.root", gSystem->TempDirectory(), appName, gSystem->GetPid(), file);
+      WriteFile(fileName, file, numberOfEvents, sums[file]);
+      fileNames.push_back(fileName.Data());
+    }
+
+    // the events of the second file have no electrons
+
+    both.jetPT = sums[0].jetPT + sums[1].jetPT;
+    both.jets = sums[0].jets + sums[1].jets;
+    both.electronPT = sums[0].electronPT;
+    both.electrons = sums[0].electrons;
+
+    failed += CheckFrame("first file", vector<string>(1, fileNames[0]), sums[0]);
+    failed += CheckFrame("both files", fileNames, both);
+
+    for(file = 0; file < 2; ++file)
+    {
+      gSystem->Unlink(fileNames[file].c_str());
+    }
+
+    cout << "** " << failed << " differences with the written events" << endl;
+
+    return failed > 0 ? 1 : 0;
+  }
+  catch(runtime_error &e)
+  {
+    cerr << "** ERROR: " << e.what() << endl;
+    return 1;
+  }
+}
+
+#else
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+  cout << "** RDataFrame data source requires ROOT 6.22 or later, nothing to check" << endl;
+  return 0;
+}
+
+#endif
@@ -0,0 +1,674 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \class DelphesBenchmark
+ *
+ *  Performance regression benchmark. Runs the same synthetic events,
+ *  generated locally with a fixed seed, through a set of reference cards
+ *  (with a synthetic minimum bias file for the pile-up cards). Each card
+ *  is processed in its own process, and the event rate, the processing
+ *  time of each module, the peak resident memory and the output size
+ *  are reported and compared with a stored baseline.
+ *
+ */
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "TApplication.h"
+#include "TROOT.h"
+
+#include "TDatabasePDG.h"
+#include "TFile.h"
+#include "TLorentzVector.h"
+#include "TMath.h"
+#include "TObjArray.h"
+#include "TParticlePDG.h"
+#include "TRandom3.h"
+#include "TStopwatch.h"
+#include "TVector2.h"
+
+#include "classes/DelphesClasses.h"
+#include "classes/DelphesFactory.h"
+#include "classes/DelphesPileUpWriter.h"
+#include "modules/Delphes.h"
+
+#include "ExRootAnalysis/ExRootConfReader.h"
+#include "ExRootAnalysis/ExRootTreeBranch.h"
+#include "ExRootAnalysis/ExRootTreeWriter.h"
+
+using namespace std;
+
+typedef map<string, Double_t> TMetrics;
+
+//---------------------------------------------------------------------------
+
+static const char *const kReferenceCards[] = {
+  "cards/delphes_card_CMS.tcl",
+  "cards/delphes_card_ATLAS.tcl",
+  "cards/delphes_card_IDEA.tcl",
+  "cards/FCC/FCChh.tcl",
+  "cards/CMS_PhaseII/CMS_PhaseII_200PU_v04.tcl",
+  0};
+
+struct TOptions
+{
+  Int_t events;
+  Int_t seed;
+  Int_t pileUpEvents;
+  Double_t tolerance;
+  Double_t memoryTolerance;
+  string workDir;
+  string baseline;
+  string newBaseline;
+  vector<string> cards;
+};
+
+//---------------------------------------------------------------------------
+
+// stable particles of the synthetic events, with cumulative probabilities
+static const Int_t kSpecies[] = {211, -211, 22, 321, -321, 130, 2212, -2212, 2112, -2112};
+static const Double_t kSpeciesFraction[] = {0.275, 0.55, 0.80, 0.84, 0.88, 0.93, 0.95, 0.97, 0.985, 1.0};
+
+static Int_t RandomSpecies(TRandom3 &random)
+{
+  Int_t i;
+  Double_t u = random.Rndm();
+  for(i = 0; i < 9 && u > kSpeciesFraction[i]; ++i)
+    ;
+  return kSpecies[i];
+}
+
+//---------------------------------------------------------------------------
+
+static void AddParticle(DelphesFactory *factory, TObjArray *allParticleOutputArray,
+  TObjArray *stableParticleOutputArray, TObjArray *partonOutputArray,
+  Int_t pid, Int_t status, Double_t pt, Double_t eta, Double_t phi, Double_t z)
+{
+  TParticlePDG *pdgParticle = TDatabasePDG::Instance()->GetParticle(pid);
+  Candidate *candidate = factory->NewCandidate();
+
+  candidate->PID = pid;
+  candidate->Status = status;
+
+  candidate->M1 = -1;
+  candidate->M2 = -1;
+  candidate->D1 = -1;
+  candidate->D2 = -1;
+
+  candidate->Charge = pdgParticle ? Int_t(pdgParticle->Charge() / 3.0) : -999;
+  candidate->Mass = pdgParticle ? pdgParticle->Mass() : 0.0;
+
+  candidate->Momentum.SetPtEtaPhiM(pt, eta, phi, candidate->Mass);
+  candidate->Position.SetXYZT(0.0, 0.0, z, 0.0);
+
+  allParticleOutputArray->Add(candidate);
+
+  if(status == 1)
+  {
+    stableParticleOutputArray->Add(candidate);
+  }
+  else
+  {
+    partonOutputArray->Add(candidate);
+  }
+}
+
+//---------------------------------------------------------------------------
+
+// toy event: two jets from hard partons, an isolated lepton in some events
+// and a soft underlying event, all from a common vertex
+
+static void GenerateEvent(TRandom3 &random, DelphesFactory *factory, TObjArray *allParticleOutputArray,
+  TObjArray *stableParticleOutputArray, TObjArray *partonOutputArray)
+{
+  Int_t i, j, n, pid;
+  Double_t z, pt, eta, phi, sum;
+  vector<Double_t> fractions;
+
+  z = random.Gaus(0.0, 50.0);
+
+  phi = random.Uniform(-TMath::Pi(), TMath::Pi());
+  pt = 50.0 * TMath::Power(random.Rndm(), -1.0 / 3.0);
+  for(i = 0; i < 2; ++i)
+  {
+    eta = random.Uniform(-2.5, 2.5);
+    if(i == 1) phi = TVector2::Phi_mpi_pi(phi + TMath::Pi() + random.Gaus(0.0, 0.2));
+
+    pid = random.Rndm() < 0.2 ? 5 * (i == 0 ? 1 : -1) : 21;
+    AddParticle(factory, allParticleOutputArray, stableParticleOutputArray, partonOutputArray, pid, 23, pt, eta, phi, z);
+
+    // fragments sharing the parton momentum
+    n = TMath::Min(8 + random.Poisson(pt / 5.0), 60);
+    fractions.resize(n);
+    sum = 0.0;
+    for(j = 0; j < n; ++j)
+    {
+      fractions[j] = random.Exp(1.0);
+      sum += fractions[j];
+    }
+    for(j = 0; j < n; ++j)
+    {
+      AddParticle(factory, allParticleOutputArray, stableParticleOutputArray, partonOutputArray,
+        RandomSpecies(random), 1, pt * fractions[j] / sum,
+        eta + random.Gaus(0.0, 0.08), TVector2::Phi_mpi_pi(phi + random.Gaus(0.0, 0.08)), z);
+    }
+  }
+
+  if(random.Rndm() < 0.3)
+  {
+    pid = random.Rndm() < 0.5 ? 11 : 13;
+    if(random.Rndm() < 0.5) pid = -pid;
+    AddParticle(factory, allParticleOutputArray, stableParticleOutputArray, partonOutputArray,
+      pid, 1, random.Uniform(20.0, 100.0), random.Uniform(-2.4, 2.4), random.Uniform(-TMath::Pi(), TMath::Pi()), z);
+  }
+
+  n = random.Poisson(80.0);
+  for(i = 0; i < n; ++i)
+  {
+    AddParticle(factory, allParticleOutputArray, stableParticleOutputArray, partonOutputArray,
+      RandomSpecies(random), 1, 0.2 + random.Exp(0.5), random.Uniform(-5.0, 5.0), random.Uniform(-TMath::Pi(), TMath::Pi()), z);
+  }
+}
+
+//---------------------------------------------------------------------------
+
+// minimum bias events for the pile-up cards, the vertex is set by PileUpMerger
+
+static void GeneratePileUp(const string &fileName, Int_t events, Int_t seed)
+{
+  Int_t entry, i, n, pid;
+  Double_t pt, eta, phi, mass;
+  TParticlePDG *pdgParticle;
+  TLorentzVector momentum;
+  TRandom3 random(seed + 1);
+  DelphesPileUpWriter writer(fileName.c_str());
+
+  for(entry = 0; entry < events; ++entry)
+  {
+    n = random.Poisson(70.0);
+    for(i = 0; i < n; ++i)
+    {
+      pid = RandomSpecies(random);
+      pdgParticle = TDatabasePDG::Instance()->GetParticle(pid);
+      mass = pdgParticle ? pdgParticle->Mass() : 0.0;
+      pt = 0.1 + random.Exp(0.4);
+      eta = random.Uniform(-6.0, 6.0);
+      phi = random.Uniform(-TMath::Pi(), TMath::Pi());
+      momentum.SetPtEtaPhiM(pt, eta, phi, mass);
+      writer.WriteParticle(pid, 0.0, 0.0, 0.0, 0.0, momentum.Px(), momentum.Py(), momentum.Pz(), momentum.E());
+    }
+    writer.WriteEntry();
+  }
+  writer.WriteIndex();
+}
+
+//---------------------------------------------------------------------------
+
+static string CardLabel(const string &card)
+{
+  string label = card.substr(card.find_last_of('/') + 1);
+  return label.substr(0, label.rfind(".tcl"));
+}
+
+//---------------------------------------------------------------------------
+
+// processes the synthetic events with one card and writes the measurements
+
+static void RunCard(const TOptions &options, const string &card, const string &pileUpFile,
+  const string &outputFileName, const string &reportFileName)
+{
+  stringstream message;
+  TFile *outputFile = 0;
+  TStopwatch genStopWatch, procStopWatch, eventStopWatch;
+  ExRootTreeWriter *treeWriter = 0;
+  ExRootTreeBranch *branchEvent = 0;
+  ExRootConfReader *confReader = 0;
+  Delphes *modularDelphes = 0;
+  DelphesFactory *factory = 0;
+  TObjArray *stableParticleOutputArray = 0, *allParticleOutputArray = 0, *partonOutputArray = 0;
+  HepMCEvent *element;
+  TRandom3 random(options.seed);
+  Int_t i;
+  Long64_t eventCounter;
+
+  outputFile = TFile::Open(outputFileName.c_str(), "RECREATE");
+
+  if(outputFile == NULL)
+  {
+    message << "can't create output file " << outputFileName;
+    throw runtime_error(message.str());
+  }
+
+  treeWriter = new ExRootTreeWriter(outputFile, "Delphes");
+
+  branchEvent = treeWriter->NewBranch("Event", HepMCEvent::Class());
+
+  confReader = new ExRootConfReader;
+  confReader->ReadFile(card.c_str());
+
+  // fixed seed and local pile-up file, whatever the card says
+  string overrideFileName = options.workDir + "/" + CardLabel(card) + "_override.tcl";
+  ofstream overrideFile(overrideFileName.c_str());
+  overrideFile << "set RandomSeed " << options.seed << endl;
+  const ExRootConfReader::ExRootTaskMap *modules = confReader->GetModules();
+  ExRootConfReader::ExRootTaskMap::const_iterator itModules;
+  for(itModules = modules->begin(); itModules != modules->end(); ++itModules)
+  {
+    if(itModules->second == "PileUpMerger")
+    {
+      overrideFile << "set " << itModules->first << "::PileUpFile {" << pileUpFile << "}" << endl;
+    }
+  }
+  overrideFile.close();
+  confReader->ReadFile(overrideFileName.c_str(), false);
+
+  modularDelphes = new Delphes("Delphes");
+  modularDelphes->SetConfReader(confReader);
+  modularDelphes->SetTreeWriter(treeWriter);
+  modularDelphes->SetModuleTiming(kTRUE);
+
+  factory = modularDelphes->GetFactory();
+  allParticleOutputArray = modularDelphes->ExportArray("allParticles");
+  stableParticleOutputArray = modularDelphes->ExportArray("stableParticles");
+  partonOutputArray = modularDelphes->ExportArray("partons");
+
+  modularDelphes->InitTask();
+
+  treeWriter->Clear();
+  modularDelphes->Clear();
+  genStopWatch.Reset();
+  procStopWatch.Reset();
+  for(eventCounter = 1; eventCounter <= options.events; ++eventCounter)
+  {
+    genStopWatch.Start(kFALSE);
+    eventStopWatch.Start();
+    GenerateEvent(random, factory, allParticleOutputArray, stableParticleOutputArray, partonOutputArray);
+    genStopWatch.Stop();
+
+    procStopWatch.Start(kFALSE);
+    modularDelphes->ProcessTask();
+    procStopWatch.Stop();
+    eventStopWatch.Stop();
+
+    element = static_cast<HepMCEvent *>(branchEvent->NewEntry());
+    element->Number = eventCounter;
+    element->Weight = 1.0;
+    element->ProcTime = eventStopWatch.RealTime();
+
+    if(modularDelphes->IsEventWritable()) treeWriter->Fill();
+
+    treeWriter->Clear();
+    modularDelphes->Clear();
+  }
+
+  modularDelphes->FinishTask();
+  treeWriter->Write();
+
+  ofstream report(reportFileName.c_str());
+  report << setprecision(9);
+  report << "events " << options.events << endl;
+  report << "generation_time " << genStopWatch.RealTime() << endl;
+  report << "processing_time " << procStopWatch.RealTime() << endl;
+  report << "events_per_second " << (procStopWatch.RealTime() > 0.0 ? options.events / procStopWatch.RealTime() : 0.0) << endl;
+  for(i = 0; i < modularDelphes->GetNumberOfModules(); ++i)
+  {
+    report << "module." << modularDelphes->GetModuleName(i) << " " << modularDelphes->GetModuleTime(i) << endl;
+  }
+
+  delete modularDelphes;
+  delete confReader;
+  delete treeWriter;
+  delete outputFile;
+}
+
+//---------------------------------------------------------------------------
+
+static void ReadMetrics(const string &fileName, map<string, TMetrics> &metrics, const string &label = "")
+{
+  string line, card, key;
+  Double_t value;
+  ifstream input(fileName.c_str());
+
+  while(getline(input, line))
+  {
+    istringstream fields(line);
+    if(label.empty())
+    {
+      if(!(fields >> card >> key >> value)) continue;
+    }
+    else
+    {
+      card = label;
+      if(!(fields >> key >> value)) continue;
+    }
+    metrics[card][key] = value;
+  }
+}
+
+//---------------------------------------------------------------------------
+
+// runs the card in a child process of this program to measure its peak memory
+
+static Bool_t SpawnCard(const char *program, const TOptions &options, const string &card,
+  const string &pileUpFile, map<string, TMetrics> &results)
+{
+  string label = CardLabel(card);
+  string outputFileName = options.workDir + "/" + label + ".root";
+  string reportFileName = options.workDir + "/" + label + ".txt";
+  stringstream events, seed;
+  string eventsArg, seedArg;
+  struct rusage usage;
+  struct stat status;
+  int exitStatus;
+  pid_t pid;
+
+  events << options.events;
+  seed << options.seed;
+  eventsArg = events.str();
+  seedArg = seed.str();
+
+  unlink(reportFileName.c_str());
+
+  pid = fork();
+  if(pid < 0) throw runtime_error("can't start a new process");
+
+  if(pid == 0)
+  {
+    const char *argv[] = {program, "--run", card.c_str(), outputFileName.c_str(), reportFileName.c_str(),
+      "--events", eventsArg.c_str(), "--seed", seedArg.c_str(),
+      "--pileup-file", pileUpFile.c_str(), "--work-dir", options.workDir.c_str(), 0};
+    execvp(program, const_cast<char *const *>(argv));
+    _exit(127);
+  }
+
+  if(wait4(pid, &exitStatus, 0, &usage) < 0 || !WIFEXITED(exitStatus) || WEXITSTATUS(exitStatus) != 0)
+  {
+    return kFALSE;
+  }
+
+  ReadMetrics(reportFileName, results, label);
+
+#ifdef __APPLE__
+  results[label]["peak_rss_kb"] = usage.ru_maxrss / 1024;
+#else
+  results[label]["peak_rss_kb"] = usage.ru_maxrss;
+#endif
+
+  if(stat(outputFileName.c_str(), &status) == 0)
+  {
+    results[label]["output_bytes"] = status.st_size;
+  }
+
+  return kTRUE;
+}
+
+//---------------------------------------------------------------------------
+
+// returns the number of regressions beyond the tolerances
+
+static Int_t Compare(const TOptions &options, map<string, TMetrics> &results, map<string, TMetrics> &baseline)
+{
+  map<string, TMetrics>::iterator itCard;
+  TMetrics::iterator itMetric;
+  Double_t value, reference, change;
+  Int_t failures = 0;
+  Bool_t failed, warned;
+  string key;
+
+  cout << "** Comparison with baseline " << options.baseline << endl;
+  for(itCard = results.begin(); itCard != results.end(); ++itCard)
+  {
+    if(baseline.find(itCard->first) == baseline.end())
+    {
+      cout << "** " << itCard->first << ": no baseline" << endl;
+      continue;
+    }
+
+    TMetrics &referenceMetrics = baseline[itCard->first];
+    for(itMetric = itCard->second.begin(); itMetric != itCard->second.end(); ++itMetric)
+    {
+      key = itMetric->first;
+      if(referenceMetrics.find(key) == referenceMetrics.end()) continue;
+
+      value = itMetric->second;
+      reference = referenceMetrics[key];
+      if(reference <= 0.0) continue;
+      change = value / reference - 1.0;
+
+      failed = kFALSE;
+      warned = kFALSE;
+      if(key == "events_per_second")
+      {
+        failed = change < -options.tolerance;
+      }
+      else if(key == "peak_rss_kb" || key == "output_bytes")
+      {
+        failed = change > options.memoryTolerance;
+      }
+      else if(key.compare(0, 7, "module.") == 0)
+      {
+        // small modules are too noisy to fail the benchmark
+        warned = change > options.tolerance && value - reference > 0.05;
+      }
+      else
+      {
+        continue;
+      }
+
+      if(!failed && !warned) continue;
+
+      cout << (failed ? "** FAILED: " : "** WARNING: ") << left << setw(40) << itCard->first;
+      cout << setw(40) << key << right << fixed << setprecision(3);
+      cout << setw(14) << reference << " -> " << setw(14) << value;
+      cout << setprecision(1) << setw(8) << 100.0 * change << " %" << endl;
+      cout.unsetf(ios::floatfield);
+      cout << left;
+
+      if(failed) ++failures;
+    }
+  }
+
+  return failures;
+}
+
+//---------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+  char appName[] = "DelphesBenchmark";
+  stringstream message;
+  TOptions options;
+  string run, runOutput, runReport, pileUpFile, arg;
+  map<string, TMetrics> results, baseline;
+  map<string, TMetrics>::iterator itCard;
+  TMetrics::iterator itMetric;
+  vector<string>::iterator itCards;
+  Int_t i, failures = 0;
+
+  options.events = 200;
+  options.seed = 12345;
+  options.pileUpEvents = 1000;
+  options.tolerance = 0.25;
+  options.memoryTolerance = 0.10;
+  options.workDir = "benchmark";
+
+  for(i = 1; i < argc; ++i)
+  {
+    arg = argv[i];
+    if(arg == "--help" || arg == "-h")
+    {
+      cout << " Usage: " << appName << " [options] [config_file(s)]" << endl;
+      cout << " config_file(s) - configuration files in Tcl format, by default the reference cards:" << endl;
+      for(Int_t j = 0; kReferenceCards[j]; ++j) cout << "   " << kReferenceCards[j] << endl;
+      cout << " --events N - number of synthetic events per card (default 200)," << endl;
+      cout << " --seed S - random seed of the events and of the modules (default 12345)," << endl;
+      cout << " --pileup-events N - number of events in the synthetic pile-up file (default 1000)," << endl;
+      cout << " --work-dir dir - directory for the generated files (default benchmark)," << endl;
+      cout << " --baseline file - compare the results with this baseline," << endl;
+      cout << " --write-baseline file - store the results as a new baseline," << endl;
+      cout << " --tolerance x - allowed relative loss of event rate (default 0.25)," << endl;
+      cout << " --memory-tolerance x - allowed relative increase of memory and output size (default 0.10)." << endl;
+      cout << " Run from the top directory of Delphes, so that the cards find their include files." << endl;
+      return 0;
+    }
+    else if(arg == "--run" && i + 3 < argc)
+    {
+      run = argv[++i];
+      runOutput = argv[++i];
+      runReport = argv[++i];
+    }
+    else if(arg == "--events" && i + 1 < argc)
+      options.events = atoi(argv[++i]);
+    else if(arg == "--seed" && i + 1 < argc)
+      options.seed = atoi(argv[++i]);
+    else if(arg == "--pileup-events" && i + 1 < argc)
+      options.pileUpEvents = atoi(argv[++i]);
+    else if(arg == "--pileup-file" && i + 1 < argc)
+      pileUpFile = argv[++i];
+    else if(arg == "--work-dir" && i + 1 < argc)
+      options.workDir = argv[++i];
+    else if(arg == "--baseline" && i + 1 < argc)
+      options.baseline = argv[++i];
+    else if(arg == "--write-baseline" && i + 1 < argc)
+      options.newBaseline = argv[++i];
+    else if(arg == "--tolerance" && i + 1 < argc)
+      options.tolerance = atof(argv[++i]);
+    else if(arg == "--memory-tolerance" && i + 1 < argc)
+      options.memoryTolerance = atof(argv[++i]);
+    else if(arg.compare(0, 2, "--") == 0)
+    {
+      cerr << "** ERROR: unknown or incomplete option " << arg << endl;
+      return 1;
+    }
+    else
+      options.cards.push_back(arg);
+  }
+
+  if(options.cards.empty())
+  {
+    for(i = 0; kReferenceCards[i]; ++i) options.cards.push_back(kReferenceCards[i]);
+  }
+
+  gROOT->SetBatch();
+
+  int appargc = 1;
+  char *appargv[] = {appName};
+  TApplication app(appName, &appargc, appargv);
+
+  try
+  {
+    if(options.events <= 0)
+    {
+      throw runtime_error("number of events must be positive");
+    }
+
+    if(!run.empty())
+    {
+      RunCard(options, run, pileUpFile, runOutput, runReport);
+      return 0;
+    }
+
+    mkdir(options.workDir.c_str(), 0755);
+
+    stringstream name;
+    name << options.workDir << "/MinBias_" << options.seed << "_" << options.pileUpEvents << ".pileup";
+    pileUpFile = name.str();
+    if(access(pileUpFile.c_str(), R_OK) != 0)
+    {
+      cout << "** Generating " << options.pileUpEvents << " pile-up events in " << pileUpFile << endl;
+      GeneratePileUp(pileUpFile, options.pileUpEvents, options.seed);
+    }
+
+    for(itCards = options.cards.begin(); itCards != options.cards.end(); ++itCards)
+    {
+      cout << "** Running " << options.events << " events with " << *itCards << endl;
+      if(!SpawnCard(argv[0], options, *itCards, pileUpFile, results))
+      {
+        cerr << "** ERROR: processing failed for " << *itCards << endl;
+        ++failures;
+      }
+    }
+
+    cout << "** Results" << endl;
+    cout << left << setw(40) << "** card" << right << setw(14) << "events/s" << setw(14) << "RSS [MB]" << setw(14) << "output [MB]" << endl;
+    for(itCard = results.begin(); itCard != results.end(); ++itCard)
+    {
+      TMetrics &metrics = itCard->second;
+      cout << left << "** " << setw(37) << itCard->first << right << fixed << setprecision(2);
+      cout << setw(14) << metrics["events_per_second"];
+      cout << setw(14) << metrics["peak_rss_kb"] / 1024.0;
+      cout << setw(14) << metrics["output_bytes"] / 1048576.0 << endl;
+      for(itMetric = metrics.begin(); itMetric != metrics.end(); ++itMetric)
+      {
+        if(itMetric->first.compare(0, 7, "module.") != 0) continue;
+        cout << left << "**   " << setw(35) << itMetric->first.substr(7) << right;
+        cout << setw(14) << setprecision(3) << itMetric->second << " s" << endl;
+      }
+      cout.unsetf(ios::floatfield);
+    }
+
+    if(!options.newBaseline.empty())
+    {
+      ofstream output(options.newBaseline.c_str());
+      output << setprecision(9);
+      for(itCard = results.begin(); itCard != results.end(); ++itCard)
+      {
+        for(itMetric = itCard->second.begin(); itMetric != itCard->second.end(); ++itMetric)
+        {
+          output << itCard->first << " " << itMetric->first << " " << itMetric->second << endl;
+        }
+      }
+      cout << "** Baseline written to " << options.newBaseline << endl;
+    }
+
+    if(!options.baseline.empty())
+    {
+      if(access(options.baseline.c_str(), R_OK) != 0)
+      {
+        message << "can't open baseline file " << options.baseline;
+        throw runtime_error(message.str());
+      }
+      ReadMetrics(options.baseline, baseline);
+      failures += Compare(options, results, baseline);
+    }
+
+    cout << "** Exiting..." << endl;
+
+    return failures > 0 ? 1 : 0;
+  }
+  catch(runtime_error &e)
+  {
+    cerr << "** ERROR: " << e.what() << endl;
+    return 1;
+  }
+}
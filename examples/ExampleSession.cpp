@@ -0,0 +1,114 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+Runs Delphes in-process on back-to-back pion pairs and reads back the jets,
+without writing any file:
+
+ExampleSession cards/delphes_card_CMS.tcl UniqueObjectFinder/jets 1000
+*/
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include "TApplication.h"
+#include "TMath.h"
+#include "TROOT.h"
+#include "TRandom3.h"
+#include "TVector2.h"
+
+#include "modules/DelphesSession.h"
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+  char appName[] = "ExampleSession";
+  vector<DelphesSession::TInputParticle> particles(2);
+  vector<DelphesSession::TOutputObject> jets;
+  Long64_t event, numberOfEvents, numberOfJets = 0;
+  Double_t pt, eta, phi, mass = 0.13957;
+  TRandom3 random(1);
+  Int_t i;
+
+  if(argc != 4)
+  {
+    cout << " Usage: " << appName << " config_file array_name number_of_events" << endl;
+    cout << " config_file - configuration file in Tcl format," << endl;
+    cout << " array_name - array read back after each event, e.g. UniqueObjectFinder/jets," << endl;
+    cout << " number_of_events - number of events to simulate." << endl;
+    return 1;
+  }
+
+  gROOT->SetBatch();
+
+  int appargc = 1;
+  char *appargv[] = {appName};
+  TApplication app(appName, &appargc, appargv);
+
+  try
+  {
+    DelphesSession session(argv[1]);
+
+    numberOfEvents = atol(argv[3]);
+
+    for(event = 0; event < numberOfEvents; ++event)
+    {
+      pt = random.Uniform(20.0, 200.0);
+      eta = random.Uniform(-2.5, 2.5);
+      phi = random.Uniform(-TMath::Pi(), TMath::Pi());
+
+      for(i = 0; i < 2; ++i)
+      {
+        DelphesSession::TInputParticle &particle = particles[i];
+        particle.PID = (i == 0) ? 211 : -211;
+        particle.Status = 1;
+        particle.M1 = particle.M2 = particle.D1 = particle.D2 = -1;
+        particle.Px = pt * TMath::Cos(phi);
+        particle.Py = pt * TMath::Sin(phi);
+        particle.Pz = pt * TMath::SinH(eta);
+        particle.Mass = mass;
+        particle.E = TMath::Sqrt(pt * pt * TMath::CosH(eta) * TMath::CosH(eta) + mass * mass);
+        particle.X = particle.Y = particle.Z = particle.T = 0.0;
+
+        // second pion back-to-back with the first one
+        eta = -eta;
+        phi = TVector2::Phi_mpi_pi(phi + TMath::Pi());
+      }
+
+      session.AddParticles(&particles[0], particles.size());
+      if(!session.ProcessEvent()) continue;
+
+      numberOfJets += session.GetObjects(argv[2], jets);
+    }
+
+    cout << "** " << session.GetNumberOfEvents() << " events processed, ";
+    cout << numberOfJets << " objects in " << argv[2] << endl;
+  }
+  catch(runtime_error &e)
+  {
+    cerr << "** ERROR: " << e.what() << endl;
+    return 1;
+  }
+
+  return 0;
+}
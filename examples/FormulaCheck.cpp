@@ -0,0 +1,300 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+Evaluates every formula of the configuration files with DelphesFormula and
+with TFormula on a grid of points, and reports the formulas that differ:
+
+FormulaCheck
+FormulaCheck cards/delphes_card_CMS.tcl cards/FCC
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <ctype.h>
+
+#include "TApplication.h"
+#include "TFormula.h"
+#include "TROOT.h"
+#include "TString.h"
+#include "TSystem.h"
+
+#include "classes/DelphesClasses.h"
+#include "classes/DelphesFormula.h"
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+void FindCards(const TString &path, vector<TString> &cards)
+{
+  FileStat_t stat;
+  void *directory;
+  const char *entry;
+  TString name;
+
+  if(gSystem->GetPathInfo(path, stat) != 0) return;
+
+  if(!R_ISDIR(stat.fMode))
+  {
+    if(path.EndsWith(".tcl")) cards.push_back(path);
+    return;
+  }
+
+  directory = gSystem->OpenDirectory(path);
+  if(!directory) return;
+
+  while((entry = gSystem->GetDirEntry(directory)))
+  {
+    name = entry;
+    if(name == "." || name == "..") continue;
+    FindCards(path + "/" + name, cards);
+  }
+
+  gSystem->FreeDirectory(directory);
+}
+
+//------------------------------------------------------------------------------
+
+// the formula is the last word of a set or add command whose parameter
+// name ends with Formula, words in braces can span several lines,
+// the modules that do not use DelphesFormula are skipped
+
+void FindFormulas(const string &text, vector<string> &formulas)
+{
+  static const char *skipped[] = {"CscClusterEfficiency", "CscClusterId", "PileUpMerger", "PileUpMergerPythia8"};
+  size_t i = 0, begin, size = text.size();
+  string command, name, formula, module;
+  Int_t depth;
+
+  while(i < size)
+  {
+    while(i < size && (text[i] == ' ' || text[i] == '\t')) ++i;
+    begin = i;
+    while(i < size && !isspace(text[i])) ++i;
+    command = text.substr(begin, i - begin);
+
+    while(i < size && (text[i] == ' ' || text[i] == '\t')) ++i;
+    begin = i;
+    while(i < size && !isspace(text[i])) ++i;
+    name = text.substr(begin, i - begin);
+
+    if(command == "module") module = name;
+    if(find(skipped, skipped + 4, module) != skipped + 4) command.clear();
+
+    if((command == "set" || command == "add") && name.size() > 7 && name.compare(name.size() - 7, 7, "Formula") == 0)
+    {
+      formula.clear();
+      while(true)
+      {
+        while(i < size && (text[i] == ' ' || text[i] == '\t' || text[i] == '\r' || (text[i] == '\\' && i + 1 < size && text[i + 1] == '\n')))
+        {
+          i += text[i] == '\\' ? 2 : 1;
+        }
+        if(i >= size || text[i] == '\n' || text[i] == '#' || text[i] == '}') break;
+
+        begin = i;
+        if(text[i] == '{')
+        {
+          depth = 0;
+          do
+          {
+            if(text[i] == '{') ++depth;
+            if(text[i] == '}') --depth;
+            ++i;
+          } while(i < size && depth > 0);
+          formula = text.substr(begin + 1, i - begin - 2);
+        }
+        else
+        {
+          while(i < size && !isspace(text[i])) ++i;
+          formula = text.substr(begin, i - begin);
+        }
+      }
+      if(!formula.empty()) formulas.push_back(formula);
+    }
+
+    while(i < size && text[i] != '\n') ++i;
+    ++i;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+// same variables and parameters as in DelphesFormula::Compile
+
+TString GetReferenceExpression(const string &formula)
+{
+  TString buffer;
+  size_t i;
+
+  for(i = 0; i < formula.size(); ++i)
+  {
+    if(isspace(formula[i]) || formula[i] == '\\') continue;
+    buffer.Append(formula[i]);
+  }
+
+  buffer.ReplaceAll("pt", "x");
+  buffer.ReplaceAll("eta", "y");
+  buffer.ReplaceAll("phi", "z");
+  buffer.ReplaceAll("energy", "t");
+  buffer.ReplaceAll("d0", "[0]");
+  buffer.ReplaceAll("dz", "[1]");
+  buffer.ReplaceAll("ctgTheta", "[2]");
+  buffer.ReplaceAll("radius", "[3]");
+  buffer.ReplaceAll("density", "[4]");
+
+  return buffer;
+}
+
+//------------------------------------------------------------------------------
+
+Bool_t IsSame(Double_t a, Double_t b)
+{
+  if(a != a || b != b) return a != a && b != b;
+  if(a == b) return true;
+  return fabs(a - b) <= 1.0e-12 * max(fabs(a), fabs(b));
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+  char appName[] = "FormulaCheck";
+  static const Double_t ptValues[] = {0.0, 0.1, 0.5, 1.0, 2.5, 10.0, 50.0, 200.0, 1000.0, 1.0e4};
+  static const Double_t etaValues[] = {-6.0, -4.0, -3.0, -2.5, -1.5, -1.0, -0.5, 0.0, 0.3, 1.0, 1.3, 2.0, 2.5, 3.5, 5.0};
+  static const Double_t parameterValues[] = {0.0, 0.01, 1.0};
+  vector<TString> cards;
+  vector<string> formulas;
+  Candidate candidate;
+  Double_t pt, eta, phi, energy, value, reference, x[4], parameters[5];
+  Int_t i, j, k, checked = 0, failed = 0;
+  size_t card, formula;
+  Bool_t same;
+
+  if(argc == 2 && (string(argv[1]) == "-h" || string(argv[1]) == "--help"))
+  {
+    cout << " Usage: " << appName << " [card_or_directory ...]" << endl;
+    cout << " card_or_directory - configuration files in Tcl format, or directories" << endl;
+    cout << " searched for them (cards by default)." << endl;
+    return 1;
+  }
+
+  gROOT->SetBatch();
+
+  int appargc = 1;
+  char *appargv[] = {appName};
+  TApplication app(appName, &appargc, appargv);
+
+  if(argc < 2)
+  {
+    FindCards("cards", cards);
+  }
+  else
+  {
+    for(i = 1; i < argc; ++i) FindCards(argv[i], cards);
+  }
+
+  for(card = 0; card < cards.size(); ++card)
+  {
+    ifstream file(cards[card].Data());
+    stringstream text;
+    text << file.rdbuf();
+
+    formulas.clear();
+    FindFormulas(text.str(), formulas);
+
+    for(formula = 0; formula < formulas.size(); ++formula)
+    {
+      DelphesFormula delphesFormula;
+      TFormula referenceFormula;
+
+      try
+      {
+        delphesFormula.Compile(formulas[formula].c_str());
+      }
+      catch(runtime_error &e)
+      {
+        cout << "** ERROR: " << cards[card] << ": cannot compile " << formulas[formula] << endl;
+        ++failed;
+        continue;
+      }
+
+      if(referenceFormula.Compile(GetReferenceExpression(formulas[formula])) != 0)
+      {
+        cout << "** ERROR: " << cards[card] << ": TFormula cannot compile " << formulas[formula] << endl;
+        ++failed;
+        continue;
+      }
+
+      same = true;
+      for(i = 0; same && i < Int_t(sizeof(ptValues) / sizeof(ptValues[0])); ++i)
+      {
+        for(j = 0; same && j < Int_t(sizeof(etaValues) / sizeof(etaValues[0])); ++j)
+        {
+          k = (i + j) % 3;
+          pt = ptValues[i];
+          eta = etaValues[j];
+          phi = 0.5 * (k - 1);
+          energy = pt * cosh(eta);
+
+          candidate.D0 = parameterValues[k];
+          candidate.DZ = parameterValues[(k + 1) % 3];
+          candidate.CtgTheta = sinh(eta);
+          candidate.Position.SetXYZT(1.0e3 * parameterValues[(k + 2) % 3], 0.0, 0.0, 0.0);
+          candidate.ParticleDensity = 10.0 * parameterValues[k];
+
+          x[0] = pt;
+          x[1] = eta;
+          x[2] = phi;
+          x[3] = energy;
+          parameters[0] = candidate.D0;
+          parameters[1] = candidate.DZ;
+          parameters[2] = candidate.CtgTheta;
+          parameters[3] = candidate.Position.Pt();
+          parameters[4] = candidate.ParticleDensity;
+
+          value = delphesFormula.Eval(pt, eta, phi, energy, &candidate);
+          reference = referenceFormula.EvalPar(x, parameters);
+
+          same = IsSame(value, reference);
+          if(!same)
+          {
+            cout << "** ERROR: " << cards[card] << ": " << formulas[formula] << endl;
+            cout << "   pt = " << pt << ", eta = " << eta << ", phi = " << phi << ", energy = " << energy;
+            cout << ": " << value << " instead of " << reference << endl;
+            ++failed;
+          }
+        }
+      }
+      ++checked;
+    }
+  }
+
+  cout << "** " << checked << " formulas from " << cards.size() << " cards checked, ";
+  cout << failed << " differences" << endl;
+
+  return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,352 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+Runs two cards sharing their first module on the same synthetic events, once
+separately and once as two chains of a single pass as in DelphesHepMC2, and
+checks that each chain gives the same objects as the corresponding single-card
+run. Only the first card isolates the electrons that both cards dress, and
+computes the particle density of the propagated particles, in place, so the
+second chain must not see the isolation nor the density of the first one:
+
+SharedChainCheck
+SharedChainCheck number_of_events
+*/
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "TApplication.h"
+#include "TDatabasePDG.h"
+#include "TLorentzVector.h"
+#include "TMath.h"
+#include "TObjArray.h"
+#include "TParticlePDG.h"
+#include "TROOT.h"
+#include "TRandom3.h"
+#include "TString.h"
+#include "TSystem.h"
+
+#include "classes/DelphesClasses.h"
+#include "classes/DelphesFactory.h"
+#include "modules/Delphes.h"
+
+#include "ExRootAnalysis/ExRootConfReader.h"
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+static const char *kPropagator =
+  "module ParticlePropagator ParticlePropagator {\n"
+  "  set InputArray Delphes/stableParticles\n"
+  "  set OutputArray stableParticles\n"
+  "  set ChargedHadronOutputArray chargedHadrons\n"
+  "  set ElectronOutputArray electrons\n"
+  "  set MuonOutputArray muons\n"
+  "  set Radius 1.29\n"
+  "  set HalfLength 3.00\n"
+  "  set Bz 3.8\n"
+  "}\n";
+
+static const char *kCards[2] = {
+  "set ExecutionPath {ParticlePropagator ElectronIsolation ParticleDensity ElectronDressing}\n"
+  "module Isolation ElectronIsolation {\n"
+  "  set CandidateInputArray ParticlePropagator/electrons\n"
+  "  set IsolationInputArray ParticlePropagator/stableParticles\n"
+  "  set OutputArray electrons\n"
+  "  set DeltaRMax 0.3\n"
+  "  set PTMin 0.5\n"
+  "  set PTRatioMax 0.12\n"
+  "}\n"
+  "module ParticleDensity ParticleDensity {\n"
+  "  set InputArray ParticlePropagator/stableParticles\n"
+  "  set OutputArray particles\n"
+  "  set EtaBins {-2.5 -1.5 -0.5 0.5 1.5 2.5}\n"
+  "  set PhiBins {-3.1416 -1.5708 0.0 1.5708 3.1416}\n"
+  "  set UseMomentumVector true\n"
+  "}\n"
+  "module LeptonDressing ElectronDressing {\n"
+  "  set DressingInputArray ParticlePropagator/stableParticles\n"
+  "  set CandidateInputArray ParticlePropagator/electrons\n"
+  "  set OutputArray electrons\n"
+  "  set DeltaRMax 0.1\n"
+  "}\n",
+
+  "set ExecutionPath {ParticlePropagator ElectronDressing}\n"
+  "module LeptonDressing ElectronDressing {\n"
+  "  set DressingInputArray ParticlePropagator/stableParticles\n"
+  "  set CandidateInputArray ParticlePropagator/electrons\n"
+  "  set OutputArray electrons\n"
+  "  set DeltaRMax 0.2\n"
+  "}\n"};
+
+static const char *kArrays[2][2] = {
+  {"ElectronIsolation/electrons", "ElectronDressing/electrons"},
+  {"ElectronDressing/electrons", 0}};
+
+//------------------------------------------------------------------------------
+
+struct TChainInput
+{
+  ExRootConfReader *confReader;
+  Delphes *modularDelphes;
+  TObjArray *allParticleOutputArray;
+  TObjArray *stableParticleOutputArray;
+};
+
+//------------------------------------------------------------------------------
+
+// the chain reads the input arrays of the source chain and runs its
+// shared modules, otherwise it exports the input arrays
+
+Int_t NewChain(const TString &cardFile, TChainInput &input, Delphes *source)
+{
+  Int_t sharedModules = 0;
+
+  input.confReader = new ExRootConfReader;
+  input.confReader->ReadFile(cardFile);
+
+  input.modularDelphes = new Delphes("Delphes");
+  input.modularDelphes->SetConfReader(input.confReader);
+
+  input.allParticleOutputArray = 0;
+  input.stableParticleOutputArray = 0;
+
+  if(source)
+  {
+    sharedModules = input.modularDelphes->GetNumberOfSharedModules(source);
+    input.modularDelphes->SetSource(source);
+  }
+  else
+  {
+    input.allParticleOutputArray = input.modularDelphes->ExportArray("allParticles");
+    input.stableParticleOutputArray = input.modularDelphes->ExportArray("stableParticles");
+    input.modularDelphes->ExportArray("partons");
+  }
+
+  input.modularDelphes->InitTask();
+
+  return sharedModules;
+}
+
+//------------------------------------------------------------------------------
+
+void DeleteChain(TChainInput &input)
+{
+  input.modularDelphes->FinishTask();
+  delete input.modularDelphes;
+  delete input.confReader;
+}
+
+//------------------------------------------------------------------------------
+
+// electrons and positrons with a few photons around them, and charged pions
+
+void FillEvent(Long64_t event, TChainInput &input)
+{
+  static const Int_t pdgCodes[4] = {11, -11, 211, -211};
+  DelphesFactory *factory = input.modularDelphes->GetFactory();
+  TDatabasePDG *pdg = TDatabasePDG::Instance();
+  TRandom3 random(event + 1);
+  TParticlePDG *pdgParticle;
+  Candidate *candidate;
+  Double_t pt, eta, phi, mass;
+  Int_t i, j, pdgCode;
+
+  for(i = 0; i < 12; ++i)
+  {
+    pdgCode = pdgCodes[i < 2 ? i : 2 + i % 2];
+    pt = i < 2 ? random.Uniform(20.0, 100.0) : random.Uniform(1.0, 20.0);
+    eta = random.Uniform(-2.0, 2.0);
+    phi = random.Uniform(-TMath::Pi(), TMath::Pi());
+
+    for(j = 0; j < (i < 2 ? 3 : 1); ++j)
+    {
+      if(j > 0)
+      {
+        pdgCode = 22;
+        pt = random.Uniform(1.0, 10.0);
+        eta += random.Gaus(0.0, 0.1);
+        phi += random.Gaus(0.0, 0.1);
+      }
+
+      pdgParticle = pdg->GetParticle(pdgCode);
+      mass = pdgParticle->Mass();
+
+      candidate = factory->NewCandidate();
+      candidate->PID = pdgCode;
+      candidate->Status = 1;
+      candidate->Charge = Int_t(pdgParticle->Charge() / 3.0);
+      candidate->Mass = mass;
+      candidate->Momentum.SetPtEtaPhiM(pt, eta, phi, mass);
+      candidate->Position.SetXYZT(0.0, 0.0, 0.0, 0.0);
+
+      input.allParticleOutputArray->Add(candidate);
+      input.stableParticleOutputArray->Add(candidate);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void Record(Delphes *modularDelphes, Int_t card, vector<Double_t> &values)
+{
+  const TObjArray *array;
+  const Candidate *candidate;
+  Int_t i, j;
+
+  for(i = 0; i < 2 && kArrays[card][i]; ++i)
+  {
+    array = modularDelphes->ImportArray(kArrays[card][i]);
+    values.push_back(array->GetEntriesFast());
+    for(j = 0; j < array->GetEntriesFast(); ++j)
+    {
+      candidate = static_cast<const Candidate *>(array->UncheckedAt(j));
+      values.push_back(candidate->PID);
+      values.push_back(candidate->Charge);
+      values.push_back(candidate->Momentum.Px());
+      values.push_back(candidate->Momentum.Py());
+      values.push_back(candidate->Momentum.Pz());
+      values.push_back(candidate->Momentum.E());
+      values.push_back(candidate->IsolationVar);
+      values.push_back(candidate->SumPt);
+      values.push_back(candidate->ParticleDensity);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+  char appName[] = "SharedChainCheck";
+  TString cardFiles[2];
+  TChainInput inputs[2];
+  vector<Double_t> single[2], shared[2];
+  Long64_t event, numberOfEvents = 1000;
+  Int_t card, sharedModules, failed = 0;
+  size_t i;
+
+  if(argc > 2)
+  {
+    cout << " Usage: " << appName << " [number_of_events]" << endl;
+    cout << " number_of_events - number of events to simulate (1000 by default)." << endl;
+    return 1;
+  }
+
+  if(argc == 2) numberOfEvents = atol(argv[1]);
+
+  gROOT->SetBatch();
+
+  int appargc = 1;
+  char *appargv[] = {appName};
+  TApplication app(appName, &appargc, appargv);
+
+  try
+  {
+    for(card = 0; card < 2; ++card)
+    {
+      cardFiles[card].Form("%s/%s_%d_%d.tcl", gSystem->TempDirectory(), appName, gSystem->GetPid(), card);
+      ofstream file(cardFiles[card].Data());
+      file << kPropagator << kCards[card];
+    }
+
+    // each card on its own
+
+    for(card = 0; card < 2; ++card)
+    {
+      NewChain(cardFiles[card], inputs[card], 0);
+      for(event = 0; event < numberOfEvents; ++event)
+      {
+        inputs[card].modularDelphes->Clear();
+        FillEvent(event, inputs[card]);
+        inputs[card].modularDelphes->ProcessTask();
+        Record(inputs[card].modularDelphes, card, single[card]);
+      }
+      DeleteChain(inputs[card]);
+    }
+
+    // both cards in a single pass, each chain is processed and read back
+    // before the next one as the tree writers are filled in DelphesHepMC2
+
+    NewChain(cardFiles[0], inputs[0], 0);
+    sharedModules = NewChain(cardFiles[1], inputs[1], inputs[0].modularDelphes);
+
+    if(sharedModules != 1)
+    {
+      cout << "** ERROR: " << sharedModules << " shared modules instead of 1" << endl;
+      ++failed;
+    }
+
+    for(event = 0; event < numberOfEvents; ++event)
+    {
+      for(card = 0; card < 2; ++card)
+      {
+        inputs[card].modularDelphes->Clear();
+      }
+
+      FillEvent(event, inputs[0]);
+
+      for(card = 0; card < 2; ++card)
+      {
+        inputs[card].modularDelphes->ProcessTask();
+        Record(inputs[card].modularDelphes, card, shared[card]);
+      }
+    }
+
+    for(card = 1; card >= 0; --card)
+    {
+      DeleteChain(inputs[card]);
+    }
+
+    for(card = 0; card < 2; ++card)
+    {
+      gSystem->Unlink(cardFiles[card]);
+
+      if(single[card].size() != shared[card].size())
+      {
+        cout << "** ERROR: card " << card << ": " << shared[card].size() << " values instead of " << single[card].size() << endl;
+        ++failed;
+        continue;
+      }
+
+      for(i = 0; i < single[card].size(); ++i)
+      {
+        if(single[card][i] == shared[card][i]) continue;
+        cout << "** ERROR: card " << card << ": value " << i << " is " << shared[card][i] << " instead of " << single[card][i] << endl;
+        ++failed;
+        break;
+      }
+    }
+
+    cout << "** " << numberOfEvents << " events processed, ";
+    cout << failed << " differences between the single-card and shared runs" << endl;
+
+    return failed > 0 ? 1 : 0;
+  }
+  catch(runtime_error &e)
+  {
+    cerr << "** ERROR: " << e.what() << endl;
+    return 1;
+  }
+}
@@ -0,0 +1,363 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+Runs FastJetFinder with jet substructure on synthetic events with one and
+with several threads, and checks that both give the same jets, and that
+they agree with trimming, pruning, SoftDrop and N-subjettiness applied
+directly to the clustered jets with FastJet, for E-scheme and WTA jets:
+
+SubstructureCheck
+SubstructureCheck number_of_events number_of_threads
+*/
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "TApplication.h"
+#include "TLorentzVector.h"
+#include "TMath.h"
+#include "TObjArray.h"
+#include "TROOT.h"
+#include "TRandom3.h"
+#include "TString.h"
+#include "TSystem.h"
+
+#include "classes/DelphesClasses.h"
+#include "classes/DelphesFactory.h"
+#include "modules/Delphes.h"
+
+#include "ExRootAnalysis/ExRootConfReader.h"
+
+#include "fastjet/ClusterSequence.hh"
+#include "fastjet/JetDefinition.hh"
+#include "fastjet/PseudoJet.hh"
+#include "fastjet/Selector.hh"
+#include "fastjet/tools/Filter.hh"
+#include "fastjet/tools/Pruner.hh"
+
+#include "fastjet/contribs/Nsubjettiness/ExtraRecombiners.hh"
+#include "fastjet/contribs/Nsubjettiness/Nsubjettiness.hh"
+#include "fastjet/contribs/RecursiveTools/SoftDrop.hh"
+
+using namespace std;
+using namespace fastjet;
+using namespace fastjet::contrib;
+
+//------------------------------------------------------------------------------
+
+static const char *kCard =
+  "set ExecutionPath {FatJetFinder}\n"
+  "module FastJetFinder FatJetFinder {\n"
+  "  set InputArray Delphes/stableParticles\n"
+  "  set NumberOfThreads %d\n"
+  "  set ParameterR 0.8\n"
+  "  set JetPTMin 50.0\n"
+  "  set ComputeNsubjettiness 1\n"
+  "  set Beta 1.0\n"
+  "  set ComputeTrimming 1\n"
+  "  set RTrim 0.2\n"
+  "  set PtFracTrim 0.05\n"
+  "  set ComputePruning 1\n"
+  "  set ZcutPrun 0.1\n"
+  "  set RcutPrun 0.5\n"
+  "  set RPrun 0.8\n"
+  "  set ComputeSoftDrop 1\n"
+  "  set BetaSoftDrop 0.0\n"
+  "  set SymmetryCutSoftDrop 0.1\n"
+  "  add JetDefinitions jets {JetAlgorithm 6 AxisMode 4}\n"
+  "  add JetDefinitions wtaJets {JetAlgorithm 7 AxisMode 1}\n"
+  "}\n";
+
+static const char *kArrays[2] = {"FatJetFinder/jets", "FatJetFinder/wtaJets"};
+
+//------------------------------------------------------------------------------
+
+struct TChainInput
+{
+  ExRootConfReader *confReader;
+  Delphes *modularDelphes;
+  TObjArray *allParticleOutputArray;
+  TObjArray *stableParticleOutputArray;
+};
+
+//------------------------------------------------------------------------------
+
+// a few collimated sprays of particles on top of a soft background
+
+void FillEvent(Long64_t event, TChainInput &input, vector<PseudoJet> &inputList)
+{
+  DelphesFactory *factory = input.modularDelphes->GetFactory();
+  TRandom3 random(event + 1);
+  Candidate *candidate;
+  PseudoJet particle;
+  Double_t pt, eta, phi, axisEta, axisPhi;
+  Int_t i, j;
+
+  inputList.clear();
+
+  for(i = 0; i < 5; ++i)
+  {
+    axisEta = random.Uniform(-2.0, 2.0);
+    axisPhi = random.Uniform(-TMath::Pi(), TMath::Pi());
+
+    for(j = 0; j < 60; ++j)
+    {
+      pt = i < 4 ? random.Exp(8.0) : random.Exp(1.0);
+      eta = i < 4 ? axisEta + random.Gaus(0.0, 0.25) : random.Uniform(-4.0, 4.0);
+      phi = i < 4 ? axisPhi + random.Gaus(0.0, 0.25) : random.Uniform(-TMath::Pi(), TMath::Pi());
+
+      candidate = factory->NewCandidate();
+      candidate->PID = 211;
+      candidate->Status = 1;
+      candidate->Charge = 1;
+      candidate->Momentum.SetPtEtaPhiM(pt + 0.1, eta, phi, 0.0);
+      candidate->Position.SetXYZT(0.0, 0.0, 0.0, 0.0);
+
+      input.allParticleOutputArray->Add(candidate);
+      input.stableParticleOutputArray->Add(candidate);
+
+      // same input as in FastJetFinder
+      particle = PseudoJet(candidate->Momentum.Px(), candidate->Momentum.Py(), candidate->Momentum.Pz(), candidate->Momentum.E());
+      particle.set_user_index(inputList.size());
+      inputList.push_back(particle);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void AddP4(vector<Double_t> &values, const TLorentzVector &p4)
+{
+  values.push_back(p4.Px());
+  values.push_back(p4.Py());
+  values.push_back(p4.Pz());
+  values.push_back(p4.E());
+}
+
+//------------------------------------------------------------------------------
+
+// groomed jet and its four hardest subjets, stored as in FastJetFinder
+
+void AddGroomed(vector<Double_t> &values, const PseudoJet &groomed)
+{
+  vector<PseudoJet> subjets = sorted_by_pt(groomed.pieces());
+  TLorentzVector p4[5];
+  size_t i;
+
+  p4[0].SetPtEtaPhiM(groomed.pt(), groomed.eta(), groomed.phi(), groomed.m());
+  for(i = 0; i < subjets.size() && i < 4; ++i)
+  {
+    p4[i + 1].SetPtEtaPhiM(subjets[i].pt(), subjets[i].eta(), subjets[i].phi(), subjets[i].m());
+  }
+
+  values.push_back(subjets.size());
+  for(i = 0; i < 5; ++i) AddP4(values, p4[i]);
+}
+
+//------------------------------------------------------------------------------
+
+void Record(Delphes *modularDelphes, Int_t definition, vector<Double_t> &values)
+{
+  const TObjArray *array = modularDelphes->ImportArray(kArrays[definition]);
+  const Candidate *candidate;
+  Int_t i, j;
+
+  values.push_back(array->GetEntriesFast());
+  for(i = 0; i < array->GetEntriesFast(); ++i)
+  {
+    candidate = static_cast<const Candidate *>(array->UncheckedAt(i));
+    for(j = 0; j < 5; ++j) values.push_back(candidate->Tau[j]);
+    values.push_back(candidate->NSubJetsTrimmed);
+    for(j = 0; j < 5; ++j) AddP4(values, candidate->TrimmedP4[j]);
+    values.push_back(candidate->NSubJetsPruned);
+    for(j = 0; j < 5; ++j) AddP4(values, candidate->PrunedP4[j]);
+    values.push_back(candidate->NSubJetsSoftDropped);
+    for(j = 0; j < 5; ++j) AddP4(values, candidate->SoftDroppedP4[j]);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+// substructure of the clustered jets computed directly with FastJet
+
+void RecordReference(const vector<PseudoJet> &inputList, Int_t definition, vector<Double_t> &values)
+{
+  WinnerTakeAllRecombiner recombiner;
+  JetDefinition jetDefinition(antikt_algorithm, 0.8);
+  vector<PseudoJet> jets;
+  Int_t j;
+  size_t i;
+
+  if(definition == 1) jetDefinition = JetDefinition(antikt_algorithm, 0.8, &recombiner);
+
+  ClusterSequence sequence(inputList, jetDefinition);
+  jets = sorted_by_pt(sequence.inclusive_jets(50.0));
+
+  Filter trimmer(JetDefinition(kt_algorithm, 0.2), SelectorPtFractionMin(0.05));
+  Pruner pruner(JetDefinition(cambridge_algorithm, 0.8), 0.1, 0.5);
+  SoftDrop softDrop(0.0, 0.1, 0.8);
+
+  values.push_back(jets.size());
+  for(i = 0; i < jets.size(); ++i)
+  {
+    for(j = 0; j < 5; ++j)
+    {
+      if(definition == 1)
+      {
+        values.push_back(Float_t(Nsubjettiness(j + 1, WTA_KT_Axes(), NormalizedMeasure(1.0, 0.8))(jets[i])));
+      }
+      else
+      {
+        values.push_back(Float_t(Nsubjettiness(j + 1, OnePass_KT_Axes(), NormalizedMeasure(1.0, 0.8))(jets[i])));
+      }
+    }
+    AddGroomed(values, trimmer(jets[i]));
+    AddGroomed(values, pruner(jets[i]));
+    AddGroomed(values, softDrop(jets[i]));
+  }
+}
+
+//------------------------------------------------------------------------------
+
+// the trimming reclusters the constituents in a different order,
+// the other values are expected to be identical
+
+Bool_t IsSame(Double_t a, Double_t b)
+{
+  return a == b || fabs(a - b) <= 1.0e-9 * (1.0 + fabs(a) + fabs(b));
+}
+
+//------------------------------------------------------------------------------
+
+Int_t Compare(const char *name, const vector<Double_t> &values, const vector<Double_t> &reference, Bool_t exact)
+{
+  size_t i;
+
+  if(values.size() != reference.size())
+  {
+    cout << "** ERROR: " << name << ": " << values.size() << " values instead of " << reference.size() << endl;
+    return 1;
+  }
+
+  for(i = 0; i < values.size(); ++i)
+  {
+    if(exact ? values[i] == reference[i] : IsSame(values[i], reference[i])) continue;
+    cout << "** ERROR: " << name << ": value " << i << " is " << values[i] << " instead of " << reference[i] << endl;
+    return 1;
+  }
+
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+  char appName[] = "SubstructureCheck";
+  Int_t threads[2] = {1, 4};
+  TString cardFiles[2];
+  TChainInput inputs[2];
+  vector<PseudoJet> inputList;
+  vector<Double_t> values[2][2], reference[2];
+  Long64_t event, numberOfEvents = 200;
+  Int_t run, definition, failed = 0;
+
+  if(argc != 1 && argc != 3)
+  {
+    cout << " Usage: " << appName << " [number_of_events number_of_threads]" << endl;
+    cout << " number_of_events - number of events to simulate (200 by default)," << endl;
+    cout << " number_of_threads - number of threads compared with a single thread (4 by default)." << endl;
+    return 1;
+  }
+
+  if(argc == 3)
+  {
+    numberOfEvents = atol(argv[1]);
+    threads[1] = atoi(argv[2]);
+  }
+
+  gROOT->SetBatch();
+
+  int appargc = 1;
+  char *appargv[] = {appName};
+  TApplication app(appName, &appargc, appargv);
+
+  try
+  {
+    for(run = 0; run < 2; ++run)
+    {
+      cardFiles[run].Form("%s/%s_%d_%d.tcl", gSystem->TempDirectory(), appName, gSystem->GetPid(), run);
+      ofstream file(cardFiles[run].Data());
+      file << Form(kCard, threads[run]);
+      file.close();
+
+      inputs[run].confReader = new ExRootConfReader;
+      inputs[run].confReader->ReadFile(cardFiles[run]);
+
+      inputs[run].modularDelphes = new Delphes("Delphes");
+      inputs[run].modularDelphes->SetConfReader(inputs[run].confReader);
+
+      inputs[run].allParticleOutputArray = inputs[run].modularDelphes->ExportArray("allParticles");
+      inputs[run].stableParticleOutputArray = inputs[run].modularDelphes->ExportArray("stableParticles");
+      inputs[run].modularDelphes->ExportArray("partons");
+
+      inputs[run].modularDelphes->InitTask();
+
+      for(event = 0; event < numberOfEvents; ++event)
+      {
+        inputs[run].modularDelphes->Clear();
+        FillEvent(event, inputs[run], inputList);
+        inputs[run].modularDelphes->ProcessTask();
+
+        for(definition = 0; definition < 2; ++definition)
+        {
+          Record(inputs[run].modularDelphes, definition, values[run][definition]);
+          if(run == 0) RecordReference(inputList, definition, reference[definition]);
+        }
+      }
+
+      inputs[run].modularDelphes->FinishTask();
+      delete inputs[run].modularDelphes;
+      delete inputs[run].confReader;
+
+      gSystem->Unlink(cardFiles[run]);
+    }
+
+    for(definition = 0; definition < 2; ++definition)
+    {
+      failed += Compare(Form("%s, %d threads", kArrays[definition], threads[1]), values[1][definition], values[0][definition], true);
+      failed += Compare(Form("%s, FastJet", kArrays[definition]), values[0][definition], reference[definition], false);
+    }
+
+    cout << "** " << numberOfEvents << " events processed, ";
+    cout << failed << " differences in the jet substructure" << endl;
+
+    return failed > 0 ? 1 : 0;
+  }
+  catch(runtime_error &e)
+  {
+    cerr << "** ERROR: " << e.what() << endl;
+    return 1;
+  }
+}
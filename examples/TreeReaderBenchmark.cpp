@@ -0,0 +1,276 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \class TreeReaderBenchmark
+ *
+ *  Compares the event rate of ExRootTreeReader in different read modes
+ *  (TTreeCache, parallel unzipping, asynchronous prefetching, lazy branch
+ *  loading), on local storage and on slow storage emulated by adding
+ *  a latency to each read request and limiting the bandwidth.
+ *
+ */
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "TApplication.h"
+#include "TROOT.h"
+
+#include "TClonesArray.h"
+#include "TEnv.h"
+#include "TFile.h"
+#include "TStopwatch.h"
+#include "TTree.h"
+
+#include "classes/DelphesClasses.h"
+
+#include "ExRootAnalysis/ExRootTreeReader.h"
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+class ThrottledFile: public TFile
+{
+public:
+  ThrottledFile(const char *fileName, Double_t latency, Double_t bandwidth) :
+    TFile(fileName), fLatency(latency), fBandwidth(bandwidth), fInside(kFALSE) {}
+
+  Bool_t ReadBuffer(char *buf, Int_t len)
+  {
+    Throttle(len);
+    return TFile::ReadBuffer(buf, len);
+  }
+
+  Bool_t ReadBuffer(char *buf, Long64_t pos, Int_t len)
+  {
+    Throttle(len);
+    return TFile::ReadBuffer(buf, pos, len);
+  }
+
+  Bool_t ReadBuffers(char *buf, Long64_t *pos, Int_t *len, Int_t nbuf)
+  {
+    Bool_t result;
+    Int_t i;
+    Long64_t size = 0;
+
+    // one request for the whole list of segments
+    for(i = 0; i < nbuf; ++i) size += len[i];
+    Throttle(size);
+
+    fInside = kTRUE;
+    result = TFile::ReadBuffers(buf, pos, len, nbuf);
+    fInside = kFALSE;
+
+    return result;
+  }
+
+private:
+  void Throttle(Long64_t size)
+  {
+    if(fInside) return;
+    usleep(UInt_t(1.0E6 * (fLatency + size / fBandwidth)));
+  }
+
+  Double_t fLatency; // in s
+  Double_t fBandwidth; // in bytes/s
+  Bool_t fInside;
+};
+
+//------------------------------------------------------------------------------
+
+enum EReadMode
+{
+  kDefault,
+  kNoCache,
+  kCache,
+  kCacheUnzip,
+  kCacheLazy,
+  kCachePrefetch
+};
+
+static const char *kModeNames[] = {"default", "no cache", "cache", "cache + unzip", "cache + lazy", "cache + prefetch"};
+
+//------------------------------------------------------------------------------
+
+void RunBenchmark(TFile *file, EReadMode mode, Long64_t maxEntries)
+{
+  TTree *tree = 0;
+  ExRootTreeReader *treeReader = 0;
+  TClonesArray *branchJet, *branchElectron, *branchMuon, *branchMissingET;
+  Long64_t entry, numberOfEntries, selected = 0;
+  Int_t i, numberOfJets;
+  TStopwatch stopWatch;
+
+  tree = static_cast<TTree *>(file->Get("Delphes"));
+  if(!tree)
+  {
+    throw runtime_error("can't find 'Delphes' tree");
+  }
+
+  treeReader = new ExRootTreeReader(tree);
+
+  branchJet = treeReader->UseBranch("Jet");
+  branchElectron = treeReader->UseBranch("Electron");
+  branchMuon = treeReader->UseBranch("Muon");
+  branchMissingET = treeReader->UseBranch("MissingET");
+
+  switch(mode)
+  {
+  case kNoCache:
+    treeReader->SetCacheSize(0);
+    break;
+  case kCache:
+    treeReader->SetCacheSize(50000000);
+    break;
+  case kCacheUnzip:
+    treeReader->SetCacheSize(50000000);
+    treeReader->SetParallelUnzip(kTRUE);
+    break;
+  case kCacheLazy:
+    treeReader->SetCacheSize(50000000);
+    treeReader->SetLazyLoading(kTRUE);
+    break;
+  case kCachePrefetch:
+    treeReader->SetCacheSize(50000000);
+    treeReader->SetAsyncPrefetch(kTRUE);
+    break;
+  default:
+    break;
+  }
+
+  numberOfEntries = treeReader->GetEntries();
+  if(maxEntries > 0 && maxEntries < numberOfEntries) numberOfEntries = maxEntries;
+
+  stopWatch.Start();
+
+  // a typical selection: leptons and missing ET are needed only for events with two hard jets
+  for(entry = 0; entry < numberOfEntries; ++entry)
+  {
+    treeReader->ReadEntry(entry);
+
+    treeReader->LoadBranch(branchJet);
+
+    numberOfJets = 0;
+    for(i = 0; i < branchJet->GetEntriesFast(); ++i)
+    {
+      if(static_cast<Jet *>(branchJet->At(i))->PT > 30.0) ++numberOfJets;
+    }
+    if(numberOfJets < 2) continue;
+
+    treeReader->LoadBranch(branchElectron);
+    treeReader->LoadBranch(branchMuon);
+    treeReader->LoadBranch(branchMissingET);
+
+    if(branchElectron->GetEntriesFast() + branchMuon->GetEntriesFast() > 0) ++selected;
+  }
+
+  stopWatch.Stop();
+
+  cout << "   " << setw(16) << left << kModeNames[mode] << right;
+  cout << setw(12) << fixed << setprecision(1) << numberOfEntries / stopWatch.RealTime() << " events/s";
+  cout << setw(12) << file->GetReadCalls() << " reads";
+  cout << setw(12) << setprecision(1) << file->GetBytesRead() / 1.0E6 << " MB";
+  cout << setw(10) << selected << " selected" << endl;
+
+  delete treeReader;
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+  char appName[] = "TreeReaderBenchmark";
+  Double_t latency = 0.005, bandwidth = 50.0;
+  Long64_t maxEntries = 0;
+  Int_t mode, storage;
+  TFile *file;
+
+  if(argc < 2 || argc > 5)
+  {
+    cout << " Usage: " << appName << " input_file [max_events] [latency_ms] [bandwidth_MBps]" << endl;
+    cout << " input_file - input file in ROOT format ('Delphes' tree)," << endl;
+    cout << " max_events - maximum number of events to read (default all)," << endl;
+    cout << " latency_ms - latency of each read request on slow storage (default 5)," << endl;
+    cout << " bandwidth_MBps - bandwidth of slow storage (default 50)." << endl;
+    return 1;
+  }
+
+  if(argc > 2) maxEntries = atoll(argv[2]);
+  if(argc > 3) latency = atof(argv[3]) * 1.0E-3;
+  if(argc > 4) bandwidth = atof(argv[4]);
+
+  gROOT->SetBatch();
+
+  int appargc = 1;
+  char *appargv[] = {appName};
+  TApplication app(appName, &appargc, appargv);
+
+  try
+  {
+    for(storage = 0; storage < 2; ++storage)
+    {
+      if(storage == 0)
+      {
+        cout << "** Local storage" << endl;
+      }
+      else
+      {
+        cout << "** Slow storage: " << latency * 1.0E3 << " ms latency, " << bandwidth << " MB/s" << endl;
+      }
+
+      for(mode = kDefault; mode <= kCachePrefetch; ++mode)
+      {
+        // the prefetching is a process-wide setting enabled by SetAsyncPrefetch
+        gEnv->SetValue("TFile.AsyncPrefetching", 0);
+
+        if(storage == 0)
+        {
+          file = TFile::Open(argv[1]);
+        }
+        else
+        {
+          file = new ThrottledFile(argv[1], latency, bandwidth * 1.0E6);
+        }
+
+        if(!file || file->IsZombie())
+        {
+          stringstream message;
+          message << "can't open " << argv[1];
+          throw runtime_error(message.str());
+        }
+
+        RunBenchmark(file, EReadMode(mode), maxEntries);
+
+        delete file;
+      }
+    }
+  }
+  catch(runtime_error &e)
+  {
+    cerr << "** ERROR: " << e.what() << endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -97,6 +97,72 @@ ExRootConfParam ExRootConfReader::GetParam(const char *name)
 
 //------------------------------------------------------------------------------
 
+TString ExRootConfReader::GetModuleParameters(const char *moduleName)
+{
+  stringstream script;
+  Tcl_Obj *names, *keys, *name, *key, *value, *array, *result;
+  int i, j, size, length;
+  TString parameters;
+
+  // sorted list of pairs of variable names and values,
+  // array variables are expanded as sorted lists of pairs of keys and values
+
+  script << "lsort [info vars ::" << moduleName << "::*]";
+  if(Tcl_Eval(fTclInterp, const_cast<char *>(script.str().c_str())) != TCL_OK) return "";
+
+  names = Tcl_GetObjResult(fTclInterp);
+  Tcl_IncrRefCount(names);
+
+  result = Tcl_NewListObj(0, 0);
+  Tcl_IncrRefCount(result);
+
+  size = 0;
+  Tcl_ListObjLength(fTclInterp, names, &size);
+  for(i = 0; i < size; ++i)
+  {
+    Tcl_ListObjIndex(fTclInterp, names, i, &name);
+    Tcl_ListObjAppendElement(fTclInterp, result, name);
+
+    value = Tcl_ObjGetVar2(fTclInterp, name, 0, TCL_GLOBAL_ONLY);
+    if(value)
+    {
+      Tcl_ListObjAppendElement(fTclInterp, result, value);
+      continue;
+    }
+
+    script.str("");
+    script << "lsort [array names " << Tcl_GetStringFromObj(name, 0) << "]";
+    array = Tcl_NewListObj(0, 0);
+    if(Tcl_Eval(fTclInterp, const_cast<char *>(script.str().c_str())) == TCL_OK)
+    {
+      keys = Tcl_GetObjResult(fTclInterp);
+      Tcl_IncrRefCount(keys);
+      length = 0;
+      Tcl_ListObjLength(fTclInterp, keys, &length);
+      for(j = 0; j < length; ++j)
+      {
+        Tcl_ListObjIndex(fTclInterp, keys, j, &key);
+        value = Tcl_ObjGetVar2(fTclInterp, name, key, TCL_GLOBAL_ONLY);
+        Tcl_ListObjAppendElement(fTclInterp, array, key);
+        Tcl_ListObjAppendElement(fTclInterp, array, value ? value : Tcl_NewObj());
+      }
+      Tcl_DecrRefCount(keys);
+    }
+    Tcl_ListObjAppendElement(fTclInterp, result, array);
+  }
+
+  parameters = Tcl_GetStringFromObj(result, 0);
+
+  Tcl_DecrRefCount(result);
+  Tcl_DecrRefCount(names);
+
+  Tcl_ResetResult(fTclInterp);
+
+  return parameters;
+}
+
+//------------------------------------------------------------------------------
+
 int ExRootConfReader::GetInt(const char *name, int defaultValue, int index)
 {
   ExRootConfParam object = GetParam(name);
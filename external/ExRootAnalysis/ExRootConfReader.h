@@ -56,6 +56,9 @@ public:
   const char *GetString(const char *name, const char *defaultValue, int index = -1);
   ExRootConfParam GetParam(const char *name);
 
+  // canonical list of the variables defined in the namespace of a module
+  TString GetModuleParameters(const char *moduleName);
+
   const ExRootTaskMap *GetModules() const { return &fModules; }
 
   void AddModule(const char *className, const char *moduleName);
@@ -0,0 +1,583 @@
+
+/** \class ExRootDataSource
+ *
+ *  RDataFrame data source for trees of TClonesArray branches
+ *
+ */
+
+#include "ExRootAnalysis/ExRootDataSource.h"
+
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6, 22, 0)
+
+#include "TBranchElement.h"
+#include "TChain.h"
+#include "TClass.h"
+#include "TClonesArray.h"
+#include "TDataMember.h"
+#include "TDataType.h"
+#include "TList.h"
+#include "TRealData.h"
+#include "TRef.h"
+#include "TRefArray.h"
+
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <typeinfo>
+
+using namespace std;
+using ROOT::VecOps::RVec;
+
+//------------------------------------------------------------------------------
+
+class ExRootDataSource::TColumnReader
+{
+public:
+  TColumnReader(Int_t branch) :
+    fBranch(branch) {}
+  virtual ~TColumnReader() {}
+
+  virtual void Fill(const TSlot &slot) = 0;
+
+  void *GetPointer() { return &fPointer; }
+
+protected:
+  // the columns of a branch missing from the current file are empty
+  const TClonesArray *GetArray(const TSlot &slot) const { return slot.branches[fBranch] ? slot.arrays[fBranch] : 0; }
+
+  Int_t fBranch;
+  void *fPointer;
+};
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+class ExRootDataSource::TMemberReader: public ExRootDataSource::TColumnReader
+{
+public:
+  TMemberReader(Int_t branch, Int_t offset) :
+    TColumnReader(branch), fOffset(offset) { fPointer = &fValue; }
+
+  void Fill(const TSlot &slot)
+  {
+    const TClonesArray *array = GetArray(slot);
+    Int_t i, size = array ? array->GetEntriesFast() : 0;
+
+    fValue.resize(size);
+    for(i = 0; i < size; ++i)
+    {
+      fValue[i] = *reinterpret_cast<const T *>(reinterpret_cast<const char *>(array->UncheckedAt(i)) + fOffset);
+    }
+  }
+
+private:
+  Int_t fOffset;
+  RVec<T> fValue;
+};
+
+//------------------------------------------------------------------------------
+
+class ExRootDataSource::TRefReader: public ExRootDataSource::TColumnReader
+{
+public:
+  TRefReader(Int_t branch, Int_t offset, Bool_t index) :
+    TColumnReader(branch), fOffset(offset), fIndex(index) { fPointer = &fValue; }
+
+  void Fill(const TSlot &slot)
+  {
+    const TClonesArray *array = GetArray(slot);
+    Int_t i, size = array ? array->GetEntriesFast() : 0;
+    const TRef *ref;
+
+    fValue.resize(size);
+    for(i = 0; i < size; ++i)
+    {
+      ref = reinterpret_cast<const TRef *>(reinterpret_cast<const char *>(array->UncheckedAt(i)) + fOffset);
+      fValue[i] = Resolve(slot, ref->GetUniqueID());
+    }
+  }
+
+  Int_t Resolve(const TSlot &slot, UInt_t uid)
+  {
+    unordered_map<UInt_t, pair<Int_t, Int_t> >::const_iterator itObject;
+
+    itObject = slot.objects.find(uid & 0xffffff);
+    if(uid == 0 || itObject == slot.objects.end()) return -1;
+    return fIndex ? itObject->second.second : itObject->second.first;
+  }
+
+protected:
+  Int_t fOffset;
+  Bool_t fIndex;
+
+private:
+  RVec<Int_t> fValue;
+};
+
+//------------------------------------------------------------------------------
+
+class ExRootDataSource::TRefArrayReader: public ExRootDataSource::TRefReader
+{
+public:
+  TRefArrayReader(Int_t branch, Int_t offset, Bool_t index) :
+    TRefReader(branch, offset, index) { fPointer = &fValue; }
+
+  void Fill(const TSlot &slot)
+  {
+    const TClonesArray *array = GetArray(slot);
+    Int_t i, j, size = array ? array->GetEntriesFast() : 0, refs;
+    const TRefArray *refArray;
+
+    fValue.resize(size);
+    for(i = 0; i < size; ++i)
+    {
+      refArray = reinterpret_cast<const TRefArray *>(reinterpret_cast<const char *>(array->UncheckedAt(i)) + fOffset);
+      refs = refArray->GetEntriesFast();
+      fValue[i].resize(refs);
+      for(j = 0; j < refs; ++j)
+      {
+        fValue[i][j] = Resolve(slot, refArray->GetUID(j));
+      }
+    }
+  }
+
+private:
+  RVec<RVec<Int_t> > fValue;
+};
+
+//------------------------------------------------------------------------------
+
+ExRootDataSource::ExRootDataSource(const char *treeName, const vector<string> &fileNames) :
+  fTreeName(treeName), fFileNames(fileNames),
+  fEntries(0), fNSlots(0), fRangesDone(false), fResolveReferences(false)
+{
+  TChain chain(treeName);
+  vector<string>::const_iterator itFileName;
+  TIterator *itBranch, *itRealData;
+  TBranch *branch;
+  TBranchElement *element;
+  TClass *cl;
+  TRealData *realData;
+  TDataMember *member;
+  TColumnInfo info;
+  string name, typeName, memberName;
+  Int_t type;
+
+  for(itFileName = fFileNames.begin(); itFileName != fFileNames.end(); ++itFileName)
+  {
+    chain.Add(itFileName->c_str());
+  }
+
+  fEntries = chain.GetEntries();
+
+  if(chain.LoadTree(0) < 0)
+  {
+    stringstream message;
+    message << "can't read tree '" << treeName << "'";
+    throw runtime_error(message.str());
+  }
+
+  // find all TClonesArray branches and the basic data members of their classes
+
+  itBranch = chain.GetListOfBranches()->MakeIterator();
+  while((branch = static_cast<TBranch *>(itBranch->Next())))
+  {
+    if(branch->IsA() != TBranchElement::Class()) continue;
+    element = static_cast<TBranchElement *>(branch);
+
+    cl = TClass::GetClass(element->GetClonesName());
+    if(!cl) continue;
+
+    info.branch = fBranchNames.size();
+    fBranchNames.push_back(branch->GetName());
+    fBranchClasses.push_back(cl);
+
+    cl->BuildRealData();
+    itRealData = cl->GetListOfRealData()->MakeIterator();
+    while((realData = static_cast<TRealData *>(itRealData->Next())))
+    {
+      member = realData->GetDataMember();
+      memberName = realData->GetName();
+
+      // skip pointers, arrays, transient members and internals of ROOT classes
+      if(!member || !member->IsPersistent() || member->IsaPointer() || member->GetArrayDim() > 0) continue;
+      if(memberName.find_first_of("*[") != string::npos) continue;
+      if(memberName.compare(0, 1, "f") == 0 || memberName.find(".f") != string::npos) continue;
+
+      name = fBranchNames.back() + "." + memberName;
+      info.offset = realData->GetThisOffset();
+      typeName = member->GetTypeName();
+
+      if(typeName == "TRef" || typeName == "TRefArray")
+      {
+        bool isArray = typeName == "TRefArray";
+
+        info.kind = isArray ? kRefArrayBranch : kRefBranch;
+        info.typeName = isArray ? "ROOT::VecOps::RVec<ROOT::VecOps::RVec<int>>" : "ROOT::VecOps::RVec<int>";
+        fColumns[name + "_branch"] = info;
+        fColumnNames.push_back(name + "_branch");
+
+        info.kind = isArray ? kRefArrayIndex : kRefIndex;
+        fColumns[name + "_index"] = info;
+        fColumnNames.push_back(name + "_index");
+        continue;
+      }
+
+      if(!member->IsBasic() || !member->GetDataType()) continue;
+
+      type = member->GetDataType()->GetType();
+      switch(type)
+      {
+      case kFloat_t:
+      case kFloat16_t:
+        info.kind = kFloat;
+        info.typeName = "ROOT::VecOps::RVec<float>";
+        break;
+      case kDouble_t:
+      case kDouble32_t:
+        info.kind = kDouble;
+        info.typeName = "ROOT::VecOps::RVec<double>";
+        break;
+      case kInt_t:
+        info.kind = kInt;
+        info.typeName = "ROOT::VecOps::RVec<int>";
+        break;
+      case kUInt_t:
+        info.kind = kUInt;
+        info.typeName = "ROOT::VecOps::RVec<unsigned int>";
+        break;
+      case kLong64_t:
+        info.kind = kLong64;
+        info.typeName = "ROOT::VecOps::RVec<Long64_t>";
+        break;
+      case kULong64_t:
+        info.kind = kULong64;
+        info.typeName = "ROOT::VecOps::RVec<ULong64_t>";
+        break;
+      case kBool_t:
+        info.kind = kBool;
+        info.typeName = "ROOT::VecOps::RVec<bool>";
+        break;
+      default:
+        continue;
+      }
+
+      fColumns[name] = info;
+      fColumnNames.push_back(name);
+    }
+    delete itRealData;
+  }
+  delete itBranch;
+
+  fBranchUsed.assign(fBranchNames.size(), false);
+}
+
+//------------------------------------------------------------------------------
+
+ExRootDataSource::~ExRootDataSource()
+{
+  ClearSlots();
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootDataSource::ClearSlots()
+{
+  vector<TSlot>::iterator itSlot;
+  vector<TClonesArray *>::iterator itArray;
+  vector<TColumnReader *>::iterator itReader;
+
+  for(itSlot = fSlots.begin(); itSlot != fSlots.end(); ++itSlot)
+  {
+    for(itReader = itSlot->readers.begin(); itReader != itSlot->readers.end(); ++itReader)
+    {
+      delete *itReader;
+    }
+    for(itArray = itSlot->arrays.begin(); itArray != itSlot->arrays.end(); ++itArray)
+    {
+      if(*itArray) delete *itArray;
+    }
+    if(itSlot->chain) delete itSlot->chain;
+  }
+  fSlots.clear();
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootDataSource::SetNSlots(unsigned int nSlots)
+{
+  unsigned int i;
+
+  ClearSlots();
+
+  fNSlots = nSlots;
+  fSlots.resize(nSlots);
+  for(i = 0; i < nSlots; ++i)
+  {
+    fSlots[i].chain = 0;
+    fSlots[i].treeNumber = -1;
+    fSlots[i].arrays.assign(fBranchNames.size(), 0);
+    fSlots[i].branches.assign(fBranchNames.size(), 0);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+bool ExRootDataSource::HasColumn(string_view name) const
+{
+  return fColumns.find(string(name)) != fColumns.end();
+}
+
+//------------------------------------------------------------------------------
+
+string ExRootDataSource::GetTypeName(string_view name) const
+{
+  map<string, TColumnInfo>::const_iterator itColumn = fColumns.find(string(name));
+
+  if(itColumn == fColumns.end())
+  {
+    stringstream message;
+    message << "column '" << name << "' does not exist";
+    throw runtime_error(message.str());
+  }
+
+  return itColumn->second.typeName;
+}
+
+//------------------------------------------------------------------------------
+
+vector<void *> ExRootDataSource::GetColumnReadersImpl(string_view name, const type_info &type)
+{
+  map<string, TColumnInfo>::const_iterator itColumn = fColumns.find(string(name));
+  vector<void *> result;
+  TColumnReader *reader = 0;
+  const type_info *expected = 0;
+  unsigned int i;
+
+  if(itColumn == fColumns.end())
+  {
+    stringstream message;
+    message << "column '" << name << "' does not exist";
+    throw runtime_error(message.str());
+  }
+
+  const TColumnInfo &info = itColumn->second;
+
+  switch(info.kind)
+  {
+  case kFloat:
+    expected = &typeid(RVec<Float_t>);
+    break;
+  case kDouble:
+    expected = &typeid(RVec<Double_t>);
+    break;
+  case kInt:
+  case kRefBranch:
+  case kRefIndex:
+    expected = &typeid(RVec<Int_t>);
+    break;
+  case kUInt:
+    expected = &typeid(RVec<UInt_t>);
+    break;
+  case kLong64:
+    expected = &typeid(RVec<Long64_t>);
+    break;
+  case kULong64:
+    expected = &typeid(RVec<ULong64_t>);
+    break;
+  case kBool:
+    expected = &typeid(RVec<Bool_t>);
+    break;
+  case kRefArrayBranch:
+  case kRefArrayIndex:
+    expected = &typeid(RVec<RVec<Int_t> >);
+    break;
+  }
+
+  if(type != *expected)
+  {
+    stringstream message;
+    message << "column '" << name << "' has type " << info.typeName;
+    throw runtime_error(message.str());
+  }
+
+  fBranchUsed[info.branch] = true;
+
+  for(i = 0; i < fNSlots; ++i)
+  {
+    switch(info.kind)
+    {
+    case kFloat:
+      reader = new TMemberReader<Float_t>(info.branch, info.offset);
+      break;
+    case kDouble:
+      reader = new TMemberReader<Double_t>(info.branch, info.offset);
+      break;
+    case kInt:
+      reader = new TMemberReader<Int_t>(info.branch, info.offset);
+      break;
+    case kUInt:
+      reader = new TMemberReader<UInt_t>(info.branch, info.offset);
+      break;
+    case kLong64:
+      reader = new TMemberReader<Long64_t>(info.branch, info.offset);
+      break;
+    case kULong64:
+      reader = new TMemberReader<ULong64_t>(info.branch, info.offset);
+      break;
+    case kBool:
+      reader = new TMemberReader<Bool_t>(info.branch, info.offset);
+      break;
+    case kRefBranch:
+    case kRefIndex:
+      reader = new TRefReader(info.branch, info.offset, info.kind == kRefIndex);
+      fResolveReferences = true;
+      break;
+    case kRefArrayBranch:
+    case kRefArrayIndex:
+      reader = new TRefArrayReader(info.branch, info.offset, info.kind == kRefArrayIndex);
+      fResolveReferences = true;
+      break;
+    }
+
+    fSlots[i].readers.push_back(reader);
+    result.push_back(reader->GetPointer());
+  }
+
+  return result;
+}
+
+//------------------------------------------------------------------------------
+
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6, 28, 0)
+void ExRootDataSource::Initialize()
+#else
+void ExRootDataSource::Initialise()
+#endif
+{
+  unsigned int i;
+
+  fRangesDone = false;
+
+  // references can point to objects in any branch
+  if(fResolveReferences) fBranchUsed.assign(fBranchNames.size(), true);
+
+  // the branches used by the columns of this event loop are set up
+  // again, even if the chain of a slot stays on the same file
+  for(i = 0; i < fNSlots; ++i)
+  {
+    fSlots[i].treeNumber = -1;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+vector<pair<ULong64_t, ULong64_t> > ExRootDataSource::GetEntryRanges()
+{
+  vector<pair<ULong64_t, ULong64_t> > ranges;
+  ULong64_t first, last, size, number;
+
+  if(fRangesDone) return ranges;
+  fRangesDone = true;
+
+  // a few ranges per slot, so that slots finishing early can take more work
+  number = fNSlots > 1 ? 4 * fNSlots : 1;
+  size = (fEntries + number - 1) / number;
+  if(size == 0) size = 1;
+
+  for(first = 0; first < fEntries; first = last)
+  {
+    last = first + size < fEntries ? first + size : fEntries;
+    ranges.push_back(make_pair(first, last));
+  }
+
+  return ranges;
+}
+
+//------------------------------------------------------------------------------
+
+bool ExRootDataSource::SetEntry(unsigned int slot, ULong64_t entry)
+{
+  TSlot &data = fSlots[slot];
+  vector<string>::const_iterator itFileName;
+  vector<TColumnReader *>::iterator itReader;
+  TBranchElement *element;
+  TClonesArray *array;
+  Long64_t treeEntry;
+  Int_t i, j, size;
+  UInt_t uid;
+
+  if(!data.chain)
+  {
+    data.chain = new TChain(fTreeName.c_str());
+    for(itFileName = fFileNames.begin(); itFileName != fFileNames.end(); ++itFileName)
+    {
+      data.chain->Add(itFileName->c_str());
+    }
+  }
+
+  treeEntry = data.chain->LoadTree(entry);
+  if(treeEntry < 0) return false;
+
+  // get branch pointers when a new file is opened
+  if(data.chain->GetTreeNumber() != data.treeNumber)
+  {
+    data.treeNumber = data.chain->GetTreeNumber();
+    for(i = 0; i < Int_t(fBranchNames.size()); ++i)
+    {
+      data.branches[i] = 0;
+      if(!fBranchUsed[i]) continue;
+
+      data.branches[i] = data.chain->GetTree()->GetBranch(fBranchNames[i].c_str());
+      if(!data.branches[i]) continue;
+
+      if(!data.arrays[i])
+      {
+        element = static_cast<TBranchElement *>(data.branches[i]);
+        data.arrays[i] = new TClonesArray(fBranchClasses[i], element->GetMaximum());
+      }
+      data.branches[i]->SetAddress(&data.arrays[i]);
+    }
+  }
+
+  for(i = 0; i < Int_t(fBranchNames.size()); ++i)
+  {
+    if(data.branches[i]) data.branches[i]->GetEntry(treeEntry);
+  }
+
+  // map unique IDs of referenced objects to their position
+  if(fResolveReferences)
+  {
+    data.objects.clear();
+    for(i = 0; i < Int_t(fBranchNames.size()); ++i)
+    {
+      array = data.arrays[i];
+      if(!data.branches[i] || !array) continue;
+
+      size = array->GetEntriesFast();
+      for(j = 0; j < size; ++j)
+      {
+        uid = array->UncheckedAt(j)->GetUniqueID() & 0xffffff;
+        if(uid != 0) data.objects[uid] = make_pair(i, j);
+      }
+    }
+  }
+
+  for(itReader = data.readers.begin(); itReader != data.readers.end(); ++itReader)
+  {
+    (*itReader)->Fill(data);
+  }
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+ROOT::RDataFrame MakeExRootDataFrame(const char *treeName, const vector<string> &fileNames)
+{
+  return ROOT::RDataFrame(unique_ptr<ROOT::RDF::RDataSource>(new ExRootDataSource(treeName, fileNames)));
+}
+
+//------------------------------------------------------------------------------
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef ExRootDataSource_h
+#define ExRootDataSource_h
+
+/** \class ExRootDataSource
+ *
+ *  RDataFrame data source for trees of TClonesArray branches
+ *
+ *  Every basic data member of the class stored in a branch is exposed
+ *  as a column named Branch.Member of type RVec<T>. A TRef member is
+ *  resolved into two columns of type RVec<int>, Branch.Member_branch and
+ *  Branch.Member_index, giving the position of the referenced object
+ *  in GetBranchNames() and in its branch. A TRefArray member gives two
+ *  columns of type RVec<RVec<int>>. The columns are those of the branches
+ *  of the first file, they are empty for the events of the files missing
+ *  the branch. Each slot reads the input files through its own TChain,
+ *  so that entry ranges can be processed in parallel.
+ *
+ */
+
+#include "RVersion.h"
+
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6, 22, 0)
+
+#include "ROOT/RDataFrame.hxx"
+#include "ROOT/RDataSource.hxx"
+#include "ROOT/RVec.hxx"
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class TBranch;
+class TChain;
+class TClass;
+class TClonesArray;
+
+class ExRootDataSource: public ROOT::RDF::RDataSource
+{
+public:
+  ExRootDataSource(const char *treeName, const std::vector<std::string> &fileNames);
+  ~ExRootDataSource();
+
+  void SetNSlots(unsigned int nSlots);
+
+  const std::vector<std::string> &GetColumnNames() const { return fColumnNames; }
+  bool HasColumn(std::string_view name) const;
+  std::string GetTypeName(std::string_view name) const;
+
+  std::vector<std::pair<ULong64_t, ULong64_t> > GetEntryRanges();
+  bool SetEntry(unsigned int slot, ULong64_t entry);
+
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6, 28, 0)
+  void Initialize();
+#else
+  void Initialise();
+#endif
+
+  std::string GetLabel() { return "ExRootDataSource"; }
+
+  const std::vector<std::string> &GetBranchNames() const { return fBranchNames; }
+
+protected:
+  std::vector<void *> GetColumnReadersImpl(std::string_view name, const std::type_info &type);
+
+private:
+  enum EColumnKind
+  {
+    kFloat,
+    kDouble,
+    kInt,
+    kUInt,
+    kLong64,
+    kULong64,
+    kBool,
+    kRefBranch,
+    kRefIndex,
+    kRefArrayBranch,
+    kRefArrayIndex
+  };
+
+  struct TColumnInfo
+  {
+    Int_t branch;
+    Int_t offset;
+    EColumnKind kind;
+    std::string typeName;
+  };
+
+  class TColumnReader;
+  template <typename T>
+  class TMemberReader;
+  class TRefReader;
+  class TRefArrayReader;
+
+  struct TSlot
+  {
+    TChain *chain;
+    Int_t treeNumber;
+    std::vector<TClonesArray *> arrays;
+    std::vector<TBranch *> branches;
+    std::vector<TColumnReader *> readers;
+    std::unordered_map<UInt_t, std::pair<Int_t, Int_t> > objects;
+  };
+
+  void ClearSlots();
+
+  std::string fTreeName;
+  std::vector<std::string> fFileNames;
+
+  ULong64_t fEntries;
+  unsigned int fNSlots;
+  bool fRangesDone;
+
+  std::vector<std::string> fBranchNames;
+  std::vector<TClass *> fBranchClasses;
+
+  std::vector<std::string> fColumnNames;
+  std::map<std::string, TColumnInfo> fColumns;
+
+  // branches read for the requested columns, all of them when references are resolved
+  std::vector<bool> fBranchUsed;
+  bool fResolveReferences;
+
+  std::vector<TSlot> fSlots;
+};
+
+//------------------------------------------------------------------------------
+
+ROOT::RDataFrame MakeExRootDataFrame(const char *treeName, const std::vector<std::string> &fileNames);
+
+#endif
+
+#endif // ExRootDataSource_h
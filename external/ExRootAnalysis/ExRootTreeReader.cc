@@ -13,6 +13,7 @@
 #include "TCanvas.h"
 #include "TParameter.h"
 #include "TClonesArray.h"
+#include "TEnv.h"
 #include "TH2.h"
 #include "TStyle.h"
 
@@ -23,7 +24,8 @@ using namespace std;
 //------------------------------------------------------------------------------
 
 ExRootTreeReader::ExRootTreeReader(TTree *tree) :
-  fChain(tree), fCurrentTree(-1)
+  fChain(tree), fCurrentTree(-1), fCurrentEntry(-1),
+  fCacheSize(-1), fParallelUnzip(kFALSE), fAsyncPrefetch(kFALSE), fLazyLoading(kFALSE), fCacheReady(kFALSE)
 {
 }
 
@@ -35,7 +37,7 @@ ExRootTreeReader::~ExRootTreeReader()
 
   for(itBranchMap = fBranchMap.begin(); itBranchMap != fBranchMap.end(); ++itBranchMap)
   {
-    delete itBranchMap->second.second;
+    delete itBranchMap->second.array;
   }
 }
 
@@ -59,15 +61,22 @@ Bool_t ExRootTreeReader::ReadEntry(Long64_t entry)
     }
   }
 
+  if(!fCacheReady) SetupCache();
+
+  fCurrentEntry = treeEntry;
+
+  if(fLazyLoading) return kTRUE;
+
   TBranchMap::iterator itBranchMap;
   TBranch *branch;
 
   for(itBranchMap = fBranchMap.begin(); itBranchMap != fBranchMap.end(); ++itBranchMap)
   {
-    branch = itBranchMap->second.first;
+    branch = itBranchMap->second.branch;
     if(branch)
     {
       branch->GetEntry(treeEntry);
+      itBranchMap->second.entry = treeEntry;
     }
   }
 
@@ -76,6 +85,83 @@ Bool_t ExRootTreeReader::ReadEntry(Long64_t entry)
 
 //------------------------------------------------------------------------------
 
+TClonesArray *ExRootTreeReader::LoadBranch(TClonesArray *array)
+{
+  // Read contents of the branch associated with array, if not yet done for the current entry.
+  TBranchMap::iterator itBranchMap;
+  TBranchEntry *entry;
+
+  for(itBranchMap = fBranchMap.begin(); itBranchMap != fBranchMap.end(); ++itBranchMap)
+  {
+    entry = &itBranchMap->second;
+    if(entry->array != array) continue;
+
+    if(entry->branch && entry->entry != fCurrentEntry)
+    {
+      entry->branch->GetEntry(fCurrentEntry);
+      entry->entry = fCurrentEntry;
+    }
+    break;
+  }
+
+  return array;
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootTreeReader::SetCacheSize(Long64_t size)
+{
+  fCacheSize = size;
+  fCacheReady = kFALSE;
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootTreeReader::SetParallelUnzip(Bool_t enable)
+{
+  fParallelUnzip = enable;
+  fCacheReady = kFALSE;
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootTreeReader::SetAsyncPrefetch(Bool_t enable)
+{
+  fAsyncPrefetch = enable;
+  fCacheReady = kFALSE;
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootTreeReader::SetupCache()
+{
+  // Restrict the TTreeCache to the branches in use.
+  // They are known in advance, so the learning phase is not needed.
+  TBranchMap::iterator itBranchMap;
+
+  fCacheReady = kTRUE;
+
+  if(!fChain || fCacheSize < 0) return;
+
+  // the prefetching is set up by the caches created after this setting,
+  // including the ones of the following files of a chain
+  if(fAsyncPrefetch && fCacheSize > 0) gEnv->SetValue("TFile.AsyncPrefetching", 1);
+
+  fChain->SetParallelUnzip(fParallelUnzip);
+  fChain->SetCacheSize(fCacheSize);
+
+  if(fCacheSize == 0) return;
+
+  fChain->DropBranchFromCache("*", kTRUE);
+  for(itBranchMap = fBranchMap.begin(); itBranchMap != fBranchMap.end(); ++itBranchMap)
+  {
+    fChain->AddBranchToCache(itBranchMap->first, kTRUE);
+  }
+  fChain->StopCacheLearningPhase();
+}
+
+//------------------------------------------------------------------------------
+
 TClonesArray *ExRootTreeReader::UseBranch(const char *branchName)
 {
   TClonesArray *array = 0;
@@ -85,7 +171,7 @@ TClonesArray *ExRootTreeReader::UseBranch(const char *branchName)
   if(itBranchMap != fBranchMap.end())
   {
     cout << "** WARNING: branch '" << branchName << "' is already in use" << endl;
-    array = itBranchMap->second.second;
+    array = itBranchMap->second.array;
   }
   else
   {
@@ -102,8 +188,10 @@ TClonesArray *ExRootTreeReader::UseBranch(const char *branchName)
         {
           array = new TClonesArray(cl, size);
           array->SetName(branchName);
-          fBranchMap.insert(make_pair(branchName, make_pair(branch, array)));
-          branch->SetAddress(&array);
+          TBranchEntry entry = {branch, array, -1, 0};
+          itBranchMap = fBranchMap.insert(make_pair(branchName, entry)).first;
+          branch->SetAddress(&itBranchMap->second.array);
+          fCacheReady = kFALSE;
         }
       }
     }
@@ -119,6 +207,34 @@ TClonesArray *ExRootTreeReader::UseBranch(const char *branchName)
 
 //------------------------------------------------------------------------------
 
+Bool_t ExRootTreeReader::UseBranch(const char *branchName, void *address)
+{
+  // address points to the pointer to the object filled from the branch
+  TBranchMap::iterator itBranchMap = fBranchMap.find(branchName);
+
+  if(itBranchMap != fBranchMap.end())
+  {
+    cout << "** WARNING: branch '" << branchName << "' is already in use" << endl;
+    return kFALSE;
+  }
+
+  TBranch *branch = fChain->GetBranch(branchName);
+  if(!branch)
+  {
+    cout << "** WARNING: cannot access branch '" << branchName << "'" << endl;
+    return kFALSE;
+  }
+
+  TBranchEntry entry = {branch, 0, -1, address};
+  fBranchMap.insert(make_pair(branchName, entry));
+  branch->SetAddress(address);
+  fCacheReady = kFALSE;
+
+  return kTRUE;
+}
+
+//------------------------------------------------------------------------------
+
 Double_t ExRootTreeReader::GetInfo(const char *name)
 {
   TTree *tree = NULL;
@@ -146,8 +262,16 @@ Bool_t ExRootTreeReader::Notify()
     branch = fChain->GetBranch(itBranchMap->first);
     if(branch)
     {
-      itBranchMap->second.first = branch;
-      branch->SetAddress(&(itBranchMap->second.second));
+      itBranchMap->second.branch = branch;
+      itBranchMap->second.entry = -1;
+      if(itBranchMap->second.address)
+      {
+        branch->SetAddress(itBranchMap->second.address);
+      }
+      else
+      {
+        branch->SetAddress(&(itBranchMap->second.array));
+      }
     }
     else
     {
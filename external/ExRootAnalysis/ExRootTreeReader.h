@@ -5,6 +5,16 @@
  *
  *  Class simplifying access to ROOT tree branches
  *
+ *  SetCacheSize enables a TTreeCache limited to the branches in use, with
+ *  the learning phase skipped. SetParallelUnzip decompresses the cached
+ *  baskets ahead of time in a separate thread. SetAsyncPrefetch reads the
+ *  next cache block in a separate thread while the current one is processed,
+ *  which hides the latency of remote or slow storage. It enables the
+ *  TFile.AsyncPrefetching setting of ROOT, which applies to all the caches
+ *  created afterwards in the process. With SetLazyLoading, ReadEntry
+ *  does not read the branches, and LoadBranch reads a branch on first access.
+ *  Branches of other types are read at the address given to UseBranch.
+ *
  *  \author P. Demin - UCL, Louvain-la-Neuve
  *
  */
@@ -28,15 +38,40 @@ public:
   Bool_t ReadEntry(Long64_t entry);
 
   TClonesArray *UseBranch(const char *branchName);
+  Bool_t UseBranch(const char *branchName, void *address);
   Double_t GetInfo(const char *name);
 
+  void SetCacheSize(Long64_t size);
+  void SetParallelUnzip(Bool_t enable);
+  void SetAsyncPrefetch(Bool_t enable);
+  void SetLazyLoading(Bool_t enable) { fLazyLoading = enable; }
+
+  TClonesArray *LoadBranch(TClonesArray *array);
+
 private:
   Bool_t Notify();
 
+  void SetupCache();
+
   TTree *fChain; //! pointer to the analyzed TTree or TChain
   Int_t fCurrentTree; //! current Tree number in a TChain
 
-  typedef std::map<TString, std::pair<TBranch *, TClonesArray *> > TBranchMap;
+  Long64_t fCurrentEntry; //! current entry in the current Tree
+  Long64_t fCacheSize; //! size of the TTreeCache, -1 to keep the TTree default
+  Bool_t fParallelUnzip; //!
+  Bool_t fAsyncPrefetch; //!
+  Bool_t fLazyLoading; //!
+  Bool_t fCacheReady; //!
+
+  struct TBranchEntry
+  {
+    TBranch *branch;
+    TClonesArray *array;
+    Long64_t entry;
+    void *address;
+  };
+
+  typedef std::map<TString, TBranchEntry> TBranchMap;
 
   TBranchMap fBranchMap; //!
 
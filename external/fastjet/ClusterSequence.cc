@@ -35,6 +35,7 @@
 #include "fastjet/version.hh" // stores the current version number
 #include "fastjet/internal/LazyTiling9Alt.hh"
 #include "fastjet/internal/LazyTiling9.hh"
+#include "fastjet/internal/LazyTiling9SoA.hh"
 #include "fastjet/internal/LazyTiling25.hh"
 #ifndef __FJCORE__
 #include "fastjet/internal/LazyTiling9SeparateGhosts.hh"
@@ -371,6 +372,14 @@ void ClusterSequence::_initialise_and_run_no_decant () {
     tiling.run();
     _plugin_activated = false;
 
+  } else if (_strategy == N2MHTLazy9SoA) {
+    // attempt to use an external tiling routine -- it manipulates
+    // the CS history via the plugin mechanism
+    _plugin_activated = true;
+    LazyTiling9SoA tiling(*this);
+    tiling.run();
+    _plugin_activated = false;
+
   } else if (_strategy == N2MHTLazy9AntiKtSeparateGhosts) {
 #ifndef __FJCORE__
     // attempt to use an external tiling routine -- it manipulates
@@ -543,6 +552,8 @@ string ClusterSequence::strategy_string (Strategy strategy_in)  const {
     strategy = "N2MHTLazy9"; break;
   case N2MHTLazy9Alt:
     strategy = "N2MHTLazy9Alt"; break;
+  case N2MHTLazy9SoA:
+    strategy = "N2MHTLazy9SoA"; break;
   case N2MHTLazy25:
     strategy = "N2MHTLazy25"; break;
   case N2MHTLazy9AntiKtSeparateGhosts:
@@ -69,6 +69,12 @@ enum Strategy {
   ///
   /// New in FJ3.1
   N2MHTLazy9AntiKtSeparateGhosts   = -10, 
+  /// same clustering as N2MHTLazy9, with the particles of each tile
+  /// stored as contiguous arrays so that the distance calculations
+  /// are vectorised. Only selected explicitly, never by Best.
+  ///
+  /// Added for Delphes
+  N2MHTLazy9SoA   = -11, 
   /// only looks into a neighbouring tile for a particle's nearest
   /// neighbour (NN) if that particle's in-tile NN is further than the
   /// distance to the edge of the neighbouring tile. Uses tiles of
@@ -0,0 +1,498 @@
+//FJSTARTHEADER
+//
+// Copyright (c) 2005-2020, Matteo Cacciari, Gavin P. Salam and Gregory Soyez
+//
+//----------------------------------------------------------------------
+// This file is part of FastJet.
+//
+//  FastJet is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  The algorithms that underlie FastJet have required considerable
+//  development. They are described in the original FastJet paper,
+//  hep-ph/0512210 and in the manual, arXiv:1111.6097. If you use
+//  FastJet as part of work towards a scientific publication, please
+//  quote the version you use and include a citation to the manual and
+//  optionally also to hep-ph/0512210.
+//
+//  FastJet is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with FastJet. If not, see <http://www.gnu.org/licenses/>.
+//----------------------------------------------------------------------
+//FJENDHEADER
+
+#include <cmath>
+#include "fastjet/internal/LazyTiling9SoA.hh"
+#include "fastjet/internal/TilingExtent.hh"
+using namespace std;
+
+FASTJET_BEGIN_NAMESPACE      // defined in fastjet/internal/base.hh
+
+
+LazyTiling9SoA::LazyTiling9SoA(ClusterSequence & cs) :
+  _cs(cs), _jets(cs.jets())
+{
+  _Rparam = cs.jet_def().R();
+  _R2 = _Rparam * _Rparam;
+  _invR2 = 1.0 / _R2;
+  _initialise_tiles();
+}
+
+
+//----------------------------------------------------------------------
+/// Set up the tiles, with the same geometry as in LazyTiling9
+void LazyTiling9SoA::_initialise_tiles() {
+
+  // first decide tile sizes (with a lower bound to avoid huge memory use with
+  // very small R)
+  double default_size = max(0.1,_Rparam);
+  _tile_size_eta = default_size;
+  // it makes no sense to go below 3 tiles in phi -- 3 tiles is
+  // sufficient to make sure all pair-wise combinations up to pi in
+  // phi are possible
+  _n_tiles_phi   = max(3,int(floor(twopi/default_size)));
+  _tile_size_phi = twopi / _n_tiles_phi; // >= _Rparam and fits in 2pi
+
+  TilingExtent tiling_analysis(_cs);
+  _tiles_eta_min = tiling_analysis.minrap();
+  _tiles_eta_max = tiling_analysis.maxrap();
+
+  // always have at least two tiles in rapidity, see LazyTiling9
+  if (_tiles_eta_max - _tiles_eta_min < 2*_tile_size_eta) {
+    _tile_size_eta = (_tiles_eta_max - _tiles_eta_min)/2;
+    _tiles_ieta_min = 0;
+    _tiles_ieta_max = 1;
+    // the eta max value is being taken as the lower edge of the
+    // highest-y tile
+    _tiles_eta_max -= _tile_size_eta;
+  } else {
+    _tiles_ieta_min = int(floor(_tiles_eta_min/_tile_size_eta));
+    _tiles_ieta_max = int(floor( _tiles_eta_max/_tile_size_eta));
+    _tiles_eta_min = _tiles_ieta_min * _tile_size_eta;
+    _tiles_eta_max = _tiles_ieta_max * _tile_size_eta;
+  }
+
+  _tile_half_size_eta = _tile_size_eta * 0.5;
+  _tile_half_size_phi = _tile_size_phi * 0.5;
+
+  // allocate the tiles
+  _tiles.resize((_tiles_ieta_max-_tiles_ieta_min+1)*_n_tiles_phi);
+
+  // now set up the cross-referencing between tiles, in the same
+  // order as in LazyTiling9: X, then the L's, then the R's
+  for (int ieta = _tiles_ieta_min; ieta <= _tiles_ieta_max; ieta++) {
+    for (int iphi = 0; iphi < _n_tiles_phi; iphi++) {
+      Tile & tile = _tiles[_tile_index(ieta,iphi)];
+      int n = 0;
+      tile.neighbours[n++] = _tile_index(ieta,iphi);
+      if (ieta > _tiles_ieta_min) {
+	for (int idphi = -1; idphi <=+1; idphi++) {
+	  tile.neighbours[n++] = _tile_index(ieta-1,iphi+idphi);
+	}
+      }
+      tile.neighbours[n++] = _tile_index(ieta,iphi-1);
+      tile.RH_begin = n;
+      tile.neighbours[n++] = _tile_index(ieta,iphi+1);
+      if (ieta < _tiles_ieta_max) {
+	for (int idphi = -1; idphi <= +1; idphi++) {
+	  tile.neighbours[n++] = _tile_index(ieta+1,iphi+idphi);
+	}
+      }
+      tile.end = n;
+      tile.tagged = false;
+      tile.max_NN_dist = 0;
+      tile.eta_centre = (ieta-_tiles_ieta_min+0.5)*_tile_size_eta + _tiles_eta_min;
+      tile.phi_centre = (iphi+0.5)*_tile_size_phi;
+      tile.eta.clear();
+      tile.phi.clear();
+      tile.jet.clear();
+    }
+  }
+}
+
+
+//----------------------------------------------------------------------
+/// return the tile index corresponding to the given eta,phi point
+int LazyTiling9SoA::_tile_index(const double eta, const double phi) const {
+  int ieta, iphi;
+  if      (eta <= _tiles_eta_min) {ieta = 0;}
+  else if (eta >= _tiles_eta_max) {ieta = _tiles_ieta_max-_tiles_ieta_min;}
+  else {
+    ieta = int(((eta - _tiles_eta_min) / _tile_size_eta));
+    // following needed in case of rare but nasty rounding errors
+    if (ieta > _tiles_ieta_max-_tiles_ieta_min) {
+      ieta = _tiles_ieta_max-_tiles_ieta_min;} 
+  }
+  iphi = int((phi+twopi)/_tile_size_phi) % _n_tiles_phi;
+  return (iphi + ieta * _n_tiles_phi);
+}
+
+
+//----------------------------------------------------------------------
+void LazyTiling9SoA::_tj_set_jetinfo(const int ibj, const int jets_index) {
+  double eta = _jets[jets_index].rap();
+  double phi = _jets[jets_index].phi_02pi();
+  int tile_index = _tile_index(eta, phi);
+  Tile & tile = _tiles[tile_index];
+
+  _bj_eta[ibj] = eta;
+  _bj_phi[ibj] = phi;
+  _bj_kt2[ibj] = _cs.jet_scale_for_algorithm(_jets[jets_index]);
+  _bj_jets_index[ibj] = jets_index;
+  _bj_NN_dist[ibj] = _R2;
+  _bj_NN[ibj] = -1;
+
+  _bj_tile_index[ibj] = tile_index;
+  _bj_tile_position[ibj] = tile.jet.size();
+  tile.eta.push_back(eta);
+  tile.phi.push_back(phi);
+  tile.jet.push_back(ibj);
+}
+
+
+//----------------------------------------------------------------------
+/// remove a briefjet from its tile by moving the last particle of the
+/// tile into its slot
+void LazyTiling9SoA::_bj_remove_from_tiles(const int ibj) {
+  Tile & tile = _tiles[_bj_tile_index[ibj]];
+  int position = _bj_tile_position[ibj];
+  int last = tile.jet.size() - 1;
+
+  if (position != last) {
+    tile.eta[position] = tile.eta[last];
+    tile.phi[position] = tile.phi[last];
+    tile.jet[position] = tile.jet[last];
+    _bj_tile_position[tile.jet[position]] = position;
+  }
+  tile.eta.pop_back();
+  tile.phi.pop_back();
+  tile.jet.pop_back();
+}
+
+
+//----------------------------------------------------------------------
+/// distance kernel: the same arithmetic as LazyTiling9::_bj_dist,
+/// written without branches over contiguous arrays so that it can be
+/// vectorised
+void LazyTiling9SoA::_tile_distances(const Tile & tile, const double eta,
+                                     const double phi, double * dist) const {
+  const int n = tile.jet.size();
+  if (n == 0) return;
+  const double * __restrict tile_eta = &tile.eta[0];
+  const double * __restrict tile_phi = &tile.phi[0];
+  double * __restrict d = dist;
+  for (int i = 0; i < n; i++) {
+    double dphi = std::abs(phi - tile_phi[i]);
+    double deta = (eta - tile_eta[i]);
+    dphi = (dphi > pi) ? twopi - dphi : dphi;
+    d[i] = dphi*dphi + deta*deta;
+  }
+}
+
+
+//----------------------------------------------------------------------
+/// returns a particle's distance to the edge of the specified tile
+double LazyTiling9SoA::_distance_to_tile(const double eta, const double phi,
+                                         const int tile_index,
+                                         const Tile & tile) const {
+  double deta;
+  if (_tiles[tile_index].eta_centre == tile.eta_centre) deta = 0;
+  else   deta = std::abs(eta - tile.eta_centre) - _tile_half_size_eta;
+
+  double dphi = std::abs(phi - tile.phi_centre);
+  if (dphi > pi) dphi = twopi-dphi;
+  dphi -= _tile_half_size_phi;
+  if (dphi < 0) dphi = 0;
+
+  return dphi*dphi + deta*deta;
+}
+
+
+//----------------------------------------------------------------------
+/// adds the untagged neighbouring tiles whose max_NN_dist is larger
+/// than their distance to the particle, see LazyTiling9
+void LazyTiling9SoA::_add_untagged_neighbours_to_tile_union_using_max_info(
+               const double eta, const double phi, const int tile_index,
+	       vector<int> & tile_union, int & n_near_tiles)  {
+  Tile & tile = _tiles[tile_index];
+
+  for (int k = 0; k < tile.end; k++) {
+    Tile & near_tile = _tiles[tile.neighbours[k]];
+    if (near_tile.tagged) continue;
+    double dist = _distance_to_tile(eta, phi, tile_index, near_tile)
+                  - tile_edge_security_margin;
+    if (dist > near_tile.max_NN_dist) continue;
+
+    near_tile.tagged = true;
+    tile_union[n_near_tiles] = tile.neighbours[k];
+    n_near_tiles++;
+  }
+}
+
+
+//----------------------------------------------------------------------
+inline void LazyTiling9SoA::_update_jetX_jetI_NN(const int jetX, const int jetI,
+                                                 const double dist,
+                                                 vector<int> & jets_for_minheap) {
+  if (jetI == jetX) return;
+  if (dist < _bj_NN_dist[jetI]) {
+    _bj_NN_dist[jetI] = dist;
+    _bj_NN[jetI] = jetX;
+    _label_minheap_update_needed(jetI, jets_for_minheap);
+  }
+  if (dist < _bj_NN_dist[jetX]) {
+    _bj_NN_dist[jetX] = dist;
+    _bj_NN[jetX] = jetI;
+  }
+}
+
+
+//----------------------------------------------------------------------
+void LazyTiling9SoA::_set_NN(const int jetI, vector<int> & jets_for_minheap) {
+  _bj_NN_dist[jetI] = _R2;
+  _bj_NN[jetI] = -1;
+  _label_minheap_update_needed(jetI, jets_for_minheap);
+
+  const double eta = _bj_eta[jetI], phi = _bj_phi[jetI];
+  const int tile_index = _bj_tile_index[jetI];
+  const Tile & tile = _tiles[tile_index];
+  double * dist = &_dist_NN[0];
+
+  // now go over tiles that are neighbours of I (include own tile)
+  for (int k = 0; k < tile.end; k++) {
+    const Tile & near_tile = _tiles[tile.neighbours[k]];
+    if (_bj_NN_dist[jetI] < _distance_to_tile(eta, phi, tile_index, near_tile)) continue;
+    const int n = near_tile.jet.size();
+    _tile_distances(near_tile, eta, phi, dist);
+    for (int i = 0; i < n; i++) {
+      if (dist[i] < _bj_NN_dist[jetI] && near_tile.jet[i] != jetI) {
+        _bj_NN_dist[jetI] = dist[i];
+        _bj_NN[jetI] = near_tile.jet[i];
+      }
+    }
+  }
+}
+
+
+//----------------------------------------------------------------------
+void LazyTiling9SoA::run() {
+
+  int n = _jets.size();
+  if (n == 0) return; 
+
+  _bj_eta.resize(n);
+  _bj_phi.resize(n);
+  _bj_kt2.resize(n);
+  _bj_NN_dist.resize(n);
+  _bj_NN.resize(n);
+  _bj_jets_index.resize(n);
+  _bj_tile_index.resize(n);
+  _bj_tile_position.resize(n);
+  _bj_minheap_update_needed.assign(n, 0);
+
+  // a tile never holds more than the n particles
+  _dist.resize(n);
+  _dist_NN.resize(n);
+  double * dist = &_dist[0];
+
+  // will be used quite deep inside loops, but declare it here so that
+  // memory (de)allocation gets done only once
+  vector<int> tile_union(3*n_tile_neighbours);
+  
+  // initialise the basic jet info 
+  for (int i = 0; i< n; i++) {
+    _tj_set_jetinfo(i, i);
+  }
+
+  // set up the initial nearest neighbour information
+  vector<Tile>::iterator tile;
+  for (tile = _tiles.begin(); tile != _tiles.end(); tile++) {
+    // first do it on this tile
+    const int m = tile->jet.size();
+    for (int a = 1; a < m; a++) {
+      const int jetA = tile->jet[a];
+      _tile_distances(*tile, tile->eta[a], tile->phi[a], dist);
+      for (int b = 0; b < a; b++) {
+        const int jetB = tile->jet[b];
+	if (dist[b] < _bj_NN_dist[jetA]) {_bj_NN_dist[jetA] = dist[b]; _bj_NN[jetA] = jetB;}
+	if (dist[b] < _bj_NN_dist[jetB]) {_bj_NN_dist[jetB] = dist[b]; _bj_NN[jetB] = jetA;}
+      }
+    }
+    for (int a = 0; a < m; a++) {
+      if (_bj_NN_dist[tile->jet[a]] > tile->max_NN_dist) tile->max_NN_dist = _bj_NN_dist[tile->jet[a]];
+    }
+  }
+  for (tile = _tiles.begin(); tile != _tiles.end(); tile++) {
+    const int tile_index = tile - _tiles.begin();
+    const int m = tile->jet.size();
+    // then do it for RH tiles
+    for (int k = tile->RH_begin; k < tile->end; k++) {
+      Tile & RTile = _tiles[tile->neighbours[k]];
+      const int mR = RTile.jet.size();
+      for (int a = 0; a < m; a++) {
+        const int jetA = tile->jet[a];
+        double dist_to_tile = _distance_to_tile(tile->eta[a], tile->phi[a], tile_index, RTile);
+        // it only makes sense to do a tile if jetA is close enough to the Rtile
+        // either for a jet in the Rtile to be closer to jetA than it's current NN
+        // or if jetA could be closer to something in the Rtile than the largest
+        // NN distance within the RTile.
+        bool relevant_for_jetA  = dist_to_tile <= _bj_NN_dist[jetA];
+        bool relevant_for_RTile = dist_to_tile <= RTile.max_NN_dist;
+        if (relevant_for_jetA || relevant_for_RTile) {
+          _tile_distances(RTile, tile->eta[a], tile->phi[a], dist);
+          for (int b = 0; b < mR; b++) {
+            const int jetB = RTile.jet[b];
+            if (dist[b] < _bj_NN_dist[jetA]) {_bj_NN_dist[jetA] = dist[b]; _bj_NN[jetA] = jetB;}
+            if (dist[b] < _bj_NN_dist[jetB]) {_bj_NN_dist[jetB] = dist[b]; _bj_NN[jetB] = jetA;}
+          }
+        } 
+      }
+    }
+  }
+  // Now update the max_NN_dist within each tile.
+  for (tile = _tiles.begin(); tile != _tiles.end(); tile++) {
+    tile->max_NN_dist = 0;
+    for (unsigned int a = 0; a < tile->jet.size(); a++) {
+      if (_bj_NN_dist[tile->jet[a]] > tile->max_NN_dist) tile->max_NN_dist = _bj_NN_dist[tile->jet[a]];
+    }
+  }
+
+  vector<double> diJs(n);
+  for (int i = 0; i < n; i++) {
+    diJs[i] = _bj_diJ(i);
+  }
+  MinHeap minheap(diJs);
+  // have a stack telling us which jets we'll have to update on the heap
+  vector<int> jets_for_minheap;
+  jets_for_minheap.reserve(n); 
+
+  // now run the recombination loop
+  while (n > 0) {
+
+    double diJ_min = minheap.minval() *_invR2;
+    int jetA = minheap.minloc();
+    int jetB = _bj_NN[jetA];
+    double oldB_eta = 0, oldB_phi = 0;
+    int oldB_tile_index = 0;
+
+    if (jetB >= 0) {
+      // jet-jet recombination
+      // If necessary relabel A & B to ensure jetB < jetA, that way if
+      // the larger of them == newtail then that ends up being jetA and 
+      // the new jet that is added as jetB is inserted in a position that
+      // has a future!
+      if (jetA < jetB) {std::swap(jetA,jetB);}
+
+      int nn; // new jet index
+      _cs.plugin_record_ij_recombination(_bj_jets_index[jetA], _bj_jets_index[jetB], diJ_min, nn);
+      
+      // what was jetB will now become the new jet
+      _bj_remove_from_tiles(jetA);
+      oldB_eta = _bj_eta[jetB];
+      oldB_phi = _bj_phi[jetB];
+      oldB_tile_index = _bj_tile_index[jetB];
+      _bj_remove_from_tiles(jetB);
+      _tj_set_jetinfo(jetB, nn); // cause jetB to become _jets[nn]
+                                 // (also registers the jet in the tiling)
+    } else {
+      // jet-beam recombination
+      _cs.plugin_record_iB_recombination(_bj_jets_index[jetA], diJ_min);
+      _bj_remove_from_tiles(jetA);
+    }
+
+    // remove the minheap entry for jetA
+    minheap.remove(jetA);
+
+    int n_near_tiles = 0;
+
+    // Initialise jetB's NN distance as well as updating it for other
+    // particles. While doing so, examine whether jetA or old jetB was
+    // some other particle's NN.
+    if (jetB >= 0) {
+      const double etaB = _bj_eta[jetB], phiB = _bj_phi[jetB];
+      const int jetB_tile_index = _bj_tile_index[jetB];
+      Tile & jetB_tile = _tiles[jetB_tile_index];
+      for (int k = 0; k < jetB_tile.end; k++) {
+        Tile & near_tile = _tiles[jetB_tile.neighbours[k]];
+
+    	double dist_to_tile = _distance_to_tile(etaB, phiB, jetB_tile_index, near_tile);
+        // use <= in next line so that on first tile, relevant_for_jetB is 
+        // set to true
+    	bool relevant_for_jetB  = dist_to_tile <= _bj_NN_dist[jetB];
+    	bool relevant_for_near_tile = dist_to_tile <= near_tile.max_NN_dist;
+        bool relevant = relevant_for_jetB || relevant_for_near_tile;
+        if (! relevant) continue;
+        // now label this tile as having been considered (so that we 
+        // don't go over it again later)
+        tile_union[n_near_tiles] = jetB_tile.neighbours[k];
+        near_tile.tagged = true;
+        n_near_tiles++;
+        
+        // if going over the neighbouring tile's jets, check anyway
+        // whether A or B were nearest neighbours
+        const int m = near_tile.jet.size();
+        _tile_distances(near_tile, etaB, phiB, dist);
+        for (int i = 0; i < m; i++) {
+          const int jetI = near_tile.jet[i];
+          if (_bj_NN[jetI] == jetA || _bj_NN[jetI] == jetB) _set_NN(jetI, jets_for_minheap);
+          _update_jetX_jetI_NN(jetB, jetI, dist[i], jets_for_minheap);
+        }
+      }
+    }
+
+    // first establish the set of tiles over which we are going to
+    // have to run searches for updated and new nearest-neighbours --
+    // basically a combination of vicinity of the tiles of the two old
+    // and one new jet.
+    int n_done_tiles = n_near_tiles;
+    _add_untagged_neighbours_to_tile_union_using_max_info(_bj_eta[jetA], _bj_phi[jetA],
+                                   _bj_tile_index[jetA], tile_union, n_near_tiles);
+    if (jetB >= 0) {
+      _add_untagged_neighbours_to_tile_union_using_max_info(oldB_eta, oldB_phi,
+                                   oldB_tile_index, tile_union, n_near_tiles);
+      _bj_minheap_update_needed[jetB] = 1;
+      jets_for_minheap.push_back(jetB);
+    }
+
+    // first untag the tiles we have already dealt with
+    for (int itile = 0; itile < n_done_tiles; itile++) {
+      _tiles[tile_union[itile]].tagged = false;
+    }
+    // now run over the tiles that were tagged earlier and that we haven't yet
+    // had a change to visit.
+    for (int itile = n_done_tiles; itile < n_near_tiles; itile++) {
+      Tile & tile_ref = _tiles[tile_union[itile]];
+      tile_ref.tagged = false;
+      // run over all jets in the current tile
+      const int m = tile_ref.jet.size();
+      for (int i = 0; i < m; i++) {
+        const int jetI = tile_ref.jet[i];
+        // see if jetI had jetA or jetB as a NN -- if so recalculate the NN
+        if (_bj_NN[jetI] == jetA || (jetB >= 0 && _bj_NN[jetI] == jetB)) {
+          _set_NN(jetI, jets_for_minheap);
+        }
+      }
+    }
+
+    // deal with jets whose minheap entry needs updating
+    while (jets_for_minheap.size() > 0) {
+      int jetI = jets_for_minheap.back(); 
+      jets_for_minheap.pop_back();
+      minheap.update(jetI, _bj_diJ(jetI));
+      _bj_minheap_update_needed[jetI] = 0;
+      // handle max_NN_dist update for all jets that might have
+      // seen a change (increase) of distance
+      Tile & tile_I = _tiles[_bj_tile_index[jetI]];
+      if (tile_I.max_NN_dist < _bj_NN_dist[jetI]) tile_I.max_NN_dist = _bj_NN_dist[jetI];
+    }
+    n--;
+  }
+}
+
+FASTJET_END_NAMESPACE
@@ -383,9 +383,10 @@ std::vector<LightLikeAxis> DefaultMeasure::UpdateAxesFast(const std::vector <Lig
                                                           ) const {
    assert(old_axes.size() == N);
    
-   // some storage, declared static to save allocation/re-allocation costs
-   static LightLikeAxis new_axes[N];
-   static fastjet::PseudoJet new_jets[N];
+   // some storage, local to each call so that several threads can
+   // compute N-subjettiness at the same time
+   LightLikeAxis new_axes[N];
+   fastjet::PseudoJet new_jets[N];
    for (int n = 0; n < N; ++n) {
       new_axes[n].reset(0.0,0.0,0.0,0.0);
       new_jets[n].reset_momentum(0.0,0.0,0.0,0.0);
@@ -0,0 +1,152 @@
+#ifndef __FASTJET_LAZYTILING9SOA_HH__
+#define __FASTJET_LAZYTILING9SOA_HH__
+
+//FJSTARTHEADER
+//
+// Copyright (c) 2005-2020, Matteo Cacciari, Gavin P. Salam and Gregory Soyez
+//
+//----------------------------------------------------------------------
+// This file is part of FastJet.
+//
+//  FastJet is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  The algorithms that underlie FastJet have required considerable
+//  development. They are described in the original FastJet paper,
+//  hep-ph/0512210 and in the manual, arXiv:1111.6097. If you use
+//  FastJet as part of work towards a scientific publication, please
+//  quote the version you use and include a citation to the manual and
+//  optionally also to hep-ph/0512210.
+//
+//  FastJet is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with FastJet. If not, see <http://www.gnu.org/licenses/>.
+//----------------------------------------------------------------------
+//FJENDHEADER
+
+#include "fastjet/internal/MinHeap.hh"
+#include "fastjet/ClusterSequence.hh"
+#include "fastjet/internal/LazyTiling9Alt.hh"
+
+#include <vector>
+
+FASTJET_BEGIN_NAMESPACE      // defined in fastjet/internal/base.hh
+
+//----------------------------------------------------------------------
+/// \class LazyTiling9SoA
+/// Same clustering as LazyTiling9 (tiles of size R, 3x3 neighbourhood,
+/// nearest-neighbour distances kept in a MinHeap), with the particles
+/// of each tile stored as contiguous arrays of rapidity and phi rather
+/// than as a linked list of TiledJet objects.
+///
+/// The distances between a particle and all the particles of a tile
+/// are computed in a single branch-free loop over these arrays, which
+/// the compiler turns into SIMD instructions, and the nearest
+/// neighbour is then searched in the resulting array of distances.
+/// Distances are evaluated with the same arithmetic as in
+/// LazyTiling9, so that the clustering sequence is the same.
+class LazyTiling9SoA {
+public:
+  LazyTiling9SoA(ClusterSequence & cs);
+
+  void run();
+
+protected:
+  /// a tile and the particles it contains
+  class Tile {
+  public:
+    /// indices of the neighbouring tiles: self first, then the
+    /// surrounding tiles, the right-hand ones starting at RH_begin
+    int  neighbours[n_tile_neighbours];
+    int  RH_begin, end;
+    /// sometimes useful to be able to tag a tile
+    bool tagged;
+    /// for all particles in the tile, this stores the largest of the
+    /// (squared) nearest-neighbour distances.
+    double max_NN_dist;
+    double eta_centre, phi_centre;
+    /// rapidity, phi and briefjet index of the particles in the tile
+    std::vector<double> eta, phi;
+    std::vector<int>    jet;
+  };
+
+  ClusterSequence & _cs;
+  const std::vector<PseudoJet> & _jets;
+  std::vector<Tile> _tiles;
+
+  double _Rparam, _R2, _invR2;
+  double _tiles_eta_min, _tiles_eta_max;
+  double _tile_size_eta, _tile_size_phi;
+  double _tile_half_size_eta, _tile_half_size_phi;
+  int    _n_tiles_phi,_tiles_ieta_min,_tiles_ieta_max;
+
+  /// per-briefjet information, indexed like the entries of the minheap
+  std::vector<double> _bj_eta, _bj_phi, _bj_kt2, _bj_NN_dist;
+  std::vector<int>    _bj_NN, _bj_jets_index, _bj_tile_index, _bj_tile_position;
+  std::vector<char>   _bj_minheap_update_needed;
+
+  /// scratch arrays for the distances to the particles of a tile
+  std::vector<double> _dist, _dist_NN;
+
+  void _initialise_tiles();
+
+  // reasonably robust return of tile index given ieta and iphi, in particular
+  // it works even if iphi is negative
+  inline int _tile_index (int ieta, int iphi) const {
+    return (ieta-_tiles_ieta_min)*_n_tiles_phi
+                  + (iphi+_n_tiles_phi) % _n_tiles_phi;
+  }
+
+  /// returns the tile index given the eta and phi values of a jet
+  int _tile_index(const double eta, const double phi) const;
+
+  /// sets up the briefjet ibj as _jets[jets_index] and inserts it in
+  /// its tile
+  void _tj_set_jetinfo(const int ibj, const int jets_index);
+
+  void _bj_remove_from_tiles(const int ibj);
+
+  /// distances between (eta, phi) and all the particles of the tile
+  void _tile_distances(const Tile & tile, const double eta, const double phi,
+                       double * dist) const;
+
+  double _distance_to_tile(const double eta, const double phi,
+                           const int tile_index, const Tile & tile) const;
+
+  void _add_untagged_neighbours_to_tile_union_using_max_info(
+                 const double eta, const double phi, const int tile_index,
+                 std::vector<int> & tile_union, int & n_near_tiles);
+
+  void _update_jetX_jetI_NN(const int jetX, const int jetI, const double dist,
+                            std::vector<int> & jets_for_minheap);
+
+  void _set_NN(const int jetI, std::vector<int> & jets_for_minheap);
+
+  void _label_minheap_update_needed(const int ibj,
+                                    std::vector<int> & jets_for_minheap) {
+    if (!_bj_minheap_update_needed[ibj]) {
+      _bj_minheap_update_needed[ibj] = 1;
+      jets_for_minheap.push_back(ibj);
+    }
+  }
+
+  // return the diJ (multiplied by _R2) for this jet assuming its NN
+  // info is correct
+  double _bj_diJ(const int ibj) const {
+    double kt2 = _bj_kt2[ibj];
+    int NN = _bj_NN[ibj];
+    if (NN >= 0) {if (_bj_kt2[NN] < kt2) {kt2 = _bj_kt2[NN];}}
+    return _bj_NN_dist[ibj] * kt2;
+  }
+};
+
+
+FASTJET_END_NAMESPACE
+
+#endif // __FASTJET_LAZYTILING9SOA_HH__
@@ -190,6 +190,9 @@ void SISConePlugin::run_clustering(ClusterSequence & clust_seq) const {
   // set the type of splitting we want (default=std one, true->pt-weighted split)
   siscone->set_pt_weighted_splitting(_use_pt_weighted_splitting);
 
+  // number of threads for the stable-cone search
+  siscone->n_threads = _n_threads;
+
   if (new_siscone) {
     // transfer fastjet initial particles into the siscone type
     std::vector<Cmomentum> siscone_momenta(n);
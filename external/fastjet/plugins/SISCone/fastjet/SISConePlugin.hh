@@ -110,6 +110,7 @@ public:
     _split_merge_stopping_scale = split_merge_stopping_scale_in;
     _ghost_sep_scale       = 0.0;
     _use_pt_weighted_splitting = false;
+    _n_threads = 1;
     _user_scale = 0;}
 
 
@@ -128,6 +129,7 @@ public:
     _split_merge_stopping_scale = 0.0;
     _split_merge_scale     = split_merge_on_transverse_mass_in ? SM_mt : SM_pttilde;
     _ghost_sep_scale       = 0.0;
+    _n_threads = 1;
     _user_scale = 0;}
   
   /// backwards compatible constructor for the SISCone Plugin class
@@ -145,6 +147,7 @@ public:
     _split_merge_stopping_scale = 0.0;
     _ghost_sep_scale       = 0.0;
     _use_pt_weighted_splitting = false;
+    _n_threads = 1;
     _user_scale = 0;}
 
   /// minimum pt for a protojet to be considered in the split-merge step
@@ -175,6 +178,13 @@ public:
   void set_split_merge_use_pt_weighted_splitting(bool val) {
     _use_pt_weighted_splitting = val;}
 
+  /// number of threads used for the stable-cone search (default 1).
+  /// The stable cones, hence the jets, do not depend on it. The
+  /// threaded search does more work than the serial one and only
+  /// pays off from about 4 threads on.
+  int n_threads() const {return _n_threads;}
+  void set_n_threads(int val) {_n_threads = (val > 1) ? val : 1;}
+
   // the things that are required by base class
   virtual std::string description () const;
   virtual void run_clustering(ClusterSequence &) const ;
@@ -188,6 +198,8 @@ private:
 
   bool _use_pt_weighted_splitting;
 
+  int _n_threads;
+
   // part needed for the cache 
   // variables for caching the results and the input
   static SharedPtr<SISConePlugin          > stored_plugin;
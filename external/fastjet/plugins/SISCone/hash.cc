@@ -208,6 +208,57 @@ int hash_cones::insert(Cmomentum *v){
   return 1;
 }
 
+/*
+ * move the candidates of some cells of another hash into this one.
+ *  - _hc          hash to merge
+ *  - _first_cell  first cell of '_hc' to merge
+ *  - _cell_step   step between merged cells
+ * Candidates are prepended to the cells on insertion, so the cells
+ * of '_hc' are reversed to keep the insertion order. As the
+ * number of cells of '_hc' does not exceed ours, the candidates of
+ * one of our cells all come from the same cell of '_hc'.
+ * return the number of cones added
+ ***********************************************************************/
+int hash_cones::merge(hash_cones *_hc, int _first_cell, int _cell_step){
+  int i, index, n_added;
+  hash_element *elm, *src, *next, *first;
+
+  n_added = 0;
+  for (i=_first_cell;i<=_hc->mask;i+=_cell_step){
+    // reverse the cell content to get the candidates in insertion order
+    first = NULL;
+    for (src=_hc->hash_array[i];src!=NULL;src=next){
+      next = src->next;
+      src->next = first;
+      first = src;
+    }
+    _hc->hash_array[i] = NULL;
+
+    for (src=first;src!=NULL;src=next){
+      next = src->next;
+      index = (src->ref.ref[0]) & mask;
+
+      // look for the same cone in our cell
+      elm = hash_array[index];
+      while ((elm!=NULL) && (!(elm->ref == src->ref)))
+	elm = elm->next;
+
+      if (elm==NULL){
+	// new cone: move the element (centre and stability unchanged)
+	src->next = hash_array[index];
+	hash_array[index] = src;
+	n_added++;
+      } else {
+	// known cone: it has to be stable for all the pairs tested
+	elm->is_stable = elm->is_stable && src->is_stable;
+	delete src;
+      }
+    }
+  }
+
+  return n_added;
+}
+
 /*
  * test if a particle is inside a cone of given centre.
  * check if the particle of coordinates 'v' is inside the circle of radius R 
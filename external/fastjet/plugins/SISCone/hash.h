@@ -89,6 +89,24 @@ class hash_cones{
    */
   int insert(Cmomentum *v);
 
+  /**
+   * move the candidates of some cells of another hash into this one.
+   * Candidates are taken in the order they were inserted into '_hc'
+   * so that merging the hashes filled for consecutive parents gives
+   * the same hash as filling it in one go. The stability flags of
+   * candidates present in both are combined.
+   * The cells _first_cell + k*_cell_step of '_hc' are merged. With a
+   * power of two as step, different first cells fill different cells
+   * of this hash and can be merged concurrently; n_cones is therefore
+   * left to the caller.
+   * \param _hc          hash to merge, its number of cells must not
+   *                    exceed the one of this hash
+   * \param _first_cell  first cell of '_hc' to merge
+   * \param _cell_step   step between merged cells
+   * \return the number of cones added to this hash
+   */
+  int merge(hash_cones *_hc, int _first_cell=0, int _cell_step=1);
+
   /// the cone data itself
   hash_element **hash_array;
 
@@ -113,6 +113,10 @@ class Cstable_cones : public Cvicinity{
 
   /// total number of tested cones
   int nb_tot;
+
+  /// number of threads used to enumerate the cone candidates
+  /// (1 = serial search, the default)
+  int n_threads;
 #ifdef DEBUG_STABLE_CONES
   int nb_hash_cones, nb_hash_occupied;
 #endif
@@ -125,6 +129,24 @@ class Cstable_cones : public Cvicinity{
   double R2;
 
  private:
+  /**
+   * enumerate the cone candidates having a parent in a given range.
+   * The candidates are inserted into 'hc'; parents without any
+   * vicinity are directly added to 'protocones'.
+   * \param _p_begin  index of the first parent
+   * \param _p_end    index after the last parent
+   */
+  void enumerate_cones(int _p_begin, int _p_end);
+
+  /**
+   * enumerate the cone candidates on 'n_threads' threads.
+   * The parents are split into contiguous chunks, each searched with
+   * its own hash. The chunks are then merged into 'hc' in parent
+   * order so that the list of stable cones is the same as for the
+   * serial search.
+   */
+  void enumerate_cones_threaded();
+
   /// cone with a given particle as parent
   /// this reduction to a single vector assumes we trust the checksums
   Cmomentum cone;
@@ -224,6 +246,15 @@ class Cstable_cones : public Cvicinity{
    */
   int proceed_with_stability();
 
+  /**
+   * test the stability of the candidates in a range of hash cells
+   * and append the stable ones to a list of cones.
+   * \param _cell_begin  first cell
+   * \param _cell_end    cell after the last one
+   * \param _cones       list of stable cones
+   */
+  void test_hash_stability(int _cell_begin, int _cell_end, std::vector<Cmomentum> &_cones);
+
   /*
    * circle intersection.
    * computes the intersection with a circle of given centre and radius.
@@ -99,8 +99,9 @@ Cvicinity::~Cvicinity(){
  * set the particle_list
  *  - particle_list   list of particles (type Cmomentum)
  *  - n               number of particles in the list
+ *  - _randomize_refs when false, keep the particle references
  ************************************************************/ 
-void Cvicinity::set_particle_list(vector<Cmomentum> &_particle_list){
+void Cvicinity::set_particle_list(vector<Cmomentum> &_particle_list, bool _randomize_refs){
   int i,j;
 #ifdef USE_QUADTREE_FOR_STABILITY_TEST
   double eta_max=0.0;
@@ -136,7 +137,8 @@ void Cvicinity::set_particle_list(vector<Cmomentum> &_particle_list){
       plist[n_part].index = n_part;
 
       // make sure the reference is randomly created
-      plist[n_part].ref.randomize();
+      if (_randomize_refs)
+        plist[n_part].ref.randomize();
 
 #ifdef USE_QUADTREE_FOR_STABILITY_TEST
       if (fabs(plist[n_part].eta)>eta_max) eta_max=fabs(plist[n_part].eta);
@@ -106,8 +106,10 @@ class Cvicinity{
   /**
    * set the particle_list
    * \param _particle_list   list of particles (type Cmomentum)
+   * \param _randomize_refs  when false, the particle references are
+   *                        kept (used to share a list between threads)
    */ 
-  void set_particle_list(std::vector<Cmomentum> &_particle_list);
+  void set_particle_list(std::vector<Cmomentum> &_particle_list, bool _randomize_refs=true);
 
   /**
    * build the vicinity list from the list of points.
@@ -0,0 +1,191 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \class ArrayWriter
+ *
+ *  Stores intermediate candidate arrays in the output tree, so that
+ *  DelphesROOT can restore them instead of running the modules that
+ *  produced them.
+ *
+ */
+
+#include "modules/ArrayWriter.h"
+
+#include "classes/DelphesClasses.h"
+#include "classes/DelphesFactory.h"
+
+#include "ExRootAnalysis/ExRootTreeBranch.h"
+#include "ExRootAnalysis/ExRootTreeWriter.h"
+
+#include "TBranch.h"
+#include "TObjArray.h"
+#include "TString.h"
+#include "TTree.h"
+
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+ArrayWriter::ArrayWriter() :
+  fBranch(0), fParticleInputArray(0), fLinks(0)
+{
+}
+
+//------------------------------------------------------------------------------
+
+ArrayWriter::~ArrayWriter()
+{
+  vector<vector<Int_t> *>::iterator itIndices;
+
+  // the tree keeps the addresses of the vectors until it is written
+
+  if(fLinks) delete fLinks;
+
+  for(itIndices = fIndices.begin(); itIndices != fIndices.end(); ++itIndices)
+  {
+    delete(*itIndices);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void ArrayWriter::Init()
+{
+  ExRootConfParam param = GetParam("InputArray");
+  Long_t i, size = param.GetSize();
+  TString branchName, particleArrayName;
+  TBranch *branch;
+  TTree *tree;
+
+  for(i = 0; i < size; ++i)
+  {
+    fInputArrays.push_back(ImportArray(param[i].GetString()));
+  }
+
+  // generated particles are stored by the tree writer in the Particle branch
+
+  particleArrayName = GetString("ParticleInputArray", "Delphes/allParticles");
+  fParticleInputArray = ImportArray(particleArrayName);
+
+  branchName = GetString("BranchName", "Intermediate");
+
+  fBranch = NewBranch(branchName, Candidate::Class());
+  tree = fTreeWriter->GetTree();
+
+  fLinks = new vector<Int_t>;
+  branch = tree->Branch(branchName + "_links", &fLinks, 64000);
+  branch->SetTitle(particleArrayName);
+
+  fIndices.resize(size, 0);
+  for(i = 0; i < size; ++i)
+  {
+    fIndices[i] = new vector<Int_t>;
+    branch = tree->Branch(Form("%s_array%ld", branchName.Data(), i), &fIndices[i], 64000);
+    branch->SetTitle(param[i].GetString());
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void ArrayWriter::Finish()
+{
+}
+
+//------------------------------------------------------------------------------
+
+Int_t ArrayWriter::GetReference(Candidate *candidate)
+{
+  map<Candidate *, Int_t>::iterator itReferences;
+  Int_t reference;
+
+  itReferences = fReferences.find(candidate);
+  if(itReferences != fReferences.end()) return itReferences->second;
+
+  reference = fCandidates.size();
+  fReferences.insert(make_pair(candidate, reference));
+  fCandidates.push_back(candidate);
+
+  return reference;
+}
+
+//------------------------------------------------------------------------------
+
+void ArrayWriter::Process()
+{
+  Candidate *candidate, *constituent, *entry;
+  TObjArray *array;
+  Int_t i, size;
+  size_t k;
+
+  fReferences.clear();
+  fCandidates.clear();
+
+  size = fParticleInputArray->GetEntriesFast();
+  for(i = 0; i < size; ++i)
+  {
+    candidate = static_cast<Candidate *>(fParticleInputArray->At(i));
+    fReferences.insert(make_pair(candidate, -1 - i));
+  }
+
+  for(k = 0; k < fInputArrays.size(); ++k)
+  {
+    fIndices[k]->clear();
+
+    TIter itInputArray(fInputArrays[k]);
+    while((candidate = static_cast<Candidate *>(itInputArray.Next())))
+    {
+      fIndices[k]->push_back(GetReference(candidate));
+    }
+  }
+
+  // the first element is the number of stored candidates, it tells DelphesROOT
+  // whether the links belong to the candidates of the current entry, the second
+  // one is checked against the size of the Particle branch
+
+  fLinks->clear();
+  fLinks->push_back(0);
+  fLinks->push_back(fParticleInputArray->GetEntriesFast());
+
+  // the list of stored candidates grows while their constituents are visited
+
+  for(k = 0; k < fCandidates.size(); ++k)
+  {
+    candidate = fCandidates[k];
+    array = candidate->GetCandidates();
+
+    fLinks->push_back(array->GetEntriesFast());
+
+    TIter itArray(array);
+    while((constituent = static_cast<Candidate *>(itArray.Next())))
+    {
+      fLinks->push_back(GetReference(constituent));
+    }
+
+    entry = static_cast<Candidate *>(fBranch->NewEntry());
+    entry->Clear();
+    candidate->Copy(*entry);
+  }
+
+  (*fLinks)[0] = fCandidates.size();
+}
+
+//------------------------------------------------------------------------------
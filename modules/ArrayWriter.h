@@ -0,0 +1,84 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ArrayWriter_h
+#define ArrayWriter_h
+
+/** \class ArrayWriter
+ *
+ *  Stores intermediate candidate arrays in the output tree, so that
+ *  DelphesROOT can restore them instead of running the modules that
+ *  produced them.
+ *
+ *  The candidates reachable from the input arrays are written once to
+ *  the branch BranchName, generated particles of ParticleInputArray
+ *  (Delphes/allParticles by default) excepted, since DelphesROOT rebuilds
+ *  them from the Particle branch. ParticleInputArray must therefore be the
+ *  array written by the TreeWriter in the Particle branch, for instance
+ *  GenParticleFilter/filteredParticles in the cards that filter them.
+ *
+ *  Candidates are referenced by their position in BranchName, or by
+ *  -1 - their position in ParticleInputArray. The branch BranchName_links,
+ *  whose title is the name of ParticleInputArray, holds the number of
+ *  stored candidates and the number of particles in ParticleInputArray,
+ *  then, for each stored candidate, the number of its constituents followed
+ *  by their references. The branch BranchName_array<i> holds the references
+ *  of the candidates of the i-th input array, whose name is the title of
+ *  the branch.
+ *
+ */
+
+#include "classes/DelphesModule.h"
+
+#include <map>
+#include <vector>
+
+class TObjArray;
+
+class Candidate;
+class ExRootTreeBranch;
+
+class ArrayWriter: public DelphesModule
+{
+public:
+  ArrayWriter();
+  ~ArrayWriter();
+
+  void Init();
+  void Process();
+  void Finish();
+
+private:
+  Int_t GetReference(Candidate *candidate);
+
+  ExRootTreeBranch *fBranch; //!
+
+  std::vector<TObjArray *> fInputArrays; //!
+
+  TObjArray *fParticleInputArray; //!
+
+  std::map<Candidate *, Int_t> fReferences; //!
+  std::vector<Candidate *> fCandidates; //!
+
+  std::vector<Int_t> *fLinks; //!
+  std::vector<std::vector<Int_t> *> fIndices; //!
+
+  ClassDef(ArrayWriter, 1)
+};
+
+#endif
@@ -143,7 +143,9 @@ void BTagging::Process()
     }
     formula = itEfficiencyMap->second;
 
-    // apply an efficiency formula
+    // apply an efficiency formula, the bit is overwritten since
+    // the jet may have been tagged before by another chain sharing it
+    jet->BTag &= ~(1U << fBitNumber);
     jet->BTag |= (gRandom->Uniform() <= formula->Eval(pt, eta, phi, e)) << fBitNumber;
 
     // find an efficiency formula for algo flavor definition
@@ -155,6 +157,7 @@ void BTagging::Process()
     formula = itEfficiencyMap->second;
 
     // apply an efficiency formula
+    jet->BTagAlgo &= ~(1U << fBitNumber);
     jet->BTagAlgo |= (gRandom->Uniform() <= formula->Eval(pt, eta, phi, e)) << fBitNumber;
 
     // find an efficiency formula for phys flavor definition
@@ -166,6 +169,7 @@ void BTagging::Process()
     formula = itEfficiencyMap->second;
 
     // apply an efficiency formula
+    jet->BTagPhys &= ~(1U << fBitNumber);
     jet->BTagPhys |= (gRandom->Uniform() <= formula->Eval(pt, eta, phi, e)) << fBitNumber;
   }
 }
@@ -35,8 +35,10 @@
 #include "ExRootAnalysis/ExRootConfReader.h"
 #include "ExRootAnalysis/ExRootFilter.h"
 #include "ExRootAnalysis/ExRootResult.h"
+#include "ExRootAnalysis/ExRootTreeBranch.h"
 #include "ExRootAnalysis/ExRootTreeWriter.h"
 
+#include "TClass.h"
 #include "TDatabasePDG.h"
 #include "TFolder.h"
 #include "TFormula.h"
@@ -48,6 +50,7 @@
 #include "TString.h"
 
 #include <algorithm>
+#include <iomanip>
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
@@ -57,8 +60,33 @@
 
 using namespace std;
 
+//------------------------------------------------------------------------------
+
+// the tree writing modules are skipped without tree writer and never shared
+
+static Bool_t IsTreeWriter(TClass *cl)
+{
+  return cl && (cl->InheritsFrom("TreeWriter") || cl->InheritsFrom("ArrayWriter"));
+}
+
+//------------------------------------------------------------------------------
+
+static void AddArrays(TFolder *folder, vector<TObjArray *> &arrays)
+{
+  TIter itObjects(folder->GetListOfFolders());
+  TObject *object;
+
+  while((object = itObjects()))
+  {
+    if(object->InheritsFrom(TObjArray::Class())) arrays.push_back(static_cast<TObjArray *>(object));
+  }
+}
+
+//------------------------------------------------------------------------------
+
 Delphes::Delphes(const char *name) :
-  fFactory(0)
+  fFactory(0), fEventAccepted(kTRUE), fWriteRejectedEvents(kFALSE),
+  fSource(0), fSharedModules(0), fCheckpoint(0), fRejectingModule(-1), fRejectionBranch(0), fModuleTiming(kFALSE)
 {
   TFolder *folder;
 
@@ -106,6 +134,93 @@ void Delphes::SetTreeWriter(ExRootTreeWriter *treeWriter)
 
 //------------------------------------------------------------------------------
 
+void Delphes::SetSource(Delphes *source)
+{
+  fSource = source;
+}
+
+//------------------------------------------------------------------------------
+
+TObjArray *Delphes::RestoreArray(const char *name)
+{
+  stringstream message;
+  TFolder *exportFolder, *folder;
+  TObjArray *array;
+  TString path(name);
+  Ssiz_t pos = path.Last('/');
+
+  if(pos <= 0 || pos == path.Length() - 1)
+  {
+    message << "can't restore array '" << name << "', expected 'Module/array'";
+    throw runtime_error(message.str());
+  }
+
+  TString moduleName(path(0, pos));
+  TString arrayName(path(pos + 1, path.Length() - pos - 1));
+
+  exportFolder = static_cast<TFolder *>(GetObject("Export", TFolder::Class()));
+  if(!exportFolder) exportFolder = GetFolder()->AddFolder("Export", "");
+
+  folder = static_cast<TFolder *>(exportFolder->FindObject(moduleName));
+  if(!folder) folder = exportFolder->AddFolder(moduleName, "");
+
+  array = fFactory->NewPermanentArray();
+  array->SetName(arrayName);
+  folder->Add(array);
+
+  fRestoredModules.insert(moduleName);
+
+  return array;
+}
+
+//------------------------------------------------------------------------------
+
+Int_t Delphes::GetNumberOfSharedModules(Delphes *source)
+{
+  ExRootConfReader *confReader = GetConfReader();
+  ExRootConfReader *sourceConfReader = source ? source->GetConfReader() : 0;
+
+  TString name;
+  TClass *cl;
+  const ExRootConfReader::ExRootTaskMap *modules, *sourceModules;
+  ExRootConfReader::ExRootTaskMap::const_iterator itModules, itSourceModules;
+
+  if(!confReader || !sourceConfReader) return 0;
+
+  // the shared modules must draw the same random numbers
+
+  if(confReader->GetInt("::RandomSeed", 0) != sourceConfReader->GetInt("::RandomSeed", 0)) return 0;
+
+  modules = confReader->GetModules();
+  sourceModules = sourceConfReader->GetModules();
+
+  ExRootConfParam param = confReader->GetParam("::ExecutionPath");
+  ExRootConfParam sourceParam = sourceConfReader->GetParam("::ExecutionPath");
+  Long_t i, size = min(param.GetSize(), sourceParam.GetSize());
+
+  for(i = 0; i < size; ++i)
+  {
+    name = param[i].GetString();
+    if(name != sourceParam[i].GetString()) break;
+
+    itModules = modules->find(name);
+    itSourceModules = sourceModules->find(name);
+    if(itModules == modules->end() || itSourceModules == sourceModules->end()) break;
+    if(itModules->second != itSourceModules->second) break;
+
+    // each chain writes its own output tree
+
+    cl = gROOT->GetClass(itModules->second);
+    if(!cl || IsTreeWriter(cl)) break;
+
+    if(confReader->GetModuleParameters(name) != sourceConfReader->GetModuleParameters(name)) break;
+  }
+
+  return i;
+}
+
+//------------------------------------------------------------------------------
+
 void Delphes::Init()
 {
   stringstream message;
@@ -115,6 +230,12 @@ void Delphes::Init()
 
   TString name;
   ExRootTask *task;
+  TClass *cl;
+  TObject *object;
+  TFolder *exportFolder, *sourceFolder;
+  Delphes *executor;
+  vector<TObjArray *> arrays;
+  Bool_t hasTreeWriter;
   const ExRootConfReader::ExRootTaskMap *modules = confReader->GetModules();
   ExRootConfReader::ExRootTaskMap::const_iterator itModules;
 
@@ -123,12 +244,103 @@ void Delphes::Init()
 
   gRandom->SetSeed(confReader->GetInt("::RandomSeed", 0));
 
-  for(i = 0; i < size; ++i)
+  // switch to write events rejected by an event filter,
+  // the modules following the filter are not executed for these events
+
+  fWriteRejectedEvents = confReader->GetBool("::WriteRejectedEvents", false);
+
+  // switch to measure the processing time of each module
+
+  fModuleTiming = fModuleTiming || confReader->GetBool("::ModuleTiming", false);
+
+  // without tree writer (in-process sessions), the tree writing modules are skipped
+
+  hasTreeWriter = GetFolder()->FindObject("TreeWriter") != 0;
+
+  // the written events are flagged with the position in the execution path
+  // of the module that rejected them, -1 for the accepted events
+
+  fRejectionBranch = 0;
+  if(fWriteRejectedEvents && hasTreeWriter)
+  {
+    fRejectionBranch = NewBranch("Rejection", Rejection::Class());
+  }
+
+  // the shared modules are not created, their export folders and the input
+  // arrays of the source chain are linked into the export folder of this chain
+
+  fSharedModules = 0;
+  if(fSource)
+  {
+    fSharedModules = GetNumberOfSharedModules(fSource);
+
+    exportFolder = static_cast<TFolder *>(GetObject("Export", TFolder::Class()));
+    if(!exportFolder) exportFolder = GetFolder()->AddFolder("Export", "");
+
+    sourceFolder = static_cast<TFolder *>(fSource->GetObject("Export", TFolder::Class()));
+    if(sourceFolder)
+    {
+      object = sourceFolder->FindObject(fSource->GetName());
+      if(object && !exportFolder->FindObject(fSource->GetName())) exportFolder->Add(object);
+      if(object && object->InheritsFrom(TFolder::Class())) AddArrays(static_cast<TFolder *>(object), arrays);
+
+      for(i = 0; i < fSharedModules; ++i)
+      {
+        object = sourceFolder->FindObject(param[i].GetString());
+        if(!object) continue;
+        exportFolder->Add(object);
+        if(object->InheritsFrom(TFolder::Class())) AddArrays(static_cast<TFolder *>(object), arrays);
+      }
+    }
+
+    // the state of the shared candidates is saved by the chain
+    // that runs the last shared module, or by the first chain
+
+    executor = fSource;
+    while(executor->fSource && fSharedModules <= executor->fSharedModules) executor = executor->fSource;
+    fCheckpoint = executor->AddCheckpoint(fSharedModules, arrays);
+
+    for(i = 0; i < fSharedModules; ++i)
+    {
+      cout << left;
+      cout << setw(30) << "** INFO: sharing module";
+      cout << setw(25) << param[i].GetString() << endl;
+    }
+  }
+
+  // the modules whose arrays are restored from a previous run are not created,
+  // nor the modules preceding them
+
+  if(!fRestoredModules.empty())
+  {
+    for(i = 0; i < size; ++i)
+    {
+      if(fRestoredModules.count(param[i].GetString()) && i + 1 > fSharedModules) fSharedModules = i + 1;
+    }
+
+    for(i = 0; i < fSharedModules; ++i)
+    {
+      cout << left;
+      cout << setw(30) << "** INFO: restored module";
+      cout << setw(25) << param[i].GetString() << endl;
+    }
+  }
+
+  for(i = fSharedModules; i < size; ++i)
   {
     name = param[i].GetString();
     itModules = modules->find(name);
     if(itModules != modules->end())
     {
+      cl = gROOT->GetClass(itModules->second);
+      if(!hasTreeWriter && IsTreeWriter(cl))
+      {
+        cout << left;
+        cout << setw(30) << "** INFO: no tree writer, skipping";
+        cout << setw(25) << itModules->first << endl;
+        continue;
+      }
+
       task = NewTask(itModules->second, itModules->first);
       if(task)
       {
@@ -143,6 +355,175 @@ void Delphes::Init()
       throw runtime_error(message.str());
     }
   }
+
+  fModuleStopWatches.resize(GetListOfTasks()->GetSize());
+  for(i = 0; i < GetNumberOfModules(); ++i)
+  {
+    fModuleStopWatches[i].Reset();
+  }
+}
+
+//------------------------------------------------------------------------------
+
+const char *Delphes::GetModuleName(Int_t i) const
+{
+  TObject *task = GetListOfTasks()->At(i);
+  return task ? task->GetName() : "";
+}
+
+//------------------------------------------------------------------------------
+
+Double_t Delphes::GetModuleTime(Int_t i)
+{
+  return fModuleStopWatches[i].RealTime();
+}
+
+//------------------------------------------------------------------------------
+
+void Delphes::ProcessTask()
+{
+  Rejection *rejection;
+
+  ProcessModules();
+
+  if(fRejectionBranch)
+  {
+    rejection = static_cast<Rejection *>(fRejectionBranch->NewEntry());
+    rejection->Module = fRejectingModule;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void Delphes::ProcessModules()
+{
+  TIter itTasks(GetListOfTasks());
+  TTask *task;
+  DelphesModule *module;
+  map<Int_t, TCheckpoint>::iterator itCheckpoints = fCheckpoints.begin();
+  Int_t i = -1;
+
+  // run the modules one by one and stop as soon as one of them rejects the event
+
+  fEventAccepted = kTRUE;
+  fRejectingModule = -1;
+
+  // the event is rejected if the source chain rejected it in a shared module
+
+  if(fSource && fSource->fRejectingModule >= 0 && fSource->fRejectingModule < fSharedModules)
+  {
+    fEventAccepted = kFALSE;
+    fRejectingModule = fSource->fRejectingModule;
+    return;
+  }
+
+  // the shared candidates may have been modified by the chains processed before
+
+  if(fCheckpoint) RestoreCheckpoint(*fCheckpoint);
+
+  while((task = static_cast<TTask *>(itTasks())))
+  {
+    ++i;
+
+    for(; itCheckpoints != fCheckpoints.end() && itCheckpoints->first <= fSharedModules + i; ++itCheckpoints)
+    {
+      SaveCheckpoint(itCheckpoints->second);
+    }
+
+    if(!task->IsActive()) continue;
+
+    module = static_cast<DelphesModule *>(task);
+    if(fModuleTiming)
+    {
+      fModuleStopWatches[i].Start(kFALSE);
+      module->ProcessTask();
+      fModuleStopWatches[i].Stop();
+    }
+    else
+    {
+      module->ProcessTask();
+    }
+
+    if(module->IsEventRejected())
+    {
+      fEventAccepted = kFALSE;
+      fRejectingModule = fSharedModules + i;
+      return;
+    }
+  }
+
+  for(; itCheckpoints != fCheckpoints.end(); ++itCheckpoints)
+  {
+    SaveCheckpoint(itCheckpoints->second);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+Delphes::TCheckpoint *Delphes::AddCheckpoint(Int_t position, const vector<TObjArray *> &arrays)
+{
+  TCheckpoint &checkpoint = fCheckpoints[position];
+  if(checkpoint.arrays.empty()) checkpoint.arrays = arrays;
+  return &checkpoint;
+}
+
+//------------------------------------------------------------------------------
+
+void Delphes::SaveCheckpoint(TCheckpoint &checkpoint)
+{
+  set<TObject *> saved;
+  TObjArray *array, *contents;
+  TObject *object;
+  Candidate *candidate, *copy;
+  size_t i;
+  Int_t j;
+
+  // the order of the arrays and the content of the candidates are saved,
+  // the copies are cleared with the other objects of this chain, the other
+  // objects, such as the density map of ParticleDensity, are only written
+  // by the module that exports them
+
+  checkpoint.contents.clear();
+  checkpoint.candidates.clear();
+
+  for(i = 0; i < checkpoint.arrays.size(); ++i)
+  {
+    array = checkpoint.arrays[i];
+    contents = fFactory->NewArray();
+    contents->AddAll(array);
+    checkpoint.contents.push_back(contents);
+
+    for(j = 0; j < array->GetEntriesFast(); ++j)
+    {
+      object = array->UncheckedAt(j);
+      if(!object || !object->InheritsFrom(Candidate::Class()) || !saved.insert(object).second) continue;
+      candidate = static_cast<Candidate *>(object);
+      copy = fFactory->New<Candidate>();
+      candidate->Copy(*copy);
+      checkpoint.candidates.push_back(make_pair(candidate, copy));
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void Delphes::RestoreCheckpoint(const TCheckpoint &checkpoint)
+{
+  Candidate *candidate;
+  size_t i;
+
+  for(i = 0; i < checkpoint.contents.size(); ++i)
+  {
+    checkpoint.arrays[i]->Clear();
+    checkpoint.arrays[i]->AddAll(checkpoint.contents[i]);
+  }
+
+  for(i = 0; i < checkpoint.candidates.size(); ++i)
+  {
+    candidate = checkpoint.candidates[i].first;
+    candidate->ECalEnergyTimePairs.clear();
+    checkpoint.candidates[i].second->Copy(*candidate);
+  }
 }
 
 //------------------------------------------------------------------------------
@@ -155,6 +536,33 @@ void Delphes::Process()
 
 void Delphes::Finish()
 {
+  Int_t i;
+  Double_t time, total = 0.0;
+  ios_base::fmtflags flags;
+  streamsize precision;
+
+  if(!fModuleTiming) return;
+
+  for(i = 0; i < GetNumberOfModules(); ++i)
+  {
+    total += GetModuleTime(i);
+  }
+
+  // the output format of cout is restored after the summary
+
+  flags = cout.flags();
+  precision = cout.precision();
+
+  cout << "** INFO: processing time per module" << endl;
+  for(i = 0; i < GetNumberOfModules(); ++i)
+  {
+    time = GetModuleTime(i);
+    cout << left << "** " << setw(40) << GetModuleName(i);
+    cout << right << fixed << setprecision(3) << setw(12) << time << " s";
+    cout << setprecision(1) << setw(8) << (total > 0.0 ? 100.0 * time / total : 0.0) << " %" << endl;
+  }
+  cout.flags(flags);
+  cout.precision(precision);
 }
 
 //------------------------------------------------------------------------------
@@ -30,10 +30,20 @@
 
 #include "classes/DelphesModule.h"
 
+#include "TStopwatch.h"
+
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
 class TFolder;
 class TObjArray;
 
+class Candidate;
+
 class ExRootTreeWriter;
+class ExRootTreeBranch;
 
 class DelphesFactory;
 
@@ -47,15 +57,76 @@ public:
 
   DelphesFactory *GetFactory() const { return fFactory; }
 
+  Bool_t IsEventAccepted() const { return fEventAccepted; }
+  Bool_t IsEventWritable() const { return fEventAccepted || fWriteRejectedEvents; }
+  Int_t GetRejectingModule() const { return fRejectingModule; }
+
   void Clear();
 
+  // reuse the input arrays and the leading modules of a chain initialised
+  // and processed before this one, the modules are shared when they have
+  // the same name, class and parameters and precede any tree writer,
+  // each chain must be processed and written before the next one since
+  // the shared candidates are restored to their state at the end of the
+  // shared modules before the other modules of a chain are run
+  Int_t GetNumberOfSharedModules(Delphes *source);
+  void SetSource(Delphes *source);
+
+  // export an array read back from a previous run on behalf of the module
+  // named in "Module/array", this module and the ones preceding it in the
+  // execution path are not run
+  TObjArray *RestoreArray(const char *name);
+
+  // accumulate the processing time of each module in the execution path
+  void SetModuleTiming(Bool_t flag) { fModuleTiming = flag; }
+  Int_t GetNumberOfModules() const { return fModuleStopWatches.size(); }
+  const char *GetModuleName(Int_t i) const;
+  Double_t GetModuleTime(Int_t i);
+
+  virtual void ProcessTask();
+
   virtual void Init();
   virtual void Process();
   virtual void Finish();
 
 private:
+  struct TCheckpoint
+  {
+    std::vector<TObjArray *> arrays, contents;
+    std::vector<std::pair<Candidate *, Candidate *> > candidates;
+  };
+
+  TCheckpoint *AddCheckpoint(Int_t position, const std::vector<TObjArray *> &arrays);
+  void SaveCheckpoint(TCheckpoint &checkpoint);
+  void RestoreCheckpoint(const TCheckpoint &checkpoint);
+
+  void ProcessModules();
+
   DelphesFactory *fFactory;
 
+  Bool_t fEventAccepted;
+  Bool_t fWriteRejectedEvents;
+
+  Delphes *fSource;
+  Int_t fSharedModules;
+
+  // state of the shared candidates, saved before the module at the given
+  // position in the execution path for the chains sharing the preceding ones
+  std::map<Int_t, TCheckpoint> fCheckpoints; //!
+  TCheckpoint *fCheckpoint; //!
+
+  std::set<TString> fRestoredModules;
+
+  // position in the execution path of the module that rejected the event
+  Int_t fRejectingModule;
+
+  // with ::WriteRejectedEvents, the position of the rejecting module
+  // is written for each event in the Rejection branch
+  ExRootTreeBranch *fRejectionBranch; //!
+
+  Bool_t fModuleTiming;
+  std::vector<TStopwatch> fModuleStopWatches; //!
+
   ClassDef(Delphes, 1)
 };
 
@@ -0,0 +1,273 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \class DelphesSession
+ *
+ *  In-process simulation session.
+ *
+ */
+
+#include "modules/DelphesSession.h"
+
+#include "classes/DelphesClasses.h"
+#include "classes/DelphesFactory.h"
+#include "modules/Delphes.h"
+
+#include "ExRootAnalysis/ExRootConfReader.h"
+
+#include "TDatabasePDG.h"
+#include "TLorentzVector.h"
+#include "TMath.h"
+#include "TObjArray.h"
+#include "TParticlePDG.h"
+
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+DelphesSession::DelphesSession(const char *cardFile) :
+  fConfReader(0), fDelphes(0), fFactory(0),
+  fAllParticleOutputArray(0), fStableParticleOutputArray(0), fPartonOutputArray(0),
+  fEventDone(kTRUE), fNumberOfEvents(0)
+{
+  fConfReader = new ExRootConfReader;
+  fConfReader->ReadFile(cardFile);
+
+  fDelphes = new Delphes("Delphes");
+  fDelphes->SetConfReader(fConfReader);
+
+  fFactory = fDelphes->GetFactory();
+
+  fAllParticleOutputArray = fDelphes->ExportArray("allParticles");
+  fStableParticleOutputArray = fDelphes->ExportArray("stableParticles");
+  fPartonOutputArray = fDelphes->ExportArray("partons");
+
+  fDelphes->InitTask();
+}
+
+//------------------------------------------------------------------------------
+
+DelphesSession::~DelphesSession()
+{
+  fDelphes->FinishTask();
+
+  delete fDelphes;
+  delete fConfReader;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesSession::NewEvent()
+{
+  fDelphes->Clear();
+  fEventDone = kFALSE;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesSession::AddParticle(const TInputParticle &particle, Int_t offset)
+{
+  Candidate *candidate;
+  TParticlePDG *pdgParticle;
+  Int_t pdgCode;
+
+  candidate = fFactory->NewCandidate();
+
+  candidate->PID = particle.PID;
+  pdgCode = TMath::Abs(candidate->PID);
+
+  candidate->Status = particle.Status;
+
+  candidate->M1 = particle.M1 >= 0 ? particle.M1 + offset : -1;
+  candidate->M2 = particle.M2 >= 0 ? particle.M2 + offset : -1;
+
+  candidate->D1 = particle.D1 >= 0 ? particle.D1 + offset : -1;
+  candidate->D2 = particle.D2 >= 0 ? particle.D2 + offset : -1;
+
+  pdgParticle = TDatabasePDG::Instance()->GetParticle(particle.PID);
+  candidate->Charge = pdgParticle ? Int_t(pdgParticle->Charge() / 3.0) : -999;
+  candidate->Mass = particle.Mass;
+
+  candidate->Momentum.SetPxPyPzE(particle.Px, particle.Py, particle.Pz, particle.E);
+
+  candidate->Position.SetXYZT(particle.X, particle.Y, particle.Z, particle.T);
+
+  fAllParticleOutputArray->Add(candidate);
+
+  if(!pdgParticle) return;
+
+  if(particle.Status == 1)
+  {
+    fStableParticleOutputArray->Add(candidate);
+  }
+  else if(pdgCode <= 5 || pdgCode == 21 || pdgCode == 15)
+  {
+    fPartonOutputArray->Add(candidate);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesSession::AddParticles(const TInputParticle *particles, Int_t size)
+{
+  Int_t i, offset;
+
+  if(fEventDone) NewEvent();
+
+  offset = fAllParticleOutputArray->GetEntriesFast();
+
+  for(i = 0; i < size; ++i)
+  {
+    AddParticle(particles[i], offset);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesSession::AddParticles(Int_t size, const Int_t *pid, const Int_t *status,
+  const Double_t *px, const Double_t *py, const Double_t *pz, const Double_t *e, const Double_t *mass)
+{
+  TInputParticle particle;
+  Int_t i;
+
+  if(fEventDone) NewEvent();
+
+  particle.M1 = particle.M2 = particle.D1 = particle.D2 = -1;
+  particle.X = particle.Y = particle.Z = particle.T = 0.0;
+
+  for(i = 0; i < size; ++i)
+  {
+    particle.PID = pid[i];
+    particle.Status = status[i];
+    particle.Px = px[i];
+    particle.Py = py[i];
+    particle.Pz = pz[i];
+    particle.E = e[i];
+    particle.Mass = mass[i];
+
+    AddParticle(particle, 0);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+Bool_t DelphesSession::ProcessEvent()
+{
+  // an event without any particle is processed as an empty event
+  if(fEventDone) NewEvent();
+
+  fDelphes->ProcessTask();
+
+  fEventDone = kTRUE;
+  ++fNumberOfEvents;
+
+  return fDelphes->IsEventAccepted();
+}
+
+//------------------------------------------------------------------------------
+
+const TObjArray *DelphesSession::GetArray(const char *name)
+{
+  map<string, TObjArray *>::iterator itArrays;
+  TObjArray *array;
+
+  itArrays = fArrays.find(name);
+  if(itArrays != fArrays.end()) return itArrays->second;
+
+  // throws if the array is not exported by any module
+  array = fDelphes->ImportArray(name);
+  fArrays[name] = array;
+
+  return array;
+}
+
+//------------------------------------------------------------------------------
+
+Int_t DelphesSession::GetSize(const char *name)
+{
+  return GetArray(name)->GetEntriesFast();
+}
+
+//------------------------------------------------------------------------------
+
+const Candidate *DelphesSession::GetCandidate(const char *name, Int_t i)
+{
+  const TObjArray *array = GetArray(name);
+  stringstream message;
+
+  if(i < 0 || i >= array->GetEntriesFast())
+  {
+    message << "index " << i << " out of range for array '" << name << "'";
+    throw runtime_error(message.str());
+  }
+
+  return static_cast<const Candidate *>(array->UncheckedAt(i));
+}
+
+//------------------------------------------------------------------------------
+
+Int_t DelphesSession::GetObjects(const char *name, vector<TOutputObject> &objects)
+{
+  const Double_t c_light = 2.99792458E8;
+
+  const TObjArray *array = GetArray(name);
+  const Candidate *candidate;
+  TOutputObject *object;
+  Double_t cosTheta, signPz;
+  Int_t i, size;
+
+  size = array->GetEntriesFast();
+  objects.resize(size);
+
+  for(i = 0; i < size; ++i)
+  {
+    candidate = static_cast<const Candidate *>(array->UncheckedAt(i));
+    object = &objects[i];
+
+    const TLorentzVector &momentum = candidate->Momentum;
+
+    cosTheta = TMath::Abs(momentum.CosTheta());
+    signPz = (momentum.Pz() >= 0.0) ? 1.0 : -1.0;
+
+    object->PT = momentum.Pt();
+    object->Eta = (cosTheta == 1.0 ? signPz * 999.9 : momentum.Eta());
+    object->Phi = momentum.Phi();
+    object->Mass = momentum.M();
+    object->E = momentum.E();
+
+    object->PID = candidate->PID;
+    object->Charge = candidate->Charge;
+
+    object->BTag = candidate->BTag;
+    object->TauTag = candidate->TauTag;
+
+    object->IsolationVar = candidate->IsolationVar;
+
+    object->D0 = candidate->D0;
+    object->DZ = candidate->DZ;
+
+    object->T = candidate->Position.T() * 1.0E-3 / c_light;
+  }
+
+  return size;
+}
+
+//------------------------------------------------------------------------------
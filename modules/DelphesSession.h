@@ -0,0 +1,117 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DelphesSession_h
+#define DelphesSession_h
+
+/** \class DelphesSession
+ *
+ *  In-process simulation session.
+ *
+ *  Builds the execution path of a card once and runs it on generator
+ *  particles given as plain arrays. The reconstructed objects are read
+ *  back from the arrays exported by the modules, either as plain
+ *  structures or directly as candidates. No tree writer is created and
+ *  the TreeWriter modules of the card are skipped, all the other state
+ *  is kept from one event to the next.
+ *
+ */
+
+#include "Rtypes.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+class TObjArray;
+
+class Candidate;
+class Delphes;
+class DelphesFactory;
+class ExRootConfReader;
+
+class DelphesSession
+{
+public:
+  // generator particle, mother and daughter indices refer to
+  // the particles of the same event (-1 if none)
+  struct TInputParticle
+  {
+    Int_t PID;
+    Int_t Status;
+    Int_t M1, M2, D1, D2;
+    Double_t Px, Py, Pz, E, Mass;
+    Double_t X, Y, Z, T;
+  };
+
+  // reconstructed object, kinematics of the candidate momentum
+  struct TOutputObject
+  {
+    Float_t PT, Eta, Phi, Mass, E;
+    Int_t PID;
+    Int_t Charge;
+    UInt_t BTag;
+    UInt_t TauTag;
+    Float_t IsolationVar;
+    Float_t D0, DZ;
+    Float_t T;
+  };
+
+  DelphesSession(const char *cardFile);
+  ~DelphesSession();
+
+  // add particles to the next event, the results of
+  // the previous event are cleared by the first call
+  void AddParticles(const TInputParticle *particles, Int_t size);
+  void AddParticles(Int_t size, const Int_t *pid, const Int_t *status,
+    const Double_t *px, const Double_t *py, const Double_t *pz, const Double_t *e, const Double_t *mass);
+
+  // run the execution path on the particles added since the last call,
+  // returns false if the event was rejected by an event filter
+  Bool_t ProcessEvent();
+
+  // results of the last event, valid until the next call to AddParticles;
+  // array names are given as in the cards, e.g. "UniqueObjectFinder/jets"
+  const TObjArray *GetArray(const char *name);
+  Int_t GetSize(const char *name);
+  const Candidate *GetCandidate(const char *name, Int_t i);
+  Int_t GetObjects(const char *name, std::vector<TOutputObject> &objects);
+
+  Long64_t GetNumberOfEvents() const { return fNumberOfEvents; }
+
+  Delphes *GetDelphes() const { return fDelphes; }
+
+private:
+  void NewEvent();
+  void AddParticle(const TInputParticle &particle, Int_t offset);
+
+  ExRootConfReader *fConfReader;
+  Delphes *fDelphes;
+  DelphesFactory *fFactory;
+
+  TObjArray *fAllParticleOutputArray;
+  TObjArray *fStableParticleOutputArray;
+  TObjArray *fPartonOutputArray;
+
+  std::map<std::string, TObjArray *> fArrays;
+
+  Bool_t fEventDone;
+  Long64_t fNumberOfEvents;
+};
+
+#endif /* DelphesSession_h */
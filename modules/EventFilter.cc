@@ -0,0 +1,176 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \class EventFilter
+ *
+ *  Rejects events that do not contain enough candidates passing
+ *  the selection formula in each of the input arrays.
+ *  The modules following a rejected event filter are not executed.
+ *
+ */
+
+#include "modules/EventFilter.h"
+
+#include "classes/DelphesClasses.h"
+#include "classes/DelphesFactory.h"
+#include "classes/DelphesFormula.h"
+
+#include "TLorentzVector.h"
+#include "TObjArray.h"
+#include "TString.h"
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+EventFilter::EventFilter() :
+  fProcessed(0)
+{
+}
+
+//------------------------------------------------------------------------------
+
+EventFilter::~EventFilter()
+{
+}
+
+//------------------------------------------------------------------------------
+
+void EventFilter::Init()
+{
+  // read selections, each selection is defined by
+  // input array, minimum number of candidates and selection formula
+
+  ExRootConfParam param = GetParam("Selection");
+  Long_t i, size;
+  const TObjArray *array;
+  DelphesFormula *formula;
+  stringstream message;
+
+  size = param.GetSize();
+  if(size == 0 || size % 3 != 0)
+  {
+    message << "module '" << GetName();
+    message << "' requires selections defined as 'InputArray MinCount Formula'";
+    throw runtime_error(message.str());
+  }
+
+  for(i = 0; i < size / 3; ++i)
+  {
+    array = ImportArray(param[i * 3].GetString());
+    fInputList.push_back(array->MakeIterator());
+
+    fMinCountList.push_back(param[i * 3 + 1].GetInt());
+
+    formula = new DelphesFormula;
+    formula->Compile(param[i * 3 + 2].GetString());
+    fFormulaList.push_back(formula);
+
+    fPassedList.push_back(0);
+  }
+
+  fProcessed = 0;
+}
+
+//------------------------------------------------------------------------------
+
+void EventFilter::Finish()
+{
+  vector<TIterator *>::iterator itInputList;
+  vector<DelphesFormula *>::iterator itFormulaList;
+  size_t i;
+
+  // write cutflow yields
+
+  if(fProcessed > 0)
+  {
+    cout << left;
+    cout << setw(30) << "** INFO: event filter";
+    cout << setw(25) << GetName() << endl;
+    cout << "** processed " << fProcessed << " events" << endl;
+    for(i = 0; i < fPassedList.size(); ++i)
+    {
+      cout << "** selection " << i << ": " << fPassedList[i] << " events" << endl;
+    }
+
+    AddInfo(Form("%sProcessed", GetName()), fProcessed);
+    AddInfo(Form("%sAccepted", GetName()), fPassedList.empty() ? fProcessed : fPassedList.back());
+  }
+
+  for(itInputList = fInputList.begin(); itInputList != fInputList.end(); ++itInputList)
+  {
+    if(*itInputList) delete *itInputList;
+  }
+
+  for(itFormulaList = fFormulaList.begin(); itFormulaList != fFormulaList.end(); ++itFormulaList)
+  {
+    if(*itFormulaList) delete *itFormulaList;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void EventFilter::Process()
+{
+  Candidate *candidate;
+  TIterator *iterator;
+  DelphesFormula *formula;
+  Double_t pt, eta, phi, e;
+  Int_t count;
+  size_t i;
+
+  ++fProcessed;
+
+  // selections are applied in order and the first failing selection rejects the event
+
+  for(i = 0; i < fInputList.size(); ++i)
+  {
+    iterator = fInputList[i];
+    formula = fFormulaList[i];
+
+    count = 0;
+    iterator->Reset();
+    while(count < fMinCountList[i] && (candidate = static_cast<Candidate *>(iterator->Next())))
+    {
+      const TLorentzVector &candidateMomentum = candidate->Momentum;
+      pt = candidateMomentum.Pt();
+      eta = candidateMomentum.Eta();
+      phi = candidateMomentum.Phi();
+      e = candidateMomentum.E();
+
+      if(formula->Eval(pt, eta, phi, e, candidate) > 0.5) ++count;
+    }
+
+    if(count < fMinCountList[i])
+    {
+      SetEventRejected(kTRUE);
+      return;
+    }
+
+    ++fPassedList[i];
+  }
+
+  SetEventRejected(kFALSE);
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,59 @@
+/*
+ *  Delphes: a framework for fast simulation of a generic collider experiment
+ *  Copyright (C) 2012-2014  Universite catholique de Louvain (UCL), Belgium
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EventFilter_h
+#define EventFilter_h
+
+/** \class EventFilter
+ *
+ *  Rejects events that do not contain enough candidates passing
+ *  the selection formula in each of the input arrays.
+ *  The modules following a rejected event filter are not executed.
+ *
+ */
+
+#include "classes/DelphesModule.h"
+
+#include <vector>
+
+class TIterator;
+class DelphesFormula;
+
+class EventFilter: public DelphesModule
+{
+public:
+  EventFilter();
+  ~EventFilter();
+
+  void Init();
+  void Process();
+  void Finish();
+
+private:
+  std::vector<TIterator *> fInputList; //!
+  std::vector<Int_t> fMinCountList; //!
+  std::vector<DelphesFormula *> fFormulaList; //!
+
+  std::vector<Long64_t> fPassedList; //!
+
+  Long64_t fProcessed; //!
+
+  ClassDef(EventFilter, 1)
+};
+
+#endif
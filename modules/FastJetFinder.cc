@@ -20,6 +20,17 @@
  *
  *  Finds jets using FastJet library.
  *
+ *  Several jet definitions can be clustered from the same input array
+ *  in a single pass: the input conversion and the rho estimation are then
+ *  shared and each definition exports its own output array.
+ *
+ *  Jet substructure (N-subjettiness, trimming, pruning and SoftDrop) is
+ *  evaluated independently for each jet and can be spread over several
+ *  threads. The constituents and the C/A reclustering of each jet are
+ *  copied out of the event cluster sequence in the calling thread, and the
+ *  reclustering is shared by the trimming and SoftDrop. The same number of
+ *  threads is used by the SISCone stable-cone search.
+ *
  *  \author P. Demin - UCL, Louvain-la-Neuve
  *
  */
@@ -29,6 +40,7 @@
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesFormula.h"
+#include "classes/DelphesThreadPool.h"
 
 #include "ExRootAnalysis/ExRootClassifier.h"
 #include "ExRootAnalysis/ExRootFilter.h"
@@ -48,6 +60,8 @@
 #include <stdexcept>
 #include <vector>
 
+#include <string.h>
+
 #include "fastjet/ClusterSequence.hh"
 #include "fastjet/ClusterSequenceArea.hh"
 #include "fastjet/JetDefinition.hh"
@@ -76,102 +90,120 @@ using namespace fastjet::contrib;
 
 //------------------------------------------------------------------------------
 
-FastJetFinder::FastJetFinder() :
-  fPlugin(0), fRecomb(0), fAxesDef(0), fMeasureDef(0), fNjettinessPlugin(0), fValenciaPlugin(0),
-  fDefinition(0), fAreaDefinition(0), fItInputArray(0)
+static void FillP4(Double_t *p4, const PseudoJet &jet)
 {
+  p4[0] = jet.pt();
+  p4[1] = jet.eta();
+  p4[2] = jet.phi();
+  p4[3] = jet.m();
 }
 
 //------------------------------------------------------------------------------
 
-FastJetFinder::~FastJetFinder()
+static AxesDefinition *NewAxesDefinition(Int_t axisMode)
 {
+  switch(axisMode)
+  {
+  default:
+  case 1:
+    return new WTA_KT_Axes();
+  case 2:
+    return new OnePass_WTA_KT_Axes();
+  case 3:
+    return new KT_Axes();
+  case 4:
+    return new OnePass_KT_Axes();
+  }
 }
 
 //------------------------------------------------------------------------------
 
-void FastJetFinder::Init()
+// the substructure of a jet is computed from plain copies of its momentum and
+// constituents, and from its own C/A reclustering: different jets do not share
+// any FastJet object and can be processed in different threads
+
+struct FastJetFinder::TSubstructureJetStruct
 {
-  JetDefinition::Plugin *plugin = 0;
-  JetDefinition::Recombiner *recomb = 0;
-  ExRootConfParam param;
-  Long_t i, size;
-  Double_t etaMin, etaMax;
-  TEstimatorStruct estimatorStruct;
+  PseudoJet momentum;
+  vector<PseudoJet> constituents;
+  PseudoJet reclustered;
+};
 
-  // define algorithm
+//------------------------------------------------------------------------------
 
-  fJetAlgorithm = GetInt("JetAlgorithm", 6);
-  fParameterR = GetDouble("ParameterR", 0.5);
-  fParameterP = GetDouble("ParameterP", -1.0);
+FastJetFinder::FastJetFinder() :
+  fAreaDefinition(0), fRhoDefinitionIndex(-1), fNumberOfThreads(1), fThreadPool(0), fItInputArray(0)
+{
+}
 
-  fConeRadius = GetDouble("ConeRadius", 0.5);
-  fSeedThreshold = GetDouble("SeedThreshold", 1.0);
-  fConeAreaFraction = GetDouble("ConeAreaFraction", 1.0);
-  fMaxIterations = GetInt("MaxIterations", 100);
-  fMaxPairSize = GetInt("MaxPairSize", 2);
-  fIratch = GetInt("Iratch", 1);
-  fAdjacencyCut = GetInt("AdjacencyCut", 2);
-  fOverlapThreshold = GetDouble("OverlapThreshold", 0.75);
+//------------------------------------------------------------------------------
 
-  fJetPTMin = GetDouble("JetPTMin", 10.0);
+FastJetFinder::~FastJetFinder()
+{
+}
 
-  //-- N(sub)jettiness parameters --
+//------------------------------------------------------------------------------
 
-  fComputeNsubjettiness = GetBool("ComputeNsubjettiness", false);
-  fBeta = GetDouble("Beta", 1.0);
-  fAxisMode = GetInt("AxisMode", 1);
-  fRcutOff = GetDouble("RcutOff", 0.8); // used only if Njettiness is used as jet clustering algo (case 8)
-  fN = GetInt("N", 2); // used only if Njettiness is used as jet clustering algo (case 8)
+Int_t FastJetFinder::GetOption(ExRootConfParam &options, const char *name, Int_t defaultValue)
+{
+  Long_t i, size = options.GetSize();
 
-  //-- Exclusive clustering for e+e- collisions --
+  for(i = 0; i < size / 2; ++i)
+  {
+    if(strcmp(options[i * 2].GetString(), name) == 0) return options[i * 2 + 1].GetInt();
+  }
+
+  return GetInt(name, defaultValue);
+}
 
-  fNJets = GetInt("NJets", 2);
-  fExclusiveClustering = GetBool("ExclusiveClustering", false);
-  fDCut = GetDouble("DCut", 0.0);
+//------------------------------------------------------------------------------
 
-  //-- Valencia Linear Collider algorithm
+Double_t FastJetFinder::GetOption(ExRootConfParam &options, const char *name, Double_t defaultValue)
+{
+  Long_t i, size = options.GetSize();
+
+  for(i = 0; i < size / 2; ++i)
+  {
+    if(strcmp(options[i * 2].GetString(), name) == 0) return options[i * 2 + 1].GetDouble();
+  }
 
-  fGamma = GetDouble("Gamma", 1.0);
-  //fBeta parameter see above
+  return GetDouble(name, defaultValue);
+}
+
+//------------------------------------------------------------------------------
 
-  fMeasureDef = new NormalizedMeasure(fBeta, fParameterR);
+Bool_t FastJetFinder::GetOption(ExRootConfParam &options, const char *name, Bool_t defaultValue)
+{
+  Long_t i, size = options.GetSize();
 
-  switch(fAxisMode)
+  for(i = 0; i < size / 2; ++i)
   {
-  default:
-  case 1:
-    fAxesDef = new WTA_KT_Axes();
-    break;
-  case 2:
-    fAxesDef = new OnePass_WTA_KT_Axes();
-    break;
-  case 3:
-    fAxesDef = new KT_Axes();
-    break;
-  case 4:
-    fAxesDef = new OnePass_KT_Axes();
+    if(strcmp(options[i * 2].GetString(), name) == 0) return options[i * 2 + 1].GetBool();
   }
 
-  //-- Trimming parameters --
+  return GetBool(name, defaultValue);
+}
 
-  fComputeTrimming = GetBool("ComputeTrimming", false);
-  fRTrim = GetDouble("RTrim", 0.2);
-  fPtFracTrim = GetDouble("PtFracTrim", 0.05);
+//------------------------------------------------------------------------------
 
-  //-- Pruning parameters --
+void FastJetFinder::Init()
+{
+  ExRootConfParam param, options;
+  Long_t i, size;
+  Double_t etaMin, etaMax;
+  TEstimatorStruct estimatorStruct;
+  TJetDefinitionStruct jetDefinitionStruct, rhoDefinitionStruct;
+  TString name;
 
-  fComputePruning = GetBool("ComputePruning", false);
-  fZcutPrun = GetDouble("ZcutPrun", 0.1);
-  fRcutPrun = GetDouble("RcutPrun", 0.5);
-  fRPrun = GetDouble("RPrun", 0.8);
+  // substructure of different jets and SISCone stable cones are computed in parallel
 
-  //-- SoftDrop parameters --
+  fNumberOfThreads = GetInt("NumberOfThreads", 1);
+  if(fNumberOfThreads < 1) fNumberOfThreads = 1;
+
+  // the FastJet reference counts are not atomic, the worker threads only use
+  // the jets prepared by PrepareSubstructure and their own substructure tools
 
-  fComputeSoftDrop = GetBool("ComputeSoftDrop", false);
-  fBetaSoftDrop = GetDouble("BetaSoftDrop", 0.0);
-  fSymmetryCutSoftDrop = GetDouble("SymmetryCutSoftDrop", 0.1);
-  fR0SoftDrop = GetDouble("R0SoftDrop=", 0.8);
+  if(fNumberOfThreads > 1) fThreadPool = new DelphesThreadPool(fNumberOfThreads);
 
   // ---  Jet Area Parameters ---
 
@@ -212,89 +244,290 @@ void FastJetFinder::Init()
     break;
   }
 
-  switch(fJetAlgorithm)
+  // import input array
+
+  fInputArray = ImportArray(GetString("InputArray", "Calorimeter/towers"));
+  fItInputArray = fInputArray->MakeIterator();
+
+  // read jet definitions
+  // add JetDefinitions OutputArray {ParameterName ParameterValue ...}
+  // parameters that are not listed are taken from the module configuration
+
+  fJetDefinitions.clear();
+
+  param = GetParam("JetDefinitions");
+  size = param.GetSize();
+
+  for(i = 0; i < size / 2; ++i)
+  {
+    name = param[i * 2].GetString();
+    options = param[i * 2 + 1];
+
+    InitJetDefinition(jetDefinitionStruct, options);
+
+    jetDefinitionStruct.outputArray = ExportArray(name);
+    jetDefinitionStruct.constituentsOutputArray = ExportArray(name + "Constituents");
+
+    fJetDefinitions.push_back(jetDefinitionStruct);
+  }
+
+  // without JetDefinitions, the module configuration defines a single jet collection
+
+  if(fJetDefinitions.empty())
+  {
+    InitJetDefinition(jetDefinitionStruct, options);
+
+    jetDefinitionStruct.outputArray = ExportArray(GetString("OutputArray", "jets"));
+    jetDefinitionStruct.constituentsOutputArray = ExportArray(GetString("ConstituentsOutputArray", "constituents"));
+
+    fJetDefinitions.push_back(jetDefinitionStruct);
+  }
+
+  ClusterSequence::print_banner();
+
+  fRhoOutputArray = ExportArray(GetString("RhoOutputArray", "rho"));
+
+  fEstimators.clear();
+  fRhoDefinitionIndex = -1;
+
+  if(fComputeRho && fAreaDefinition)
+  {
+    // rho is estimated with the jet definition from the module configuration,
+    // reuse the clustering of an identical jet definition if there is one
+
+    options = ExRootConfParam();
+    InitJetDefinition(rhoDefinitionStruct, options);
+
+    for(i = 0; i < Long_t(fJetDefinitions.size()); ++i)
+    {
+      if(fJetDefinitions[i].definition->description() == rhoDefinitionStruct.definition->description())
+      {
+        fRhoDefinitionIndex = i;
+        break;
+      }
+    }
+
+    if(fRhoDefinitionIndex < 0)
+    {
+      rhoDefinitionStruct.outputArray = 0;
+      rhoDefinitionStruct.constituentsOutputArray = 0;
+      fRhoDefinitionIndex = fJetDefinitions.size();
+      fJetDefinitions.push_back(rhoDefinitionStruct);
+    }
+    else
+    {
+      DeleteJetDefinition(rhoDefinitionStruct);
+    }
+
+    // read eta ranges
+
+    param = GetParam("RhoEtaRange");
+    size = param.GetSize();
+
+    for(i = 0; i < size / 2; ++i)
+    {
+      etaMin = param[i * 2].GetDouble();
+      etaMax = param[i * 2 + 1].GetDouble();
+      estimatorStruct.estimator = new JetMedianBackgroundEstimator(SelectorRapRange(etaMin, etaMax));
+      estimatorStruct.etaMin = etaMin;
+      estimatorStruct.etaMax = etaMax;
+      fEstimators.push_back(estimatorStruct);
+    }
+  }
+
+  fSequences.assign(fJetDefinitions.size(), 0);
+}
+
+//------------------------------------------------------------------------------
+
+void FastJetFinder::InitJetDefinition(TJetDefinitionStruct &jetDefinition, ExRootConfParam &options)
+{
+  JetDefinition::Plugin *plugin = 0;
+  JetDefinition::Recombiner *recomb = 0;
+  TSubstructureToolsStruct tools;
+  Int_t i, j;
+
+  // define algorithm
+
+  Int_t jetAlgorithm = GetOption(options, "JetAlgorithm", 6);
+  Double_t parameterR = GetOption(options, "ParameterR", 0.5);
+  Double_t parameterP = GetOption(options, "ParameterP", -1.0);
+
+  Double_t coneRadius = GetOption(options, "ConeRadius", 0.5);
+  Double_t seedThreshold = GetOption(options, "SeedThreshold", 1.0);
+  Double_t coneAreaFraction = GetOption(options, "ConeAreaFraction", 1.0);
+  Int_t maxIterations = GetOption(options, "MaxIterations", 100);
+  Int_t maxPairSize = GetOption(options, "MaxPairSize", 2);
+  Int_t iratch = GetOption(options, "Iratch", 1);
+  Int_t adjacencyCut = GetOption(options, "AdjacencyCut", 2);
+  Double_t overlapThreshold = GetOption(options, "OverlapThreshold", 0.75);
+
+  Double_t jetPTMin = GetOption(options, "JetPTMin", 10.0);
+
+  // FastJet clustering strategy for the kt, Cambridge and anti-kt algorithms,
+  // -11 selects the tiling with vectorised distance calculations
+  Strategy strategy = Strategy(GetOption(options, "ClusteringStrategy", Int_t(Best)));
+
+  //-- N(sub)jettiness parameters --
+
+  Bool_t computeNsubjettiness = GetOption(options, "ComputeNsubjettiness", false);
+  Double_t beta = GetOption(options, "Beta", 1.0);
+  Int_t axisMode = GetOption(options, "AxisMode", 1);
+  Double_t rcutOff = GetOption(options, "RcutOff", 0.8); // used only if Njettiness is used as jet clustering algo (case 8)
+  Int_t n = GetOption(options, "N", 2); // used only if Njettiness is used as jet clustering algo (case 8)
+
+  //-- Exclusive clustering for e+e- collisions --
+
+  jetDefinition.nJets = GetOption(options, "NJets", 2);
+  jetDefinition.exclusiveClustering = GetOption(options, "ExclusiveClustering", false);
+  jetDefinition.dCut = GetOption(options, "DCut", 0.0);
+
+  //-- Valencia Linear Collider algorithm
+
+  Double_t gamma = GetOption(options, "Gamma", 1.0);
+  //beta parameter see above
+
+  //-- Trimming parameters --
+
+  Bool_t computeTrimming = GetOption(options, "ComputeTrimming", false);
+  Double_t rTrim = GetOption(options, "RTrim", 0.2);
+  Double_t ptFracTrim = GetOption(options, "PtFracTrim", 0.05);
+
+  //-- Pruning parameters --
+
+  Bool_t computePruning = GetOption(options, "ComputePruning", false);
+  Double_t zcutPrun = GetOption(options, "ZcutPrun", 0.1);
+  Double_t rcutPrun = GetOption(options, "RcutPrun", 0.5);
+  Double_t rPrun = GetOption(options, "RPrun", 0.8);
+
+  //-- SoftDrop parameters --
+
+  Bool_t computeSoftDrop = GetOption(options, "ComputeSoftDrop", false);
+  Double_t betaSoftDrop = GetOption(options, "BetaSoftDrop", 0.0);
+  Double_t symmetryCutSoftDrop = GetOption(options, "SymmetryCutSoftDrop", 0.1);
+  Double_t r0SoftDrop = GetOption(options, "R0SoftDrop=", 0.8);
+
+  switch(jetAlgorithm)
   {
   case 1:
-    plugin = new CDFJetCluPlugin(fSeedThreshold, fConeRadius, fAdjacencyCut, fMaxIterations, fIratch, fOverlapThreshold);
-    fDefinition = new JetDefinition(plugin);
+    plugin = new CDFJetCluPlugin(seedThreshold, coneRadius, adjacencyCut, maxIterations, iratch, overlapThreshold);
+    jetDefinition.definition = new JetDefinition(plugin);
     break;
   case 2:
-    plugin = new CDFMidPointPlugin(fSeedThreshold, fConeRadius, fConeAreaFraction, fMaxPairSize, fMaxIterations, fOverlapThreshold);
-    fDefinition = new JetDefinition(plugin);
+    plugin = new CDFMidPointPlugin(seedThreshold, coneRadius, coneAreaFraction, maxPairSize, maxIterations, overlapThreshold);
+    jetDefinition.definition = new JetDefinition(plugin);
     break;
   case 3:
-    plugin = new SISConePlugin(fConeRadius, fOverlapThreshold, fMaxIterations, fJetPTMin);
-    fDefinition = new JetDefinition(plugin);
+    plugin = new SISConePlugin(coneRadius, overlapThreshold, maxIterations, jetPTMin);
+    static_cast<SISConePlugin *>(plugin)->set_n_threads(fNumberOfThreads);
+    jetDefinition.definition = new JetDefinition(plugin);
     break;
   case 4:
-    fDefinition = new JetDefinition(kt_algorithm, fParameterR);
+    jetDefinition.definition = new JetDefinition(kt_algorithm, parameterR, E_scheme, strategy);
     break;
   case 5:
-    fDefinition = new JetDefinition(cambridge_algorithm, fParameterR);
+    jetDefinition.definition = new JetDefinition(cambridge_algorithm, parameterR, E_scheme, strategy);
     break;
   default:
   case 6:
-    fDefinition = new JetDefinition(antikt_algorithm, fParameterR);
+    jetDefinition.definition = new JetDefinition(antikt_algorithm, parameterR, E_scheme, strategy);
     break;
   case 7:
     recomb = new WinnerTakeAllRecombiner();
-    fDefinition = new JetDefinition(antikt_algorithm, fParameterR, recomb, Best);
+    jetDefinition.definition = new JetDefinition(antikt_algorithm, parameterR, recomb, strategy);
     break;
   case 8:
-    fNjettinessPlugin = new NjettinessPlugin(fN, Njettiness::wta_kt_axes, Njettiness::unnormalized_cutoff_measure, fBeta, fRcutOff);
-    fDefinition = new JetDefinition(fNjettinessPlugin);
+    plugin = new NjettinessPlugin(n, Njettiness::wta_kt_axes, Njettiness::unnormalized_cutoff_measure, beta, rcutOff);
+    jetDefinition.definition = new JetDefinition(plugin);
     break;
   case 9:
-    fValenciaPlugin = new ValenciaPlugin(fParameterR, fBeta, fGamma);
-    fDefinition = new JetDefinition(fValenciaPlugin);
+    plugin = new ValenciaPlugin(parameterR, beta, gamma);
+    jetDefinition.definition = new JetDefinition(plugin);
     break;
   case 10:
-    fDefinition = new JetDefinition(ee_genkt_algorithm,fParameterR,fParameterP);
+    jetDefinition.definition = new JetDefinition(ee_genkt_algorithm, parameterR, parameterP);
     break;
 
   // kT durham algorithm, 2 options:
   // 1. njets mode: stop when reach predetermined n jet (optionally apply sqrt(ExclYmerge(n-1,n))*Evis) > cut offline)
-  // 2. dcut mode: stop when all dij above some threshold dcut. Is applied if fDCut > 0.
+  // 2. dcut mode: stop when all dij above some threshold dcut. Is applied if dCut > 0.
   case 11:
-    fDefinition = new JetDefinition(ee_kt_algorithm);
+    jetDefinition.definition = new JetDefinition(ee_kt_algorithm);
     break;
-
   }
 
-  fPlugin = plugin;
-  fRecomb = recomb;
+  // C/A reclustering of the jets with their recombination scheme,
+  // the same as the default reclustering of SoftDrop
 
-  ClusterSequence::print_banner();
+  jetDefinition.reclusterDefinition = new JetDefinition(cambridge_algorithm, JetDefinition::max_allowable_R);
+  jetDefinition.reclusterDefinition->set_recombiner(*jetDefinition.definition);
 
-  if(fComputeRho && fAreaDefinition)
-  {
-    // read eta ranges
+  jetDefinition.plugin = plugin;
+  jetDefinition.recomb = recomb;
 
-    param = GetParam("RhoEtaRange");
-    size = param.GetSize();
+  jetDefinition.jetAlgorithm = jetAlgorithm;
+  jetDefinition.parameterR = parameterR;
+  jetDefinition.jetPTMin = jetPTMin;
 
-    fEstimators.clear();
-    for(i = 0; i < size / 2; ++i)
+  // substructure tools are created once and applied to every jet, FastJet
+  // tools keep internal state and the WTA axes share their recombiner with
+  // their copies, so each thread gets its own tools and axes definition
+
+  jetDefinition.computeNsubjettiness = computeNsubjettiness;
+  jetDefinition.computeTrimming = computeTrimming;
+  jetDefinition.computePruning = computePruning;
+  jetDefinition.computeSoftDrop = computeSoftDrop;
+
+  jetDefinition.tools.clear();
+
+  for(j = 0; j < fNumberOfThreads; ++j)
+  {
+    tools.axesDef = computeNsubjettiness ? NewAxesDefinition(axisMode) : 0;
+    tools.measureDef = computeNsubjettiness ? new NormalizedMeasure(beta, parameterR) : 0;
+
+    for(i = 0; i < 5; ++i)
     {
-      etaMin = param[i * 2].GetDouble();
-      etaMax = param[i * 2 + 1].GetDouble();
-      estimatorStruct.estimator = new JetMedianBackgroundEstimator(SelectorRapRange(etaMin, etaMax), *fDefinition, *fAreaDefinition);
-      estimatorStruct.etaMin = etaMin;
-      estimatorStruct.etaMax = etaMax;
-      fEstimators.push_back(estimatorStruct);
+      tools.nSub[i] = computeNsubjettiness ? new Nsubjettiness(i + 1, *tools.axesDef, *tools.measureDef) : 0;
     }
+
+    tools.trimmer = computeTrimming ? new Filter(JetDefinition(kt_algorithm, rTrim), SelectorPtFractionMin(ptFracTrim)) : 0;
+    tools.pruner = computePruning ? new Pruner(JetDefinition(cambridge_algorithm, rPrun), zcutPrun, rcutPrun) : 0;
+    tools.softDrop = computeSoftDrop ? new SoftDrop(betaSoftDrop, symmetryCutSoftDrop, r0SoftDrop) : 0;
+
+    // SoftDrop is applied to the C/A reclustering prepared for each jet
+    if(tools.softDrop) tools.softDrop->set_reclustering(false);
+
+    jetDefinition.tools.push_back(tools);
   }
+}
 
-  // import input array
+//------------------------------------------------------------------------------
 
-  fInputArray = ImportArray(GetString("InputArray", "Calorimeter/towers"));
-  fItInputArray = fInputArray->MakeIterator();
+void FastJetFinder::DeleteJetDefinition(TJetDefinitionStruct &jetDefinition)
+{
+  vector<TSubstructureToolsStruct>::iterator itTools;
+  Int_t i;
+
+  for(itTools = jetDefinition.tools.begin(); itTools != jetDefinition.tools.end(); ++itTools)
+  {
+    for(i = 0; i < 5; ++i)
+    {
+      if(itTools->nSub[i]) delete itTools->nSub[i];
+    }
 
-  // create output arrays
+    if(itTools->trimmer) delete itTools->trimmer;
+    if(itTools->pruner) delete itTools->pruner;
+    if(itTools->softDrop) delete itTools->softDrop;
 
-  fOutputArray = ExportArray(GetString("OutputArray", "jets"));
-  fRhoOutputArray = ExportArray(GetString("RhoOutputArray", "rho"));
-  fConstituentsOutputArray = ExportArray(GetString("ConstituentsOutputArray", "constituents"));
+    if(itTools->axesDef) delete itTools->axesDef;
+    if(itTools->measureDef) delete itTools->measureDef;
+  }
+  jetDefinition.tools.clear();
+
+  if(jetDefinition.reclusterDefinition) delete jetDefinition.reclusterDefinition;
+  if(jetDefinition.definition) delete jetDefinition.definition;
+  if(jetDefinition.plugin) delete static_cast<JetDefinition::Plugin *>(jetDefinition.plugin);
+  if(jetDefinition.recomb) delete static_cast<JetDefinition::Recombiner *>(jetDefinition.recomb);
 }
 
 //------------------------------------------------------------------------------
@@ -302,51 +535,40 @@ void FastJetFinder::Init()
 void FastJetFinder::Finish()
 {
   vector<TEstimatorStruct>::iterator itEstimators;
+  vector<TJetDefinitionStruct>::iterator itJetDefinitions;
 
   for(itEstimators = fEstimators.begin(); itEstimators != fEstimators.end(); ++itEstimators)
   {
     if(itEstimators->estimator) delete itEstimators->estimator;
   }
 
+  for(itJetDefinitions = fJetDefinitions.begin(); itJetDefinitions != fJetDefinitions.end(); ++itJetDefinitions)
+  {
+    DeleteJetDefinition(*itJetDefinitions);
+  }
+
   if(fItInputArray) delete fItInputArray;
-  if(fDefinition) delete fDefinition;
   if(fAreaDefinition) delete fAreaDefinition;
-  if(fPlugin) delete static_cast<JetDefinition::Plugin *>(fPlugin);
-  if(fRecomb) delete static_cast<JetDefinition::Recombiner *>(fRecomb);
-  if(fNjettinessPlugin) delete static_cast<JetDefinition::Plugin *>(fNjettinessPlugin);
-  if(fAxesDef) delete fAxesDef;
-  if(fMeasureDef) delete fMeasureDef;
-  if(fValenciaPlugin) delete static_cast<JetDefinition::Plugin *>(fValenciaPlugin);
+  if(fThreadPool) delete fThreadPool;
 }
 
 //------------------------------------------------------------------------------
 
 void FastJetFinder::Process()
 {
-  Candidate *candidate, *constituent;
+  Candidate *candidate;
   TLorentzVector momentum;
 
-  Double_t deta, dphi, detaMax, dphiMax;
-  Double_t time, timeWeight;
-  Double_t neutralEnergyFraction, chargedEnergyFraction;
-
-  Int_t number, ncharged, nneutrals;
-  Int_t charge;
+  Int_t number;
   Double_t rho = 0.0;
-  PseudoJet jet, area;
-  ClusterSequence *sequence;
-  vector<PseudoJet> inputList, outputList, subjets;
-  vector<PseudoJet>::iterator itInputList, itOutputList;
+  PseudoJet jet;
+  size_t i;
   vector<TEstimatorStruct>::iterator itEstimators;
-  Double_t excl_ymerge12 = 0.0;
-  Double_t excl_ymerge23 = 0.0;
-  Double_t excl_ymerge34 = 0.0;
-  Double_t excl_ymerge45 = 0.0;
-  Double_t excl_ymerge56 = 0.0;
 
   DelphesFactory *factory = GetFactory();
 
-  inputList.clear();
+  // the input list is shared by all jet definitions and keeps its capacity between events
+  fInputList.clear();
 
   // loop over input objects
   fItInputArray->Reset();
@@ -356,26 +578,29 @@ void FastJetFinder::Process()
     momentum = candidate->Momentum;
     jet = PseudoJet(momentum.Px(), momentum.Py(), momentum.Pz(), momentum.E());
     jet.set_user_index(number);
-    inputList.push_back(jet);
+    fInputList.push_back(jet);
     ++number;
   }
 
   // construct jets
-  if(fAreaDefinition)
-  {
-    sequence = new ClusterSequenceArea(inputList, *fDefinition, *fAreaDefinition);
-  }
-  else
+  for(i = 0; i < fJetDefinitions.size(); ++i)
   {
-    sequence = new ClusterSequence(inputList, *fDefinition);
+    if(fAreaDefinition)
+    {
+      fSequences[i] = new ClusterSequenceArea(fInputList, *fJetDefinitions[i].definition, *fAreaDefinition);
+    }
+    else
+    {
+      fSequences[i] = new ClusterSequence(fInputList, *fJetDefinitions[i].definition);
+    }
   }
 
-  // compute rho and store it
-  if(fComputeRho && fAreaDefinition)
+  // compute rho and store it, all eta ranges share the same clustering
+  if(fRhoDefinitionIndex >= 0)
   {
     for(itEstimators = fEstimators.begin(); itEstimators != fEstimators.end(); ++itEstimators)
     {
-      itEstimators->estimator->set_particles(inputList);
+      itEstimators->estimator->set_cluster_sequence(*static_cast<ClusterSequenceArea *>(fSequences[fRhoDefinitionIndex]));
       rho = itEstimators->estimator->rho();
 
       candidate = factory->NewCandidate();
@@ -386,28 +611,70 @@ void FastJetFinder::Process()
     }
   }
 
-  outputList.clear();
+  for(i = 0; i < fJetDefinitions.size(); ++i)
+  {
+    if(fJetDefinitions[i].outputArray) ProcessJetDefinition(fJetDefinitions[i], fSequences[i]);
+  }
+
+  for(i = 0; i < fSequences.size(); ++i)
+  {
+    delete fSequences[i];
+    fSequences[i] = 0;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void FastJetFinder::ProcessJetDefinition(TJetDefinitionStruct &jetDefinition, ClusterSequence *sequence)
+{
+  Candidate *candidate, *constituent;
+  TLorentzVector momentum;
+
+  Double_t deta, dphi, detaMax, dphiMax;
+  Double_t time, timeWeight;
+  Double_t neutralEnergyFraction, chargedEnergyFraction;
+
+  Int_t ncharged, nneutrals;
+  Int_t charge;
+  Int_t index, number;
+  PseudoJet jet, area;
+  vector<PseudoJet>::iterator itInputList, itOutputList;
+  Double_t excl_ymerge12 = 0.0;
+  Double_t excl_ymerge23 = 0.0;
+  Double_t excl_ymerge34 = 0.0;
+  Double_t excl_ymerge45 = 0.0;
+  Double_t excl_ymerge56 = 0.0;
+
+  DelphesFactory *factory = GetFactory();
+
+  Bool_t substructure = jetDefinition.computeTrimming || jetDefinition.computePruning
+    || jetDefinition.computeSoftDrop || jetDefinition.computeNsubjettiness;
 
-  if(fExclusiveClustering)
+  fSubstructureCandidates.clear();
+  fSubstructureJets.clear();
+
+  fOutputList.clear();
+
+  if(jetDefinition.exclusiveClustering)
   {
     try
     {
       // exclusive dcut mode
-      if (fDCut > 0.0)
+      if(jetDefinition.dCut > 0.0)
       {
-        outputList = sorted_by_pt(sequence->exclusive_jets(fDCut*fDCut));
+        fOutputList = sorted_by_pt(sequence->exclusive_jets(jetDefinition.dCut * jetDefinition.dCut));
       }
       else
       {
         // exclusive njet mode
-        outputList = sorted_by_pt(sequence->exclusive_jets(fNJets));
+        fOutputList = sorted_by_pt(sequence->exclusive_jets(jetDefinition.nJets));
       }
     }
     catch(fastjet::Error)
     {
-      outputList.clear();
+      fOutputList.clear();
     }
-    
+
     excl_ymerge12 = sequence->exclusive_ymerge(1);
     excl_ymerge23 = sequence->exclusive_ymerge(2);
     excl_ymerge34 = sequence->exclusive_ymerge(3);
@@ -416,17 +683,17 @@ void FastJetFinder::Process()
   }
   else
   {
-    outputList = sorted_by_pt(sequence->inclusive_jets(fJetPTMin));
+    fOutputList = sorted_by_pt(sequence->inclusive_jets(jetDefinition.jetPTMin));
   }
 
   // loop over all jets and export them
   detaMax = 0.0;
   dphiMax = 0.0;
 
-  for(itOutputList = outputList.begin(); itOutputList != outputList.end(); ++itOutputList)
+  for(itOutputList = fOutputList.begin(); itOutputList != fOutputList.end(); ++itOutputList)
   {
     jet = *itOutputList;
-    if(fJetAlgorithm == 7) jet = join(jet.constituents());
+    if(jetDefinition.jetAlgorithm == 7) jet = join(jet.constituents());
 
     momentum.SetPxPyPzE(jet.px(), jet.py(), jet.pz(), jet.E());
 
@@ -443,13 +710,13 @@ void FastJetFinder::Process()
     ncharged = 0;
     nneutrals = 0;
 
-    neutralEnergyFraction =0.;
-    chargedEnergyFraction =0.;
+    neutralEnergyFraction = 0.;
+    chargedEnergyFraction = 0.;
 
-    inputList.clear();
-    inputList = sequence->constituents(*itOutputList);
+    fConstituentList.clear();
+    fConstituentList = sequence->constituents(*itOutputList);
 
-    for(itInputList = inputList.begin(); itInputList != inputList.end(); ++itInputList)
+    for(itInputList = fConstituentList.begin(); itInputList != fConstituentList.end(); ++itInputList)
     {
       if(itInputList->user_index() < 0) continue;
       constituent = static_cast<Candidate *>(fInputArray->At(itInputList->user_index()));
@@ -475,7 +742,7 @@ void FastJetFinder::Process()
 
       charge += constituent->Charge;
 
-      fConstituentsOutputArray->Add(constituent);
+      jetDefinition.constituentsOutputArray->Add(constituent);
       candidate->AddCandidate(constituent);
     }
 
@@ -489,8 +756,8 @@ void FastJetFinder::Process()
     candidate->NNeutrals = nneutrals;
     candidate->NCharged = ncharged;
 
-    candidate->NeutralEnergyFraction = (momentum.E() > 0 ) ? neutralEnergyFraction/momentum.E() : 0.0;
-    candidate->ChargedEnergyFraction = (momentum.E() > 0 ) ? chargedEnergyFraction/momentum.E() : 0.0;
+    candidate->NeutralEnergyFraction = (momentum.E() > 0) ? neutralEnergyFraction / momentum.E() : 0.0;
+    candidate->ChargedEnergyFraction = (momentum.E() > 0) ? chargedEnergyFraction / momentum.E() : 0.0;
 
     //for exclusive clustering, access y_n,n+1 as exclusive_ymerge (fNJets);
     candidate->ExclYmerge12 = excl_ymerge12;
@@ -499,107 +766,224 @@ void FastJetFinder::Process()
     candidate->ExclYmerge45 = excl_ymerge45;
     candidate->ExclYmerge56 = excl_ymerge56;
 
-    //------------------------------------
-    // Trimming
-    //------------------------------------
+    // the substructure is computed for all the jets once they are exported
 
-    if(fComputeTrimming)
+    if(substructure)
     {
+      fSubstructureCandidates.push_back(candidate);
+      fSubstructureJets.push_back(TSubstructureJetStruct());
+      PrepareSubstructure(jetDefinition, *itOutputList, fSubstructureJets.back());
+    }
 
-      fastjet::Filter trimmer(fastjet::JetDefinition(fastjet::kt_algorithm, fRTrim), fastjet::SelectorPtFractionMin(fPtFracTrim));
-      fastjet::PseudoJet trimmed_jet = trimmer(*itOutputList);
+    jetDefinition.outputArray->Add(candidate);
+  }
 
-      candidate->TrimmedP4[0].SetPtEtaPhiM(trimmed_jet.pt(), trimmed_jet.eta(), trimmed_jet.phi(), trimmed_jet.m());
+  if(fSubstructureCandidates.empty()) return;
 
-      // four hardest subjets
-      subjets.clear();
-      subjets = trimmed_jet.pieces();
-      subjets = sorted_by_pt(subjets);
+  // compute substructure, in parallel with several threads,
+  // and store it in the same order as the jets
 
-      candidate->NSubJetsTrimmed = subjets.size();
+  number = fSubstructureCandidates.size();
+  fSubstructureResults.resize(number);
 
-      for(size_t i = 0; i < subjets.size() and i < 4; i++)
-      {
-        if(subjets.at(i).pt() < 0) continue;
-        candidate->TrimmedP4[i + 1].SetPtEtaPhiM(subjets.at(i).pt(), subjets.at(i).eta(), subjets.at(i).phi(), subjets.at(i).m());
-      }
+  if(fThreadPool)
+  {
+    fThreadPool->Run(number, [&](Int_t index, Int_t thread) {
+      ComputeSubstructure(jetDefinition, jetDefinition.tools[thread], fSubstructureJets[index], fSubstructureResults[index]);
+    });
+  }
+  else
+  {
+    for(index = 0; index < number; ++index)
+    {
+      ComputeSubstructure(jetDefinition, jetDefinition.tools[0], fSubstructureJets[index], fSubstructureResults[index]);
     }
+  }
+
+  for(index = 0; index < number; ++index)
+  {
+    FillSubstructure(jetDefinition, fSubstructureResults[index], fSubstructureCandidates[index]);
+  }
 
-    //------------------------------------
-    // Pruning
-    //------------------------------------
+  // release the reclustered jets, their cluster sequences are then deleted
+  fSubstructureJets.clear();
+}
 
-    if(fComputePruning)
-    {
+//------------------------------------------------------------------------------
+
+void FastJetFinder::PrepareSubstructure(const TJetDefinitionStruct &jetDefinition, const PseudoJet &jet, TSubstructureJetStruct &result)
+{
+  ClusterSequence *sequence;
+  vector<PseudoJet> reclusteredList;
+  vector<PseudoJet>::const_iterator itConstituentList;
+  PseudoJet constituent;
 
-      fastjet::Pruner pruner(fastjet::JetDefinition(fastjet::cambridge_algorithm, fRPrun), fZcutPrun, fRcutPrun);
-      fastjet::PseudoJet pruned_jet = pruner(*itOutputList);
+  // runs in the calling thread: fConstituentList holds the constituents of
+  // the jet, they are copied without reference to the event cluster sequence,
+  // explicit ghosts are left out
 
-      candidate->PrunedP4[0].SetPtEtaPhiM(pruned_jet.pt(), pruned_jet.eta(), pruned_jet.phi(), pruned_jet.m());
+  result.momentum.reset_momentum(jet);
 
-      // four hardest subjet
-      subjets.clear();
-      subjets = pruned_jet.pieces();
-      subjets = sorted_by_pt(subjets);
+  result.constituents.clear();
+  for(itConstituentList = fConstituentList.begin(); itConstituentList != fConstituentList.end(); ++itConstituentList)
+  {
+    if(itConstituentList->user_index() < 0) continue;
+    constituent.reset_momentum(*itConstituentList);
+    constituent.set_user_index(itConstituentList->user_index());
+    result.constituents.push_back(constituent);
+  }
 
-      candidate->NSubJetsPruned = subjets.size();
+  // C/A reclustering of the constituents, as done by SoftDrop,
+  // the cluster sequence is deleted with the last jet using it
 
-      for(size_t i = 0; i < subjets.size() and i < 4; i++)
-      {
-        if(subjets.at(i).pt() < 0) continue;
-        candidate->PrunedP4[i + 1].SetPtEtaPhiM(subjets.at(i).pt(), subjets.at(i).eta(), subjets.at(i).phi(), subjets.at(i).m());
-      }
+  if(result.constituents.empty() || !(jetDefinition.computeTrimming || jetDefinition.computeSoftDrop)) return;
+
+  sequence = new ClusterSequence(result.constituents, *jetDefinition.reclusterDefinition);
+  reclusteredList = sorted_by_pt(sequence->inclusive_jets());
+  if(reclusteredList.empty())
+  {
+    delete sequence;
+    return;
+  }
+
+  result.reclustered = reclusteredList[0];
+  sequence->delete_self_when_unused();
+}
+
+//------------------------------------------------------------------------------
+
+void FastJetFinder::FillSubstructure(const TJetDefinitionStruct &jetDefinition, const TSubstructureStruct &result, Candidate *candidate)
+{
+  Int_t i;
+
+  if(jetDefinition.computeTrimming)
+  {
+    candidate->NSubJetsTrimmed = result.nSubJetsTrimmed;
+    for(i = 0; i <= result.nSubJetsTrimmed && i < 5; ++i)
+    {
+      candidate->TrimmedP4[i].SetPtEtaPhiM(result.trimmedP4[i][0], result.trimmedP4[i][1], result.trimmedP4[i][2], result.trimmedP4[i][3]);
     }
+  }
 
-    //------------------------------------
-    // SoftDrop
-    //------------------------------------
+  if(jetDefinition.computePruning)
+  {
+    candidate->NSubJetsPruned = result.nSubJetsPruned;
+    for(i = 0; i <= result.nSubJetsPruned && i < 5; ++i)
+    {
+      candidate->PrunedP4[i].SetPtEtaPhiM(result.prunedP4[i][0], result.prunedP4[i][1], result.prunedP4[i][2], result.prunedP4[i][3]);
+    }
+  }
+
+  if(jetDefinition.computeSoftDrop)
+  {
+    candidate->NSubJetsSoftDropped = result.nSubJetsSoftDropped;
+    for(i = 0; i <= result.nSubJetsSoftDropped && i < 5; ++i)
+    {
+      candidate->SoftDroppedP4[i].SetPtEtaPhiM(result.softDroppedP4[i][0], result.softDroppedP4[i][1], result.softDroppedP4[i][2], result.softDroppedP4[i][3]);
+    }
+    candidate->SoftDroppedJet = candidate->SoftDroppedP4[0];
+    if(result.nSubJetsSoftDropped > 0) candidate->SoftDroppedSubJet1 = candidate->SoftDroppedP4[1];
+    if(result.nSubJetsSoftDropped > 1) candidate->SoftDroppedSubJet2 = candidate->SoftDroppedP4[2];
+  }
 
-    if(fComputeSoftDrop)
+  if(jetDefinition.computeNsubjettiness)
+  {
+    for(i = 0; i < 5; ++i)
     {
+      candidate->Tau[i] = result.tau[i];
+    }
+  }
+}
 
-      contrib::SoftDrop softDrop(fBetaSoftDrop, fSymmetryCutSoftDrop, fR0SoftDrop);
-      fastjet::PseudoJet softdrop_jet = softDrop(*itOutputList);
+//------------------------------------------------------------------------------
 
-      candidate->SoftDroppedP4[0].SetPtEtaPhiM(softdrop_jet.pt(), softdrop_jet.eta(), softdrop_jet.phi(), softdrop_jet.m());
+void FastJetFinder::ComputeSubstructure(const TJetDefinitionStruct &jetDefinition, const TSubstructureToolsStruct &tools,
+  const TSubstructureJetStruct &jet, TSubstructureStruct &result)
+{
+  PseudoJet trimmingInput, composite, groomed;
+  vector<PseudoJet> subjets;
+  size_t i;
 
-      // four hardest subjet
+  // this function may run in worker threads: it only uses the objects
+  // prepared for this jet and the tools of the current thread
 
-      subjets.clear();
-      subjets = softdrop_jet.pieces();
-      subjets = sorted_by_pt(subjets);
-      candidate->NSubJetsSoftDropped = softdrop_jet.pieces().size();
+  result = TSubstructureStruct();
 
-      candidate->SoftDroppedJet = candidate->SoftDroppedP4[0];
+  if(jet.constituents.empty()) return;
 
-      for(size_t i = 0; i < subjets.size() and i < 4; i++)
-      {
-        if(subjets.at(i).pt() < 0) continue;
-        candidate->SoftDroppedP4[i + 1].SetPtEtaPhiM(subjets.at(i).pt(), subjets.at(i).eta(), subjets.at(i).phi(), subjets.at(i).m());
-        if(i == 0) candidate->SoftDroppedSubJet1 = candidate->SoftDroppedP4[i + 1];
-        if(i == 1) candidate->SoftDroppedSubJet2 = candidate->SoftDroppedP4[i + 1];
-      }
+  // trimming needs a jet from a cluster sequence and SoftDrop the C/A history,
+  // pruning and N-subjettiness take the constituents in their original order,
+  // trimming and pruning refer to the momentum of the clustered jet
+
+  composite = join(jet.constituents);
+  composite.reset_momentum(jet.momentum);
+
+  //------------------------------------
+  // Trimming
+  //------------------------------------
+
+  if(jetDefinition.computeTrimming && jet.reclustered.has_associated_cluster_sequence())
+  {
+    trimmingInput = jet.reclustered;
+    trimmingInput.reset_momentum(jet.momentum);
+    groomed = (*tools.trimmer)(trimmingInput);
+
+    // four hardest subjets
+    subjets = sorted_by_pt(groomed.pieces());
+
+    result.nSubJetsTrimmed = subjets.size();
+    FillP4(result.trimmedP4[0], groomed);
+    for(i = 0; i < subjets.size() && i < 4; ++i)
+    {
+      FillP4(result.trimmedP4[i + 1], subjets[i]);
     }
+  }
+
+  //------------------------------------
+  // Pruning
+  //------------------------------------
 
-    // --- compute N-subjettiness with N = 1,2,3,4,5 ----
+  if(jetDefinition.computePruning)
+  {
+    groomed = (*tools.pruner)(composite);
+
+    // four hardest subjets
+    subjets = sorted_by_pt(groomed.pieces());
 
-    if(fComputeNsubjettiness)
+    result.nSubJetsPruned = subjets.size();
+    FillP4(result.prunedP4[0], groomed);
+    for(i = 0; i < subjets.size() && i < 4; ++i)
     {
+      FillP4(result.prunedP4[i + 1], subjets[i]);
+    }
+  }
+
+  //------------------------------------
+  // SoftDrop
+  //------------------------------------
 
-      Nsubjettiness nSub1(1, *fAxesDef, *fMeasureDef);
-      Nsubjettiness nSub2(2, *fAxesDef, *fMeasureDef);
-      Nsubjettiness nSub3(3, *fAxesDef, *fMeasureDef);
-      Nsubjettiness nSub4(4, *fAxesDef, *fMeasureDef);
-      Nsubjettiness nSub5(5, *fAxesDef, *fMeasureDef);
-
-      candidate->Tau[0] = nSub1(*itOutputList);
-      candidate->Tau[1] = nSub2(*itOutputList);
-      candidate->Tau[2] = nSub3(*itOutputList);
-      candidate->Tau[3] = nSub4(*itOutputList);
-      candidate->Tau[4] = nSub5(*itOutputList);
+  if(jetDefinition.computeSoftDrop && jet.reclustered.has_associated_cluster_sequence())
+  {
+    groomed = (*tools.softDrop)(jet.reclustered);
+
+    // four hardest subjets
+    subjets = sorted_by_pt(groomed.pieces());
+
+    result.nSubJetsSoftDropped = subjets.size();
+    FillP4(result.softDroppedP4[0], groomed);
+    for(i = 0; i < subjets.size() && i < 4; ++i)
+    {
+      FillP4(result.softDroppedP4[i + 1], subjets[i]);
     }
+  }
 
-    fOutputArray->Add(candidate);
+  // --- compute N-subjettiness with N = 1,2,3,4,5 ----
+
+  if(jetDefinition.computeNsubjettiness)
+  {
+    for(i = 0; i < 5; ++i)
+    {
+      result.tau[i] = (*tools.nSub[i])(composite);
+    }
   }
-  delete sequence;
 }
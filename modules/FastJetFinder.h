@@ -23,6 +23,16 @@
  *
  *  Finds jets using FastJet library.
  *
+ *  Several jet definitions can be clustered from the same input array
+ *  in a single pass: the input conversion and the rho estimation are then
+ *  shared and each definition exports its own output array.
+ *
+ *  Jet substructure (N-subjettiness, trimming, pruning and SoftDrop) is
+ *  evaluated independently for each jet and can be spread over several
+ *  threads. The constituents and the C/A reclustering of each jet are
+ *  prepared in the calling thread, the reclustering is computed once and
+ *  shared by the trimming and SoftDrop.
+ *
  *  \author P. Demin - UCL, Louvain-la-Neuve
  *
  */
@@ -34,17 +44,27 @@
 class TObjArray;
 class TIterator;
 
+class Candidate;
+
+class ExRootConfParam;
+
+class DelphesThreadPool;
+
 namespace fastjet
 {
+class PseudoJet;
+class ClusterSequence;
 class JetDefinition;
 class AreaDefinition;
 class JetMedianBackgroundEstimator;
+class Filter;
+class Pruner;
 namespace contrib
 {
-class NjettinessPlugin;
-class ValenciaPlugin;
 class AxesDefinition;
 class MeasureDefinition;
+class Nsubjettiness;
+class SoftDrop;
 } // namespace contrib
 } // namespace fastjet
 
@@ -59,67 +79,6 @@ public:
   void Finish();
 
 private:
-  void *fPlugin; //!
-  void *fRecomb; //!
-
-  fastjet::contrib::AxesDefinition *fAxesDef;
-  fastjet::contrib::MeasureDefinition *fMeasureDef;
-
-  fastjet::contrib::NjettinessPlugin *fNjettinessPlugin; //!
-  fastjet::contrib::ValenciaPlugin *fValenciaPlugin; //!
-  fastjet::JetDefinition *fDefinition; //!
-
-  Int_t fJetAlgorithm;
-  Double_t fParameterR;
-  Double_t fParameterP;
-
-  Double_t fJetPTMin;
-  Double_t fConeRadius;
-  Double_t fSeedThreshold;
-  Double_t fConeAreaFraction;
-  Int_t fMaxIterations;
-  Int_t fMaxPairSize;
-  Int_t fIratch;
-  Int_t fAdjacencyCut;
-  Double_t fOverlapThreshold;
-
-  //-- Exclusive clustering for e+e- collisions --
-
-  Int_t fNJets;
-  Double_t fDCut;
-  Bool_t fExclusiveClustering;
-
-  //-- Valencia Linear Collider algorithm
-  Double_t fGamma;
-
-  //-- N (sub)jettiness parameters --
-
-  Bool_t fComputeNsubjettiness;
-  Double_t fBeta;
-  Int_t fAxisMode;
-  Double_t fRcutOff;
-  Int_t fN;
-
-  //-- Trimming parameters --
-
-  Bool_t fComputeTrimming;
-  Double_t fRTrim;
-  Double_t fPtFracTrim;
-
-  //-- Pruning parameters --
-
-  Bool_t fComputePruning;
-  Double_t fZcutPrun;
-  Double_t fRcutPrun;
-  Double_t fRPrun;
-
-  //-- SoftDrop parameters --
-
-  Bool_t fComputeSoftDrop;
-  Double_t fBetaSoftDrop;
-  Double_t fSymmetryCutSoftDrop;
-  Double_t fR0SoftDrop;
-
   // --- FastJet Area method --------
 
   fastjet::AreaDefinition *fAreaDefinition;
@@ -144,16 +103,95 @@ private:
     Double_t etaMin, etaMax;
   };
 
+  struct TSubstructureToolsStruct
+  {
+    fastjet::contrib::AxesDefinition *axesDef;
+    fastjet::contrib::MeasureDefinition *measureDef;
+    fastjet::contrib::Nsubjettiness *nSub[5];
+    fastjet::Filter *trimmer;
+    fastjet::Pruner *pruner;
+    fastjet::contrib::SoftDrop *softDrop;
+  };
+
+  struct TJetDefinitionStruct
+  {
+    fastjet::JetDefinition *definition;
+    fastjet::JetDefinition *reclusterDefinition;
+    void *plugin;
+    void *recomb;
+
+    Int_t jetAlgorithm;
+    Double_t parameterR;
+    Double_t jetPTMin;
+
+    //-- Exclusive clustering for e+e- collisions --
+
+    Int_t nJets;
+    Double_t dCut;
+    Bool_t exclusiveClustering;
+
+    //-- N (sub)jettiness, trimming, pruning and SoftDrop --
+
+    Bool_t computeNsubjettiness;
+    Bool_t computeTrimming;
+    Bool_t computePruning;
+    Bool_t computeSoftDrop;
+
+    // one set of substructure tools per thread
+    std::vector<TSubstructureToolsStruct> tools;
+
+    TObjArray *outputArray;
+    TObjArray *constituentsOutputArray;
+  };
+
+  // jet prepared for the substructure in the calling thread, defined in FastJetFinder.cc
+  struct TSubstructureJetStruct;
+
+  // substructure variables of one jet, four-momenta are stored as (pt, eta, phi, mass)
+  struct TSubstructureStruct
+  {
+    Double_t tau[5];
+    Int_t nSubJetsTrimmed, nSubJetsPruned, nSubJetsSoftDropped;
+    Double_t trimmedP4[5][4], prunedP4[5][4], softDroppedP4[5][4];
+  };
+
+  void InitJetDefinition(TJetDefinitionStruct &jetDefinition, ExRootConfParam &options);
+  void DeleteJetDefinition(TJetDefinitionStruct &jetDefinition);
+  void ProcessJetDefinition(TJetDefinitionStruct &jetDefinition, fastjet::ClusterSequence *sequence);
+
+  void PrepareSubstructure(const TJetDefinitionStruct &jetDefinition, const fastjet::PseudoJet &jet, TSubstructureJetStruct &result);
+  static void ComputeSubstructure(const TJetDefinitionStruct &jetDefinition, const TSubstructureToolsStruct &tools,
+    const TSubstructureJetStruct &jet, TSubstructureStruct &result);
+  static void FillSubstructure(const TJetDefinitionStruct &jetDefinition, const TSubstructureStruct &result, Candidate *candidate);
+
+  Int_t GetOption(ExRootConfParam &options, const char *name, Int_t defaultValue);
+  Double_t GetOption(ExRootConfParam &options, const char *name, Double_t defaultValue);
+  Bool_t GetOption(ExRootConfParam &options, const char *name, Bool_t defaultValue);
+
   std::vector<TEstimatorStruct> fEstimators; //!
+  std::vector<TJetDefinitionStruct> fJetDefinitions; //!
+  std::vector<fastjet::ClusterSequence *> fSequences; //!
+
+  std::vector<fastjet::PseudoJet> fInputList; //!
+  std::vector<fastjet::PseudoJet> fOutputList; //!
+  std::vector<fastjet::PseudoJet> fConstituentList; //!
+
+  std::vector<Candidate *> fSubstructureCandidates; //!
+  std::vector<TSubstructureJetStruct> fSubstructureJets; //!
+  std::vector<TSubstructureStruct> fSubstructureResults; //!
 #endif
 
+  Int_t fNumberOfThreads;
+
+  DelphesThreadPool *fThreadPool; //!
+
+  Int_t fRhoDefinitionIndex;
+
   TIterator *fItInputArray; //!
 
   const TObjArray *fInputArray; //!
 
-  TObjArray *fOutputArray; //!
   TObjArray *fRhoOutputArray; //!
-  TObjArray *fConstituentsOutputArray; //!
 
   ClassDef(FastJetFinder, 1)
 };
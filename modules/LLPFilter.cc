@@ -165,7 +165,9 @@ void LLPFilter::Process()
     if(find(fPdgCodes.begin(), fPdgCodes.end(), pdgCode) == fPdgCodes.end()) continue; //require pdgID is one of the LLP id
     if(fRequireStatus && (candidate->Status != fStatus)) continue;
 
-    // loop over particles to find LLP daughters and assign EM and hadronic energy
+    // loop over particles to find LLP daughters and assign EM and hadronic energy,
+    // the energies are set on a copy since the input particles are shared
+    candidate = static_cast<Candidate *>(candidate->Clone());
     candidate->Eem = 0.0;
     candidate->Ehad = 0.0;
     fItParticleInputArray->Reset();
@@ -29,6 +29,7 @@
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesFormula.h"
+#include "classes/DelphesNeighbourIndex.h"
 
 #include "ExRootAnalysis/ExRootClassifier.h"
 #include "ExRootAnalysis/ExRootFilter.h"
@@ -52,7 +53,7 @@ using namespace std;
 //------------------------------------------------------------------------------
 
 LeptonDressing::LeptonDressing() :
-  fItDressingInputArray(0), fItCandidateInputArray(0)
+  fItCandidateInputArray(0), fDressingIndex(0)
 {
 }
 
@@ -70,8 +71,7 @@ void LeptonDressing::Init()
 
   // import input array(s)
 
-  fDressingInputArray = ImportArray(GetString("DressingInputArray", "Calorimeter/photons"));
-  fItDressingInputArray = fDressingInputArray->MakeIterator();
+  fDressingIndex = ImportNeighbourIndex(GetString("DressingInputArray", "Calorimeter/photons"));
 
   fCandidateInputArray = ImportArray(GetString("CandidateInputArray", "UniqueObjectFinder/electrons"));
   fItCandidateInputArray = fCandidateInputArray->MakeIterator();
@@ -86,7 +86,6 @@ void LeptonDressing::Init()
 void LeptonDressing::Finish()
 {
   if(fItCandidateInputArray) delete fItCandidateInputArray;
-  if(fItDressingInputArray) delete fItDressingInputArray;
 }
 
 //------------------------------------------------------------------------------
@@ -95,6 +94,7 @@ void LeptonDressing::Process()
 {
   Candidate *candidate, *dressing, *mother;
   TLorentzVector momentum;
+  Int_t i, n;
 
   // loop over all input candidate
   fItCandidateInputArray->Reset();
@@ -102,18 +102,16 @@ void LeptonDressing::Process()
   {
     const TLorentzVector &candidateMomentum = candidate->Momentum;
 
-    // loop over all input tracks
-    fItDressingInputArray->Reset();
+    // loop over the dressing candidates inside the cone
+    fDressingIndex->Find(candidateMomentum.Eta(), candidateMomentum.Phi(), fDeltaR, fNeighbours);
+    n = fNeighbours.size();
     momentum.SetPxPyPzE(0.0, 0.0, 0.0, 0.0);
-    while((dressing = static_cast<Candidate *>(fItDressingInputArray->Next())))
+    for(i = 0; i < n; ++i)
     {
-      const TLorentzVector &dressingMomentum = dressing->Momentum;
-      if(dressingMomentum.Pt() > 0.1)
+      if(fDressingIndex->GetPT(fNeighbours[i].index) > 0.1)
       {
-        if(candidateMomentum.DeltaR(dressingMomentum) <= fDeltaR)
-        {
-          momentum += dressingMomentum;
-        }
+        dressing = fDressingIndex->GetCandidate(fNeighbours[i].index);
+        momentum += dressing->Momentum;
       }
     }
 
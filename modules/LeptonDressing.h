@@ -26,6 +26,9 @@
  */
 
 #include "classes/DelphesModule.h"
+#include "classes/DelphesNeighbourIndex.h"
+
+#include <vector>
 
 class TIterator;
 class TObjArray;
@@ -43,14 +46,14 @@ public:
 private:
   Double_t fDeltaR;
 
-  TIterator *fItDressingInputArray; //!
-
   TIterator *fItCandidateInputArray; //!
 
-  const TObjArray *fDressingInputArray; //!
+  DelphesNeighbourIndex *fDressingIndex; //!
 
   const TObjArray *fCandidateInputArray; //!
 
+  std::vector<DelphesNeighbourIndex::TNeighbour> fNeighbours; //!
+
   TObjArray *fOutputArray; //!
 
   ClassDef(LeptonDressing, 1)
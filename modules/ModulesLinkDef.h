@@ -82,6 +82,8 @@
 #include "modules/LLPFilter.h"
 #include "modules/CscClusterEfficiency.h"
 #include "modules/CscClusterId.h"
+#include "modules/EventFilter.h"
+#include "modules/ArrayWriter.h"
 
 #ifdef __CINT__
 
@@ -146,5 +148,7 @@
 #pragma link C++ class LLPFilter+;
 #pragma link C++ class CscClusterEfficiency+;
 #pragma link C++ class CscClusterId+;
+#pragma link C++ class EventFilter+;
+#pragma link C++ class ArrayWriter+;
 
 #endif
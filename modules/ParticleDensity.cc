@@ -20,6 +20,9 @@
  *
  *  This module calculates the particle multiplicity density in eta-phi bins.
  *  It then assigns the value to the candidates according to the candidate eta.
+ *  The density map is also exported as a DelphesDensityGrid, the only object
+ *  of the DensityMapArray, so that other modules can read it. This array
+ *  does not hold candidates and can't be written by TreeWriter or ArrayWriter.
  *
  *  \author R. Preghenella - INFN, Bologna
  *
@@ -28,6 +31,7 @@
 #include "modules/ParticleDensity.h"
 
 #include "classes/DelphesClasses.h"
+#include "classes/DelphesDensityGrid.h"
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesFormula.h"
 
@@ -41,7 +45,6 @@
 #include "TObjArray.h"
 #include "TRandom3.h"
 #include "TString.h"
-#include "TH2F.h"
 
 #include <algorithm>
 #include <iostream>
@@ -53,18 +56,25 @@ using namespace std;
 //------------------------------------------------------------------------------
 
 ParticleDensity::ParticleDensity() :
-  fItInputArray(0)
-{}
+  fItInputArray(0), fGrid(0)
+{
+  fGrid = new DelphesDensityGrid;
+}
 
 //------------------------------------------------------------------------------
 
 ParticleDensity::~ParticleDensity()
-{}
+{
+  if(fGrid) delete fGrid;
+}
 
 //------------------------------------------------------------------------------
 
 void ParticleDensity::Init()
 {
+  ExRootConfParam param;
+  Long_t i, size;
+  vector<Double_t> binsEta, binsPhi;
 
   // import input array(s)
 
@@ -75,25 +85,34 @@ void ParticleDensity::Init()
 
   fOutputArray = ExportArray(GetString("OutputArray", "tracks"));
 
-  // create multiplicity histogram
+  fDensityMapArray = ExportArray(GetString("DensityMapArray", "densityMap"));
 
-  ExRootConfParam paramEta = GetParam("EtaBins");
-  const Long_t sizeEta = paramEta.GetSize();
-  Int_t nbinsEta = sizeEta - 1;
-  Float_t binsEta[sizeEta];
-  for (Int_t i = 0; i < sizeEta; ++i) {
-    binsEta[i] = paramEta[i].GetDouble();
+  // create multiplicity map
+
+  param = GetParam("EtaBins");
+  size = param.GetSize();
+  for(i = 0; i < size; ++i)
+  {
+    binsEta.push_back(param[i].GetDouble());
   }
-  
-  ExRootConfParam paramPhi = GetParam("PhiBins");
-  const Long_t sizePhi = paramPhi.GetSize();
-  Int_t nbinsPhi = sizePhi - 1;
-  Float_t binsPhi[sizePhi];
-  for (Int_t i = 0; i < sizePhi; ++i) {
-    binsPhi[i] = paramPhi[i].GetDouble();
+
+  param = GetParam("PhiBins");
+  size = param.GetSize();
+  for(i = 0; i < size; ++i)
+  {
+    binsPhi.push_back(param[i].GetDouble());
+  }
+
+  try
+  {
+    fGrid->SetBins(binsEta, binsPhi);
+  }
+  catch(runtime_error &e)
+  {
+    stringstream message;
+    message << "invalid EtaBins or PhiBins in module '" << GetName() << "': " << e.what();
+    throw runtime_error(message.str());
   }
-  
-  fHisto = new TH2F("hParticleDensity", ";#eta;#varphi;d^{2}N/d#etad#varphi", nbinsEta, binsEta, nbinsPhi, binsPhi);
 
   fUseMomentumVector = GetBool("UseMomentumVector", false);
 }
@@ -103,7 +122,6 @@ void ParticleDensity::Init()
 void ParticleDensity::Finish()
 {
   if(fItInputArray) delete fItInputArray;
-  if (fHisto) delete fHisto;
 }
 
 //------------------------------------------------------------------------------
@@ -111,34 +129,35 @@ void ParticleDensity::Finish()
 void ParticleDensity::Process()
 {
   Candidate *candidate;
-  fHisto->Reset();
-  
-  // loop over all input candidates to fill histogram
-  fItInputArray->Reset();
-  while((candidate = static_cast<Candidate *>(fItInputArray->Next()))) {
-    if (fUseMomentumVector) fHisto->Fill(candidate->Momentum.Eta(), candidate->Momentum.Phi());
-    else                    fHisto->Fill(candidate->Position.Eta(), candidate->Position.Phi());
+  const TLorentzVector *direction;
+  Int_t i, n;
+
+  fGrid->Clear();
+
+  n = fInputArray->GetEntriesFast();
+  fBins.resize(n);
+
+  // loop over all input candidates to count them in eta-phi bins
+  for(i = 0; i < n; ++i)
+  {
+    candidate = static_cast<Candidate *>(fInputArray->At(i));
+    direction = fUseMomentumVector ? &candidate->Momentum : &candidate->Position;
+    fBins[i] = fGrid->FindBin(direction->Eta(), direction->Phi());
+    fGrid->Fill(fBins[i]);
   }
 
-  // normalise by bin width
-  fHisto->Scale(1., "width");
-  
+  // normalise by bin area
+  fGrid->Normalize();
+
   // loop over all input candidates to assign multiplicity
-  fItInputArray->Reset();
-  while((candidate = static_cast<Candidate *>(fItInputArray->Next()))) {
-    Int_t ieta, iphi;
-    if (fUseMomentumVector) {
-      ieta = fHisto->GetXaxis()->FindBin(candidate->Momentum.Eta());
-      iphi = fHisto->GetYaxis()->FindBin(candidate->Momentum.Phi());
-    } else {
-      ieta = fHisto->GetXaxis()->FindBin(candidate->Position.Eta());
-      iphi = fHisto->GetYaxis()->FindBin(candidate->Position.Phi());
-    }
-    candidate->ParticleDensity = fHisto->GetBinContent(ieta, iphi);
+  for(i = 0; i < n; ++i)
+  {
+    candidate = static_cast<Candidate *>(fInputArray->At(i));
+    candidate->ParticleDensity = fGrid->GetBinContent(fBins[i]);
     fOutputArray->Add(candidate);
   }
 
-  
+  fDensityMapArray->Add(fGrid);
 }
 
 //------------------------------------------------------------------------------
@@ -30,10 +30,10 @@
 
 #include "classes/DelphesModule.h"
 
-#include <deque>
+#include <vector>
 
 class TObjArray;
-class TH2F;
+class DelphesDensityGrid;
 
 class ParticleDensity: public DelphesModule
 {
@@ -53,9 +53,14 @@ private:
 
   TObjArray *fOutputArray; //!
 
+  TObjArray *fDensityMapArray; //!
+
   Bool_t fUseMomentumVector; // !
-  TH2F *fHisto; //!
-  
+
+  DelphesDensityGrid *fGrid; //!
+
+  std::vector<Int_t> fBins; //!
+
   ClassDef(ParticleDensity, 1)
 };
 
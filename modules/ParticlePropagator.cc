@@ -32,6 +32,7 @@
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesFormula.h"
+#include "classes/DelphesPropagator.h"
 
 #include "ExRootAnalysis/ExRootClassifier.h"
 #include "ExRootAnalysis/ExRootFilter.h"
@@ -55,14 +56,16 @@ using namespace std;
 //------------------------------------------------------------------------------
 
 ParticlePropagator::ParticlePropagator() :
-  fItInputArray(0)
+  fPropagator(0), fItInputArray(0)
 {
+  fPropagator = new DelphesPropagator;
 }
 
 //------------------------------------------------------------------------------
 
 ParticlePropagator::~ParticlePropagator()
 {
+  if(fPropagator) delete fPropagator;
 }
 
 //------------------------------------------------------------------------------
@@ -87,6 +90,9 @@ void ParticlePropagator::Init()
   fRadiusMax = GetDouble("RadiusMax", fRadius);
   fHalfLengthMax = GetDouble("HalfLengthMax", fHalfLength);
 
+  fPropagator->SetBz(fBz);
+  fPropagator->SetCylinder(fRadius, fHalfLength);
+
   // import array with output from filter/classifier module
 
   fInputArray = ImportArray(GetString("InputArray", "Delphes/stableParticles"));
@@ -123,19 +129,8 @@ void ParticlePropagator::Process()
 {
   Candidate *candidate, *mother, *particle;
   TLorentzVector particlePosition, particleMomentum, beamSpotPosition;
-  Double_t px, py, pz, pt, pt2, e, q;
-  Double_t x, y, z, t, r;
-  Double_t x_c, y_c, r_c, phi_0;
-  Double_t x_t, y_t, z_t, r_t, phi_t;
-  Double_t t_r, t_z;
-  Double_t tmp;
-  Double_t gammam, omega;
-  Double_t xd, yd, zd;
-  Double_t l, d0, dz, ctgTheta, alpha;
-  Double_t bsx, bsy, bsz;
-  Double_t td, pio, phid, vz;
-
-  const Double_t c_light = 2.99792458E8;
+  Double_t x, y, z, q, pt, ctgTheta;
+  Int_t i, index, size;
 
   if(!fBeamSpotInputArray || fBeamSpotInputArray->GetSize() == 0)
   {
@@ -147,6 +142,15 @@ void ParticlePropagator::Process()
     beamSpotPosition = beamSpotCandidate.Position;
   }
 
+  // gather the particles to propagate
+
+  fPropagator->Clear();
+  fPropagator->SetBeamSpot(beamSpotPosition.X(), beamSpotPosition.Y(), beamSpotPosition.Z());
+
+  fCandidateList.clear();
+  fParticleList.clear();
+  fIndexList.clear();
+
   fItInputArray->Reset();
   while((candidate = static_cast<Candidate *>(fItInputArray->Next())))
   {
@@ -159,18 +163,12 @@ void ParticlePropagator::Process()
       particle = static_cast<Candidate *>(candidate->GetCandidates()->At(0));
     }
 
-    particlePosition = particle->Position;
-    particleMomentum = particle->Momentum;
-
-    x = particlePosition.X() * 1.0E-3;
-    y = particlePosition.Y() * 1.0E-3;
-    z = particlePosition.Z() * 1.0E-3;
+    const TLorentzVector &position = particle->Position;
+    const TLorentzVector &momentum = particle->Momentum;
 
-    bsx = beamSpotPosition.X() * 1.0E-3;
-    bsy = beamSpotPosition.Y() * 1.0E-3;
-    bsz = beamSpotPosition.Z() * 1.0E-3;
-
-    q = particle->Charge;
+    x = position.X() * 1.0E-3;
+    y = position.Y() * 1.0E-3;
+    z = position.Z() * 1.0E-3;
 
     // check that particle position is inside the cylinder
     if(TMath::Hypot(x, y) > fRadiusMax || TMath::Abs(z) > fHalfLengthMax)
@@ -178,19 +176,45 @@ void ParticlePropagator::Process()
       continue;
     }
 
-    px = particleMomentum.Px();
-    py = particleMomentum.Py();
-    pz = particleMomentum.Pz();
-    pt = particleMomentum.Pt();
-    pt2 = particleMomentum.Perp2();
-    e = particleMomentum.E();
-
-    if(pt2 < 1.0E-9)
+    if(momentum.Perp2() < 1.0E-9)
     {
       continue;
     }
 
+    // particles produced outside of the inner cylinder are not propagated
     if(TMath::Hypot(x, y) > fRadius || TMath::Abs(z) > fHalfLength)
+    {
+      index = -1;
+    }
+    else
+    {
+      index = fPropagator->Add(position, momentum, particle->Charge);
+    }
+
+    fCandidateList.push_back(candidate);
+    fParticleList.push_back(particle);
+    fIndexList.push_back(index);
+  }
+
+  // propagate all neutral and charged particles at once
+
+  fPropagator->PropagateToCylinder();
+
+  // fill output arrays in the input order
+
+  size = fIndexList.size();
+  for(i = 0; i < size; ++i)
+  {
+    candidate = fCandidateList[i];
+    particle = fParticleList[i];
+    index = fIndexList[i];
+
+    particlePosition = particle->Position;
+    particleMomentum = particle->Momentum;
+
+    q = particle->Charge;
+
+    if(index < 0)
     {
       mother = candidate;
       candidate = static_cast<Candidate *>(candidate->Clone());
@@ -204,28 +228,14 @@ void ParticlePropagator::Process()
 
       fOutputArray->Add(candidate);
     }
-    else if(TMath::Abs(q) < 1.0E-9 || TMath::Abs(fBz) < 1.0E-9)
+    else if(!fPropagator->IsCharged(index))
     {
-      // solve pt2*t^2 + 2*(px*x + py*y)*t - (fRadius2 - x*x - y*y) = 0
-      tmp = px * y - py * x;
-      t_r = (TMath::Sqrt(pt2 * fRadius2 - tmp * tmp) - px * x - py * y) / pt2;
-
-      t_z = (TMath::Sign(fHalfLength, pz) - z) / pz;
-
-      t = TMath::Min(t_r, t_z);
-
-      x_t = x + px * t;
-      y_t = y + py * t;
-      z_t = z + pz * t;
-
-      l = TMath::Sqrt((x_t - x) * (x_t - x) + (y_t - y) * (y_t - y) + (z_t - z) * (z_t - z));
-
       mother = candidate;
       candidate = static_cast<Candidate *>(candidate->Clone());
 
       candidate->InitialPosition = particlePosition;
-      candidate->Position.SetXYZT(x_t * 1.0E3, y_t * 1.0E3, z_t * 1.0E3, particlePosition.T() + t * e * 1.0E3);
-      candidate->L = l * 1.0E3;
+      candidate->Position.SetXYZT(fPropagator->GetX(index), fPropagator->GetY(index), fPropagator->GetZ(index), particlePosition.T() + fPropagator->GetDT(index));
+      candidate->L = fPropagator->GetL(index);
 
       candidate->Momentum = particleMomentum;
       candidate->AddCandidate(mother);
@@ -251,124 +261,52 @@ void ParticlePropagator::Process()
         fNeutralOutputArray->Add(candidate);
       }
     }
-    else
+    else if(fPropagator->IsValid(index))
     {
-
-      // 1. initial transverse momentum p_{T0}: Part->pt
-      //    initial transverse momentum direction phi_0 = -atan(p_{X0} / p_{Y0})
-      //    relativistic gamma: gamma = E / mc^2; gammam = gamma * m
-      //    gyration frequency omega = q * Bz / (gammam)
-      //    helix radius r = p_{T0} / (omega * gammam)
-
-      gammam = e * 1.0E9 / (c_light * c_light); // gammam in [eV/c^2]
-      omega = q * fBz / gammam; // omega is here in [89875518/s]
-      r = pt / (q * fBz) * 1.0E9 / c_light; // in [m]
-
-      phi_0 = TMath::ATan2(py, px); // [rad] in [-pi, pi]
-
-      // 2. helix axis coordinates
-      x_c = x + r * TMath::Sin(phi_0);
-      y_c = y - r * TMath::Cos(phi_0);
-      r_c = TMath::Hypot(x_c, y_c);
-
-      // time of closest approach
-      td = (phi_0 + TMath::ATan2(x_c, y_c)) / omega;
-
-      // remove all the modulo pi that might have come from the atan
-      pio = TMath::Abs(TMath::Pi() / omega);
-      while(TMath::Abs(td) > 0.5 * pio)
-      {
-        td -= TMath::Sign(1.0, td) * pio;
-      }
-
-      vz = pz * c_light / e;
-
-      // calculate coordinates of closest approach to z axis
-      phid = phi_0 - omega * td;
-      xd = x_c - r * TMath::Sin(phid);
-      yd = y_c + r * TMath::Cos(phid);
-      zd = z + vz * td;
-
       // momentum at closest approach
-      px = pt * TMath::Cos(phid);
-      py = pt * TMath::Sin(phid);
-
-      particleMomentum.SetPtEtaPhiE(pt, particleMomentum.Eta(), phid, particleMomentum.E());
+      pt = particleMomentum.Pt();
+      particleMomentum.SetPtEtaPhiE(pt, particleMomentum.Eta(), fPropagator->GetPhiD(index), particleMomentum.E());
 
-      // calculate additional track parameters (correct for beamspot position)
-      d0 = ((xd - bsx) * py - (yd - bsy) * px) / pt;
-      dz = zd - bsz;
       ctgTheta = 1.0 / TMath::Tan(particleMomentum.Theta());
 
-      // 3. time evaluation t = TMath::Min(t_r, t_z)
-      //    t_r : time to exit from the sides
-      //    t_z : time to exit from the front or the back
-      t_z = (vz == 0.0) ? 1.0E99 : (TMath::Sign(fHalfLength, pz) - z) / vz;
-
-      if(r_c + TMath::Abs(r) < fRadius)
+      // store these variables before cloning
+      if(particle == candidate)
       {
-        // helix does not cross the cylinder sides
-        t = t_z;
+        particle->D0 = fPropagator->GetD0(index);
+        particle->DZ = fPropagator->GetDZ(index);
+        particle->P = particleMomentum.P();
+        particle->PT = pt;
+        particle->CtgTheta = ctgTheta;
+        particle->Phi = particleMomentum.Phi();
       }
-      else
-      {
-        alpha = TMath::ACos((r * r + r_c * r_c - fRadius * fRadius) / (2 * TMath::Abs(r) * r_c));
-        t_r = td + TMath::Abs(alpha / omega);
-
-        t = TMath::Min(t_r, t_z);
-      }
-
-      // 4. position in terms of x(t), y(t), z(t)
-      phi_t = phi_0 - omega * t;
-      x_t = x_c - r * TMath::Sin(phi_t);
-      y_t = y_c + r * TMath::Cos(phi_t);
-      z_t = z + vz * t;
-      r_t = TMath::Hypot(x_t, y_t);
-
-      // lenght of the path from production to tracker
-      l = t * TMath::Hypot(vz, r * omega);
-
-      if(r_t > 0.0)
-      {
-        // store these variables before cloning
-        if(particle == candidate)
-        {
-          particle->D0 = d0 * 1.0E3;
-          particle->DZ = dz * 1.0E3;
-          particle->P = particleMomentum.P();
-          particle->PT = pt;
-          particle->CtgTheta = ctgTheta;
-          particle->Phi = particleMomentum.Phi();
-        }
 
-        mother = candidate;
-        candidate = static_cast<Candidate *>(candidate->Clone());
+      mother = candidate;
+      candidate = static_cast<Candidate *>(candidate->Clone());
 
-        candidate->InitialPosition = particlePosition;
-        candidate->Position.SetXYZT(x_t * 1.0E3, y_t * 1.0E3, z_t * 1.0E3, particlePosition.T() + t * c_light * 1.0E3);
+      candidate->InitialPosition = particlePosition;
+      candidate->Position.SetXYZT(fPropagator->GetX(index), fPropagator->GetY(index), fPropagator->GetZ(index), particlePosition.T() + fPropagator->GetDT(index));
 
-        candidate->Momentum = particleMomentum;
+      candidate->Momentum = particleMomentum;
 
-        candidate->L = l * 1.0E3;
+      candidate->L = fPropagator->GetL(index);
 
-        candidate->Xd = xd * 1.0E3;
-        candidate->Yd = yd * 1.0E3;
-        candidate->Zd = zd * 1.0E3;
+      candidate->Xd = fPropagator->GetXd(index);
+      candidate->Yd = fPropagator->GetYd(index);
+      candidate->Zd = fPropagator->GetZd(index);
 
-        candidate->AddCandidate(mother);
+      candidate->AddCandidate(mother);
 
-        fOutputArray->Add(candidate);
-        switch(TMath::Abs(candidate->PID))
-        {
-        case 11:
-          fElectronOutputArray->Add(candidate);
-          break;
-        case 13:
-          fMuonOutputArray->Add(candidate);
-          break;
-        default:
-          fChargedHadronOutputArray->Add(candidate);
-        }
+      fOutputArray->Add(candidate);
+      switch(TMath::Abs(candidate->PID))
+      {
+      case 11:
+        fElectronOutputArray->Add(candidate);
+        break;
+      case 13:
+        fMuonOutputArray->Add(candidate);
+        break;
+      default:
+        fChargedHadronOutputArray->Add(candidate);
       }
     }
   }
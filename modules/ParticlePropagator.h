@@ -32,9 +32,13 @@
 
 #include "classes/DelphesModule.h"
 
+#include <vector>
+
 class TClonesArray;
 class TIterator;
 class TLorentzVector;
+class Candidate;
+class DelphesPropagator;
 
 class ParticlePropagator: public DelphesModule
 {
@@ -50,6 +54,12 @@ private:
   Double_t fRadius, fRadius2, fRadiusMax, fHalfLength, fHalfLengthMax;
   Double_t fBz;
 
+  DelphesPropagator *fPropagator; //!
+
+  std::vector<Candidate *> fCandidateList; //!
+  std::vector<Candidate *> fParticleList; //!
+  std::vector<Int_t> fIndexList; //!
+
   TIterator *fItInputArray; //!
 
   const TObjArray *fInputArray; //!
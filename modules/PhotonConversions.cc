@@ -36,14 +36,12 @@
 #include "ExRootAnalysis/ExRootResult.h"
 
 #include "TDatabasePDG.h"
-#include "TF1.h"
 #include "TFormula.h"
 #include "TLorentzVector.h"
 #include "TMath.h"
 #include "TObjArray.h"
 #include "TRandom3.h"
 #include "TString.h"
-#include "TVector3.h"
 
 #include <algorithm>
 #include <iostream>
@@ -55,9 +53,8 @@ using namespace std;
 //------------------------------------------------------------------------------
 
 PhotonConversions::PhotonConversions() :
-  fItInputArray(0), fConversionMap(0), fDecayXsec(0)
+  fItInputArray(0), fConversionMap(0)
 {
-  fDecayXsec = new TF1("decayXsec", "1.0 - 4.0/3.0 * x * (1.0 - x)", 0.0, 1.0);
   fConversionMap = new DelphesCylindricalFormula;
 }
 
@@ -83,6 +80,30 @@ void PhotonConversions::Init()
 
   fConversionMap->Compile(GetString("ConversionMap", "0.0"));
 
+  // optionally, photons produced within TableTolerance (in m) from the origin
+  // use the conversion probabilities precomputed on a grid in (eta, phi),
+  // evaluated at the bin centres instead of the exact direction
+
+  fTableEtaBins = GetInt("TableEtaBins", 100);
+  fTablePhiBins = GetInt("TablePhiBins", 32);
+  fTableTolerance = GetDouble("TableTolerance", 0.0);
+
+  if(fStep <= 0.0)
+  {
+    stringstream message;
+    message << "Step must be positive in module '" << GetName() << "'";
+    throw runtime_error(message.str());
+  }
+
+  if(fTableEtaBins <= 0 || fTablePhiBins <= 0)
+  {
+    stringstream message;
+    message << "TableEtaBins and TablePhiBins must be positive in module '" << GetName() << "'";
+    throw runtime_error(message.str());
+  }
+
+  if(fTableTolerance > 0.0) BuildTable();
+
   // import array with output from filter/classifier module
 
   fInputArray = ImportArray(GetString("InputArray", "Delphes/stableParticles"));
@@ -98,26 +119,130 @@ void PhotonConversions::Init()
 void PhotonConversions::Finish()
 {
   if(fItInputArray) delete fItInputArray;
-  if(fDecayXsec) delete fDecayXsec;
   if(fConversionMap) delete fConversionMap;
 }
 
 //------------------------------------------------------------------------------
 
+Double_t PhotonConversions::PathLength(Double_t x, Double_t y, Double_t z, Double_t px, Double_t py, Double_t pz) const
+{
+  Double_t pt2, tmp, discr2, discr, t, t1, t2, t3, t4, z_t;
+
+  // solve pt2*t^2 + 2*(px*x + py*y)*t - (fRadius2 - x*x - y*y) = 0
+  pt2 = px * px + py * py;
+  tmp = px * y - py * x;
+  discr2 = pt2 * fRadius2 - tmp * tmp;
+
+  if(discr2 < 0.0)
+  {
+    // no solutions
+    return -1.0;
+  }
+
+  tmp = px * x + py * y;
+  discr = TMath::Sqrt(discr2);
+  t1 = (-tmp + discr) / pt2;
+  t2 = (-tmp - discr) / pt2;
+  t = (t1 < 0.0) ? t2 : t1;
+
+  z_t = z + pz * t;
+  if(TMath::Abs(z_t) > fHalfLength)
+  {
+    t3 = (+fHalfLength - z) / pz;
+    t4 = (-fHalfLength - z) / pz;
+    t = (t3 < 0.0) ? t4 : t3;
+  }
+
+  return t;
+}
+
+//------------------------------------------------------------------------------
+
+void PhotonConversions::BuildTable()
+{
+  Int_t i, j, k, bin, nsteps;
+  Double_t eta, phi, px, py, pz, t, dt, r_t, r_i, x_i, y_i, z_i, depth;
+
+  fTable.clear();
+  fTableOffset.assign(fTableEtaBins * fTablePhiBins, 0);
+  fTableSteps.assign(fTableEtaBins * fTablePhiBins, 0);
+
+  for(i = 0; i < fTableEtaBins; ++i)
+  {
+    eta = fEtaMin + (i + 0.5) * (fEtaMax - fEtaMin) / fTableEtaBins;
+    for(j = 0; j < fTablePhiBins; ++j)
+    {
+      phi = -TMath::Pi() + (j + 0.5) * TMath::TwoPi() / fTablePhiBins;
+
+      px = TMath::Cos(phi);
+      py = TMath::Sin(phi);
+      pz = TMath::SinH(eta);
+
+      bin = i * fTablePhiBins + j;
+      fTableOffset[bin] = fTable.size();
+
+      t = PathLength(0.0, 0.0, 0.0, px, py, pz);
+      if(t <= 0.0) continue;
+
+      r_t = t * TMath::Sqrt(1.0 + pz * pz);
+      nsteps = Int_t(r_t / fStep);
+      if(nsteps <= 0) continue;
+
+      dt = t / nsteps;
+
+      // accumulate the optical depth, the probability for the photon
+      // not to convert before step k is exp(-depth)
+      depth = 0.0;
+      for(k = 0; k < nsteps; ++k)
+      {
+        x_i = px * dt * (k + 1);
+        y_i = py * dt * (k + 1);
+        z_i = pz * dt * (k + 1);
+        r_i = TMath::Sqrt(x_i * x_i + y_i * y_i);
+
+        depth += 7.0 / 9.0 * fStep * fConversionMap->Eval(r_i, phi, z_i);
+        fTable.push_back(depth);
+      }
+
+      fTableSteps[bin] = nsteps;
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+Double_t PhotonConversions::GenerateEnergyFraction() const
+{
+  Double_t y;
+
+  // dsigma/dx = 1 - 4/3*x*(1 - x) = 6/7*(flat) + 1/7*(3/2*y^2), with y = 1 - 2*x,
+  // the second term is sampled by inverting its cumulative distribution (y^3 + 1)/2
+
+  if(gRandom->Uniform() < 6.0 / 7.0)
+  {
+    return gRandom->Uniform();
+  }
+  else
+  {
+    y = TMath::Power(TMath::Abs(2.0 * gRandom->Uniform() - 1.0), 1.0 / 3.0);
+    if(gRandom->Uniform() < 0.5) y = -y;
+    return 0.5 * (1.0 - y);
+  }
+}
+
+//------------------------------------------------------------------------------
+
 void PhotonConversions::Process()
 {
   Candidate *candidate, *ep, *em;
   TLorentzVector candidatePosition, candidateMomentum;
-  TVector3 pos_i;
-  Double_t px, py, pz, pt, pt2, e, eta, phi;
-  Double_t x, y, z, t;
-  Double_t x_t, y_t, z_t, r_t;
-  Double_t x_i, y_i, z_i, r_i, phi_i;
-  Double_t dt, t1, t2, t3, t4;
-  Double_t tmp, discr, discr2;
-  Int_t nsteps, i;
-  Double_t rate, p_conv, x1, x2;
-  Bool_t converted;
+  Double_t px, py, pz, pt, e, eta, phi;
+  Double_t x, y, z, t, r_t;
+  Double_t x_i, y_i, z_i, r_i, phi_i, dt;
+  Double_t depth, threshold, fraction;
+  Int_t nsteps, i, bin, etaBin, phiBin;
+  const Double_t *first;
+  Double_t x1, x2;
 
   fItInputArray->Reset();
   while((candidate = static_cast<Candidate *>(fItInputArray->Next())))
@@ -142,107 +267,109 @@ void PhotonConversions::Process()
       py = candidateMomentum.Py();
       pz = candidateMomentum.Pz();
       pt = candidateMomentum.Pt();
-      pt2 = candidateMomentum.Perp2();
       eta = candidateMomentum.Eta();
       phi = candidateMomentum.Phi();
       e = candidateMomentum.E();
 
       if(eta < fEtaMin || eta > fEtaMax) continue;
 
-      // solve pt2*t^2 + 2*(px*x + py*y)*t - (fRadius2 - x*x - y*y) = 0
-      tmp = px * y - py * x;
-      discr2 = pt2 * fRadius2 - tmp * tmp;
-
-      if(discr2 < 0.0)
-      {
-        // no solutions
-        continue;
-      }
-
-      tmp = px * x + py * y;
-      discr = TMath::Sqrt(discr2);
-      t1 = (-tmp + discr) / pt2;
-      t2 = (-tmp - discr) / pt2;
-      t = (t1 < 0.0) ? t2 : t1;
-
-      z_t = z + pz * t;
-      if(TMath::Abs(z_t) > fHalfLength)
-      {
-        t3 = (+fHalfLength - z) / pz;
-        t4 = (-fHalfLength - z) / pz;
-        t = (t3 < 0.0) ? t4 : t3;
-      }
-
-      // final position
-      x_t = x + px * t;
-      y_t = y + py * t;
-      z_t = z + pz * t;
-
-      r_t = TMath::Sqrt(x_t * x_t + y_t * y_t + z_t * z_t);
+      t = PathLength(x, y, z, px, py, pz);
+      if(t < 0.0) continue;
 
       // here starts conversion code
-      nsteps = Int_t(r_t / fStep);
 
-      x_i = x;
-      y_i = y;
-      z_i = z;
+      // a single exponential draw gives the optical depth at which the photon converts
+      threshold = -TMath::Log(gRandom->Uniform());
 
-      dt = t / nsteps;
+      fraction = -1.0;
 
-      converted = false;
+      if(TMath::Hypot(x, y) < fTableTolerance && TMath::Abs(z) < fTableTolerance)
+      {
+        etaBin = TMath::Min(Int_t((eta - fEtaMin) / (fEtaMax - fEtaMin) * fTableEtaBins), fTableEtaBins - 1);
+        phiBin = TMath::Min(Int_t((phi + TMath::Pi()) / TMath::TwoPi() * fTablePhiBins), fTablePhiBins - 1);
+        etaBin = TMath::Max(etaBin, 0);
+        phiBin = TMath::Max(phiBin, 0);
+
+        bin = etaBin * fTablePhiBins + phiBin;
+        nsteps = fTableSteps[bin];
 
-      for(i = 0; i < nsteps; ++i)
+        if(nsteps > 0 && threshold < fTable[fTableOffset[bin] + nsteps - 1])
+        {
+          // find the first step where the accumulated depth exceeds the threshold
+          first = &fTable[fTableOffset[bin]];
+          i = upper_bound(first, first + nsteps, threshold) - first;
+          fraction = Double_t(i + 1) / nsteps;
+        }
+      }
+      else
       {
-        x_i += px * dt;
-        y_i += py * dt;
-        z_i += pz * dt;
-        pos_i.SetXYZ(x_i, y_i, z_i);
+        x_i = x + px * t;
+        y_i = y + py * t;
+        z_i = z + pz * t;
+        r_t = TMath::Sqrt(x_i * x_i + y_i * y_i + z_i * z_i);
+        nsteps = Int_t(r_t / fStep);
 
-        // convert photon position into cylindrical coordinates, cylindrical r,phi,z !!
+        dt = t / nsteps;
+        depth = 0.0;
 
-        r_i = TMath::Sqrt(x_i * x_i + y_i * y_i);
-        phi_i = pos_i.Phi();
+        for(i = 0; i < nsteps; ++i)
+        {
+          x_i = x + px * dt * (i + 1);
+          y_i = y + py * dt * (i + 1);
+          z_i = z + pz * dt * (i + 1);
 
-        // read conversion rate/meter from card
-        rate = fConversionMap->Eval(r_i, phi_i, z_i);
+          // convert photon position into cylindrical coordinates, cylindrical r,phi,z !!
 
-        // convert into conversion probability
-        p_conv = 1 - TMath::Exp(-7.0 / 9.0 * fStep * rate);
+          r_i = TMath::Sqrt(x_i * x_i + y_i * y_i);
+          phi_i = TMath::ATan2(y_i, x_i);
 
-        // case conversion occurs
-        if(gRandom->Uniform() < p_conv)
-        {
-          converted = true;
+          // read conversion rate/meter from card
+          depth += 7.0 / 9.0 * fStep * fConversionMap->Eval(r_i, phi_i, z_i);
+
+          if(depth > threshold)
+          {
+            fraction = Double_t(i + 1) / nsteps;
+            break;
+          }
+        }
+      }
 
-          // generate x1 and x2, the fraction of the photon energy taken resp. by e+ and e-
-          x1 = fDecayXsec->GetRandom();
-          x2 = 1 - x1;
+      // case conversion occurs
+      if(fraction > 0.0)
+      {
+        x_i = x + px * t * fraction;
+        y_i = y + py * t * fraction;
+        z_i = z + pz * t * fraction;
 
-          ep = static_cast<Candidate *>(candidate->Clone());
-          em = static_cast<Candidate *>(candidate->Clone());
+        // generate x1 and x2, the fraction of the photon energy taken resp. by e+ and e-
+        x1 = GenerateEnergyFraction();
+        x2 = 1 - x1;
 
-          ep->Position.SetXYZT(x_i * 1.0E3, y_i * 1.0E3, z_i * 1.0E3, candidatePosition.T() + nsteps * dt * e * 1.0E3);
-          em->Position.SetXYZT(x_i * 1.0E3, y_i * 1.0E3, z_i * 1.0E3, candidatePosition.T() + nsteps * dt * e * 1.0E3);
+        ep = static_cast<Candidate *>(candidate->Clone());
+        em = static_cast<Candidate *>(candidate->Clone());
 
-          ep->Momentum.SetPtEtaPhiE(x1 * pt, eta, phi, x1 * e);
-          em->Momentum.SetPtEtaPhiE(x2 * pt, eta, phi, x2 * e);
+        ep->Position.SetXYZT(x_i * 1.0E3, y_i * 1.0E3, z_i * 1.0E3, candidatePosition.T() + t * e * 1.0E3);
+        em->Position.SetXYZT(x_i * 1.0E3, y_i * 1.0E3, z_i * 1.0E3, candidatePosition.T() + t * e * 1.0E3);
 
-          ep->PID = -11;
-          em->PID = 11;
+        ep->Momentum.SetPtEtaPhiE(x1 * pt, eta, phi, x1 * e);
+        em->Momentum.SetPtEtaPhiE(x2 * pt, eta, phi, x2 * e);
 
-          ep->Charge = 1.0;
-          em->Charge = -1.0;
+        ep->PID = -11;
+        em->PID = 11;
 
-          ep->IsFromConversion = 1;
-          em->IsFromConversion = 1;
+        ep->Charge = 1.0;
+        em->Charge = -1.0;
 
-          fOutputArray->Add(em);
-          fOutputArray->Add(ep);
+        ep->IsFromConversion = 1;
+        em->IsFromConversion = 1;
 
-          break;
-        }
+        fOutputArray->Add(em);
+        fOutputArray->Add(ep);
+      }
+      else
+      {
+        fOutputArray->Add(candidate);
       }
-      if(!converted) fOutputArray->Add(candidate);
     }
   }
 }
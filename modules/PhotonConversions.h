@@ -29,10 +29,11 @@
 
 #include "classes/DelphesModule.h"
 
+#include <vector>
+
 class TClonesArray;
 class TIterator;
 class DelphesCylindricalFormula;
-class TF1;
 
 class PhotonConversions: public DelphesModule
 {
@@ -56,10 +57,21 @@ private:
 
   DelphesCylindricalFormula *fConversionMap; //!
 
-  TF1 *fDecayXsec; //!
-
   Double_t fStep;
 
+  Int_t fTableEtaBins, fTablePhiBins;
+  Double_t fTableTolerance;
+
+  // cumulative conversion probability (in units of optical depth) along
+  // straight lines from the origin, one block of steps per (eta, phi) bin
+  std::vector<Double_t> fTable; //!
+  std::vector<Int_t> fTableOffset; //!
+  std::vector<Int_t> fTableSteps; //!
+
+  void BuildTable();
+  Double_t PathLength(Double_t x, Double_t y, Double_t z, Double_t px, Double_t py, Double_t pz) const;
+  Double_t GenerateEnergyFraction() const;
+
   ClassDef(PhotonConversions, 1)
 };
 
@@ -12,6 +12,7 @@
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesFormula.h"
+#include "classes/DelphesNeighbourIndex.h"
 
 #include "ExRootAnalysis/ExRootClassifier.h"
 #include "ExRootAnalysis/ExRootFilter.h"
@@ -35,7 +36,7 @@ using namespace std;
 //------------------------------------------------------------------------------
 
 PileUpJetID::PileUpJetID() :
-  fItJetInputArray(0), fTrackInputArray(0), fNeutralInputArray(0)
+  fItJetInputArray(0), fTrackIndex(0), fNeutralIndex(0)
 {
 }
 
@@ -69,11 +70,9 @@ void PileUpJetID::Init()
   fJetInputArray = ImportArray(GetString("JetInputArray", "FastJetFinder/jets"));
   fItJetInputArray = fJetInputArray->MakeIterator();
 
-  fTrackInputArray = ImportArray(GetString("TrackInputArray", "ParticlePropagator/tracks"));
-  fItTrackInputArray = fTrackInputArray->MakeIterator();
+  fTrackIndex = ImportNeighbourIndex(GetString("TrackInputArray", "ParticlePropagator/tracks"));
 
-  fNeutralInputArray = ImportArray(GetString("NeutralInputArray", "ParticlePropagator/tracks"));
-  fItNeutralInputArray = fNeutralInputArray->MakeIterator();
+  fNeutralIndex = ImportNeighbourIndex(GetString("NeutralInputArray", "ParticlePropagator/tracks"));
 
   // create output array(s)
 
@@ -89,8 +88,6 @@ void PileUpJetID::Finish()
   //  cout << "In finish" << endl;
 
   if(fItJetInputArray) delete fItJetInputArray;
-  if(fItTrackInputArray) delete fItTrackInputArray;
-  if(fItNeutralInputArray) delete fItNeutralInputArray;
 }
 
 //------------------------------------------------------------------------------
@@ -109,6 +106,9 @@ void PileUpJetID::Process()
     momentum = candidate->Momentum;
     area = candidate->Area;
 
+    double eta = momentum.Eta();
+    double phi = momentum.Phi();
+
     float sumT0 = 0.;
     float sumT1 = 0.;
     float sumT10 = 0.;
@@ -206,12 +206,13 @@ void PileUpJetID::Process()
     else
     {
       // Not using constituents, using dr
-      fItTrackInputArray->Reset();
-      while((trk = static_cast<Candidate *>(fItTrackInputArray->Next())))
+      fTrackIndex->Find(eta, phi, fParameterR, fNeighbours);
+      for(int j = 0; j < int(fNeighbours.size()); j++)
       {
-        if(trk->Momentum.DeltaR(candidate->Momentum) < fParameterR)
+        if(fNeighbours[j].deltaR < fParameterR)
         {
-          float pt = trk->Momentum.Pt();
+          trk = fTrackIndex->GetCandidate(fNeighbours[j].index);
+          float pt = fTrackIndex->GetPT(fNeighbours[j].index);
           sumpt += pt;
           sumptch += pt;
           if(trk->IsRecoPU)
@@ -222,7 +223,7 @@ void PileUpJetID::Process()
           {
             sumptchpv += pt;
           }
-          float dr = candidate->Momentum.DeltaR(trk->Momentum);
+          float dr = fNeighbours[j].deltaR;
           sumdrsqptsq += dr * dr * pt * pt;
           sumptsq += pt * pt;
           nc++;
@@ -235,14 +236,14 @@ void PileUpJetID::Process()
           }
         }
       }
-      fItNeutralInputArray->Reset();
-      while((constituent = static_cast<Candidate *>(fItNeutralInputArray->Next())))
+      fNeutralIndex->Find(eta, phi, fParameterR, fNeighbours);
+      for(int j = 0; j < int(fNeighbours.size()); j++)
       {
-        if(constituent->Momentum.DeltaR(candidate->Momentum) < fParameterR)
+        if(fNeighbours[j].deltaR < fParameterR)
         {
-          float pt = constituent->Momentum.Pt();
+          float pt = fNeutralIndex->GetPT(fNeighbours[j].index);
           sumpt += pt;
-          float dr = candidate->Momentum.DeltaR(constituent->Momentum);
+          float dr = fNeighbours[j].deltaR;
           sumdrsqptsq += dr * dr * pt * pt;
           sumptsq += pt * pt;
           nn++;
@@ -341,11 +342,12 @@ void PileUpJetID::Process()
       }
       else
       { // use DeltaR
-        fItNeutralInputArray->Reset();
-        while((constituent = static_cast<Candidate *>(fItNeutralInputArray->Next())))
+        fNeutralIndex->Find(eta, phi, fParameterR, fNeighbours);
+        for(int j = 0; j < int(fNeighbours.size()); j++)
         {
-          if(constituent->Momentum.DeltaR(candidate->Momentum) < fParameterR && constituent->Momentum.Pt() > fNeutralPTMin)
+          if(fNeighbours[j].deltaR < fParameterR && fNeutralIndex->GetPT(fNeighbours[j].index) > fNeutralPTMin)
           {
+            constituent = fNeutralIndex->GetCandidate(fNeighbours[j].index);
             fNeutralsInPassingJets->Add(constituent);
             //            cout << "    Constitutent added Pt Eta Charge " << constituent->Momentum.Pt() << " " << constituent->Momentum.Eta() << " " << constituent->Charge << endl;
           }
@@ -12,6 +12,9 @@
 #include "classes/DelphesModule.h"
 
 #include <deque>
+#include <vector>
+
+#include "classes/DelphesNeighbourIndex.h"
 
 class TObjArray;
 class DelphesFormula;
@@ -92,11 +95,10 @@ MeanSqDeltaR
 
   const TObjArray *fJetInputArray; //!
 
-  const TObjArray *fTrackInputArray; // SCZ
-  const TObjArray *fNeutralInputArray;
+  DelphesNeighbourIndex *fTrackIndex; //!
+  DelphesNeighbourIndex *fNeutralIndex; //!
 
-  TIterator *fItTrackInputArray; // SCZ
-  TIterator *fItNeutralInputArray; // SCZ
+  std::vector<DelphesNeighbourIndex::TNeighbour> fNeighbours; //!
 
   TObjArray *fOutputArray; //!
   TObjArray *fNeutralsInPassingJets; // SCZ
@@ -20,6 +20,11 @@
  *
  *  Merges particles from pile-up sample into event
  *
+ *  With NumberOfThreads > 0, minimum-bias events are generated ahead of
+ *  time by independently seeded Pythia8 instances running in worker
+ *  threads. Events are taken from the workers in turn, so that
+ *  the sequence of pile-up events does not depend on thread timing.
+ *
  *  \author M. Selvaggi - UCL, Louvain-la-Neuve
  *
  */
@@ -55,7 +60,7 @@ using namespace std;
 //------------------------------------------------------------------------------
 
 PileUpMergerPythia8::PileUpMergerPythia8() :
-  fFunction(0), fPythia(0), fItInputArray(0)
+  fFunction(0), fPythia(0), fItInputArray(0), fStopWorkers(kFALSE), fEventCounter(0)
 {
   fFunction = new DelphesTF2;
 }
@@ -90,9 +95,26 @@ void PileUpMergerPythia8::Init()
   fFunction->Compile(GetString("VertexDistributionFormula", "0.0"));
   fFunction->SetRange(-fZVertexSpread, -fTVertexSpread, fZVertexSpread, fTVertexSpread);
 
+  fNumberOfThreads = GetInt("NumberOfThreads", 0);
+  fQueueSize = GetInt("QueueSize", 256);
+
+  if(fNumberOfThreads < 0 || fQueueSize < 1)
+  {
+    stringstream message;
+    message << "invalid NumberOfThreads or QueueSize in module '" << GetName() << "'";
+    throw runtime_error(message.str());
+  }
+
   fileName = GetString("ConfigFile", "MinBias.cmnd");
-  fPythia = new Pythia8::Pythia();
-  fPythia->readFile(fileName);
+  if(fNumberOfThreads > 0)
+  {
+    StartWorkers(fileName);
+  }
+  else
+  {
+    fPythia = new Pythia8::Pythia();
+    fPythia->readFile(fileName);
+  }
 
   // import input array
   fInputArray = ImportArray(GetString("InputArray", "Delphes/stableParticles"));
@@ -107,22 +129,237 @@ void PileUpMergerPythia8::Init()
 
 void PileUpMergerPythia8::Finish()
 {
+  StopWorkers();
   if(fPythia) delete fPythia;
 }
 
 //------------------------------------------------------------------------------
 
-void PileUpMergerPythia8::Process()
+void PileUpMergerPythia8::StartWorkers(const char *fileName)
+{
+  Int_t i;
+  TWorker *worker;
+  stringstream seed;
+
+  fStopWorkers = kFALSE;
+  fEventCounter = 0;
+
+  for(i = 0; i < fNumberOfThreads; ++i)
+  {
+    worker = new TWorker;
+    worker->pythia = new Pythia8::Pythia();
+    worker->pythia->readFile(fileName);
+
+    // each instance gets its own seed, drawn from the Delphes random generator
+    seed.str("");
+    seed << "Random:seed = " << gRandom->Integer(900000000) + 1;
+    worker->pythia->readString("Random:setSeed = on");
+    worker->pythia->readString(seed.str());
+
+    if(!worker->pythia->init())
+    {
+      delete worker->pythia;
+      delete worker;
+      StopWorkers();
+      stringstream message;
+      message << "cannot initialize Pythia8 with " << fileName << " in module '" << GetName() << "'";
+      throw runtime_error(message.str());
+    }
+
+    worker->queue.resize(fQueueSize);
+    worker->head = 0;
+    worker->tail = 0;
+
+    fWorkers.push_back(worker);
+  }
+
+  for(i = 0; i < fNumberOfThreads; ++i)
+  {
+    worker = fWorkers[i];
+    worker->thread = thread(&PileUpMergerPythia8::WorkerLoop, this, worker);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void PileUpMergerPythia8::StopWorkers()
+{
+  vector<TWorker *>::iterator itWorker;
+
+  fStopWorkers = kTRUE;
+
+  // the flag is set before taking the mutex, so that a worker cannot miss
+  // the notification between testing the flag and waiting
+
+  for(itWorker = fWorkers.begin(); itWorker != fWorkers.end(); ++itWorker)
+  {
+    {
+      lock_guard<mutex> lock((*itWorker)->mutex);
+    }
+    (*itWorker)->notFull.notify_all();
+  }
+
+  for(itWorker = fWorkers.begin(); itWorker != fWorkers.end(); ++itWorker)
+  {
+    if((*itWorker)->thread.joinable()) (*itWorker)->thread.join();
+    delete (*itWorker)->pythia;
+    delete *itWorker;
+  }
+
+  fWorkers.clear();
+}
+
+//------------------------------------------------------------------------------
+
+void PileUpMergerPythia8::WorkerLoop(TWorker *worker)
+{
+  ULong64_t tail;
+  const ULong64_t size = worker->queue.size();
+
+  while(!fStopWorkers)
+  {
+    // wait for Process to free a slot
+    {
+      unique_lock<mutex> lock(worker->mutex);
+      while(!fStopWorkers && worker->tail - worker->head >= size)
+      {
+        worker->notFull.wait(lock);
+      }
+      if(fStopWorkers) return;
+      tail = worker->tail;
+    }
+
+    while(!worker->pythia->next())
+    {
+      if(fStopWorkers) return;
+    }
+
+    // Process does not read the slot at tail until tail is advanced
+    DecodeEvent(worker->pythia->event, worker->queue[tail % size]);
+
+    {
+      lock_guard<mutex> lock(worker->mutex);
+      worker->tail = tail + 1;
+    }
+    worker->notEmpty.notify_one();
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void PileUpMergerPythia8::DecodeEvent(Pythia8::Event &event, TEventRecord &record)
+{
+  Int_t i;
+  TParticleRecord particleRecord;
+
+  record.numberOfParticles = event.size();
+  record.particles.clear();
+
+  for(i = 1; i < record.numberOfParticles; ++i)
+  {
+    Pythia8::Particle &particle = event[i];
+
+    if(particle.statusHepMC() != 1 || !particle.isVisible() || particle.pT() <= fPTMin) continue;
+
+    particleRecord.pid = particle.id();
+    particleRecord.px = particle.px();
+    particleRecord.py = particle.py();
+    particleRecord.pz = particle.pz();
+    particleRecord.e = particle.e();
+    particleRecord.x = particle.xProd();
+    particleRecord.y = particle.yProd();
+    particleRecord.z = particle.zProd();
+    particleRecord.t = particle.tProd();
+
+    record.particles.push_back(particleRecord);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void PileUpMergerPythia8::AddEvent(const TEventRecord &record)
 {
   TDatabasePDG *pdg = TDatabasePDG::Instance();
   TParticlePDG *pdgParticle;
-  Int_t pid, status;
+  Int_t pid;
   Float_t x, y, z, t, vx, vy;
-  Float_t px, py, pz, e;
   Double_t dz, dphi, dt;
-  Int_t numberOfEvents, event, numberOfParticles, i;
+  Candidate *candidate, *vertex;
+  DelphesFactory *factory = GetFactory();
+  vector<TParticleRecord>::const_iterator itParticle;
+
+  const Double_t c_light = 2.99792458E8;
+
+  // --- Pile-up vertex smearing
+
+  fFunction->GetRandom2(dz, dt);
+
+  dt *= c_light * 1.0E3; // necessary in order to make t in mm/c
+  dz *= 1.0E3; // necessary in order to make z in mm
+
+  dphi = gRandom->Uniform(-TMath::Pi(), TMath::Pi());
+
+  vx = 0.0;
+  vy = 0.0;
+  for(itParticle = record.particles.begin(); itParticle != record.particles.end(); ++itParticle)
+  {
+    pid = itParticle->pid;
+    x = itParticle->x;
+    y = itParticle->y;
+    z = itParticle->z;
+    t = itParticle->t;
+
+    candidate = factory->NewCandidate();
+
+    candidate->PID = pid;
+
+    candidate->Status = 1;
+
+    pdgParticle = pdg->GetParticle(pid);
+    candidate->Charge = pdgParticle ? Int_t(pdgParticle->Charge() / 3.0) : -999;
+    candidate->Mass = pdgParticle ? pdgParticle->Mass() : -999.9;
+
+    candidate->IsPU = 1;
+
+    candidate->Momentum.SetPxPyPzE(itParticle->px, itParticle->py, itParticle->pz, itParticle->e);
+    candidate->Momentum.RotateZ(dphi);
+
+    x -= fInputBeamSpotX;
+    y -= fInputBeamSpotY;
+    candidate->Position.SetXYZT(x, y, z + dz, t + dt);
+    candidate->Position.RotateZ(dphi);
+    candidate->Position += TLorentzVector(fOutputBeamSpotX, fOutputBeamSpotY, 0.0, 0.0);
+
+    vx += candidate->Position.X();
+    vy += candidate->Position.Y();
+
+    fParticleOutputArray->Add(candidate);
+  }
+
+  if(record.numberOfParticles > 0)
+  {
+    vx /= record.numberOfParticles;
+    vy /= record.numberOfParticles;
+  }
+
+  vertex = factory->NewCandidate();
+  vertex->Position.SetXYZT(vx, vy, dz, dt);
+  vertex->IsPU = 1;
+
+  fVertexOutputArray->Add(vertex);
+}
+
+//------------------------------------------------------------------------------
+
+void PileUpMergerPythia8::Process()
+{
+  Float_t z, t, vx, vy;
+  Double_t dz, dt;
+  Int_t numberOfEvents, event, numberOfParticles;
   Candidate *candidate, *vertex;
   DelphesFactory *factory;
+  TWorker *worker;
+  ULong64_t head;
 
   const Double_t c_light = 2.99792458E8;
 
@@ -177,77 +414,37 @@ void PileUpMergerPythia8::Process()
 
   for(event = 0; event < numberOfEvents; ++event)
   {
-    while(!fPythia->next())
-      ;
-
-    // --- Pile-up vertex smearing
-
-    fFunction->GetRandom2(dz, dt);
-
-    dt *= c_light * 1.0E3; // necessary in order to make t in mm/c
-    dz *= 1.0E3; // necessary in order to make z in mm
-
-    dphi = gRandom->Uniform(-TMath::Pi(), TMath::Pi());
-
-    vx = 0.0;
-    vy = 0.0;
-    numberOfParticles = fPythia->event.size();
-    for(i = 1; i < numberOfParticles; ++i)
+    if(fWorkers.empty())
     {
-      Pythia8::Particle &particle = fPythia->event[i];
-
-      status = particle.statusHepMC();
-
-      if(status != 1 || !particle.isVisible() || particle.pT() <= fPTMin) continue;
-
-      pid = particle.id();
-      px = particle.px();
-      py = particle.py();
-      pz = particle.pz();
-      e = particle.e();
-      x = particle.xProd();
-      y = particle.yProd();
-      z = particle.zProd();
-      t = particle.tProd();
-
-      candidate = factory->NewCandidate();
-
-      candidate->PID = pid;
-
-      candidate->Status = 1;
+      while(!fPythia->next())
+        ;
 
-      pdgParticle = pdg->GetParticle(pid);
-      candidate->Charge = pdgParticle ? Int_t(pdgParticle->Charge() / 3.0) : -999;
-      candidate->Mass = pdgParticle ? pdgParticle->Mass() : -999.9;
-
-      candidate->IsPU = 1;
-
-      candidate->Momentum.SetPxPyPzE(px, py, pz, e);
-      candidate->Momentum.RotateZ(dphi);
-
-      x -= fInputBeamSpotX;
-      y -= fInputBeamSpotY;
-      candidate->Position.SetXYZT(x, y, z + dz, t + dt);
-      candidate->Position.RotateZ(dphi);
-      candidate->Position += TLorentzVector(fOutputBeamSpotX, fOutputBeamSpotY, 0.0, 0.0);
-
-      vx += candidate->Position.X();
-      vy += candidate->Position.Y();
-
-      fParticleOutputArray->Add(candidate);
+      DecodeEvent(fPythia->event, fEventRecord);
+      AddEvent(fEventRecord);
     }
-
-    if(numberOfParticles > 0)
+    else
     {
-      vx /= numberOfParticles;
-      vy /= numberOfParticles;
+      worker = fWorkers[fEventCounter % fWorkers.size()];
+      ++fEventCounter;
+
+      {
+        unique_lock<mutex> lock(worker->mutex);
+        while(worker->tail == worker->head)
+        {
+          worker->notEmpty.wait(lock);
+        }
+        head = worker->head;
+      }
+
+      // the worker does not overwrite the slot at head until head is advanced
+      AddEvent(worker->queue[head % worker->queue.size()]);
+
+      {
+        lock_guard<mutex> lock(worker->mutex);
+        worker->head = head + 1;
+      }
+      worker->notFull.notify_one();
     }
-
-    vertex = factory->NewCandidate();
-    vertex->Position.SetXYZT(vx, vy, dz, dt);
-    vertex->IsPU = 1;
-
-    fVertexOutputArray->Add(vertex);
   }
 }
 
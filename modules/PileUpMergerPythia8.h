@@ -29,12 +29,21 @@
 
 #include "classes/DelphesModule.h"
 
+#if !defined(__CINT__) && !defined(__CLING__)
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#endif
+
 class TObjArray;
 class DelphesTF2;
 
 namespace Pythia8
 {
 class Pythia;
+class Event;
 };
 
 class PileUpMergerPythia8: public DelphesModule
@@ -61,10 +70,55 @@ private:
 
   Double_t fPTMin;
 
+  Int_t fNumberOfThreads;
+  Int_t fQueueSize;
+
   DelphesTF2 *fFunction; //!
 
   Pythia8::Pythia *fPythia; //!
 
+#if !defined(__CINT__) && !defined(__CLING__)
+  struct TParticleRecord
+  {
+    Int_t pid;
+    Float_t px, py, pz, e;
+    Float_t x, y, z, t;
+  };
+
+  struct TEventRecord
+  {
+    Int_t numberOfParticles;
+    std::vector<TParticleRecord> particles;
+  };
+
+  // minimum-bias events generated by one Pythia8 instance in a worker
+  // thread, and passed to Process through a ring buffer, the positions
+  // head and tail are guarded by the mutex and each side waits on a
+  // condition variable while the buffer is empty or full
+  struct TWorker
+  {
+    Pythia8::Pythia *pythia;
+    std::thread thread;
+    std::vector<TEventRecord> queue;
+    ULong64_t head, tail;
+    std::mutex mutex;
+    std::condition_variable notEmpty, notFull;
+  };
+
+  void StartWorkers(const char *fileName);
+  void StopWorkers();
+  void WorkerLoop(TWorker *worker);
+
+  void DecodeEvent(Pythia8::Event &event, TEventRecord &record);
+  void AddEvent(const TEventRecord &record);
+
+  std::vector<TWorker *> fWorkers; //!
+  std::atomic<Bool_t> fStopWorkers; //!
+  ULong64_t fEventCounter; //!
+
+  TEventRecord fEventRecord; //!
+#endif
+
   TIterator *fItInputArray; //!
 
   const TObjArray *fInputArray; //!
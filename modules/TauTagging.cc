@@ -281,6 +281,7 @@ void TauTagging::Process()
     // apply an efficency formula
     eff = formula->Eval(pt, eta, phi, e);
     jet->TauFlavor = pdgCode;
+    jet->TauTag &= ~(1U << fBitNumber);
     jet->TauTag |= (gRandom->Uniform() <= eff) << fBitNumber;
     jet->TauWeight = eff;
 
@@ -93,7 +93,8 @@ void TimeOfFlight::Finish()
 
 void TimeOfFlight::Process()
 {
-  Candidate *candidate, *particle, *vertex, *constituent, *mother;
+  Candidate *candidate, *particle, *mother;
+  unordered_map<const Candidate *, Candidate *>::const_iterator itParticleVertexMap;
   Double_t ti, t_truth, tf;
   Double_t l, tof, beta, p,  mass;
 
@@ -139,21 +140,11 @@ void TimeOfFlight::Process()
     	{
         // same as 2 but attempt at estimate beta from vertex mass and momentum
         beta = 1.;
-        fItVertexInputArray->Reset();
-        while((vertex = static_cast<Candidate *>(fItVertexInputArray->Next())))
+        itParticleVertexMap = fParticleVertexMap.find(particle);
+        if(itParticleVertexMap != fParticleVertexMap.end())
         {
-          TIter itGenParts(vertex->GetCandidates());
-          itGenParts.Reset();
-
-          while((constituent = static_cast<Candidate *>(itGenParts.Next())))
-          {
-            if (particle == constituent)
-            {
-              beta = vertex->Momentum.Beta();
-              break;
-            }
-          }
-        } // end vertex  loop
+          beta = itParticleVertexMap->second->Momentum.Beta();
+        }
 
         // track displacement to be possibily replaced by vertex fitted position
         ti = candidateInitialPositionSmeared.Vect().Mag() * 1.0E-3 /(beta*c_light);
@@ -197,6 +188,38 @@ void TimeOfFlight::Process()
 void TimeOfFlight::ComputeVertexMomenta()
 {
   Candidate *track, *constituent, *particle, *vertex;
+  unordered_map<const Candidate *, pair<Int_t, Int_t> >::iterator itParticleTrackMap;
+  Int_t i;
+
+  // index the tracks by generated particle, keeping the input order
+  // of the tracks that share the same particle
+
+  fTrackList.clear();
+  fNextTrack.clear();
+  fParticleTrackMap.clear();
+  fParticleVertexMap.clear();
+
+  fItInputArray->Reset();
+  while((track = static_cast<Candidate *>(fItInputArray->Next())))
+  {
+    // get gen part that generated track
+    particle = static_cast<Candidate *>(track->GetCandidates()->At(0));
+
+    i = fTrackList.size();
+    fTrackList.push_back(track);
+    fNextTrack.push_back(-1);
+
+    itParticleTrackMap = fParticleTrackMap.find(particle);
+    if(itParticleTrackMap == fParticleTrackMap.end())
+    {
+      fParticleTrackMap.insert(make_pair(particle, make_pair(i, i)));
+    }
+    else
+    {
+      fNextTrack[itParticleTrackMap->second.second] = i;
+      itParticleTrackMap->second.second = i;
+    }
+  } // end track loop
 
   fItVertexInputArray->Reset();
   while((vertex = static_cast<Candidate *>(fItVertexInputArray->Next())))
@@ -207,17 +230,18 @@ void TimeOfFlight::ComputeVertexMomenta()
 
     while((constituent = static_cast<Candidate *>(itGenParts.Next())))
     {
-      fItInputArray->Reset();
-      while((track = static_cast<Candidate *>(fItInputArray->Next())))
-      {
-        // get gen part that generated track
-        particle = static_cast<Candidate *>(track->GetCandidates()->At(0));
-        if (particle == constituent)
-        {
-          vertex->Momentum += track->Momentum;
-        }
+      // the last vertex containing the particle is used to compute its time
+      fParticleVertexMap[constituent] = vertex;
+
+      itParticleTrackMap = fParticleTrackMap.find(constituent);
+      if(itParticleTrackMap == fParticleTrackMap.end()) continue;
 
-      } // end track loop
+      for(i = itParticleTrackMap->second.first; i >= 0; i = fNextTrack[i])
+      {
+        vertex->Momentum += fTrackList[i]->Momentum;
+      }
     } // end vertex consitutent loop
   } // end vertex  loop
 }
+
+//------------------------------------------------------------------------------
@@ -29,8 +29,13 @@
 
 #include "classes/DelphesModule.h"
 
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 class TIterator;
 class TObjArray;
+class Candidate;
 
 class TimeOfFlight: public DelphesModule
 {
@@ -55,6 +60,13 @@ private:
 
   TObjArray *fOutputArray; //!
 
+  // per-event index of the tracks and of the vertex of each generated particle
+
+  std::vector<Candidate *> fTrackList; //!
+  std::vector<Int_t> fNextTrack; //!
+  std::unordered_map<const Candidate *, std::pair<Int_t, Int_t> > fParticleTrackMap; //!
+  std::unordered_map<const Candidate *, Candidate *> fParticleVertexMap; //!
+
   ClassDef(TimeOfFlight, 1)
 };
 
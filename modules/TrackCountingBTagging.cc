@@ -29,6 +29,7 @@
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesFormula.h"
+#include "classes/DelphesNeighbourIndex.h"
 
 #include "TFormula.h"
 #include "TLorentzVector.h"
@@ -47,7 +48,7 @@ using namespace std;
 //------------------------------------------------------------------------------
 
 TrackCountingBTagging::TrackCountingBTagging() :
-  fItTrackInputArray(0), fItJetInputArray(0)
+  fItJetInputArray(0), fTrackIndex(0)
 {
 }
 
@@ -74,8 +75,7 @@ void TrackCountingBTagging::Init()
 
   // import input array(s)
 
-  fTrackInputArray = ImportArray(GetString("TrackInputArray", "Calorimeter/eflowTracks"));
-  fItTrackInputArray = fTrackInputArray->MakeIterator();
+  fTrackIndex = ImportNeighbourIndex(GetString("TrackInputArray", "Calorimeter/eflowTracks"));
 
   fJetInputArray = ImportArray(GetString("JetInputArray", "FastJetFinder/jets"));
   fItJetInputArray = fJetInputArray->MakeIterator();
@@ -85,7 +85,6 @@ void TrackCountingBTagging::Init()
 
 void TrackCountingBTagging::Finish()
 {
-  if(fItTrackInputArray) delete fItTrackInputArray;
   if(fItJetInputArray) delete fItJetInputArray;
 }
 
@@ -96,12 +95,11 @@ void TrackCountingBTagging::Process()
   Candidate *jet, *track;
 
   Double_t jpx, jpy, jpz;
-  Double_t dr, tpt;
   Double_t xd, yd, zd, d0, dd0, dz, ddz, sip;
 
   Int_t sign;
 
-  Int_t count;
+  Int_t count, i, n;
 
   // loop over all input jets
   fItJetInputArray->Reset();
@@ -112,22 +110,20 @@ void TrackCountingBTagging::Process()
     jpy = jetMomentum.Py();
     jpz = jetMomentum.Pz();
 
-    // loop over all input tracks
-    fItTrackInputArray->Reset();
+    // loop over the input tracks inside the jet cone
+    fTrackIndex->Find(jetMomentum.Eta(), jetMomentum.Phi(), fDeltaR, fNeighbours);
+    n = fNeighbours.size();
     count = 0;
     // stop once we have enough tracks
-    while((track = static_cast<Candidate *>(fItTrackInputArray->Next())) and count < fNtracks)
+    for(i = 0; i < n && count < fNtracks; ++i)
     {
-      const TLorentzVector &trkMomentum = track->Momentum;
-      tpt = trkMomentum.Pt();
-      if(tpt < fPtMin) continue;
+      if(fTrackIndex->GetPT(fNeighbours[i].index) < fPtMin) continue;
+
+      track = fTrackIndex->GetCandidate(fNeighbours[i].index);
 
       d0 = TMath::Abs(track->D0);
       if(d0 > fIPmax) continue;
 
-      dr = jetMomentum.DeltaR(trkMomentum);
-      if(dr > fDeltaR) continue;
-
       xd = track->Xd;
       yd = track->Yd;
       zd = track->Zd;
@@ -150,7 +146,8 @@ void TrackCountingBTagging::Process()
       if(sip > fSigMin) count++;
     }
 
-    // set BTag flag to true if count >= Ntracks
+    // set BTag flag to true if count >= Ntracks, clearing any previous value
+    jet->BTag &= ~(1U << fBitNumber);
     jet->BTag |= (count >= fNtracks) << fBitNumber;
   }
 }
@@ -30,6 +30,9 @@
 #include "classes/DelphesModule.h"
 
 #include <map>
+#include <vector>
+
+#include "classes/DelphesNeighbourIndex.h"
 
 class TObjArray;
 
@@ -53,12 +56,13 @@ private:
   Int_t fNtracks;
   Bool_t fUse3D;
 
-  TIterator *fItTrackInputArray; //!
   TIterator *fItJetInputArray; //!
 
-  const TObjArray *fTrackInputArray; //!
+  DelphesNeighbourIndex *fTrackIndex; //!
   const TObjArray *fJetInputArray; //!
 
+  std::vector<DelphesNeighbourIndex::TNeighbour> fNeighbours; //!
+
   ClassDef(TrackCountingBTagging, 1)
 };
 
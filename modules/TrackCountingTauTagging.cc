@@ -18,6 +18,7 @@
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesFormula.h"
+#include "classes/DelphesNeighbourIndex.h"
 
 #include "ExRootAnalysis/ExRootClassifier.h"
 #include "ExRootAnalysis/ExRootFilter.h"
@@ -108,7 +109,7 @@ Int_t TrackCountingTauTaggingPartonClassifier::GetCategory(TObject *object)
 
 TrackCountingTauTagging::TrackCountingTauTagging() :
   fClassifier(0), fFilter(0),
-  fItPartonInputArray(0), fItTrackInputArray(0), fItJetInputArray(0)
+  fItPartonInputArray(0), fItJetInputArray(0), fTrackIndex(0)
 {
 }
 
@@ -167,8 +168,7 @@ void TrackCountingTauTagging::Init()
   fPartonInputArray = ImportArray(GetString("PartonInputArray", "Delphes/partons"));
   fItPartonInputArray = fPartonInputArray->MakeIterator();
 
-  fTrackInputArray = ImportArray(GetString("TrackInputArray", "TrackMerger/tracks"));
-  fItTrackInputArray = fTrackInputArray->MakeIterator();
+  fTrackIndex = ImportNeighbourIndex(GetString("TrackInputArray", "TrackMerger/tracks"));
 
   fFilter = new ExRootFilter(fPartonInputArray);
 
@@ -186,7 +186,6 @@ void TrackCountingTauTagging::Finish()
   if(fFilter) delete fFilter;
   if(fClassifier) delete fClassifier;
   if(fItJetInputArray) delete fItJetInputArray;
-  if(fItTrackInputArray) delete fItTrackInputArray;
   if(fItPartonInputArray) delete fItPartonInputArray;
 
   for(itEfficiencyMap = fEfficiencyMap.begin(); itEfficiencyMap != fEfficiencyMap.end(); ++itEfficiencyMap)
@@ -206,7 +205,7 @@ void TrackCountingTauTagging::Process()
   TObjArray *tauArray;
   map<Int_t, DelphesFormula *>::iterator itEfficiencyMap;
   DelphesFormula *formula;
-  Int_t pdgCode, charge, i, identifier;
+  Int_t pdgCode, charge, i, j, identifier;
 
   // select taus
   fFilter->Reset();
@@ -229,16 +228,14 @@ void TrackCountingTauTagging::Process()
     pt = jetMomentum.Pt();
     e = jetMomentum.E();
 
-    // loop over all input tracks
-    fItTrackInputArray->Reset();
-    while((track = static_cast<Candidate *>(fItTrackInputArray->Next())))
+    // loop over the input tracks inside the jet cone
+    fTrackIndex->Find(eta, phi, fDeltaRTrack, fNeighbours);
+    for(j = 0; j < Int_t(fNeighbours.size()); ++j)
     {
-      if((track->Momentum).Pt() < fTrackPTMin) continue;
-      if(jetMomentum.DeltaR(track->Momentum) <= fDeltaRTrack)
-      {
-        identifier -= 1;
-        charge += track->Charge;
-      }
+      if(fTrackIndex->GetPT(fNeighbours[j].index) < fTrackPTMin) continue;
+      track = fTrackIndex->GetCandidate(fNeighbours[j].index);
+      identifier -= 1;
+      charge += track->Charge;
     }
 
     // loop over all input taus
@@ -287,6 +284,7 @@ void TrackCountingTauTagging::Process()
     // apply an efficency formula
 
     // apply an efficency formula
+    jet->TauTag &= ~(1U << fBitNumber);
     jet->TauTag |= (gRandom->Uniform() <= formula->Eval(pt, eta, phi, e)) << fBitNumber;
 
     // set tau charge
@@ -18,6 +18,9 @@
 #include "classes/DelphesModule.h"
 
 #include <map>
+#include <vector>
+
+#include "classes/DelphesNeighbourIndex.h"
 
 class TObjArray;
 class DelphesFormula;
@@ -50,13 +53,13 @@ private:
 
   TIterator *fItPartonInputArray; //!
 
-  TIterator *fItTrackInputArray; //!
-
   TIterator *fItJetInputArray; //!
 
   const TObjArray *fParticleInputArray; //!
 
-  const TObjArray *fTrackInputArray; //!
+  DelphesNeighbourIndex *fTrackIndex; //!
+
+  std::vector<DelphesNeighbourIndex::TNeighbour> fNeighbours; //!
 
   const TObjArray *fPartonInputArray; //!
 
@@ -11,6 +11,7 @@
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesFormula.h"
+#include "classes/DelphesLookupTable.h"
 
 #include "ExRootAnalysis/ExRootClassifier.h"
 #include "ExRootAnalysis/ExRootFilter.h"
@@ -22,7 +23,7 @@
 #include "TLorentzVector.h"
 #include "TMath.h"
 #include "TObjArray.h"
-#include "TProfile2D.h"
+#include "TH2.h"
 #include "TRandom3.h"
 #include "TString.h"
 
@@ -36,7 +37,8 @@ using namespace std;
 //------------------------------------------------------------------------------
 
 TrackSmearing::TrackSmearing() :
-  fD0Formula(0), fDZFormula(0), fPFormula(0), fCtgThetaFormula(0), fPhiFormula(0), fItInputArray(0)
+  fD0Formula(0), fD0Table(0), fDZFormula(0), fDZTable(0), fPFormula(0), fPTable(0),
+  fCtgThetaFormula(0), fCtgThetaTable(0), fPhiFormula(0), fPhiTable(0), fItInputArray(0)
 {
   fD0Formula = new DelphesFormula;
   fDZFormula = new DelphesFormula;
@@ -54,6 +56,45 @@ TrackSmearing::~TrackSmearing()
   if(fPFormula) delete fPFormula;
   if(fCtgThetaFormula) delete fCtgThetaFormula;
   if(fPhiFormula) delete fPhiFormula;
+  if(fD0Table) delete fD0Table;
+  if(fDZTable) delete fDZTable;
+  if(fPTable) delete fPTable;
+  if(fCtgThetaTable) delete fCtgThetaTable;
+  if(fPhiTable) delete fPhiTable;
+}
+
+//------------------------------------------------------------------------------
+
+DelphesLookupTable *TrackSmearing::LoadTable(const string &fileName, const string &histName)
+{
+  stringstream message;
+  DelphesLookupTable *table;
+  TFile *file;
+  TH2 *hist;
+
+  file = TFile::Open(fileName.c_str());
+  if(!file || file->IsZombie())
+  {
+    message << "can't open resolution file '" << fileName << "'";
+    throw runtime_error(message.str());
+  }
+
+  hist = dynamic_cast<TH2 *>(file->Get(histName.c_str()));
+  if(!hist)
+  {
+    file->Close();
+    delete file;
+    message << "can't find 2D resolution histogram '" << histName << "' in file '" << fileName << "'";
+    throw runtime_error(message.str());
+  }
+
+  table = new DelphesLookupTable;
+  table->SetHistogram(hist);
+
+  file->Close();
+  delete file;
+
+  return table;
 }
 
 //------------------------------------------------------------------------------
@@ -75,6 +116,7 @@ void TrackSmearing::Init()
     fD0ResolutionFile = GetString("D0ResolutionFile", "errors.root");
     fD0ResolutionHist = GetString("D0ResolutionHist", "d0");
     fUseD0Formula = false;
+    fD0Table = LoadTable(fD0ResolutionFile, fD0ResolutionHist);
   }
   if(string(GetString("DZResolutionFormula", "0.0")) != "0.0")
   {
@@ -86,6 +128,7 @@ void TrackSmearing::Init()
     fDZResolutionFile = GetString("DZResolutionFile", "errors.root");
     fDZResolutionHist = GetString("DZResolutionHist", "dz");
     fUseDZFormula = false;
+    fDZTable = LoadTable(fDZResolutionFile, fDZResolutionHist);
   }
   if(string(GetString("PResolutionFormula", "0.0")) != "0.0")
   {
@@ -97,6 +140,7 @@ void TrackSmearing::Init()
     fPResolutionFile = GetString("PResolutionFile", "errors.root");
     fPResolutionHist = GetString("PResolutionHist", "p");
     fUsePFormula = false;
+    fPTable = LoadTable(fPResolutionFile, fPResolutionHist);
   }
   if(string(GetString("CtgThetaResolutionFormula", "0.0")) != "0.0")
   {
@@ -108,6 +152,7 @@ void TrackSmearing::Init()
     fCtgThetaResolutionFile = GetString("CtgThetaResolutionFile", "errors.root");
     fCtgThetaResolutionHist = GetString("CtgThetaResolutionHist", "ctgTheta");
     fUseCtgThetaFormula = false;
+    fCtgThetaTable = LoadTable(fCtgThetaResolutionFile, fCtgThetaResolutionHist);
   }
   if(string(GetString("PhiResolutionFormula", "0.0")) != "0.0")
   {
@@ -119,10 +164,14 @@ void TrackSmearing::Init()
     fPhiResolutionFile = GetString("PhiResolutionFile", "errors.root");
     fPhiResolutionHist = GetString("PhiResolutionHist", "phi");
     fUsePhiFormula = false;
+    fPhiTable = LoadTable(fPhiResolutionFile, fPhiResolutionHist);
   }
 
   fApplyToPileUp = GetBool("ApplyToPileUp", true);
 
+  // interpolate the resolution maps between bin centres instead of using the bin content
+  fInterpolate = GetBool("ResolutionInterpolation", false);
+
   // import input array
 
   fInputArray = ImportArray(GetString("InputArray", "ParticlePropagator/stableParticles"));
@@ -152,22 +201,49 @@ void TrackSmearing::Finish()
 
 //------------------------------------------------------------------------------
 
+void TrackSmearing::FillErrors(Bool_t useFormula, DelphesFormula *formula, const DelphesLookupTable *table, Bool_t scaleByP, vector<Double_t> &errors)
+{
+  Int_t i, n = fCandidates.size();
+  Double_t pt, error, xmax, xlast;
+
+  errors.resize(n);
+
+  if(useFormula)
+  {
+    for(i = 0; i < n; ++i)
+    {
+      error = formula->Eval(fPT[i], fEta[i], fPhi[i], fE[i], fCandidates[i]);
+      errors[i] = scaleByP ? error * fP[i] : error;
+    }
+    return;
+  }
+
+  // tracks beyond the x axis range take the resolution of the last bin
+  xmax = table->GetXmax();
+  xlast = table->GetXLastCenter();
+
+  for(i = 0; i < n; ++i)
+  {
+    pt = fPT[i] < xmax ? fPT[i] : xlast;
+    error = fInterpolate ? table->Interpolate(pt, fAbsEta[i]) : table->GetValue(pt, fAbsEta[i]);
+    if(scaleByP) error *= fP[i];
+    errors[i] = error ? error : -1.0;
+  }
+}
+
+//------------------------------------------------------------------------------
+
 void TrackSmearing::Process()
 {
-  Int_t iCandidate = 0;
+  Int_t iCandidate = 0, i, n;
   TLorentzVector beamSpotPosition;
   Candidate *candidate, *mother;
-  Double_t pt, eta, e, m, d0, d0Error, trueD0, dz, dzError, trueDZ, p, pError, trueP, ctgTheta, ctgThetaError, trueCtgTheta, phi, phiError, truePhi;
+  Double_t pt, eta, m, d0, d0Error, trueD0, dz, dzError, trueDZ, p, pError, trueP, ctgTheta, ctgThetaError, trueCtgTheta, phi, phiError, truePhi;
   Double_t x, y, z, t, px, py, pz, theta;
   Double_t q, r;
   Double_t x_c, y_c, r_c, phi_0;
   Double_t rcu, rc2, xd, yd, zd;
   const Double_t c_light = 2.99792458E8;
-  TProfile2D *d0ErrorHist = NULL,
-             *dzErrorHist = NULL,
-             *pErrorHist = NULL,
-             *ctgThetaErrorHist = NULL,
-             *phiErrorHist = NULL;
 
   if(!fBeamSpotInputArray || fBeamSpotInputArray->GetSize() == 0)
     beamSpotPosition.SetXYZT(0.0, 0.0, 0.0, 0.0);
@@ -177,135 +253,66 @@ void TrackSmearing::Process()
     beamSpotPosition = beamSpotCandidate.Position;
   }
 
-  if(!fUseD0Formula)
-  {
-    TFile *fin = TFile::Open(fD0ResolutionFile.c_str());
-    d0ErrorHist = (TProfile2D *)fin->Get(fD0ResolutionHist.c_str());
-    d0ErrorHist->SetDirectory(0);
-    fin->Close();
-  }
-  if(!fUseDZFormula)
-  {
-    TFile *fin = TFile::Open(fDZResolutionFile.c_str());
-    dzErrorHist = (TProfile2D *)fin->Get(fDZResolutionHist.c_str());
-    dzErrorHist->SetDirectory(0);
-    fin->Close();
-  }
-  if(!fUsePFormula)
-  {
-    TFile *fin = TFile::Open(fPResolutionFile.c_str());
-    pErrorHist = (TProfile2D *)fin->Get(fPResolutionHist.c_str());
-    pErrorHist->SetDirectory(0);
-    fin->Close();
-  }
-  if(!fUseCtgThetaFormula)
-  {
-    TFile *fin = TFile::Open(fCtgThetaResolutionFile.c_str());
-    ctgThetaErrorHist = (TProfile2D *)fin->Get(fCtgThetaResolutionHist.c_str());
-    ctgThetaErrorHist->SetDirectory(0);
-    fin->Close();
-  }
-  if(!fUsePhiFormula)
-  {
-    TFile *fin = TFile::Open(fPhiResolutionFile.c_str());
-    phiErrorHist = (TProfile2D *)fin->Get(fPhiResolutionHist.c_str());
-    phiErrorHist->SetDirectory(0);
-    fin->Close();
-  }
+  // collect the kinematics of all tracks
+
+  fCandidates.clear();
+  fPT.clear();
+  fAbsEta.clear();
+  fEta.clear();
+  fPhi.clear();
+  fE.clear();
+  fP.clear();
 
   fItInputArray->Reset();
   while((candidate = static_cast<Candidate *>(fItInputArray->Next())))
   {
-
     const TLorentzVector &momentum = candidate->Momentum;
-    const TLorentzVector &position = candidate->InitialPosition;
 
-    pt = momentum.Pt();
     eta = momentum.Eta();
-    e = momentum.E();
-    m = momentum.M();
-
-    d0 = trueD0 = candidate->D0;
-    dz = trueDZ = candidate->DZ;
 
-    p = trueP = candidate->P;
-    ctgTheta = trueCtgTheta = candidate->CtgTheta;
-    phi = truePhi = candidate->Phi;
+    fCandidates.push_back(candidate);
+    fPT.push_back(momentum.Pt());
+    fEta.push_back(eta);
+    fAbsEta.push_back(TMath::Abs(eta));
+    fPhi.push_back(candidate->Phi);
+    fE.push_back(momentum.E());
+    fP.push_back(candidate->P);
+  }
 
-    if(fUseD0Formula)
-      d0Error = fD0Formula->Eval(pt, eta, phi, e, candidate);
-    else
-    {
-      Int_t xbin, ybin;
+  // look up the five resolutions, one quantity at a time
 
-      xbin = pt < d0ErrorHist->GetXaxis()->GetXmax() ? d0ErrorHist->GetXaxis()->FindBin(pt) : d0ErrorHist->GetXaxis()->GetBinCenter(d0ErrorHist->GetXaxis()->GetNbins());
-      ybin = d0ErrorHist->GetYaxis()->FindBin(TMath::Abs(eta));
-      d0Error = d0ErrorHist->GetBinContent(xbin, ybin);
-      if(!d0Error)
-        d0Error = -1.0;
-    }
-    if(d0Error < 0.0)
-      continue;
+  FillErrors(fUseD0Formula, fD0Formula, fD0Table, kFALSE, fD0Error);
+  FillErrors(fUseDZFormula, fDZFormula, fDZTable, kFALSE, fDZError);
+  FillErrors(fUsePFormula, fPFormula, fPTable, kTRUE, fPError);
+  FillErrors(fUseCtgThetaFormula, fCtgThetaFormula, fCtgThetaTable, kFALSE, fCtgThetaError);
+  FillErrors(fUsePhiFormula, fPhiFormula, fPhiTable, kFALSE, fPhiError);
 
-    if(fUseDZFormula)
-      dzError = fDZFormula->Eval(pt, eta, phi, e, candidate);
-    else
-    {
-      Int_t xbin, ybin;
+  // smear the tracks in their original order
 
-      xbin = pt < dzErrorHist->GetXaxis()->GetXmax() ? dzErrorHist->GetXaxis()->FindBin(pt) : dzErrorHist->GetXaxis()->GetBinCenter(dzErrorHist->GetXaxis()->GetNbins());
-      ybin = dzErrorHist->GetYaxis()->FindBin(TMath::Abs(eta));
-      dzError = dzErrorHist->GetBinContent(xbin, ybin);
-      if(!dzError)
-        dzError = -1.0;
-    }
-    if(dzError < 0.0)
-      continue;
+  n = fCandidates.size();
+  for(i = 0; i < n; ++i)
+  {
+    candidate = fCandidates[i];
 
-    if(fUsePFormula)
-      pError = fPFormula->Eval(pt, eta, phi, e, candidate) * p;
-    else
-    {
-      Int_t xbin, ybin;
+    d0Error = fD0Error[i];
+    dzError = fDZError[i];
+    pError = fPError[i];
+    ctgThetaError = fCtgThetaError[i];
+    phiError = fPhiError[i];
 
-      xbin = pt < pErrorHist->GetXaxis()->GetXmax() ? pErrorHist->GetXaxis()->FindBin(pt) : pErrorHist->GetXaxis()->GetBinCenter(pErrorHist->GetXaxis()->GetNbins());
-      ybin = pErrorHist->GetYaxis()->FindBin(TMath::Abs(eta));
-      pError = pErrorHist->GetBinContent(xbin, ybin) * p;
-      if(!pError)
-        pError = -1.0;
-    }
-    if(pError < 0.0)
+    if(d0Error < 0.0 || dzError < 0.0 || pError < 0.0 || ctgThetaError < 0.0 || phiError < 0.0)
       continue;
 
-    if(fUseCtgThetaFormula)
-      ctgThetaError = fCtgThetaFormula->Eval(pt, eta, phi, e, candidate);
-    else
-    {
-      Int_t xbin, ybin;
+    const TLorentzVector &position = candidate->InitialPosition;
 
-      xbin = pt < ctgThetaErrorHist->GetXaxis()->GetXmax() ? ctgThetaErrorHist->GetXaxis()->FindBin(pt) : ctgThetaErrorHist->GetXaxis()->GetBinCenter(ctgThetaErrorHist->GetXaxis()->GetNbins());
-      ybin = ctgThetaErrorHist->GetYaxis()->FindBin(TMath::Abs(eta));
-      ctgThetaError = ctgThetaErrorHist->GetBinContent(xbin, ybin);
-      if(!ctgThetaError)
-        ctgThetaError = -1.0;
-    }
-    if(ctgThetaError < 0.0)
-      continue;
+    m = candidate->Momentum.M();
 
-    if(fUsePhiFormula)
-      phiError = fPhiFormula->Eval(pt, eta, phi, e, candidate);
-    else
-    {
-      Int_t xbin, ybin;
+    d0 = trueD0 = candidate->D0;
+    dz = trueDZ = candidate->DZ;
 
-      xbin = pt < phiErrorHist->GetXaxis()->GetXmax() ? phiErrorHist->GetXaxis()->FindBin(pt) : phiErrorHist->GetXaxis()->GetBinCenter(phiErrorHist->GetXaxis()->GetNbins());
-      ybin = phiErrorHist->GetYaxis()->FindBin(TMath::Abs(eta));
-      phiError = phiErrorHist->GetBinContent(xbin, ybin);
-      if(!phiError)
-        phiError = -1.0;
-    }
-    if(phiError < 0.0)
-      continue;
+    p = trueP = candidate->P;
+    ctgTheta = trueCtgTheta = candidate->CtgTheta;
+    phi = truePhi = candidate->Phi;
 
     if(fApplyToPileUp || !candidate->IsPU)
     {
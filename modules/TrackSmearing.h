@@ -13,9 +13,13 @@
 
 #include "classes/DelphesModule.h"
 
+#include <vector>
+
 class TIterator;
 class TObjArray;
+class Candidate;
 class DelphesFormula;
+class DelphesLookupTable;
 
 class TrackSmearing: public DelphesModule
 {
@@ -30,34 +34,44 @@ public:
 private:
   Double_t ptError(const Double_t, const Double_t, const Double_t, const Double_t);
 
+  DelphesLookupTable *LoadTable(const std::string &fileName, const std::string &histName);
+
+  void FillErrors(Bool_t useFormula, DelphesFormula *formula, const DelphesLookupTable *table, Bool_t scaleByP, std::vector<Double_t> &errors);
+
   Double_t fBz;
 
   DelphesFormula *fD0Formula; //!
   std::string fD0ResolutionFile;
   std::string fD0ResolutionHist;
   Bool_t fUseD0Formula;
+  DelphesLookupTable *fD0Table; //!
 
   DelphesFormula *fDZFormula; //!
   std::string fDZResolutionFile;
   std::string fDZResolutionHist;
   Bool_t fUseDZFormula;
+  DelphesLookupTable *fDZTable; //!
 
   DelphesFormula *fPFormula; //!
   std::string fPResolutionFile;
   std::string fPResolutionHist;
   Bool_t fUsePFormula;
+  DelphesLookupTable *fPTable; //!
 
   DelphesFormula *fCtgThetaFormula; //!
   std::string fCtgThetaResolutionFile;
   std::string fCtgThetaResolutionHist;
   Bool_t fUseCtgThetaFormula;
+  DelphesLookupTable *fCtgThetaTable; //!
 
   DelphesFormula *fPhiFormula; //!
   std::string fPhiResolutionFile;
   std::string fPhiResolutionHist;
   Bool_t fUsePhiFormula;
+  DelphesLookupTable *fPhiTable; //!
 
   Bool_t fApplyToPileUp;
+  Bool_t fInterpolate;
 
   TIterator *fItInputArray; //!
 
@@ -66,6 +80,11 @@ private:
 
   TObjArray *fOutputArray; //!
 
+  // tracks of the current event and their resolutions, filled quantity by quantity
+  std::vector<Candidate *> fCandidates; //!
+  std::vector<Double_t> fPT, fAbsEta, fEta, fPhi, fE, fP; //!
+  std::vector<Double_t> fD0Error, fDZError, fPError, fCtgThetaError, fPhiError; //!
+
   ClassDef(TrackSmearing, 1)
 };
 
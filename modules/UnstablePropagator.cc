@@ -30,6 +30,7 @@
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesFormula.h"
+#include "classes/DelphesPropagator.h"
 
 #include "ExRootAnalysis/ExRootClassifier.h"
 #include "ExRootAnalysis/ExRootFilter.h"
@@ -53,14 +54,16 @@ using namespace std;
 //------------------------------------------------------------------------------
 
 UnstablePropagator::UnstablePropagator() :
-  fItInputArray(0)
+  fPropagator(0), fItInputArray(0)
 {
+  fPropagator = new DelphesPropagator;
 }
 
 //------------------------------------------------------------------------------
 
 UnstablePropagator::~UnstablePropagator()
 {
+  if(fPropagator) delete fPropagator;
 }
 
 //------------------------------------------------------------------------------
@@ -87,6 +90,10 @@ void UnstablePropagator::Init()
 
   fRadiusMax = GetDouble("RadiusMax", fRadius);
   fHalfLengthMax = GetDouble("HalfLengthMax", fHalfLength);
+
+  fPropagator->SetBz(fBz);
+  fPropagator->SetCylinder(fRadius, fHalfLength);
+
   // import array with output from filter/classifier module
 
   fInputArray = ImportArray(GetString("InputArray", "Delphes/allParticles"));
@@ -296,15 +303,10 @@ void UnstablePropagator::PropagateAndUpdateChain(TString prefix, Candidate *cand
 TLorentzVector UnstablePropagator::PropagatedPosition(Candidate *candidate)
 {
 
-  TLorentzVector particlePosition, particleMomentum, beamSpotPosition;
-  Double_t px, py, pz, pt, pt2, e, q;
-  Double_t x, y, z, t, r;
-  Double_t x_c, y_c, r_c, phi_0;
-  Double_t x_t, y_t, z_t, r_t, phi_t;
-  Double_t gammam, omega;
-  Double_t l;
-  Double_t vz;
+  TLorentzVector particlePosition, particleMomentum;
+  Double_t x, y, z;
   Double_t tof, lof;
+  Int_t index;
 
   const Double_t c_light = 2.99792458E8;
 
@@ -315,90 +317,23 @@ TLorentzVector UnstablePropagator::PropagatedPosition(Candidate *candidate)
   y = particlePosition.Y() * 1.0E-3;
   z = particlePosition.Z() * 1.0E-3;
 
-  q = candidate->Charge;
-
-  px = particleMomentum.Px();
-  py = particleMomentum.Py();
-  pz = particleMomentum.Pz();
-  pt = particleMomentum.Pt();
-  pt2 = particleMomentum.Perp2();
-  e = particleMomentum.E();
-
   // propagation flight and time of flight
   lof = candidate->L * 1.0E-3; // in meters
   tof = lof/(particleMomentum.Beta() * c_light); // in seconds
 
-  //if (fDebug) cout << "propagating from : "<<x<<", "<<y<<", "<<z<<",  lof:"<<lof<<", tof: "<<tof<<endl;
-
   if(TMath::Hypot(x, y) > fRadius || TMath::Abs(z) > fHalfLength)
   {
     return particlePosition;
   }
 
-  // neutral propagation
-  else if(TMath::Abs(q) < 1.0E-9 || TMath::Abs(fBz) < 1.0E-9)
-  {
-    // solve pt2*t^2 + 2*(px*x + py*y)*t - (fRadius2 - x*x - y*y) = 0
-
-    /*
-    tmp = px * y - py * x;
-    t_r = (TMath::Sqrt(pt2 * fRadius2 - tmp * tmp) - px * x - py * y) / pt2;
-
-    t_z = (TMath::Sign(fHalfLength, pz) - z) / pz;
+  // TODO: check that l and t within cilinder
+  fPropagator->Clear();
+  index = fPropagator->Add(particlePosition, particleMomentum, candidate->Charge, tof);
+  fPropagator->PropagateFlightTime();
 
-    t = TMath::Min(t_r, t_z);
-    */
-
-    // TODO: check that l and t within cilinder
-    // TODO: convert time properly in proper units
-    t =  c_light * tof / e ;
-    x_t = x + px * t;
-    y_t = y + py * t;
-    z_t = z + pz * t;
-    l = TMath::Sqrt((x_t - x) * (x_t - x) + (y_t - y) * (y_t - y) + (z_t - z) * (z_t - z));
-    //if (fDebug) cout << "propagated neutral length: "<<l<<endl;
-    particlePosition.SetXYZT(x_t * 1.0E3, y_t * 1.0E3, z_t * 1.0E3, particlePosition.T() + t * e * 1.0E3);
-
-  }
-  else
+  if(fPropagator->IsValid(index))
   {
-
-    // 1. initial transverse momentum p_{T0}: Part->pt
-    //    initial transverse momentum direction phi_0 = -atan(p_{X0} / p_{Y0})
-    //    relativistic gamma: gamma = E / mc^2; gammam = gamma * m
-    //    gyration frequency omega = q * Bz / (gammam)
-    //    helix radius r = p_{T0} / (omega * gammam)
-
-    gammam = e * 1.0E9 / (c_light * c_light); // gammam in [eV/c^2]
-    omega = q * fBz / gammam; // omega is here in [89875518/s]
-    r = pt / (q * fBz) * 1.0E9 / c_light; // in [m]
-
-    phi_0 = TMath::ATan2(py, px); // [rad] in [-pi, pi]
-
-    // 2. helix axis coordinates
-    x_c = x + r * TMath::Sin(phi_0);
-    y_c = y - r * TMath::Cos(phi_0);
-    r_c = TMath::Hypot(x_c, y_c);
-
-    vz = pz * c_light / e;
-
-    // 3. position in terms of x(t), y(t), z(t)
-
-    t = tof; // in seconds
-    phi_t = phi_0 - omega * t;
-    x_t = x_c - r * TMath::Sin(phi_t);
-    y_t = y_c + r * TMath::Cos(phi_t);
-    z_t = z + vz * t;
-    r_t = TMath::Hypot(x_t, y_t);
-
-    // lenght of the path from production to tracker
-    l = t * TMath::Hypot(vz, r * omega);
-    //if (fDebug) cout << "propagated to: X: "<<x_t<<" Y: "<<y_t<<" Z: "<<z_t<<"  length: "<<l<<endl;
-
-    if(r_t > 0.0)
-    {
-      particlePosition.SetXYZT(x_t * 1.0E3, y_t * 1.0E3, z_t * 1.0E3, particlePosition.T() + t * c_light * 1.0E3);
-    }
+    particlePosition.SetXYZT(fPropagator->GetX(index), fPropagator->GetY(index), fPropagator->GetZ(index), particlePosition.T() + fPropagator->GetDT(index));
   }
 
   return particlePosition;
@@ -34,6 +34,7 @@ class TClonesArray;
 class TIterator;
 class TLorentzVector;
 class Candidate;
+class DelphesPropagator;
 
 class UnstablePropagator: public DelphesModule
 {
@@ -51,6 +52,9 @@ private:
   Double_t fLmin; // minimum
 
   Bool_t fDebug;
+
+  DelphesPropagator *fPropagator; //!
+
   TIterator *fItInputArray; //!
 
   const TObjArray *fInputArray; //!
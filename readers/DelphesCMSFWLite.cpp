@@ -412,7 +412,7 @@ int main(int argc, char *argv[])
 
           firstEvent = kFALSE;
 
-          treeWriter->Fill();
+          if(modularDelphes->IsEventWritable()) treeWriter->Fill();
 
           modularDelphes->Clear();
           treeWriter->Clear();
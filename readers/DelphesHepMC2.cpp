@@ -19,6 +19,7 @@
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
+#include <vector>
 
 #include <signal.h>
 
@@ -33,8 +34,10 @@
 #include "TStopwatch.h"
 
 #include "classes/DelphesClasses.h"
+#include "classes/DelphesEventIndex.h"
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesHepMC2Reader.h"
+#include "classes/DelphesInputFile.h"
 #include "modules/Delphes.h"
 
 #include "ExRootAnalysis/ExRootProgressBar.h"
@@ -58,18 +61,26 @@ int main(int argc, char *argv[])
 {
   char appName[] = "DelphesHepMC2";
   stringstream message;
+  DelphesInputFile input;
   FILE *inputFile = 0;
   TFile *outputFile = 0;
   TStopwatch readStopWatch, procStopWatch;
   ExRootTreeWriter *treeWriter = 0;
-  ExRootTreeBranch *branchEvent = 0, *branchWeight = 0;
   ExRootConfReader *confReader = 0;
-  Delphes *modularDelphes = 0;
+  Delphes *modularDelphes = 0, *source;
+  TObjArray *configFileNames = 0, *outputFileNames = 0;
+  vector<TFile *> outputFiles;
+  vector<ExRootTreeWriter *> treeWriters;
+  vector<ExRootTreeBranch *> branchEvents, branchWeights;
+  vector<ExRootConfReader *> confReaders;
+  vector<Delphes *> chains;
   DelphesFactory *factory = 0;
   TObjArray *stableParticleOutputArray = 0, *allParticleOutputArray = 0, *partonOutputArray = 0;
   DelphesHepMC2Reader *reader = 0;
-  Int_t i, maxEvents, skipEvents;
-  Long64_t length, eventCounter;
+  DelphesEventIndex *eventIndex = 0;
+  Int_t i, maxEvents, skipEvents, readAheadEvents;
+  Int_t j, k, shared, maxShared, chainsSize;
+  Long64_t length, eventCounter, skippedEvents;
 
   if(argc < 3)
   {
@@ -80,6 +91,9 @@ int main(int argc, char *argv[])
     cout << " output_file - output file in ROOT format," << endl;
     cout << " input_file(s) - input file(s) in HepMC format," << endl;
     cout << " with no input_file, or when input_file is -, read standard input." << endl;
+    cout << " input files compressed with gzip, zstd, xz or lz4 are decompressed on the fly." << endl;
+    cout << " with comma-separated lists of config_files and output_files, all configurations" << endl;
+    cout << " are run over the same input and their identical leading modules are executed once." << endl;
     return 1;
   }
 
@@ -93,24 +107,53 @@ int main(int argc, char *argv[])
 
   try
   {
-    outputFile = TFile::Open(argv[2], "CREATE");
+    configFileNames = TString(argv[1]).Tokenize(",");
+    outputFileNames = TString(argv[2]).Tokenize(",");
 
-    if(outputFile == NULL)
+    if(configFileNames->GetEntriesFast() != outputFileNames->GetEntriesFast())
     {
-      message << "can't create output file " << argv[2];
-      throw runtime_error(message.str());
+      throw runtime_error("numbers of configuration files and output files differ");
     }
 
-    treeWriter = new ExRootTreeWriter(outputFile, "Delphes");
+    // one chain of modules per configuration file, each writing its own output file
 
-    branchEvent = treeWriter->NewBranch("Event", HepMCEvent::Class());
-    branchWeight = treeWriter->NewBranch("Weight", Weight::Class());
+    chainsSize = configFileNames->GetEntriesFast();
+    for(j = 0; j < chainsSize; ++j)
+    {
+      outputFile = TFile::Open(outputFileNames->At(j)->GetName(), "CREATE");
+
+      if(outputFile == NULL)
+      {
+        message << "can't create output file " << outputFileNames->At(j)->GetName();
+        throw runtime_error(message.str());
+      }
+
+      outputFiles.push_back(outputFile);
+
+      treeWriter = new ExRootTreeWriter(outputFile, "Delphes");
+      treeWriters.push_back(treeWriter);
 
-    confReader = new ExRootConfReader;
-    confReader->ReadFile(argv[1]);
+      branchEvents.push_back(treeWriter->NewBranch("Event", HepMCEvent::Class()));
+      branchWeights.push_back(treeWriter->NewBranch("Weight", Weight::Class()));
+
+      confReader = new ExRootConfReader;
+      confReaders.push_back(confReader);
+      confReader->ReadFile(configFileNames->At(j)->GetName());
+
+      modularDelphes = new Delphes("Delphes");
+      chains.push_back(modularDelphes);
+      modularDelphes->SetConfReader(confReader);
+      modularDelphes->SetTreeWriter(treeWriter);
+    }
+
+    // the input and the event selection are configured by the first configuration file
+
+    confReader = confReaders[0];
+    modularDelphes = chains[0];
 
     maxEvents = confReader->GetInt("::MaxEvents", 0);
     skipEvents = confReader->GetInt("::SkipEvents", 0);
+    readAheadEvents = confReader->GetInt("::ReadAheadEvents", 0);
 
     if(maxEvents < 0)
     {
@@ -122,9 +165,10 @@ int main(int argc, char *argv[])
       throw runtime_error("SkipEvents must be zero or positive");
     }
 
-    modularDelphes = new Delphes("Delphes");
-    modularDelphes->SetConfReader(confReader);
-    modularDelphes->SetTreeWriter(treeWriter);
+    if(readAheadEvents < 0)
+    {
+      throw runtime_error("ReadAheadEvents must be zero or positive");
+    }
 
     factory = modularDelphes->GetFactory();
     allParticleOutputArray = modularDelphes->ExportArray("allParticles");
@@ -132,9 +176,35 @@ int main(int argc, char *argv[])
     partonOutputArray = modularDelphes->ExportArray("partons");
 
     reader = new DelphesHepMC2Reader;
+    reader->SetReadAhead(readAheadEvents);
+
+    if(confReader->GetBool("::EventIndex", false))
+    {
+      eventIndex = new DelphesEventIndex("E");
+    }
 
     modularDelphes->InitTask();
 
+    // the other chains reuse the input arrays and the longest
+    // identical sequence of leading modules of a previous chain
+
+    for(j = 1; j < chainsSize; ++j)
+    {
+      source = chains[0];
+      maxShared = 0;
+      for(k = 0; k < j; ++k)
+      {
+        shared = chains[j]->GetNumberOfSharedModules(chains[k]);
+        if(shared > maxShared)
+        {
+          source = chains[k];
+          maxShared = shared;
+        }
+      }
+      chains[j]->SetSource(source);
+      chains[j]->InitTask();
+    }
+
     i = 3;
     do
     {
@@ -143,40 +213,43 @@ int main(int argc, char *argv[])
       if(i == argc || strncmp(argv[i], "-", 2) == 0)
       {
         cout << "** Reading standard input" << endl;
-        inputFile = stdin;
-        length = -1;
+        inputFile = input.Open("-");
       }
       else
       {
         cout << "** Reading " << argv[i] << endl;
-        inputFile = fopen(argv[i], "r");
-
-        if(inputFile == NULL)
-        {
-          message << "can't open " << argv[i];
-          throw runtime_error(message.str());
-        }
-
-        fseek(inputFile, 0L, SEEK_END);
-        length = ftello(inputFile);
-        fseek(inputFile, 0L, SEEK_SET);
+        inputFile = input.Open(argv[i]);
 
-        if(length <= 0)
+        if(input.GetLength() <= 0)
         {
-          fclose(inputFile);
+          input.Close();
           ++i;
           continue;
         }
       }
 
+      length = input.GetLength();
+
+      // jump to the first selected event using the event index
+
+      skippedEvents = 0;
+      if(eventIndex && inputFile != stdin && !input.IsCompressed() && skipEvents > 0)
+      {
+        eventIndex->Open(inputFile, argv[i]);
+        skippedEvents = eventIndex->Seek(inputFile, skipEvents);
+      }
+
       reader->SetInputFile(inputFile);
 
       ExRootProgressBar progressBar(length);
 
       // Loop over all objects
-      eventCounter = 0;
-      treeWriter->Clear();
-      modularDelphes->Clear();
+      eventCounter = skippedEvents;
+      for(j = 0; j < chainsSize; ++j)
+      {
+        treeWriters[j]->Clear();
+        chains[j]->Clear();
+      }
       reader->Clear();
       readStopWatch.Start();
       while((maxEvents <= 0 || eventCounter - skipEvents < maxEvents) && reader->ReadBlock(factory, allParticleOutputArray, stableParticleOutputArray, partonOutputArray) && !interrupted)
@@ -189,52 +262,75 @@ int main(int argc, char *argv[])
 
           if(eventCounter > skipEvents)
           {
-            procStopWatch.Start();
-            modularDelphes->ProcessTask();
-            procStopWatch.Stop();
+            // each chain is written before the next one modifies the shared candidates
 
-            reader->AnalyzeEvent(branchEvent, eventCounter, &readStopWatch, &procStopWatch);
-            reader->AnalyzeWeight(branchWeight);
+            for(j = 0; j < chainsSize; ++j)
+            {
+              procStopWatch.Start();
+              chains[j]->ProcessTask();
+              procStopWatch.Stop();
 
-            treeWriter->Fill();
+              reader->AnalyzeEvent(branchEvents[j], eventCounter, &readStopWatch, &procStopWatch);
+              reader->AnalyzeWeight(branchWeights[j]);
 
-            treeWriter->Clear();
+              if(chains[j]->IsEventWritable()) treeWriters[j]->Fill();
+
+              treeWriters[j]->Clear();
+            }
           }
 
-          modularDelphes->Clear();
+          // the candidates of the first chain are shared with all the others
+
+          for(j = 0; j < chainsSize; ++j)
+          {
+            chains[j]->Clear();
+          }
           reader->Clear();
 
           readStopWatch.Start();
         }
-        progressBar.Update(ftello(inputFile), eventCounter);
+        progressBar.Update(input.GetPosition(), eventCounter);
       }
 
-      fseek(inputFile, 0L, SEEK_END);
-      progressBar.Update(ftello(inputFile), eventCounter, kTRUE);
+      reader->StopReadAhead();
+
+      progressBar.Update(input.GetLength(), eventCounter, kTRUE);
       progressBar.Finish();
 
-      if(inputFile != stdin) fclose(inputFile);
+      input.Close();
 
       ++i;
     } while(i < argc);
 
-    modularDelphes->FinishTask();
-    treeWriter->Write();
+    for(j = 0; j < chainsSize; ++j)
+    {
+      chains[j]->FinishTask();
+      treeWriters[j]->Write();
+    }
 
     cout << "** Exiting..." << endl;
 
+    if(eventIndex) delete eventIndex;
     delete reader;
-    delete modularDelphes;
-    delete confReader;
-    delete treeWriter;
-    delete outputFile;
+    for(j = chainsSize - 1; j >= 0; --j)
+    {
+      delete chains[j];
+      delete confReaders[j];
+      delete treeWriters[j];
+      delete outputFiles[j];
+    }
+    delete configFileNames;
+    delete outputFileNames;
 
     return 0;
   }
   catch(runtime_error &e)
   {
-    if(treeWriter) delete treeWriter;
-    if(outputFile) delete outputFile;
+    for(j = 0; j < Int_t(treeWriters.size()); ++j)
+    {
+      delete treeWriters[j];
+      delete outputFiles[j];
+    }
     cerr << "** ERROR: " << e.what() << endl;
     return 1;
   }
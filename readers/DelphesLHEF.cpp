@@ -33,7 +33,9 @@
 #include "TStopwatch.h"
 
 #include "classes/DelphesClasses.h"
+#include "classes/DelphesEventIndex.h"
 #include "classes/DelphesFactory.h"
+#include "classes/DelphesInputFile.h"
 #include "classes/DelphesLHEFReader.h"
 #include "modules/Delphes.h"
 
@@ -58,6 +60,7 @@ int main(int argc, char *argv[])
 {
   char appName[] = "DelphesLHEF";
   stringstream message;
+  DelphesInputFile input;
   FILE *inputFile = 0;
   TFile *outputFile = 0;
   TStopwatch readStopWatch, procStopWatch;
@@ -68,7 +71,9 @@ int main(int argc, char *argv[])
   DelphesFactory *factory = 0;
   TObjArray *stableParticleOutputArray = 0, *allParticleOutputArray = 0, *partonOutputArray = 0;
   DelphesLHEFReader *reader = 0;
+  DelphesEventIndex *eventIndex = 0;
   Int_t i, maxEvents, skipEvents;
+  Bool_t weightArray;
   Long64_t length, eventCounter;
 
   if(argc < 3)
@@ -80,6 +85,7 @@ int main(int argc, char *argv[])
     cout << " output_file - output file in ROOT format," << endl;
     cout << " input_file(s) - input file(s) in LHEF format," << endl;
     cout << " with no input_file, or when input_file is -, read standard input." << endl;
+    cout << " input files compressed with gzip, zstd, xz or lz4 are decompressed on the fly." << endl;
     return 1;
   }
 
@@ -104,7 +110,6 @@ int main(int argc, char *argv[])
     treeWriter = new ExRootTreeWriter(outputFile, "Delphes");
 
     branchEvent = treeWriter->NewBranch("Event", LHEFEvent::Class());
-    branchWeight = treeWriter->NewBranch("Weight", LHEFWeight::Class());
 
     confReader = new ExRootConfReader;
     confReader->ReadFile(argv[1]);
@@ -112,6 +117,16 @@ int main(int argc, char *argv[])
     maxEvents = confReader->GetInt("::MaxEvents", 0);
     skipEvents = confReader->GetInt("::SkipEvents", 0);
 
+    // switch to write the weights of each event as a single
+    // fixed-size array instead of a branch of LHEFWeight objects
+
+    weightArray = confReader->GetBool("::WeightArray", false);
+
+    if(!weightArray)
+    {
+      branchWeight = treeWriter->NewBranch("Weight", LHEFWeight::Class());
+    }
+
     if(maxEvents < 0)
     {
       throw runtime_error("MaxEvents must be zero or positive");
@@ -133,6 +148,11 @@ int main(int argc, char *argv[])
 
     reader = new DelphesLHEFReader;
 
+    if(confReader->GetBool("::EventIndex", false))
+    {
+      eventIndex = new DelphesEventIndex("<event>", false);
+    }
+
     modularDelphes->InitTask();
 
     i = 3;
@@ -143,32 +163,23 @@ int main(int argc, char *argv[])
       if(i == argc || strncmp(argv[i], "-", 2) == 0)
       {
         cout << "** Reading standard input" << endl;
-        inputFile = stdin;
-        length = -1;
+        inputFile = input.Open("-");
       }
       else
       {
         cout << "** Reading " << argv[i] << endl;
-        inputFile = fopen(argv[i], "r");
-
-        if(inputFile == NULL)
-        {
-          message << "can't open " << argv[i];
-          throw runtime_error(message.str());
-        }
-
-        fseek(inputFile, 0L, SEEK_END);
-        length = ftello(inputFile);
-        fseek(inputFile, 0L, SEEK_SET);
+        inputFile = input.Open(argv[i]);
 
-        if(length <= 0)
+        if(input.GetLength() <= 0)
         {
-          fclose(inputFile);
+          input.Close();
           ++i;
           continue;
         }
       }
 
+      length = input.GetLength();
+
       reader->SetInputFile(inputFile);
 
       ExRootProgressBar progressBar(length);
@@ -178,6 +189,18 @@ int main(int argc, char *argv[])
       treeWriter->Clear();
       modularDelphes->Clear();
       reader->Clear();
+
+      // read the header preceding the first event and
+      // jump to the first selected event using the event index
+
+      if(eventIndex && inputFile != stdin && !input.IsCompressed() && skipEvents > 0)
+      {
+        eventIndex->Open(inputFile, argv[i]);
+        while(reader->GetPosition() < eventIndex->GetOffset(0) && reader->ReadBlock(factory, allParticleOutputArray, stableParticleOutputArray, partonOutputArray)) continue;
+        eventCounter = eventIndex->Seek(inputFile, skipEvents);
+        reader->SetInputFile(inputFile);
+      }
+
       readStopWatch.Start();
       while((maxEvents <= 0 || eventCounter - skipEvents < maxEvents) && reader->ReadBlock(factory, allParticleOutputArray, stableParticleOutputArray, partonOutputArray) && !interrupted)
       {
@@ -195,9 +218,16 @@ int main(int argc, char *argv[])
             procStopWatch.Stop();
 
             reader->AnalyzeEvent(branchEvent, eventCounter, &readStopWatch, &procStopWatch);
-            reader->AnalyzeWeight(branchWeight);
+            if(weightArray)
+            {
+              reader->AnalyzeWeightArray(treeWriter);
+            }
+            else
+            {
+              reader->AnalyzeWeight(branchWeight);
+            }
 
-            treeWriter->Fill();
+            if(modularDelphes->IsEventWritable()) treeWriter->Fill();
 
             treeWriter->Clear();
           }
@@ -207,14 +237,13 @@ int main(int argc, char *argv[])
 
           readStopWatch.Start();
         }
-        progressBar.Update(ftello(inputFile), eventCounter);
+        progressBar.Update(input.GetPosition(), eventCounter);
       }
 
-      fseek(inputFile, 0L, SEEK_END);
-      progressBar.Update(ftello(inputFile), eventCounter, kTRUE);
+      progressBar.Update(input.GetLength(), eventCounter, kTRUE);
       progressBar.Finish();
 
-      if(inputFile != stdin) fclose(inputFile);
+      input.Close();
 
       ++i;
     } while(i < argc);
@@ -224,6 +253,7 @@ int main(int argc, char *argv[])
 
     cout << "** Exiting..." << endl;
 
+    if(eventIndex) delete eventIndex;
     delete reader;
     delete modularDelphes;
     delete confReader;
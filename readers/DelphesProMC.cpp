@@ -277,7 +277,7 @@ int main(int argc, char *argv[])
         modularDelphes->ProcessTask();
         procStopWatch.Stop();
 
-        treeWriter->Fill();
+        if(modularDelphes->IsEventWritable()) treeWriter->Fill();
 
         modularDelphes->Clear();
         treeWriter->Clear();
@@ -421,7 +421,7 @@ int main(int argc, char *argv[])
       }
 #endif
       
-      treeWriter->Fill();
+      if(modularDelphes->IsEventWritable()) treeWriter->Fill();
 
       treeWriter->Clear();
       modularDelphes->Clear();
@@ -54,6 +54,24 @@ using namespace std;
 
 //---------------------------------------------------------------------------
 
+// stored candidates are referenced by their position in the restored branch,
+// generated particles by -1 - their position in the Particle branch
+
+static Candidate *GetRestoredCandidate(Int_t reference, const vector<Candidate *> &candidates, TObjArray *particles)
+{
+  stringstream message;
+  if(reference >= 0 && reference < Int_t(candidates.size()))
+  {
+    return candidates[reference];
+  }
+  else if(reference < 0 && -1 - reference < particles->GetEntriesFast())
+  {
+    return static_cast<Candidate *>(particles->At(-1 - reference));
+  }
+  message << "invalid reference " << reference << " in restored arrays";
+  throw runtime_error(message.str());
+}
+
 //---------------------------------------------------------------------------
 
 static bool interrupted = false;
@@ -71,7 +89,9 @@ int main(int argc, char *argv[])
   stringstream message;
   TFile *inputFile = 0;
   TFile *outputFile = 0;
+  TChain *inputChain = 0;
   TStopwatch eventStopWatch;
+  ExRootTreeReader *treeReader = 0;
   ExRootTreeWriter *treeWriter = 0;
   ExRootTreeBranch *branchEvent = 0;
   ExRootConfReader *confReader = 0;
@@ -80,13 +100,21 @@ int main(int argc, char *argv[])
   GenParticle *gen;
   HepMCEvent *element, *eve;
   Candidate *candidate;
+  TBranch *branch;
+  TString restoredBranchName, restoredParticleArrayName;
+  TClonesArray *branchParticle = 0, *branchHepMCEvent = 0, *branchRestored = 0;
+  vector<Int_t> *restoredLinks = 0;
+  vector<vector<Int_t> *> restoredIndices;
+  vector<TObjArray *> restoredArrays;
+  vector<Candidate *> restoredCandidates;
+  vector<Int_t>::const_iterator itIndices;
   Int_t pdgCode;
 
   const Double_t c_light = 2.99792458E8;
 
   TObjArray *allParticleOutputArray = 0, *stableParticleOutputArray = 0, *partonOutputArray = 0;
-  Int_t i;
-  Long64_t eventCounter, numberOfEvents;
+  Int_t i, j, k, size, position;
+  Long64_t entry, eventCounter, numberOfEvents;
 
   if(argc < 4)
   {
@@ -96,6 +124,10 @@ int main(int argc, char *argv[])
     cout << " config_file - configuration file in Tcl format," << endl;
     cout << " output_file - output file in ROOT format," << endl;
     cout << " input_file(s) - input file(s) in ROOT format." << endl;
+    cout << " With 'set RestoreBranch <name>' in config_file, the arrays stored by" << endl;
+    cout << " an ArrayWriter module in branch <name> are read back and the modules" << endl;
+    cout << " that produced them are not run. The Particle branch must hold the" << endl;
+    cout << " ParticleInputArray of the ArrayWriter module." << endl;
     return 1;
   }
 
@@ -128,22 +160,18 @@ int main(int argc, char *argv[])
     modularDelphes->SetConfReader(confReader);
     modularDelphes->SetTreeWriter(treeWriter);
 
-    TChain *chain = new TChain("Delphes");
-
     factory = modularDelphes->GetFactory();
     allParticleOutputArray = modularDelphes->ExportArray("allParticles");
     stableParticleOutputArray = modularDelphes->ExportArray("stableParticles");
     partonOutputArray = modularDelphes->ExportArray("partons");
 
-    modularDelphes->InitTask();
-
-    for(i = 3; i < argc && !interrupted; ++i)
-    {
-      cout << "** Reading " << argv[i] << endl;
+    // all input files are read through one chain, so that the read-ahead
+    // cache spans the file boundaries
 
-      chain->Add(argv[i]);
-      ExRootTreeReader *treeReader = new ExRootTreeReader(chain);
+    inputChain = new TChain("Delphes");
 
+    for(i = 3; i < argc; ++i)
+    {
       inputFile = TFile::Open(argv[i]);
 
       if(inputFile == NULL)
@@ -152,113 +180,208 @@ int main(int argc, char *argv[])
         throw runtime_error(message.str());
       }
 
-      numberOfEvents = treeReader->GetEntries();
-      TClonesArray *branchParticle = treeReader->UseBranch("Particle");
-      TClonesArray *branchHepMCEvent = treeReader->UseBranch("Event");
+      inputFile->Close();
+      delete inputFile;
+
+      inputChain->Add(argv[i]);
+    }
 
-      if(numberOfEvents <= 0) continue;
+    treeReader = new ExRootTreeReader(inputChain);
 
-      // ExRootProgressBar progressBar(numberOfEvents - 1);
-      ExRootProgressBar progressBar(-1);
+    // only the branches in use are read and decompressed
 
-      // Loop over all objects
-      eventCounter = 0;
-      modularDelphes->Clear();
-      treeWriter->Clear();
-      for(Int_t entry = 0; entry < numberOfEvents && !interrupted; ++entry)
+    treeReader->SetCacheSize(confReader->GetLong("::ReadCacheSize", 100000000));
+    treeReader->SetParallelUnzip(confReader->GetBool("::ReadParallelUnzip", false));
+    treeReader->SetAsyncPrefetch(confReader->GetBool("::ReadAsyncPrefetch", false));
+
+    branchParticle = treeReader->UseBranch("Particle");
+    branchHepMCEvent = treeReader->UseBranch("Event");
+
+    if(!branchParticle || !branchHepMCEvent)
+    {
+      message << "can't access branches 'Particle' and 'Event' in the input files" << endl;
+      throw runtime_error(message.str());
+    }
+
+    // arrays stored by an ArrayWriter module in the previous run replace
+    // the output of the modules that produced them, the Particle branch
+    // must hold the ParticleInputArray of the ArrayWriter module, whose
+    // name is the title of the links branch, in the same order
+
+    restoredBranchName = confReader->GetString("::RestoreBranch", "");
+
+    if(restoredBranchName.Length() > 0)
+    {
+      branchRestored = treeReader->UseBranch(restoredBranchName);
+      restoredLinks = new vector<Int_t>;
+
+      if(!branchRestored || !treeReader->UseBranch(restoredBranchName + "_links", &restoredLinks))
       {
+        message << "can't access branch '" << restoredBranchName << "' in the input files" << endl;
+        throw runtime_error(message.str());
+      }
 
-        treeReader->ReadEntry(entry);
+      restoredParticleArrayName = inputChain->GetBranch(restoredBranchName + "_links")->GetTitle();
 
-        // -- TBC need also to include event weights --
+      for(k = 0; (branch = inputChain->GetBranch(Form("%s_array%d", restoredBranchName.Data(), k))); ++k)
+      {
+        restoredIndices.push_back(new vector<Int_t>);
+        restoredArrays.push_back(modularDelphes->RestoreArray(branch->GetTitle()));
+      }
 
-        eve = (HepMCEvent *)branchHepMCEvent->At(0);
-        element = static_cast<HepMCEvent *>(branchEvent->NewEntry());
+      for(k = 0; k < Int_t(restoredIndices.size()); ++k)
+      {
+        treeReader->UseBranch(Form("%s_array%d", restoredBranchName.Data(), k), &restoredIndices[k]);
+      }
+    }
 
-        element->Number = eventCounter;
+    modularDelphes->InitTask();
 
-        element->ProcessID = eve->ProcessID;
-        element->MPI = eve->MPI;
-        element->Weight = eve->Weight;
-        element->Scale = eve->Scale;
-        element->AlphaQED = eve->AlphaQED;
-        element->AlphaQCD = eve->AlphaQCD;
+    numberOfEvents = treeReader->GetEntries();
 
-        element->ID1 = eve->ID1;
-        element->ID2 = eve->ID2;
-        element->X1 = eve->X1;
-        element->X2 = eve->X2;
-        element->ScalePDF = eve->ScalePDF;
-        element->PDF1 = eve->PDF1;
-        element->PDF2 = eve->PDF2;
+    ExRootProgressBar progressBar(numberOfEvents - 1);
 
-        element->ReadTime = eve->ReadTime;
-        element->ProcTime = eve->ProcTime;
+    // Loop over all objects
+    eventCounter = 0;
+    modularDelphes->Clear();
+    treeWriter->Clear();
+    for(entry = 0; entry < numberOfEvents && !interrupted; ++entry)
+    {
+      treeReader->ReadEntry(entry);
 
-        for(Int_t j = 0; j < branchParticle->GetEntriesFast(); j++)
-        {
+      // -- TBC need also to include event weights --
 
-          gen = (GenParticle *)branchParticle->At(j);
-          candidate = factory->NewCandidate();
+      eve = (HepMCEvent *)branchHepMCEvent->At(0);
+      element = static_cast<HepMCEvent *>(branchEvent->NewEntry());
 
-          candidate->Momentum = gen->P4();
-          candidate->Position.SetXYZT(gen->X, gen->Y, gen->Z, gen->T * 1.0E3 * c_light);
+      element->Number = eventCounter;
 
-          candidate->PID = gen->PID;
-          candidate->Status = gen->Status;
+      element->ProcessID = eve->ProcessID;
+      element->MPI = eve->MPI;
+      element->Weight = eve->Weight;
+      element->Scale = eve->Scale;
+      element->AlphaQED = eve->AlphaQED;
+      element->AlphaQCD = eve->AlphaQCD;
 
-          candidate->M1 = gen->M1;
-          candidate->M2 = gen->M2;
+      element->ID1 = eve->ID1;
+      element->ID2 = eve->ID2;
+      element->X1 = eve->X1;
+      element->X2 = eve->X2;
+      element->ScalePDF = eve->ScalePDF;
+      element->PDF1 = eve->PDF1;
+      element->PDF2 = eve->PDF2;
 
-          candidate->D1 = gen->D1;
-          candidate->D2 = gen->D2;
+      element->ReadTime = eve->ReadTime;
+      element->ProcTime = eve->ProcTime;
 
-          candidate->Charge = gen->Charge;
-          candidate->Mass = gen->Mass;
+      for(j = 0; j < branchParticle->GetEntriesFast(); j++)
+      {
 
-          allParticleOutputArray->Add(candidate);
+        gen = (GenParticle *)branchParticle->At(j);
+        candidate = factory->NewCandidate();
 
-          pdgCode = TMath::Abs(gen->PID);
+        candidate->Momentum = gen->P4();
+        candidate->Position.SetXYZT(gen->X, gen->Y, gen->Z, gen->T * 1.0E3 * c_light);
 
-          if(gen->Status == 1)
-          {
-            stableParticleOutputArray->Add(candidate);
-          }
-          else if(pdgCode <= 5 || pdgCode == 21 || pdgCode == 15)
-          {
-            partonOutputArray->Add(candidate);
-          }
+        candidate->PID = gen->PID;
+        candidate->Status = gen->Status;
+
+        candidate->M1 = gen->M1;
+        candidate->M2 = gen->M2;
+
+        candidate->D1 = gen->D1;
+        candidate->D2 = gen->D2;
+
+        candidate->Charge = gen->Charge;
+        candidate->Mass = gen->Mass;
+
+        allParticleOutputArray->Add(candidate);
+
+        pdgCode = TMath::Abs(gen->PID);
+
+        if(gen->Status == 1)
+        {
+          stableParticleOutputArray->Add(candidate);
         }
+        else if(pdgCode <= 5 || pdgCode == 21 || pdgCode == 15)
+        {
+          partonOutputArray->Add(candidate);
+        }
+      }
 
-        modularDelphes->ProcessTask();
+      // the first link is the number of stored candidates, the restored arrays
+      // are left empty for events rejected before the ArrayWriter module,
+      // the second one is the number of particles the references point to
 
-        treeWriter->Fill();
+      size = branchRestored ? branchRestored->GetEntriesFast() : 0;
+      if(branchRestored && !restoredLinks->empty() && (*restoredLinks)[0] == size)
+      {
+        if(restoredLinks->size() < 2 || (*restoredLinks)[1] != branchParticle->GetEntriesFast())
+        {
+          message << "the arrays of branch '" << restoredBranchName << "' reference the particles of '";
+          message << restoredParticleArrayName << "', that are not the ones of the Particle branch";
+          message << " in entry " << entry << endl;
+          throw runtime_error(message.str());
+        }
 
-        modularDelphes->Clear();
-        treeWriter->Clear();
+        restoredCandidates.clear();
+        for(j = 0; j < size; ++j)
+        {
+          candidate = factory->NewCandidate();
+          static_cast<Candidate *>(branchRestored->At(j))->Copy(*candidate);
+          restoredCandidates.push_back(candidate);
+        }
+
+        position = 2;
+        for(j = 0; j < size; ++j)
+        {
+          for(i = (*restoredLinks)[position++]; i > 0; --i)
+          {
+            restoredCandidates[j]->AddCandidate(GetRestoredCandidate((*restoredLinks)[position++], restoredCandidates, allParticleOutputArray));
+          }
+        }
 
-        progressBar.Update(eventCounter, eventCounter);
-        ++eventCounter;
+        for(k = 0; k < Int_t(restoredArrays.size()); ++k)
+        {
+          for(itIndices = restoredIndices[k]->begin(); itIndices != restoredIndices[k]->end(); ++itIndices)
+          {
+            restoredArrays[k]->Add(GetRestoredCandidate(*itIndices, restoredCandidates, allParticleOutputArray));
+          }
+        }
       }
 
-      progressBar.Update(eventCounter, eventCounter, kTRUE);
-      progressBar.Finish();
+      modularDelphes->ProcessTask();
 
-      inputFile->Close();
+      if(modularDelphes->IsEventWritable()) treeWriter->Fill();
 
-      delete treeReader;
+      modularDelphes->Clear();
+      treeWriter->Clear();
+
+      progressBar.Update(eventCounter, eventCounter);
+      ++eventCounter;
     }
 
+    progressBar.Update(eventCounter, eventCounter, kTRUE);
+    progressBar.Finish();
+
     modularDelphes->FinishTask();
     treeWriter->Write();
 
     cout << "** Exiting..." << endl;
 
+    delete treeReader;
+    delete inputChain;
+
+    for(k = 0; k < Int_t(restoredIndices.size()); ++k)
+    {
+      delete restoredIndices[k];
+    }
+    if(restoredLinks) delete restoredLinks;
+
     delete modularDelphes;
     delete confReader;
     delete treeWriter;
     delete outputFile;
-    delete chain;
 
     return 0;
   }
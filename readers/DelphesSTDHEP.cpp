@@ -34,6 +34,7 @@
 
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
+#include "classes/DelphesInputFile.h"
 #include "classes/DelphesSTDHEPReader.h"
 #include "modules/Delphes.h"
 
@@ -58,6 +59,7 @@ int main(int argc, char *argv[])
 {
   char appName[] = "DelphesSTDHEP";
   stringstream message;
+  DelphesInputFile input;
   FILE *inputFile = 0;
   TFile *outputFile = 0;
   TStopwatch readStopWatch, procStopWatch;
@@ -80,6 +82,7 @@ int main(int argc, char *argv[])
     cout << " output_file - output file in ROOT format," << endl;
     cout << " input_file(s) - input file(s) in STDHEP format," << endl;
     cout << " with no input_file, or when input_file is -, read standard input." << endl;
+    cout << " input files compressed with gzip, zstd, xz or lz4 are decompressed on the fly." << endl;
     return 1;
   }
 
@@ -142,32 +145,23 @@ int main(int argc, char *argv[])
       if(i == argc || strncmp(argv[i], "-", 2) == 0)
       {
         cout << "** Reading standard input" << endl;
-        inputFile = stdin;
-        length = -1;
+        inputFile = input.Open("-");
       }
       else
       {
         cout << "** Reading " << argv[i] << endl;
-        inputFile = fopen(argv[i], "rb");
+        inputFile = input.Open(argv[i], "rb");
 
-        if(inputFile == NULL)
+        if(input.GetLength() <= 0)
         {
-          message << "can't open " << argv[i];
-          throw runtime_error(message.str());
-        }
-
-        fseek(inputFile, 0L, SEEK_END);
-        length = ftello(inputFile);
-        fseek(inputFile, 0L, SEEK_SET);
-
-        if(length <= 0)
-        {
-          fclose(inputFile);
+          input.Close();
           ++i;
           continue;
         }
       }
 
+      length = input.GetLength();
+
       reader->SetInputFile(inputFile);
 
       ExRootProgressBar progressBar(length);
@@ -194,7 +188,7 @@ int main(int argc, char *argv[])
 
             reader->AnalyzeEvent(branchEvent, eventCounter, &readStopWatch, &procStopWatch);
 
-            treeWriter->Fill();
+            if(modularDelphes->IsEventWritable()) treeWriter->Fill();
 
             treeWriter->Clear();
           }
@@ -204,14 +198,13 @@ int main(int argc, char *argv[])
 
           readStopWatch.Start();
         }
-        progressBar.Update(ftello(inputFile), eventCounter);
+        progressBar.Update(input.GetPosition(), eventCounter);
       }
 
-      fseek(inputFile, 0L, SEEK_END);
-      progressBar.Update(ftello(inputFile), eventCounter, kTRUE);
+      progressBar.Update(input.GetLength(), eventCounter, kTRUE);
       progressBar.Finish();
 
-      if(inputFile != stdin) fclose(inputFile);
+      input.Close();
 
       ++i;
     } while(i < argc);